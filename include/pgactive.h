@@ -24,6 +24,7 @@
 #include "storage/ipc.h"
 #include "storage/latch.h"
 #include "storage/lock.h"
+#include "storage/spin.h"
 #include "tcop/utility.h"
 
 #include "lib/ilist.h"
@@ -36,6 +37,7 @@
 #include "pgactive_version.h"
 #include "pgactive_compat.h"
 #include "nodes/execnodes.h"
+#include "portability/instr_time.h"
 
 /* pg_fallthrough was introduced in PG 19 (c.h) */
 #ifndef pg_fallthrough
@@ -157,7 +159,8 @@ extern shmem_request_hook_type pgactive_prev_shmem_request_hook;
  */
 typedef enum pgactiveOutputBeginFlags
 {
-	pgactive_OUTPUT_TRANSACTION_HAS_ORIGIN = 1
+	pgactive_OUTPUT_TRANSACTION_HAS_ORIGIN = 1,
+	pgactive_OUTPUT_TRANSACTION_HAS_CHANGE_COUNT = 2
 } pgactiveOutputBeginFlags;
 
 /*
@@ -200,6 +203,26 @@ typedef struct pgactiveConflictHandler
 	uint64		timeframe;
 }			pgactiveConflictHandler;
 
+/* Which generator pgactive_snowflake_id_nextval() uses */
+typedef enum pgactiveSnowflakeIdGenerator
+{
+	/* nextval() on the underlying sequence for every id */
+	pgactive_SNOWFLAKE_ID_GENERATOR_SEQUENCE,
+	/* per-sequence atomic counter in shared memory */
+	pgactive_SNOWFLAKE_ID_GENERATOR_SHMEM
+}			pgactiveSnowflakeIdGenerator;
+
+/* How a logically joining node copies table data from its upstream */
+typedef enum pgactiveInitNodeDataSyncMethod
+{
+	/* pg_dump and pg_restore of schema and data */
+	pgactive_INIT_NODE_DATA_SYNC_DUMP,
+	/* pg_dump and pg_restore of schema, parallel COPY of table data */
+	pgactive_INIT_NODE_DATA_SYNC_COPY,
+	/* pg_dump and pg_restore, table data restored while being dumped */
+	pgactive_INIT_NODE_DATA_SYNC_PIPELINE
+}			pgactiveInitNodeDataSyncMethod;
+
 /* How detailed logging of DDL locks is */
 enum pgactiveDDLLockTraceLevel
 {
@@ -249,6 +272,76 @@ typedef struct pgactiveTupleData
 	bool		changed[MaxTupleAttributeNumber];
 }			pgactiveTupleData;
 
+/*
+ * Phases of applying changes an apply worker spends its time in, see
+ * pgactive.track_apply_timing.
+ */
+typedef enum pgactiveApplyPhase
+{
+	pgactive_APPLY_PHASE_NETWORK_WAIT = 0,
+	pgactive_APPLY_PHASE_DECODE,
+	pgactive_APPLY_PHASE_LOOKUP,
+	pgactive_APPLY_PHASE_HEAP_WRITE,
+	pgactive_APPLY_PHASE_INDEX_UPDATE,
+	pgactive_APPLY_PHASE_CONFLICT,
+	pgactive_APPLY_PHASE_DDL,
+	pgactive_APPLY_PHASE_COMMIT
+}			pgactiveApplyPhase;
+
+#define pgactive_APPLY_PHASE_COUNT (pgactive_APPLY_PHASE_COMMIT + 1)
+
+extern PGDLLIMPORT const char *const pgactiveApplyPhaseNames[];
+
+/*
+ * Bucket i of an apply timing histogram counts durations of less than
+ * 2^(i+1) microseconds that didn't fit in bucket i-1; the last bucket counts
+ * everything longer.
+ */
+#define pgactive_APPLY_TIMING_BUCKETS 24
+
+typedef struct pgactiveApplyPhaseTiming
+{
+	int64		count;
+	int64		total_us;
+	int64		buckets[pgactive_APPLY_TIMING_BUCKETS];
+}			pgactiveApplyPhaseTiming;
+
+/*
+ * Time an apply worker spent in each phase. Only that worker adds to it,
+ * readers and resetters must hold the mutex.
+ */
+typedef struct pgactiveApplyTiming
+{
+	slock_t		mutex;
+	TimestampTz reset_at;
+	pgactiveApplyPhaseTiming phases[pgactive_APPLY_PHASE_COUNT];
+}			pgactiveApplyTiming;
+
+/*
+ * Progress of the remote transaction an apply worker is applying. Only that
+ * worker writes it, readers must hold the mutex. xid is invalid between
+ * transactions.
+ */
+typedef struct pgactiveApplyProgress
+{
+	slock_t		mutex;
+
+	TransactionId xid;
+	/* end of the remote commit record + 1 */
+	XLogRecPtr	commit_lsn;
+	TimestampTz committs;
+	TimestampTz started_at;
+
+	/* changes the upstream decoded for the transaction, -1 if not sent */
+	int64		changes_total;
+
+	int64		inserts;
+	int64		updates;
+	int64		deletes;
+	Oid			current_relid;
+	int64		bytes;
+}			pgactiveApplyProgress;
+
 /*
  * pgactiveApplyWorker describes a pgactive worker connection.
  *
@@ -298,8 +391,68 @@ typedef struct pgactiveApplyWorker
 
 	/* timestamp at which last change was applied */
 	TimestampTz last_applied_xact_at;
+
+	/* end of the last applied remote commit record + 1 */
+	XLogRecPtr	last_applied_lsn;
+
+	/* last remote position received from the walsender */
+	XLogRecPtr	last_received_lsn;
+
+	/* time spent in each phase of apply, if pgactive.track_apply_timing */
+	pgactiveApplyTiming timing;
+
+	/* remote transaction being applied, see pgactive_stat_progress_apply */
+	pgactiveApplyProgress progress;
 }			pgactiveApplyWorker;
 
+/*
+ * Phases of a logical join, as reported by pgactive.pgactive_join_progress.
+ */
+typedef enum pgactiveJoinPhase
+{
+	pgactive_JOIN_PHASE_NONE = 0,
+	pgactive_JOIN_PHASE_INITIALIZING,
+	pgactive_JOIN_PHASE_DUMPING,
+	pgactive_JOIN_PHASE_RESTORING_SCHEMA,
+	pgactive_JOIN_PHASE_COPYING_DATA,
+	pgactive_JOIN_PHASE_RESTORING,
+	pgactive_JOIN_PHASE_BUILDING_INDEXES,
+	pgactive_JOIN_PHASE_SYNCING_NODES,
+	pgactive_JOIN_PHASE_CATCHUP,
+	pgactive_JOIN_PHASE_CREATING_SLOTS,
+	pgactive_JOIN_PHASE_DONE
+}			pgactiveJoinPhase;
+
+extern PGDLLIMPORT const char *const pgactiveJoinPhaseNames[];
+
+/*
+ * Progress of the logical join run by a per-db worker. Only that worker
+ * writes it, readers must hold the mutex. Counters are -1 while unknown.
+ */
+typedef struct pgactiveJoinProgress
+{
+	slock_t		mutex;
+
+	pgactiveJoinPhase phase;
+	TimestampTz join_start;
+	TimestampTz phase_start;
+
+	int			tables_total;
+	int			tables_done;
+	int64		bytes_total;
+	int64		bytes_done;
+	char		current_table[2 * NAMEDATALEN + 6];
+
+	/* connections or processes moving data, and how many are doing so */
+	int			jobs_total;
+	int			jobs_busy;
+
+	/* remote LSNs of the catchup phase */
+	XLogRecPtr	catchup_start_lsn;
+	XLogRecPtr	catchup_target_lsn;
+	XLogRecPtr	catchup_lsn;
+}			pgactiveJoinProgress;
+
 /*
  * pgactivePerdbCon describes a per-database worker, a static bgworker that manages
  * pgactive for a given DB.
@@ -332,8 +485,37 @@ typedef struct pgactivePerdbWorker
 
 	/* Was the worker requested to unregister? */
 	bool		unregistered;
+
+	/* Progress of the join of this database, if any */
+	pgactiveJoinProgress join_progress;
 }			pgactivePerdbWorker;
 
+/*
+ * Decoding statistics of a walsender, since it started. Only written by the
+ * walsender itself.
+ */
+typedef struct pgactiveWalsenderStats
+{
+	/* transactions sent, and skipped as they came from another node */
+	int64		xacts_sent;
+	int64		xacts_filtered;
+
+	/* changes decoded, skipped by origin or replication set, and sent */
+	int64		changes_decoded;
+	int64		changes_filtered_origin;
+	int64		changes_filtered_repset;
+	int64		changes_sent;
+
+	/* bytes of change messages sent, and of column data in each format */
+	int64		bytes_sent;
+	int64		bytes_binary;
+	int64		bytes_sendrecv;
+	int64		bytes_text;
+
+	/* time spent encoding the changes sent */
+	instr_time	encode_time;
+}			pgactiveWalsenderStats;
+
 /*
  * Walsender worker. These are only allocated while a output plugin is active.
  */
@@ -353,6 +535,8 @@ typedef struct pgactiveWalsenderWorker
 
 	/* timestamp at which last change was sent */
 	TimestampTz last_sent_xact_at;
+
+	pgactiveWalsenderStats stats;
 }			pgactiveWalsenderWorker;
 
 /*
@@ -454,6 +638,8 @@ extern char *pgactive_temp_dump_directory;
 extern bool pgactive_log_conflicts_to_table;
 extern bool pgactive_log_conflicts_to_logfile;
 extern bool pgactive_conflict_logging_include_tuples;
+extern int	pgactive_conflict_logging_sample_limit;
+extern int	pgactive_conflict_logging_sample_interval;
 
 /*
  * replaced by pgactive_skip_ddl_replication for now
@@ -475,10 +661,18 @@ extern bool pgactive_debug_trace_replay;
 extern int	pgactive_debug_trace_ddl_locks_level;
 extern char *pgactive_extra_apply_connection_options;
 extern int	pgactive_init_node_parallel_jobs;
+extern int	pgactive_init_node_data_sync_method;
 extern int	pgactive_max_nodes;
 extern bool pgactive_permit_node_identifier_getter_function_creation;
 extern bool pgactive_debug_trace_connection_errors;
 extern bool pgactive_apply_as_table_owner;
+extern int	pgactive_snowflake_id_generator;
+extern int	pgactive_max_stat_relations;
+extern bool pgactive_track_apply_timing;
+extern int	pgactive_conflict_history_retention;
+extern int	pgactive_queued_commands_retention;
+extern int	pgactive_queued_drops_retention;
+extern int	pgactive_history_prune_batch_size;
 
 static const char *const pgactive_default_apply_connection_options =
 "connect_timeout=30 "
@@ -559,6 +753,12 @@ extern int	pgactive_log_min_messages;
 extern void pgactive_fetch_sysid_via_node_id(RepOriginId node_id, pgactiveNodeId * out_nodeid);
 extern bool pgactive_fetch_sysid_via_node_id_ifexists(RepOriginId node_id, pgactiveNodeId * out_nodeid, bool missing_ok);
 extern RepOriginId pgactive_fetch_node_id_via_sysid(const pgactiveNodeId * const node);
+extern void pgactive_read_tuple(StringInfo s, pgactiveRelation * rel, pgactiveTupleData * tup);
+extern void pgactive_read_datum(StringInfo s, Form_pg_attribute att, Datum *value, bool *isnull);
+
+/* output plugin tuple encoding (pgactive_output.c) */
+extern void pgactive_write_tuple(StringInfo out, Relation rel, HeapTuple tuple);
+extern void pgactive_write_datum(StringInfo out, Form_pg_attribute att, Datum value, bool isnull);
 
 /* Index maintenance, heap access, etc */
 extern struct EState *pgactive_create_rel_estate(Relation rel, ResultRelInfo *resultRelInfo);
@@ -607,6 +807,7 @@ typedef struct pgactiveApplyConflict
 	bool		remote_tuple_null;
 	Datum		remote_tuple;	/* composite */
 	ErrorData  *apply_error;
+	bool		suppressed;		/* over pgactive.conflict_logging_sample_limit */
 }			pgactiveApplyConflict;
 
 typedef struct pgactiveNodeDSNsInfo
@@ -617,6 +818,7 @@ typedef struct pgactiveNodeDSNsInfo
 
 extern void pgactive_conflict_logging_startup(void);
 extern void pgactive_conflict_logging_cleanup(void);
+extern void pgactive_conflict_logging_flush(void);
 
 extern pgactiveApplyConflict * pgactive_make_apply_conflict(pgactiveConflictType conflict_type,
 															pgactiveConflictResolution resolution,
@@ -635,7 +837,11 @@ extern void tuple_to_stringinfo(StringInfo s, TupleDesc tupdesc, HeapTuple tuple
 
 /* statistic functions */
 extern void pgactive_count_shmem_init(int nnodes);
+#if PG_VERSION_NUM >= 180000
+extern void pgactive_count_register_kind(void);
+#endif
 extern void pgactive_count_set_current_node(RepOriginId node_id);
+extern void pgactive_count_drop_node(RepOriginId node_id);
 extern void pgactive_count_commit(void);
 extern void pgactive_count_rollback(void);
 extern void pgactive_count_insert(void);
@@ -645,6 +851,27 @@ extern void pgactive_count_update_conflict(void);
 extern void pgactive_count_delete(void);
 extern void pgactive_count_delete_conflict(void);
 extern void pgactive_count_disconnect(void);
+extern void pgactive_count_relation_insert(Oid relid);
+extern void pgactive_count_relation_update(Oid relid);
+extern void pgactive_count_relation_delete(Oid relid);
+extern void pgactive_count_relation_conflict(Oid relid, pgactiveConflictType conflict_type);
+extern void pgactive_count_relation_start(instr_time *start);
+extern void pgactive_count_relation_apply(Oid relid, Size nbytes, instr_time start);
+extern void pgactive_count_relation_flush(void);
+extern void pgactive_count_metrics(StringInfo out);
+
+/* backlog summary, pgactive_backlog.c */
+extern const char *pgactive_backlog_source_slot(const char *slot_name);
+extern void pgactive_backlog_begin_txn(TransactionId xid, RepOriginId origin);
+extern void pgactive_backlog_change(Oid relid, char action, Size bytes, bool sent);
+extern void pgactive_backlog_commit_txn(XLogRecPtr end_lsn, TimestampTz committs,
+										bool sent);
+
+/* Prometheus metrics export, pgactive_metrics.c */
+extern void pgactive_metrics_family(StringInfo out, const char *name,
+									const char *type, const char *help);
+extern void pgactive_metrics_label_value(StringInfo out, const char *value);
+extern void pgactive_metrics_database_label(StringInfo out, Oid dboid);
 
 /* compat check functions */
 extern bool pgactive_get_float4byval(void);
@@ -788,6 +1015,9 @@ extern struct pg_conn *pgactive_establish_connection_and_slot(const char *dsn,
 															  RepOriginId * out_rep_origin_id,
 															  char *out_snapshot);
 
+extern char *pgactive_create_slot_command(Name slot_name);
+extern bool pgactive_slot_exists_result(const PGresult *res);
+
 extern PGconn *pgactive_connect_nonrepl(const char *connstring,
 										const char *appname,
 										bool is_appnamesuffix,
@@ -796,6 +1026,19 @@ extern PGconn *pgactive_connect_nonrepl(const char *connstring,
 /* Helper for PG_ENSURE_ERROR_CLEANUP to close a PGconn */
 extern void pgactive_cleanup_conn_close(int code, Datum offset);
 
+/* A query sent to a remote node as part of a pipeline */
+typedef struct pgactiveRemoteQuery
+{
+	const char *query;
+	int			nparams;
+	const char *const *params;
+	PGresult   *res;			/* set by pgactive_exec_pipeline */
+}			pgactiveRemoteQuery;
+
+extern void pgactive_exec_pipeline(PGconn *conn, pgactiveRemoteQuery * queries,
+								   int nqueries);
+extern void pgactive_clear_pipeline(pgactiveRemoteQuery * queries, int nqueries);
+
 /* use instead of table_open()/table_close() */
 extern pgactiveRelation * pgactive_table_open(Oid reloid, LOCKMODE lockmode);
 extern void pgactive_table_close(pgactiveRelation * rel, LOCKMODE lockmode);
@@ -852,7 +1095,9 @@ extern void pgactive_get_remote_nodeinfo_internal(PGconn *conn, remote_node_info
 
 extern void free_remote_node_info(remote_node_info * ri);
 
+extern const char *const pgactive_ext_version_query;
 extern void pgactive_ensure_ext_installed(PGconn *pgconn);
+extern void pgactive_ensure_ext_installed_result(PGresult *res);
 
 /*
  * Global to identify the type of pgactive worker the current process is. Primarily
@@ -868,6 +1113,7 @@ extern const char *pgactive_error_severity(int elevel);
 /*
  * sequencer support
  */
+extern void pgactive_seq_shmem_init(void);
 
 /*
  * Protocol
@@ -938,6 +1184,37 @@ extern bool is_pgactive_nid_getter_function_alter_rename(RenameStmt *stmt);
 extern void pgactive_set_data_only_node_init(Oid dboid, bool val);
 extern bool pgactive_get_data_only_node_init(Oid dboid);
 
+/*
+ * Places pgactive waits at, reported as custom wait events of type
+ * "Extension" on PostgreSQL 17 and later, see pgactive_wait_event().
+ */
+typedef enum pgactiveWaitEvent
+{
+	pgactive_WAIT_APPLY_NETWORK_READ = 0,
+	pgactive_WAIT_APPLY_DELAY,
+	pgactive_WAIT_APPLY_PAUSED,
+	pgactive_WAIT_APPLY_WORKER_EXIT,
+	pgactive_WAIT_DDL_LOCK_ACQUIRE,
+	pgactive_WAIT_DDL_LOCK_CANCEL_XACTS,
+	pgactive_WAIT_DDL_LOCK_DML_WAIT,
+	pgactive_WAIT_SLOT_FLUSH,
+	pgactive_WAIT_SUPERVISOR_MAIN,
+	pgactive_WAIT_SUPERVISOR_PERDB_START,
+	pgactive_WAIT_PERDB_MAIN,
+	pgactive_WAIT_PERDB_CONNECT_RETRY,
+	pgactive_WAIT_INIT_CHILD_PROCESS,
+	pgactive_WAIT_INIT_COPY_DATA,
+	pgactive_WAIT_INIT_CREATE_SLOTS,
+	pgactive_WAIT_INIT_INBOUND_SLOTS,
+	pgactive_WAIT_INIT_NODE_READY,
+	pgactive_WAIT_INIT_WORKER_START,
+	pgactive_WAIT_COMPARE_REMOTE
+}			pgactiveWaitEvent;
+
+#define pgactive_WAIT_EVENT_COUNT (pgactive_WAIT_COMPARE_REMOTE + 1)
+
+extern uint32 pgactive_wait_event(pgactiveWaitEvent event);
+
 /* Postgres commit cfdf4dc4fc96 introduced this pseudo-event in version 12. */
 #if PG_VERSION_NUM >= 120000
 static inline int
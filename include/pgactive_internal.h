@@ -103,6 +103,7 @@ extern void pgactive_slot_name(Name out_name, const pgactiveNodeId * const remot
 extern char *pgactive_replident_name(const pgactiveNodeId * const remote, Oid local_dboid);
 
 extern void pgactive_parse_slot_name(const char *name, pgactiveNodeId * remote, Oid *local_dboid);
+extern bool pgactive_is_node_slot_name(const char *name);
 
 extern void pgactive_parse_replident_name(const char *name, pgactiveNodeId * remote, Oid *local_dboid);
 
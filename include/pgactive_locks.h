@@ -42,4 +42,6 @@ extern void pgactive_locks_node_detached(pgactiveNodeId * node);
 
 extern bool IspgactiveLocksShmemLockHeldByMe(void);
 
+extern void pgactive_locks_metrics(StringInfo out);
+
 #endif
@@ -0,0 +1,79 @@
+/*
+ * pgactive_probes.h
+ *
+ * Active-active Replication
+ *
+ * Static tracepoints (USDT probes) of the "pgactive" provider.
+ *
+ * Like PostgreSQL's own TRACE_POSTGRESQL_* probes they're only compiled in
+ * when the server was built with --enable-dtrace (-Ddtrace=enabled), and
+ * expand to nothing otherwise. The probes are defined with the macros of
+ * systemtap's <sys/sdt.h>, which record them in the ELF notes of
+ * pgactive.so without a separate dtrace -G step, so they're available on
+ * Linux only. List them with e.g.
+ *
+ *     bpftrace -l 'usdt:/path/to/pgactive.so:*'
+ *
+ * Probes taking a LSN or timestamp get them as 64-bit integers, relation and
+ * transaction ids as 32-bit integers and actions as the protocol's action
+ * character ('I', 'U' or 'D').
+ *
+ * Copyright (c) 2014-2015, PostgreSQL Global Development Group
+ *
+ * pgactive_probes.h
+ */
+#ifndef pgactive_PROBES_H
+#define pgactive_PROBES_H
+
+#if defined(ENABLE_DTRACE) && defined(__linux__)
+
+#include <sys/sdt.h>
+
+/* Remote transaction applied: remote xid, its commit LSN and timestamp */
+#define TRACE_PGACTIVE_APPLY_BEGIN(xid, lsn, committs) \
+	DTRACE_PROBE3(pgactive, apply__begin, xid, lsn, committs)
+#define TRACE_PGACTIVE_APPLY_COMMIT(xid, lsn, committs) \
+	DTRACE_PROBE3(pgactive, apply__commit, xid, lsn, committs)
+
+/* Change applied by an apply worker: relation, action */
+#define TRACE_PGACTIVE_APPLY_CHANGE_START(relid, action) \
+	DTRACE_PROBE2(pgactive, apply__change__start, relid, action)
+#define TRACE_PGACTIVE_APPLY_CHANGE_DONE(relid, action) \
+	DTRACE_PROBE2(pgactive, apply__change__done, relid, action)
+
+/* Conflict: relation, pgactiveConflictType and pgactiveConflictResolution */
+#define TRACE_PGACTIVE_CONFLICT_DETECTED(relid, conflict_type) \
+	DTRACE_PROBE2(pgactive, conflict__detected, relid, conflict_type)
+#define TRACE_PGACTIVE_CONFLICT_RESOLVED(relid, conflict_type, resolution) \
+	DTRACE_PROBE3(pgactive, conflict__resolved, relid, conflict_type, resolution)
+
+/* Change encoded by the output plugin: relation, action, bytes written */
+#define TRACE_PGACTIVE_OUTPUT_CHANGE_START(relid, action) \
+	DTRACE_PROBE2(pgactive, output__change__start, relid, action)
+#define TRACE_PGACTIVE_OUTPUT_CHANGE_DONE(relid, action, bytes) \
+	DTRACE_PROBE3(pgactive, output__change__done, relid, action, bytes)
+
+/* Global DDL lock state change: database, old and new pgactiveLockState */
+#define TRACE_PGACTIVE_DDL_LOCK_STATE(dboid, old_state, new_state) \
+	DTRACE_PROBE3(pgactive, ddl__lock__state, dboid, old_state, new_state)
+
+/* Feedback sent by an apply worker: write, flush and apply LSN */
+#define TRACE_PGACTIVE_FEEDBACK_SENT(write_lsn, flush_lsn, apply_lsn) \
+	DTRACE_PROBE3(pgactive, feedback__sent, write_lsn, flush_lsn, apply_lsn)
+
+#else
+
+#define TRACE_PGACTIVE_APPLY_BEGIN(xid, lsn, committs) do {} while (0)
+#define TRACE_PGACTIVE_APPLY_COMMIT(xid, lsn, committs) do {} while (0)
+#define TRACE_PGACTIVE_APPLY_CHANGE_START(relid, action) do {} while (0)
+#define TRACE_PGACTIVE_APPLY_CHANGE_DONE(relid, action) do {} while (0)
+#define TRACE_PGACTIVE_CONFLICT_DETECTED(relid, conflict_type) do {} while (0)
+#define TRACE_PGACTIVE_CONFLICT_RESOLVED(relid, conflict_type, resolution) do {} while (0)
+#define TRACE_PGACTIVE_OUTPUT_CHANGE_START(relid, action) do {} while (0)
+#define TRACE_PGACTIVE_OUTPUT_CHANGE_DONE(relid, action, bytes) do {} while (0)
+#define TRACE_PGACTIVE_DDL_LOCK_STATE(dboid, old_state, new_state) do {} while (0)
+#define TRACE_PGACTIVE_FEEDBACK_SENT(write_lsn, flush_lsn, apply_lsn) do {} while (0)
+
+#endif
+
+#endif							/* pgactive_PROBES_H */
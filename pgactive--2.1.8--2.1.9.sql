@@ -0,0 +1,395 @@
+/* pgactive--2.1.8--2.1.9.sql */
+
+-- complain if script is sourced in psql, rather than via ALTER EXTENSION
+\echo Use "ALTER EXTENSION pgactive UPDATE TO '2.1.9'" to load this file. \quit
+
+SET pgactive.skip_ddl_replication = true;
+SET LOCAL search_path = pgactive;
+-- Start Upgrade SQLs/Functions/Procedures
+
+CREATE FUNCTION pgactive_snowflake_id_nextval_batch(regclass, integer)
+RETURNS SETOF bigint
+AS 'MODULE_PATHNAME','pgactive_snowflake_id_nextval_batch'
+LANGUAGE C STRICT VOLATILE;
+
+COMMENT ON FUNCTION pgactive_snowflake_id_nextval_batch(regclass, integer) IS
+'Reserve a batch of sequence values unique to this node using a local sequence as a seed';
+
+CREATE FUNCTION pgactive_snowflake_id_nextval_array(regclass, integer)
+RETURNS bigint[]
+AS 'MODULE_PATHNAME','pgactive_snowflake_id_nextval_array'
+LANGUAGE C STRICT VOLATILE;
+
+COMMENT ON FUNCTION pgactive_snowflake_id_nextval_array(regclass, integer) IS
+'Reserve a batch of sequence values unique to this node using a local sequence as a seed, returned as an array';
+
+CREATE FUNCTION pgactive_get_stat_relation (
+    OUT rep_node_id oid,
+    OUT riremoteid text,
+    OUT relid oid,
+    OUT nr_insert int8,
+    OUT nr_update int8,
+    OUT nr_delete int8,
+    OUT nr_insert_insert_conflict int8,
+    OUT nr_update_update_conflict int8,
+    OUT nr_update_delete_conflict int8,
+    OUT nr_delete_delete_conflict int8,
+    OUT bytes_received int8,
+    OUT apply_time float8
+)
+RETURNS SETOF record
+AS 'MODULE_PATHNAME'
+LANGUAGE C;
+
+REVOKE ALL ON FUNCTION pgactive_get_stat_relation() FROM PUBLIC;
+
+COMMENT ON FUNCTION pgactive_get_stat_relation() IS
+'Per-relation statistics of changes applied from each peer node, apply_time is in milliseconds';
+
+CREATE VIEW pgactive_stat_relation AS
+SELECT s.rep_node_id, s.riremoteid, s.relid,
+       n.nspname AS schemaname, c.relname,
+       s.nr_insert, s.nr_update, s.nr_delete,
+       s.nr_insert_insert_conflict, s.nr_update_update_conflict,
+       s.nr_update_delete_conflict, s.nr_delete_delete_conflict,
+       s.bytes_received, s.apply_time
+FROM pgactive_get_stat_relation() s
+LEFT JOIN pg_catalog.pg_class c ON c.oid = s.relid
+LEFT JOIN pg_catalog.pg_namespace n ON n.oid = c.relnamespace;
+
+CREATE FUNCTION pgactive_stat_relation_reset()
+RETURNS void
+AS 'MODULE_PATHNAME'
+LANGUAGE C;
+
+REVOKE ALL ON FUNCTION pgactive_stat_relation_reset() FROM PUBLIC;
+
+COMMENT ON FUNCTION pgactive_stat_relation_reset() IS
+'Discard per-relation statistics of the current database';
+
+CREATE FUNCTION pgactive_stats_reset()
+RETURNS void
+AS 'MODULE_PATHNAME'
+LANGUAGE C;
+
+REVOKE ALL ON FUNCTION pgactive_stats_reset() FROM PUBLIC;
+
+COMMENT ON FUNCTION pgactive_stats_reset() IS
+'Reset the replication statistics of all nodes shown in pgactive_stats';
+
+CREATE FUNCTION pgactive_get_local_replication_lag(
+    OUT node_sysid text,
+    OUT node_timeline oid,
+    OUT node_dboid oid,
+    OUT direction text,
+    OUT pid integer,
+    OUT sent_lsn pg_lsn,
+    OUT write_lsn pg_lsn,
+    OUT flush_lsn pg_lsn,
+    OUT replay_lsn pg_lsn,
+    OUT lag_bytes int8,
+    OUT write_lag interval,
+    OUT flush_lag interval,
+    OUT replay_lag interval,
+    OUT last_xact_committs timestamptz,
+    OUT last_xact_at timestamptz
+)
+RETURNS SETOF record
+AS 'MODULE_PATHNAME'
+LANGUAGE C VOLATILE STRICT;
+
+REVOKE ALL ON FUNCTION pgactive_get_local_replication_lag() FROM PUBLIC;
+
+COMMENT ON FUNCTION pgactive_get_local_replication_lag() IS
+'Gets replication lag of this node''s pgactive connections from shared memory, without connecting to other nodes.';
+
+CREATE VIEW pgactive_replication_lag AS
+SELECT n.node_name, l.*
+FROM pgactive_get_local_replication_lag() l
+LEFT JOIN pgactive_nodes n
+  ON (n.node_sysid = l.node_sysid AND n.node_timeline = l.node_timeline
+      AND n.node_dboid = l.node_dboid);
+
+CREATE TABLE pgactive_init_progress (
+    step text NOT NULL,
+    relname text NOT NULL DEFAULT '',
+    nrows bigint,
+    snapshot text,
+    schema_position text,
+    completed_at timestamptz NOT NULL DEFAULT current_timestamp,
+    PRIMARY KEY (step, relname)
+);
+REVOKE ALL ON TABLE pgactive_init_progress FROM PUBLIC;
+
+COMMENT ON TABLE pgactive_init_progress IS 'Steps of the initial data copy of a logical join that have completed on this node, used to resume a failed join';
+COMMENT ON COLUMN pgactive_init_progress.step IS 'Completed step: [schema] tables created, [data] table data copied, [post-data] indexes and constraints built';
+COMMENT ON COLUMN pgactive_init_progress.relname IS 'Table whose data was copied for step data, empty otherwise';
+COMMENT ON COLUMN pgactive_init_progress.nrows IS 'Number of rows copied for step data';
+COMMENT ON COLUMN pgactive_init_progress.snapshot IS 'Upstream snapshot the step was done with';
+COMMENT ON COLUMN pgactive_init_progress.schema_position IS 'Fingerprint of the upstream table columns, indexes and constraints, for step schema';
+
+CREATE FUNCTION pgactive_get_join_progress(
+    OUT dboid oid,
+    OUT pid integer,
+    OUT phase text,
+    OUT join_started_at timestamptz,
+    OUT phase_started_at timestamptz,
+    OUT tables_total integer,
+    OUT tables_done integer,
+    OUT bytes_total int8,
+    OUT bytes_done int8,
+    OUT current_table text,
+    OUT jobs_total integer,
+    OUT jobs_busy integer,
+    OUT catchup_target_lsn pg_lsn,
+    OUT catchup_lsn pg_lsn,
+    OUT catchup_remaining_bytes int8,
+    OUT estimated_phase_end timestamptz
+)
+RETURNS SETOF record
+AS 'MODULE_PATHNAME'
+LANGUAGE C VOLATILE STRICT;
+
+REVOKE ALL ON FUNCTION pgactive_get_join_progress() FROM PUBLIC;
+
+COMMENT ON FUNCTION pgactive_get_join_progress() IS
+'Gets the progress of logical joins of the databases of this node from shared memory.';
+
+CREATE VIEW pgactive_join_progress AS
+SELECT d.datname, p.*
+FROM pgactive_get_join_progress() p
+LEFT JOIN pg_catalog.pg_database d ON (d.oid = p.dboid);
+
+CREATE FUNCTION pgactive_compare_table(
+    relation regclass,
+    node_name text,
+    local_lsn pg_lsn DEFAULT NULL,
+    remote_lsn pg_lsn DEFAULT NULL,
+    OUT key_lo text[],
+    OUT key_hi text[],
+    OUT local_rows int8,
+    OUT remote_rows int8
+)
+RETURNS SETOF record
+AS 'MODULE_PATHNAME'
+LANGUAGE C VOLATILE;
+
+REVOKE ALL ON FUNCTION pgactive_compare_table(regclass, text, pg_lsn, pg_lsn) FROM PUBLIC;
+
+COMMENT ON FUNCTION pgactive_compare_table(regclass, text, pg_lsn, pg_lsn) IS
+'Compares the contents of a table with a peer node by hashing primary key ranges on both nodes, and returns the key ranges that differ. local_lsn and remote_lsn choose the WAL positions each node waits for the other to replay first, NULL meaning its current position.';
+
+CREATE FUNCTION pgactive_resync_range(
+    relation regclass,
+    node_name text,
+    key_lo text[],
+    key_hi text[],
+    OUT rows_deleted int8,
+    OUT rows_updated int8,
+    OUT rows_inserted int8
+)
+RETURNS record
+AS 'MODULE_PATHNAME'
+LANGUAGE C VOLATILE;
+
+REVOKE ALL ON FUNCTION pgactive_resync_range(regclass, text, text[], text[]) FROM PUBLIC;
+
+COMMENT ON FUNCTION pgactive_resync_range(regclass, text, text[], text[]) IS
+'Makes the rows of a primary key range of a table on this node match those on a peer node, without replicating the changes.';
+
+CREATE FUNCTION _bench_encode(
+    relation regclass,
+    n_rows integer,
+    OUT column_name text,
+    OUT type_name text,
+    OUT format "char",
+    OUT bytes_per_row float8,
+    OUT encode_ns_per_row float8
+)
+RETURNS SETOF record
+AS 'MODULE_PATHNAME', 'pgactive_bench_encode'
+LANGUAGE C VOLATILE STRICT;
+
+REVOKE ALL ON FUNCTION _bench_encode(regclass, integer) FROM PUBLIC;
+
+COMMENT ON FUNCTION _bench_encode(regclass, integer) IS
+'Development only: times the encoding of rows of a table by the output plugin, per row and per column.';
+
+CREATE FUNCTION _bench_roundtrip(
+    relation regclass,
+    n_rows integer,
+    OUT column_name text,
+    OUT type_name text,
+    OUT format "char",
+    OUT bytes_per_row float8,
+    OUT encode_ns_per_row float8,
+    OUT decode_ns_per_row float8
+)
+RETURNS SETOF record
+AS 'MODULE_PATHNAME', 'pgactive_bench_roundtrip'
+LANGUAGE C VOLATILE STRICT;
+
+REVOKE ALL ON FUNCTION _bench_roundtrip(regclass, integer) FROM PUBLIC;
+
+COMMENT ON FUNCTION _bench_roundtrip(regclass, integer) IS
+'Development only: times the encoding of rows of a table by the output plugin and their decoding by the apply worker, per row and per column.';
+
+CREATE FUNCTION pgactive_get_apply_timing(
+    OUT node_sysid text,
+    OUT node_timeline oid,
+    OUT node_dboid oid,
+    OUT dboid oid,
+    OUT pid integer,
+    OUT phase text,
+    OUT calls int8,
+    OUT total_time float8,
+    OUT mean_time float8,
+    OUT p50_time float8,
+    OUT p95_time float8,
+    OUT p99_time float8,
+    OUT histogram int8[],
+    OUT stats_reset timestamptz
+)
+RETURNS SETOF record
+AS 'MODULE_PATHNAME'
+LANGUAGE C VOLATILE STRICT;
+
+REVOKE ALL ON FUNCTION pgactive_get_apply_timing() FROM PUBLIC;
+
+COMMENT ON FUNCTION pgactive_get_apply_timing() IS
+'Gets the time apply workers spent in each phase of applying changes from shared memory, collected when pgactive.track_apply_timing is on.';
+
+CREATE VIEW pgactive_apply_timing AS
+SELECT n.node_name, t.*
+FROM pgactive_get_apply_timing() t
+LEFT JOIN pgactive_nodes n
+  ON (n.node_sysid = t.node_sysid AND n.node_timeline = t.node_timeline
+      AND n.node_dboid = t.node_dboid);
+
+CREATE FUNCTION pgactive_apply_timing_reset()
+RETURNS void
+AS 'MODULE_PATHNAME'
+LANGUAGE C VOLATILE STRICT;
+
+REVOKE ALL ON FUNCTION pgactive_apply_timing_reset() FROM PUBLIC;
+
+COMMENT ON FUNCTION pgactive_apply_timing_reset() IS
+'Discards the apply timing statistics of all apply workers.';
+
+CREATE FUNCTION pgactive_metrics()
+RETURNS text
+AS 'MODULE_PATHNAME'
+LANGUAGE C VOLATILE STRICT;
+
+REVOKE ALL ON FUNCTION pgactive_metrics() FROM PUBLIC;
+
+COMMENT ON FUNCTION pgactive_metrics() IS
+'Reports counters, workers, global lock state and replication positions of all databases in Prometheus text format.';
+
+CREATE FUNCTION pgactive_backlog_summary(
+    slot_name name,
+    upto_lsn pg_lsn DEFAULT NULL,
+    OUT kind text,
+    OUT relation regclass,
+    OUT action text,
+    OUT origin text,
+    OUT xid xid,
+    OUT commit_lsn pg_lsn,
+    OUT commit_time timestamptz,
+    OUT transactions bigint,
+    OUT changes bigint,
+    OUT bytes bigint,
+    OUT decoded_changes bigint
+)
+RETURNS SETOF record
+AS 'MODULE_PATHNAME'
+LANGUAGE C VOLATILE;
+
+REVOKE ALL ON FUNCTION pgactive_backlog_summary(name, pg_lsn) FROM PUBLIC;
+
+COMMENT ON FUNCTION pgactive_backlog_summary(name, pg_lsn) IS
+'Summarizes the changes pending on a pgactive slot per relation, transaction and origin, without consuming them.';
+
+-- The copies pgactive_backlog_summary decodes from use the pgactive plugin too
+COMMENT ON FUNCTION pgactive_parse_slot_name(name) IS
+'Parse a slot name from the pgactive plugin and report the embedded field values, NULL if it is not the name of a slot for a peer node';
+
+CREATE FUNCTION pgactive_get_walsender_stats(
+    OUT node_sysid text,
+    OUT node_timeline oid,
+    OUT node_dboid oid,
+    OUT dboid oid,
+    OUT slot_name name,
+    OUT pid integer,
+    OUT xacts_sent int8,
+    OUT xacts_filtered int8,
+    OUT changes_decoded int8,
+    OUT changes_filtered_origin int8,
+    OUT changes_filtered_repset int8,
+    OUT changes_sent int8,
+    OUT bytes_sent int8,
+    OUT bytes_binary int8,
+    OUT bytes_sendrecv int8,
+    OUT bytes_text int8,
+    OUT encode_time float8,
+    OUT spill_txns int8,
+    OUT spill_count int8,
+    OUT spill_bytes int8,
+    OUT stream_txns int8,
+    OUT stream_count int8,
+    OUT stream_bytes int8
+)
+RETURNS SETOF record
+AS 'MODULE_PATHNAME'
+LANGUAGE C VOLATILE STRICT;
+
+REVOKE ALL ON FUNCTION pgactive_get_walsender_stats() FROM PUBLIC;
+
+COMMENT ON FUNCTION pgactive_get_walsender_stats() IS
+'Gets the decoding statistics of the walsenders streaming to pgactive peers from shared memory.';
+
+CREATE VIEW pgactive_walsender_stats AS
+SELECT n.node_name, w.*
+FROM pgactive_get_walsender_stats() w
+LEFT JOIN pgactive_nodes n
+  ON (n.node_sysid = w.node_sysid AND n.node_timeline = w.node_timeline
+      AND n.node_dboid = w.node_dboid);
+
+CREATE FUNCTION pgactive_get_apply_progress(
+    OUT node_sysid text,
+    OUT node_timeline oid,
+    OUT node_dboid oid,
+    OUT dboid oid,
+    OUT pid integer,
+    OUT xid xid,
+    OUT commit_lsn pg_lsn,
+    OUT commit_timestamp timestamptz,
+    OUT started_at timestamptz,
+    OUT elapsed interval,
+    OUT changes_total int8,
+    OUT changes_done int8,
+    OUT inserts int8,
+    OUT updates int8,
+    OUT deletes int8,
+    OUT current_relation regclass,
+    OUT bytes int8
+)
+RETURNS SETOF record
+AS 'MODULE_PATHNAME'
+LANGUAGE C VOLATILE STRICT;
+
+REVOKE ALL ON FUNCTION pgactive_get_apply_progress() FROM PUBLIC;
+
+COMMENT ON FUNCTION pgactive_get_apply_progress() IS
+'Gets the progress of the remote transactions the apply workers are applying from shared memory.';
+
+CREATE VIEW pgactive_stat_progress_apply AS
+SELECT n.node_name, p.*
+FROM pgactive_get_apply_progress() p
+LEFT JOIN pgactive_nodes n
+  ON (n.node_sysid = p.node_sysid AND n.node_timeline = p.node_timeline
+      AND n.node_dboid = p.node_dboid);
+
+-- Finish Upgrade SQLs/Functions/Procedures
+RESET pgactive.skip_ddl_replication;
+RESET search_path;
@@ -373,6 +373,34 @@ _EndData(ArchiveHandle *AH, TocEntry *te)
 		fatal("could not close data file: %m");
 
 	ctx->dataFH = NULL;
+
+	/*
+	 * For pgactive pipelined node init, announce the completed data file by
+	 * writing its COPY statement to <dumpId>.ready. The file is renamed into
+	 * place so that the restoring side never sees it half written.
+	 */
+	if (AH->public.dopt != NULL && AH->public.dopt->pgactive_pipeline &&
+		te->copyStmt != NULL)
+	{
+		char		readyname[MAXPGPATH];
+		char		fname[MAXPGPATH];
+		char		tmpname[MAXPGPATH];
+		FILE	   *fp;
+		size_t		len = strlen(te->copyStmt);
+
+		snprintf(readyname, sizeof(readyname), "%d.ready", te->dumpId);
+		setFilePath(AH, fname, readyname);
+		snprintf(tmpname, sizeof(tmpname), "%s.tmp", fname);
+
+		fp = fopen(tmpname, PG_BINARY_W);
+		if (fp == NULL)
+			fatal("could not open output file \"%s\": %m", tmpname);
+		if (fwrite(te->copyStmt, 1, len, fp) != len || fclose(fp) != 0)
+			fatal("could not write to output file \"%s\": %m", tmpname);
+		if (rename(tmpname, fname) != 0)
+			fatal("could not rename file \"%s\" to \"%s\": %m",
+			      tmpname, fname);
+	}
 }
 
 /*
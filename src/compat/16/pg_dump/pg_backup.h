@@ -164,6 +164,7 @@ typedef struct _dumpOptions
 
 	int			binary_upgrade;
 	int                     pgactive_init_node;
+	int                     pgactive_pipeline;
 
 	/* various user-settable parameters */
 	bool		schemaOnly;
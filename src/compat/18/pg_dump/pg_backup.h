@@ -173,6 +173,7 @@ typedef struct _dumpOptions
 
 	int			binary_upgrade;
 	int                     pgactive_init_node;
+	int                     pgactive_pipeline;
 
 	/* various user-settable parameters */
 	int			dumpSections;	/* bitmask of chosen sections */
@@ -53,6 +53,7 @@
 #include "postmaster/bgworker.h"
 
 #include "replication/origin.h"
+#include "replication/walsender_private.h"
 
 #if PG_VERSION_NUM >= 190000
 #include "storage/fd.h"
@@ -123,10 +124,18 @@ int			pgactive_debug_trace_ddl_locks_level = DDL_LOCK_TRACE_STATEMENT;
 char	   *pgactive_extra_apply_connection_options;
 int			pgactive_log_min_messages = WARNING;
 int			pgactive_init_node_parallel_jobs;
+int			pgactive_init_node_data_sync_method = pgactive_INIT_NODE_DATA_SYNC_DUMP;
 int			pgactive_max_nodes;
 bool		pgactive_permit_node_identifier_getter_function_creation;
 bool		pgactive_debug_trace_connection_errors;
 bool		pgactive_apply_as_table_owner;
+int			pgactive_snowflake_id_generator = pgactive_SNOWFLAKE_ID_GENERATOR_SEQUENCE;
+int			pgactive_max_stat_relations;
+bool		pgactive_track_apply_timing;
+int			pgactive_conflict_history_retention = -1;
+int			pgactive_queued_commands_retention = -1;
+int			pgactive_queued_drops_retention = -1;
+int			pgactive_history_prune_batch_size = 1000;
 
 PG_MODULE_MAGIC;
 
@@ -159,6 +168,7 @@ PGDLLEXPORT Datum pgactive_get_last_applied_xact_info(PG_FUNCTION_ARGS);
 PGDLLEXPORT Datum get_last_applied_xact_info(PG_FUNCTION_ARGS);
 PGDLLEXPORT Datum pgactive_get_replication_lag_info(PG_FUNCTION_ARGS);
 PGDLLEXPORT Datum get_replication_lag_info(PG_FUNCTION_ARGS);
+PGDLLEXPORT Datum pgactive_get_local_replication_lag(PG_FUNCTION_ARGS);
 PGDLLEXPORT Datum _pgactive_get_free_disk_space(PG_FUNCTION_ARGS);
 PGDLLEXPORT Datum get_free_disk_space(PG_FUNCTION_ARGS);
 PGDLLEXPORT Datum _pgactive_check_file_system_mount_points(PG_FUNCTION_ARGS);
@@ -190,6 +200,7 @@ PG_FUNCTION_INFO_V1(pgactive_get_last_applied_xact_info);
 PG_FUNCTION_INFO_V1(get_last_applied_xact_info);
 PG_FUNCTION_INFO_V1(pgactive_get_replication_lag_info);
 PG_FUNCTION_INFO_V1(get_replication_lag_info);
+PG_FUNCTION_INFO_V1(pgactive_get_local_replication_lag);
 PG_FUNCTION_INFO_V1(_pgactive_get_free_disk_space);
 PG_FUNCTION_INFO_V1(get_free_disk_space);
 PG_FUNCTION_INFO_V1(_pgactive_check_file_system_mount_points);
@@ -215,6 +226,19 @@ static const struct config_enum_entry pgactive_debug_trace_ddl_locks_level_optio
 	{NULL, 0, false}
 };
 
+static const struct config_enum_entry pgactive_snowflake_id_generator_options[] = {
+	{"sequence", pgactive_SNOWFLAKE_ID_GENERATOR_SEQUENCE, false},
+	{"shmem", pgactive_SNOWFLAKE_ID_GENERATOR_SHMEM, false},
+	{NULL, 0, false}
+};
+
+static const struct config_enum_entry pgactive_init_node_data_sync_method_options[] = {
+	{"dump", pgactive_INIT_NODE_DATA_SYNC_DUMP, false},
+	{"copy", pgactive_INIT_NODE_DATA_SYNC_COPY, false},
+	{"pipeline", pgactive_INIT_NODE_DATA_SYNC_PIPELINE, false},
+	{NULL, 0, false}
+};
+
 /*
  * Lookup table for types of pgactive workers.
  */
@@ -478,11 +502,47 @@ pgactive_connect(const char *conninfo,
 	return streamConn;
 }
 
+/*
+ * Build the replication command that creates the pgactive slot slot_name on
+ * a peer.
+ */
+char *
+pgactive_create_slot_command(Name slot_name)
+{
+	return psprintf("CREATE_REPLICATION_SLOT \"%s\" LOGICAL %s",
+					NameStr(*slot_name), "pgactive");
+}
+
+/*
+ * Did a slot creation command fail because the slot exists already?
+ *
+ * The slot name says which node it's for, so an existing slot is one we
+ * created ourselves in an attempt that errored out before it could record
+ * the local replication identifier.
+ */
+bool
+pgactive_slot_exists_result(const PGresult *res)
+{
+	const char *sqlstate;
+
+	if (PQresultStatus(res) != PGRES_FATAL_ERROR)
+		return false;
+
+	sqlstate = PQresultErrorField(res, PG_DIAG_SQLSTATE);
+
+	return sqlstate != NULL &&
+		strcmp(sqlstate, unpack_sql_state(ERRCODE_DUPLICATE_OBJECT)) == 0;
+}
+
 /*
  * ----------
  * Create a slot on a remote node, and the corresponding local replication
  * identifier.
  *
+ * A slot left behind by an earlier attempt is reused, unless a snapshot is
+ * wanted; that can only be had from a new slot, so the old one is dropped and
+ * created again.
+ *
  * Arguments:
  *   streamConn		Connection to use for slot creation
  *   slot_name		Name of the slot to create
@@ -493,47 +553,62 @@ pgactive_connect(const char *conninfo,
  *   snapshot					If !NULL, snapshot ID of slot snapshot
  * ----------
  */
-/*
- * TODO we should really handle the case where the slot already exists but
- * there's no local replication identifier, by dropping and recreating the
- * slot.
- */
 static void
 pgactive_create_slot(PGconn *streamConn, Name slot_name, char *remote_ident,
 					 RepOriginId * replication_identifier, char *snapshot)
 {
-	StringInfoData query;
+	char	   *query;
 	PGresult   *res;
 
-	initStringInfo(&query);
-
 	Assert(IsTransactionState());
 
 	/* we want the new identifier on stable storage immediately */
 	ForceSyncCommit();
 
 	/* acquire remote decoding slot */
-	appendStringInfo(&query, "CREATE_REPLICATION_SLOT \"%s\" LOGICAL %s",
-					 NameStr(*slot_name), "pgactive");
+	query = pgactive_create_slot_command(slot_name);
 
-	elog(DEBUG3, "sending replication command: %s", query.data);
+	elog(DEBUG3, "sending replication command: %s", query);
 
-	res = PQexec(streamConn, query.data);
+	res = PQexec(streamConn, query);
 
-	if (PQresultStatus(res) != PGRES_TUPLES_OK)
+	if (pgactive_slot_exists_result(res) && snapshot != NULL)
 	{
-		/*
-		 * TODO: Should test whether this error is 'already exists' and carry
-		 * on
-		 */
+		char	   *drop_query;
+
+		PQclear(res);
 
+		elog(LOG, "dropping replication slot \"%s\" left behind by an earlier attempt",
+			 NameStr(*slot_name));
+
+		drop_query = psprintf("DROP_REPLICATION_SLOT \"%s\"",
+							  NameStr(*slot_name));
+		res = PQexec(streamConn, drop_query);
+		if (PQresultStatus(res) != PGRES_COMMAND_OK)
+			elog(FATAL, "could not send replication command \"%s\": status %s: %s",
+				 drop_query,
+				 PQresStatus(PQresultStatus(res)), PQresultErrorMessage(res));
+		PQclear(res);
+		pfree(drop_query);
+
+		res = PQexec(streamConn, query);
+	}
+	else if (pgactive_slot_exists_result(res))
+		elog(LOG, "reusing replication slot \"%s\" left behind by an earlier attempt",
+			 NameStr(*slot_name));
+	else if (PQresultStatus(res) != PGRES_TUPLES_OK)
 		elog(FATAL, "could not send replication command \"%s\": status %s: %s",
-			 query.data,
+			 query,
+			 PQresStatus(PQresultStatus(res)), PQresultErrorMessage(res));
+
+	if (snapshot != NULL && PQresultStatus(res) != PGRES_TUPLES_OK)
+		elog(FATAL, "could not send replication command \"%s\": status %s: %s",
+			 query,
 			 PQresStatus(PQresultStatus(res)), PQresultErrorMessage(res));
-	}
 
 	/* acquire new local identifier, but don't commit */
 	*replication_identifier = replorigin_create(remote_ident);
+	pgactive_count_drop_node(*replication_identifier);
 
 	CurrentResourceOwner = pgactive_saved_resowner;
 	elog(DEBUG1, "created replication identifier %u", *replication_identifier);
@@ -543,7 +618,7 @@ pgactive_create_slot(PGconn *streamConn, Name slot_name, char *remote_ident,
 		snprintf(snapshot, NAMEDATALEN, "%s", PQgetvalue(res, 0, 2));
 
 	PQclear(res);
-	pfree(query.data);
+	pfree(query);
 }
 
 /*
@@ -600,6 +675,8 @@ pgactive_bgworker_init(uint32 worker_arg, pgactiveWorkerType worker_type)
 		apply->last_applied_xact_id = InvalidTransactionId;
 		apply->last_applied_xact_committs = 0;
 		apply->last_applied_xact_at = 0;
+		apply->last_applied_lsn = InvalidXLogRecPtr;
+		apply->last_received_lsn = InvalidXLogRecPtr;
 		dboid = apply->dboid;
 	}
 	else
@@ -1045,6 +1122,25 @@ _PG_init(void)
 							 PGC_SIGHUP,
 							 0,
 							 NULL, NULL, NULL);
+
+	DefineCustomIntVariable("pgactive.conflict_logging_sample_limit",
+							"Sets the number of conflicts of each type on each relation logged in full per sampling interval.",
+							"Further conflicts in the interval are only counted and reported in a summary. "
+							"If set to -1, every conflict is logged in full.",
+							&pgactive_conflict_logging_sample_limit,
+							-1, -1, INT_MAX,
+							PGC_SIGHUP,
+							0,
+							NULL, NULL, NULL);
+
+	DefineCustomIntVariable("pgactive.conflict_logging_sample_interval",
+							"Sets the length of the conflict logging sampling interval.",
+							NULL,
+							&pgactive_conflict_logging_sample_interval,
+							60000, 1000, INT_MAX,
+							PGC_SIGHUP,
+							GUC_UNIT_MS,
+							NULL, NULL, NULL);
 /*
  * replaced by pgactive_skip_ddl_replication for now
  * DefineCustomBoolVariable("pgactive.permit_ddl_locking",
@@ -1224,6 +1320,18 @@ _PG_init(void)
 							0,
 							NULL, NULL, NULL);
 
+	DefineCustomEnumVariable("pgactive.init_node_data_sync_method",
+							 "Sets how table data is copied while logical join of a node.",
+							 "\"dump\" copies schema and data with dump and restore, "
+							 "\"copy\" copies schema with dump and restore and table data over parallel COPY connections, "
+							 "\"pipeline\" restores each table's data as soon as it has been dumped.",
+							 &pgactive_init_node_data_sync_method,
+							 pgactive_INIT_NODE_DATA_SYNC_DUMP,
+							 pgactive_init_node_data_sync_method_options,
+							 PGC_SIGHUP,
+							 0,
+							 NULL, NULL, NULL);
+
 	DefineCustomIntVariable("pgactive.max_nodes",
 							"Sets maximum allowed nodes in a pgactive group.",
 							"This parameter must be set to same value on all pgactive members, otherwise "
@@ -1262,6 +1370,75 @@ _PG_init(void)
 							 0,
 							 NULL, NULL, NULL);
 
+	DefineCustomEnumVariable("pgactive.snowflake_id_generator",
+							 "Sets how pgactive_snowflake_id_nextval generates the per-millisecond sequence part of ids.",
+							 "\"sequence\" calls nextval() on the underlying sequence for every id, "
+							 "\"shmem\" uses a shared memory counter and only touches the sequence to persist its high-water mark.",
+							 &pgactive_snowflake_id_generator,
+							 pgactive_SNOWFLAKE_ID_GENERATOR_SEQUENCE,
+							 pgactive_snowflake_id_generator_options,
+							 PGC_POSTMASTER,
+							 0,
+							 NULL, NULL, NULL);
+
+	DefineCustomIntVariable("pgactive.max_stat_relations",
+							"Sets the maximum number of relations tracked in pgactive_stat_relation.",
+							"Statistics of relations beyond this limit are not tracked. "
+							"Zero disables per-relation statistics.",
+							&pgactive_max_stat_relations,
+							1000, 0, INT_MAX / 2,
+							PGC_POSTMASTER,
+							0,
+							NULL, NULL, NULL);
+
+	DefineCustomBoolVariable("pgactive.track_apply_timing",
+							 "Collects timing statistics of the phases of applying changes.",
+							 "The statistics are shown in pgactive.pgactive_apply_timing.",
+							 &pgactive_track_apply_timing,
+							 false,
+							 PGC_SIGHUP,
+							 0,
+							 NULL, NULL, NULL);
+
+	DefineCustomIntVariable("pgactive.conflict_history_retention",
+							"Sets how long rows are kept in pgactive.pgactive_conflict_history.",
+							"Older rows are deleted by the per-db worker. "
+							"If set to -1, rows are kept forever.",
+							&pgactive_conflict_history_retention,
+							-1, -1, INT_MAX,
+							PGC_SIGHUP,
+							GUC_UNIT_S,
+							NULL, NULL, NULL);
+
+	DefineCustomIntVariable("pgactive.queued_commands_retention",
+							"Sets how long rows are kept in pgactive.pgactive_queued_commands.",
+							"Older rows are deleted by the per-db worker. "
+							"If set to -1, rows are kept forever.",
+							&pgactive_queued_commands_retention,
+							-1, -1, INT_MAX,
+							PGC_SIGHUP,
+							GUC_UNIT_S,
+							NULL, NULL, NULL);
+
+	DefineCustomIntVariable("pgactive.queued_drops_retention",
+							"Sets how long rows are kept in pgactive.pgactive_queued_drops.",
+							"Older rows are deleted by the per-db worker. "
+							"If set to -1, rows are kept forever.",
+							&pgactive_queued_drops_retention,
+							-1, -1, INT_MAX,
+							PGC_SIGHUP,
+							GUC_UNIT_S,
+							NULL, NULL, NULL);
+
+	DefineCustomIntVariable("pgactive.history_prune_batch_size",
+							"Sets the number of rows the per-db worker deletes from a history table per transaction.",
+							NULL,
+							&pgactive_history_prune_batch_size,
+							1000, 1, INT_MAX,
+							PGC_SIGHUP,
+							0,
+							NULL, NULL, NULL);
+
 	EmitWarningsOnPlaceholders("pgactive");
 
 	/* Security label provider hook */
@@ -1283,6 +1460,11 @@ _PG_init(void)
 		pgactive_shmem_init();
 #endif
 
+#if PG_VERSION_NUM >= 180000
+		/* replication stats live in the cumulative statistics system */
+		pgactive_count_register_kind();
+#endif
+
 		pgactive_executor_init();
 
 		/* Set up a ProcessUtility_hook to stop unsupported commands being run */
@@ -1494,6 +1676,10 @@ pgactive_parse_slot_name_sql(PG_FUNCTION_ARGS)
 	memset(values, 0, sizeof(values));
 	memset(isnull, 0, sizeof(isnull));
 
+	/* Not a slot for a peer node, so callers can skip it */
+	if (!pgactive_is_node_slot_name(slot_name))
+		PG_RETURN_NULL();
+
 	pgactive_parse_slot_name(slot_name, &remote, &local_dboid);
 
 	snprintf(remote_sysid_str, sizeof(remote_sysid_str),
@@ -1723,7 +1909,8 @@ pgactive_skip_changes(PG_FUNCTION_ARGS)
 		{
 			(void) pgactiveWaitLatch(&MyProc->procLatch,
 									 WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
-									 500L, PG_WAIT_EXTENSION);
+									 500L,
+									 pgactive_wait_event(pgactive_WAIT_APPLY_WORKER_EXIT));
 			ResetLatch(&MyProc->procLatch);
 			CHECK_FOR_INTERRUPTS();
 		}
@@ -2215,6 +2402,7 @@ GetReplicationStats(StringInfoData *dsn, ReturnSetInfo *rsinfo)
 	PGconn	   *conn;
 	PGresult   *res;
 	StringInfoData cmd;
+	pgactiveRemoteQuery queries[2];
 	int			row,
 				col;
 
@@ -2234,10 +2422,15 @@ GetReplicationStats(StringInfoData *dsn, ReturnSetInfo *rsinfo)
 	if (PQstatus(conn) != CONNECTION_OK)
 		return;
 
+	memset(queries, 0, sizeof(queries));
+	queries[0].query = pgactive_ext_version_query;
+	queries[1].query = cmd.data;
+	pgactive_exec_pipeline(conn, queries, lengthof(queries));
+
 	/* Make sure pgactive is actually present and active on the remote */
-	pgactive_ensure_ext_installed(conn);
+	pgactive_ensure_ext_installed_result(queries[0].res);
 
-	res = PQexec(conn, cmd.data);
+	res = queries[1].res;
 
 	if (PQresultStatus(res) != PGRES_TUPLES_OK)
 	{
@@ -2321,7 +2514,7 @@ GetReplicationStats(StringInfoData *dsn, ReturnSetInfo *rsinfo)
 
 done:
 	pfree(cmd.data);
-	PQclear(res);
+	pgactive_clear_pipeline(queries, lengthof(queries));
 	PQfinish(conn);
 #undef GET_REPLICATION_LAG_INFO_COLS
 }
@@ -2381,6 +2574,176 @@ pgactive_get_replication_lag_info(PG_FUNCTION_ARGS)
 	PG_RETURN_VOID();
 }
 
+static Datum
+lag_to_interval_datum(TimeOffset lag)
+{
+	Interval   *result = palloc0(sizeof(Interval));
+
+	result->time = lag;
+
+	return IntervalPGetDatum(result);
+}
+
+/*
+ * Report replication lag of the current database's pgactive connections
+ * using only what our walsenders and apply workers keep in shared memory.
+ *
+ * Outbound rows come from walsenders streaming to peers and use the
+ * positions and lag times the walsender derives from the peer's feedback.
+ * Inbound rows come from apply workers and report how far apply is behind
+ * what has been received, and the delay between commit on the peer and
+ * apply here for the last applied transaction.
+ *
+ * Unlike pgactive_get_replication_lag_info() this doesn't connect to any
+ * node.
+ */
+Datum
+pgactive_get_local_replication_lag(PG_FUNCTION_ARGS)
+{
+#define pgactive_LOCAL_REPLICATION_LAG_COLS	15
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	XLogRecPtr	local_flush = GetFlushRecPtr();
+	int			i;
+
+	/* Construct the tuplestore and tuple descriptor */
+	InitMaterializedSRF(fcinfo, 0);
+
+	LWLockAcquire(pgactiveWorkerCtl->lock, LW_SHARED);
+	for (i = 0; i < pgactive_max_workers; i++)
+	{
+		pgactiveWorker *w = &pgactiveWorkerCtl->slots[i];
+		Datum		values[pgactive_LOCAL_REPLICATION_LAG_COLS] = {0};
+		bool		nulls[pgactive_LOCAL_REPLICATION_LAG_COLS] = {0};
+		pgactiveNodeId *remote_node;
+		char		sysid_str[33];
+
+		if (w->worker_type == pgactive_WORKER_APPLY)
+		{
+			pgactiveApplyWorker *aw = &w->data.apply;
+
+			if (aw->dboid != MyDatabaseId)
+				continue;
+
+			remote_node = &aw->remote_node;
+			values[3] = CStringGetTextDatum("inbound");
+
+			/* positions are those of the peer's WAL */
+			if (aw->last_received_lsn != InvalidXLogRecPtr)
+				values[5] = LSNGetDatum(aw->last_received_lsn);
+			else
+				nulls[5] = true;
+			nulls[6] = true;
+			nulls[7] = true;
+			if (aw->last_applied_lsn != InvalidXLogRecPtr)
+				values[8] = LSNGetDatum(aw->last_applied_lsn);
+			else
+				nulls[8] = true;
+
+			if (aw->last_received_lsn != InvalidXLogRecPtr &&
+				aw->last_applied_lsn != InvalidXLogRecPtr)
+				values[9] = Int64GetDatum(aw->last_received_lsn > aw->last_applied_lsn ?
+										  aw->last_received_lsn - aw->last_applied_lsn : 0);
+			else
+				nulls[9] = true;
+
+			nulls[10] = true;
+			nulls[11] = true;
+			if (aw->last_applied_xact_committs != 0)
+			{
+				values[12] = lag_to_interval_datum(aw->last_applied_xact_at -
+												   aw->last_applied_xact_committs);
+				values[13] = TimestampTzGetDatum(aw->last_applied_xact_committs);
+				values[14] = TimestampTzGetDatum(aw->last_applied_xact_at);
+			}
+			else
+			{
+				nulls[12] = true;
+				nulls[13] = true;
+				nulls[14] = true;
+			}
+		}
+		else if (w->worker_type == pgactive_WORKER_WALSENDER)
+		{
+			pgactiveWalsenderWorker *ws = &w->data.walsnd;
+			WalSnd	   *walsnd = ws->walsender;
+			XLogRecPtr	sent;
+			XLogRecPtr	write;
+			XLogRecPtr	flush;
+			XLogRecPtr	apply;
+			TimeOffset	lags[3];
+			int			j;
+
+			/* the SQL interface has no walsender to report on */
+			if (walsnd == NULL || ws->slot == NULL ||
+				ws->slot->data.database != MyDatabaseId)
+				continue;
+
+			SpinLockAcquire(&walsnd->mutex);
+			if (walsnd->pid != w->worker_pid)
+			{
+				SpinLockRelease(&walsnd->mutex);
+				continue;
+			}
+			sent = walsnd->sentPtr;
+			write = walsnd->write;
+			flush = walsnd->flush;
+			apply = walsnd->apply;
+			lags[0] = walsnd->writeLag;
+			lags[1] = walsnd->flushLag;
+			lags[2] = walsnd->applyLag;
+			SpinLockRelease(&walsnd->mutex);
+
+			remote_node = &ws->remote_node;
+			values[3] = CStringGetTextDatum("outbound");
+
+			values[5] = LSNGetDatum(sent);
+			values[6] = LSNGetDatum(write);
+			values[7] = LSNGetDatum(flush);
+			values[8] = LSNGetDatum(apply);
+
+			if (apply != InvalidXLogRecPtr)
+				values[9] = Int64GetDatum(local_flush > apply ? local_flush - apply : 0);
+			else
+				nulls[9] = true;
+
+			/* the walsender reports -1 while it can't tell yet */
+			for (j = 0; j < 3; j++)
+			{
+				if (lags[j] >= 0)
+					values[10 + j] = lag_to_interval_datum(lags[j]);
+				else
+					nulls[10 + j] = true;
+			}
+
+			if (ws->last_sent_xact_committs != 0)
+			{
+				values[13] = TimestampTzGetDatum(ws->last_sent_xact_committs);
+				values[14] = TimestampTzGetDatum(ws->last_sent_xact_at);
+			}
+			else
+			{
+				nulls[13] = true;
+				nulls[14] = true;
+			}
+		}
+		else
+			continue;
+
+		snprintf(sysid_str, sizeof(sysid_str), UINT64_FORMAT, remote_node->sysid);
+		values[0] = CStringGetTextDatum(sysid_str);
+		values[1] = ObjectIdGetDatum(remote_node->timeline);
+		values[2] = ObjectIdGetDatum(remote_node->dboid);
+		values[4] = Int32GetDatum(w->worker_pid);
+
+		tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc,
+							 values, nulls);
+	}
+	LWLockRelease(pgactiveWorkerCtl->lock);
+
+	PG_RETURN_VOID();
+#undef pgactive_LOCAL_REPLICATION_LAG_COLS
+}
+
 /* For 2.1.0 backward compatibility */
 Datum
 get_free_disk_space(PG_FUNCTION_ARGS)
@@ -19,6 +19,7 @@
 #include "pgactive.h"
 #include "pgactive_locks.h"
 #include "pgactive_messaging.h"
+#include "pgactive_probes.h"
 
 #include "funcapi.h"
 #include "libpq-fe.h"
@@ -47,6 +48,8 @@
 
 #include "parser/parse_type.h"
 
+#include "port/pg_bitutils.h"
+
 #include "replication/logical.h"
 #include "replication/origin.h"
 
@@ -134,6 +137,13 @@ static pgactiveConnectionConfig * pgactive_apply_config = NULL;
 
 static dlist_head pgactive_lsn_association = DLIST_STATIC_INIT(pgactive_lsn_association);
 
+/*
+ * Time spent in each phase of apply that's yet to be added to the worker's
+ * shared memory, see apply_timing_flush().
+ */
+static pgactiveApplyPhaseTiming pending_timing[pgactive_APPLY_PHASE_COUNT];
+static bool pending_timing_valid = false;
+
 struct ActionErrCallbackArg
 {
 	const char *action_name;
@@ -175,6 +185,149 @@ static void abs_timestamp_difference(TimestampTz start_time,
 static void log_tuple(const char *format, TupleDesc desc, HeapTuple tup);
 #endif
 
+/*
+ * Start timing a phase of apply, if pgactive.track_apply_timing is on.
+ */
+static inline void
+apply_timing_start(instr_time *start)
+{
+	if (pgactive_track_apply_timing)
+		INSTR_TIME_SET_CURRENT(*start);
+	else
+		INSTR_TIME_SET_ZERO(*start);
+}
+
+static void
+apply_timing_add(pgactiveApplyPhase phase, instr_time *start)
+{
+	pgactiveApplyPhaseTiming *timing = &pending_timing[phase];
+	instr_time	duration;
+	int64		us;
+	int			bucket;
+
+	INSTR_TIME_SET_CURRENT(duration);
+	INSTR_TIME_SUBTRACT(duration, *start);
+	us = INSTR_TIME_GET_MICROSEC(duration);
+
+	bucket = us < 2 ? 0 : pg_leftmost_one_pos64(us);
+	bucket = Min(bucket, pgactive_APPLY_TIMING_BUCKETS - 1);
+
+	timing->count++;
+	timing->total_us += us;
+	timing->buckets[bucket]++;
+	pending_timing_valid = true;
+}
+
+/*
+ * Record the time spent in a phase of apply since apply_timing_start().
+ */
+static inline void
+apply_timing_end(pgactiveApplyPhase phase, instr_time *start)
+{
+	if (!INSTR_TIME_IS_ZERO(*start))
+		apply_timing_add(phase, start);
+}
+
+/*
+ * Add the time spent in each phase of apply since the last call to the
+ * worker's shared memory, where pgactive.pgactive_apply_timing shows it.
+ */
+static void
+apply_timing_flush(void)
+{
+	pgactiveApplyTiming *timing = &pgactive_apply_worker->timing;
+	int			i;
+	int			j;
+
+	if (!pending_timing_valid)
+		return;
+
+	SpinLockAcquire(&timing->mutex);
+	for (i = 0; i < pgactive_APPLY_PHASE_COUNT; i++)
+	{
+		timing->phases[i].count += pending_timing[i].count;
+		timing->phases[i].total_us += pending_timing[i].total_us;
+		for (j = 0; j < pgactive_APPLY_TIMING_BUCKETS; j++)
+			timing->phases[i].buckets[j] += pending_timing[i].buckets[j];
+	}
+	SpinLockRelease(&timing->mutex);
+
+	memset(pending_timing, 0, sizeof(pending_timing));
+	pending_timing_valid = false;
+}
+
+/*
+ * Progress of the remote transaction being applied, as shown by
+ * pgactive.pgactive_stat_progress_apply.
+ */
+static void
+apply_progress_begin(TransactionId xid, XLogRecPtr commit_lsn,
+					 TimestampTz committs, int64 changes_total)
+{
+	pgactiveApplyProgress *progress = &pgactive_apply_worker->progress;
+	TimestampTz now = GetCurrentTimestamp();
+
+	SpinLockAcquire(&progress->mutex);
+	progress->xid = xid;
+	progress->commit_lsn = commit_lsn;
+	progress->committs = committs;
+	progress->started_at = now;
+	progress->changes_total = changes_total;
+	progress->inserts = 0;
+	progress->updates = 0;
+	progress->deletes = 0;
+	progress->current_relid = InvalidOid;
+	progress->bytes = 0;
+	SpinLockRelease(&progress->mutex);
+}
+
+/*
+ * Report the relation a change is being applied to.
+ */
+static void
+apply_progress_relation(Oid relid)
+{
+	pgactiveApplyProgress *progress = &pgactive_apply_worker->progress;
+
+	SpinLockAcquire(&progress->mutex);
+	progress->current_relid = relid;
+	SpinLockRelease(&progress->mutex);
+}
+
+/*
+ * Count a change of the given action ('I', 'U' or 'D') that's been applied,
+ * and the size of the message it came in.
+ */
+static void
+apply_progress_change(char action, int bytes)
+{
+	pgactiveApplyProgress *progress = &pgactive_apply_worker->progress;
+
+	SpinLockAcquire(&progress->mutex);
+	if (action == 'I')
+		progress->inserts++;
+	else if (action == 'U')
+		progress->updates++;
+	else
+		progress->deletes++;
+	progress->bytes += bytes;
+	SpinLockRelease(&progress->mutex);
+}
+
+/*
+ * Forget the transaction once it's committed or aborted.
+ */
+static void
+apply_progress_end(void)
+{
+	pgactiveApplyProgress *progress = &pgactive_apply_worker->progress;
+
+	SpinLockAcquire(&progress->mutex);
+	progress->xid = InvalidTransactionId;
+	progress->current_relid = InvalidOid;
+	SpinLockRelease(&progress->mutex);
+}
+
 static void
 format_action_description(
 						  StringInfo si,
@@ -268,6 +421,7 @@ process_remote_begin(StringInfo s)
 	char		statbuf[100];
 	int			apply_delay = pgactive_apply_config->apply_delay;
 	int			flags = 0;
+	int64		changes_total = -1;
 	ErrorContextCallback errcallback;
 	struct ActionErrCallbackArg cbarg;
 
@@ -310,6 +464,11 @@ process_remote_begin(StringInfo s)
 		remote_origin_lsn = InvalidXLogRecPtr;
 	}
 
+	if (flags & pgactive_OUTPUT_TRANSACTION_HAS_CHANGE_COUNT)
+		changes_total = pq_getmsgint64(s);
+
+	apply_progress_begin(remote_xid, commit_afterend_lsn, committime,
+						 changes_total);
 
 	/*
 	 * Set up state for commit and conflict detection. The timestamp will be
@@ -328,6 +487,8 @@ process_remote_begin(StringInfo s)
 	/* store remote xid for logging and debugging */
 	replication_origin_xid = remote_xid;
 
+	TRACE_PGACTIVE_APPLY_BEGIN(remote_xid, commit_afterend_lsn, committime);
+
 	snprintf(statbuf, sizeof(statbuf),
 			 "pgactive_apply: BEGIN origin(orig_lsn, timestamp): %X/%X, %s",
 			 LSN_FORMAT_ARGS(replorigin_session_origin_lsn),
@@ -445,7 +606,8 @@ process_remote_begin(StringInfo s)
 
 			(void) pgactiveWaitLatch(&MyProc->procLatch,
 									 WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
-									 delay_ms, PG_WAIT_EXTENSION);
+									 delay_ms,
+									 pgactive_wait_event(pgactive_WAIT_APPLY_DELAY));
 			ResetLatch(&MyProc->procLatch);
 			CHECK_FOR_INTERRUPTS();
 		}
@@ -517,8 +679,11 @@ process_remote_commit(StringInfo s)
 	if (started_transaction)
 	{
 		pgactiveFlushPosition *flushpos;
+		instr_time	phase_start;
 
+		apply_timing_start(&phase_start);
 		CommitTransactionCommand();
+		apply_timing_end(pgactive_APPLY_PHASE_COMMIT, &phase_start);
 		MemoryContextSwitchTo(MessageContext);
 
 		/*
@@ -566,11 +731,20 @@ process_remote_commit(StringInfo s)
 	CurrentResourceOwner = pgactive_saved_resowner;
 
 	pgactive_count_commit();
+	pgactive_count_relation_flush();
+	apply_timing_flush();
+	pgactive_conflict_logging_flush();
+	apply_progress_end();
 
 	/* Save last applied transaction info */
 	pgactive_apply_worker->last_applied_xact_id = replication_origin_xid;
 	pgactive_apply_worker->last_applied_xact_committs = replorigin_session_origin_timestamp;
 	pgactive_apply_worker->last_applied_xact_at = GetCurrentTimestamp();
+	pgactive_apply_worker->last_applied_lsn = replorigin_session_origin_lsn;
+
+	TRACE_PGACTIVE_APPLY_COMMIT(replication_origin_xid,
+								replorigin_session_origin_lsn,
+								replorigin_session_origin_timestamp);
 
 	replication_origin_xid = InvalidTransactionId;
 	replorigin_session_origin_lsn = InvalidXLogRecPtr;
@@ -631,7 +805,11 @@ process_remote_insert(StringInfo s)
 	ErrorContextCallback errcallback;
 	struct ActionErrCallbackArg cbarg;
 	UserContext ucxt;
+	Oid			relid;
+	instr_time	start;
+	instr_time	phase_start;
 
+	pgactive_count_relation_start(&start);
 	ItemPointerSetInvalid(&conflicting_tid);
 
 	xact_action_counter++;
@@ -647,6 +825,9 @@ process_remote_insert(StringInfo s)
 	Assert(pgactive_apply_worker != NULL);
 
 	rel = read_rel(s, RowExclusiveLock, &cbarg);
+	relid = RelationGetRelid(rel->rel);
+	TRACE_PGACTIVE_APPLY_CHANGE_START(relid, 'I');
+	apply_progress_relation(relid);
 
 	if (pgactive_apply_as_table_owner)
 	{
@@ -674,6 +855,7 @@ process_remote_insert(StringInfo s)
 	newslot = ExecInitExtraTupleSlotpgactive(estate, NULL);
 	ExecSetSlotDescriptor(newslot, RelationGetDescr(rel->rel));
 
+	apply_timing_start(&phase_start);
 	read_tuple_parts(s, rel, &new_tuple);
 	{
 		HeapTuple	tup;
@@ -682,6 +864,7 @@ process_remote_insert(StringInfo s)
 							  new_tuple.values, new_tuple.isnull);
 		ExecStoreHeapTuple(tup, newslot, true);
 	}
+	apply_timing_end(pgactive_APPLY_PHASE_DECODE, &phase_start);
 
 	if (rel->rel->rd_rel->relkind != RELKIND_RELATION)
 		elog(ERROR, "unexpected relkind '%c' rel \"%s\"",
@@ -695,6 +878,7 @@ process_remote_insert(StringInfo s)
 	/*
 	 * Search for conflicting tuples.
 	 */
+	apply_timing_start(&phase_start);
 	ExecOpenIndices(relinfo, false);
 
 	index_keys = palloc0(relinfo->ri_NumIndices * sizeof(ScanKeyData *));
@@ -762,6 +946,7 @@ process_remote_insert(StringInfo s)
 
 		CHECK_FOR_INTERRUPTS();
 	}
+	apply_timing_end(pgactive_APPLY_PHASE_LOOKUP, &phase_start);
 
 	PushActiveSnapshot(GetTransactionSnapshot());
 
@@ -779,6 +964,7 @@ process_remote_insert(StringInfo s)
 		pgactiveApplyConflict *apply_conflict = NULL;	/* Mute compiler */
 		pgactiveConflictResolution resolution;
 
+		apply_timing_start(&phase_start);
 		get_local_tuple_origin(TTS_TUP(oldslot), &local_ts, &local_node_id);
 
 		/*
@@ -803,7 +989,9 @@ process_remote_insert(StringInfo s)
 			pgactive_conflict_log_serverlog(apply_conflict);
 
 			pgactive_count_insert_conflict();
+			pgactive_count_relation_conflict(relid, pgactiveConflictType_InsertInsert);
 		}
+		apply_timing_end(pgactive_APPLY_PHASE_CONFLICT, &phase_start);
 
 		/*
 		 * Finally, apply the update.
@@ -828,12 +1016,14 @@ process_remote_insert(StringInfo s)
 				ExecStoreHeapTuple(user_tuple, newslot, true);
 			}
 
+			apply_timing_start(&phase_start);
 #if PG_VERSION_NUM >= 160000
 			simple_table_tuple_update(rel->rel,
 									  &(oldslot->tts_tid),
 									  newslot,
 									  estate->es_snapshot,
 									  &update_indexes);
+			apply_timing_end(pgactive_APPLY_PHASE_HEAP_WRITE, &phase_start);
 
 			if (update_indexes != TU_None)
 #elif PG_VERSION_NUM >= 120000
@@ -842,35 +1032,50 @@ process_remote_insert(StringInfo s)
 									  newslot,
 									  estate->es_snapshot,
 									  &update_indexes);
+			apply_timing_end(pgactive_APPLY_PHASE_HEAP_WRITE, &phase_start);
 
 			if (update_indexes)
 #else
 			simple_heap_update(rel->rel,
 							   &(TTS_TUP(oldslot)->t_self),
 							   TTS_TUP(newslot));
+			apply_timing_end(pgactive_APPLY_PHASE_HEAP_WRITE, &phase_start);
 #endif
-			/* races will be resolved by abort/retry */
-			UserTableUpdateOpenIndexes(estate, newslot, relinfo, false);
+			{
+				/* races will be resolved by abort/retry */
+				apply_timing_start(&phase_start);
+				UserTableUpdateOpenIndexes(estate, newslot, relinfo, false);
+				apply_timing_end(pgactive_APPLY_PHASE_INDEX_UPDATE, &phase_start);
+			}
 
 			pgactive_count_insert();
+			pgactive_count_relation_insert(relid);
 		}
 
 		/* Log conflict to table */
 		if (log_update)
 		{
+			apply_timing_start(&phase_start);
 			pgactive_conflict_log_table(apply_conflict);
 			pgactive_conflict_logging_cleanup();
+			apply_timing_end(pgactive_APPLY_PHASE_CONFLICT, &phase_start);
 		}
 	}
 	else
 	{
+		apply_timing_start(&phase_start);
 #if PG_VERSION_NUM >= 120000
 		simple_table_tuple_insert(relinfo->ri_RelationDesc, newslot);
 #else
 		simple_heap_insert(rel->rel, TTS_TUP(newslot));
 #endif
+		apply_timing_end(pgactive_APPLY_PHASE_HEAP_WRITE, &phase_start);
+
+		apply_timing_start(&phase_start);
 		UserTableUpdateOpenIndexes(estate, newslot, relinfo, false);
+		apply_timing_end(pgactive_APPLY_PHASE_INDEX_UPDATE, &phase_start);
 		pgactive_count_insert();
+		pgactive_count_relation_insert(relid);
 	}
 
 	PopActiveSnapshot();
@@ -886,13 +1091,12 @@ process_remote_insert(StringInfo s)
 	 * execute DDL if insertion was into the ddl command queue and if ddl
 	 * replication is wanted
 	 */
-	if (!prev_pgactive_skip_ddl_replication && (RelationGetRelid(rel->rel) == QueuedDDLCommandsRelid ||
-												RelationGetRelid(rel->rel) == QueuedDropsRelid))
+	if (!prev_pgactive_skip_ddl_replication && (relid == QueuedDDLCommandsRelid ||
+												relid == QueuedDropsRelid))
 	{
 		HeapTuple	ht;
 		LockRelId	lockid = rel->rel->rd_lockInfo.lockRelId;
 		TransactionId oldxid = GetTopTransactionId();
-		Oid			relid = RelationGetRelid(rel->rel);
 		Relation	qrel;
 
 		/* there never should be conflicts on these */
@@ -912,6 +1116,7 @@ process_remote_insert(StringInfo s)
 		ExecResetTupleTable(estate->es_tupleTable, true);
 		FreeExecutorState(estate);
 
+		apply_timing_start(&phase_start);
 		if (relid == QueuedDDLCommandsRelid)
 		{
 			cbarg.action_name = "QUEUED_DDL";
@@ -922,6 +1127,7 @@ process_remote_insert(StringInfo s)
 			cbarg.action_name = "QUEUED_DROP";
 			process_queued_drop(ht);
 		}
+		apply_timing_end(pgactive_APPLY_PHASE_DDL, &phase_start);
 
 		qrel = table_open(QueuedDDLCommandsRelid, RowExclusiveLock);
 
@@ -943,6 +1149,10 @@ process_remote_insert(StringInfo s)
 		FreeExecutorState(estate);
 	}
 
+	pgactive_count_relation_apply(relid, s->len, start);
+	apply_progress_change('I', s->len);
+	TRACE_PGACTIVE_APPLY_CHANGE_DONE(relid, 'I');
+
 	CommandCounterIncrement();
 
 	if (error_context_stack == &errcallback)
@@ -970,6 +1180,11 @@ process_remote_update(StringInfo s)
 	struct ActionErrCallbackArg cbarg;
 	ResultRelInfo *relinfo = makeNode(ResultRelInfo);
 	UserContext ucxt;
+	Oid			relid;
+	instr_time	start;
+	instr_time	phase_start;
+
+	pgactive_count_relation_start(&start);
 
 	xact_action_counter++;
 	memset(&cbarg, 0, sizeof(struct ActionErrCallbackArg));
@@ -982,6 +1197,9 @@ process_remote_update(StringInfo s)
 	pgactive_performing_work();
 
 	rel = read_rel(s, RowExclusiveLock, &cbarg);
+	relid = RelationGetRelid(rel->rel);
+	TRACE_PGACTIVE_APPLY_CHANGE_START(relid, 'U');
+	apply_progress_relation(relid);
 
 	if (pgactive_apply_as_table_owner)
 	{
@@ -1010,6 +1228,7 @@ process_remote_update(StringInfo s)
 	newslot = ExecInitExtraTupleSlotpgactive(estate, NULL);
 	ExecSetSlotDescriptor(newslot, RelationGetDescr(rel->rel));
 
+	apply_timing_start(&phase_start);
 	if (action == 'K')
 	{
 		pkey_sent = true;
@@ -1029,6 +1248,7 @@ process_remote_update(StringInfo s)
 
 	/* read new tuple */
 	read_tuple_parts(s, rel, &new_tuple);
+	apply_timing_end(pgactive_APPLY_PHASE_DECODE, &phase_start);
 
 	/* lookup index to build scankey */
 	idxoid = RelationGetReplicaIndex(rel->rel);
@@ -1054,8 +1274,10 @@ process_remote_update(StringInfo s)
 	PushActiveSnapshot(GetTransactionSnapshot());
 
 	/* look for tuple identified by the (old) primary key */
+	apply_timing_start(&phase_start);
 	found_tuple = find_pkey_tuple(skey, rel, idxrel, oldslot, true,
 								  pkey_sent ? LockTupleExclusive : LockTupleNoKeyExclusive);
+	apply_timing_end(pgactive_APPLY_PHASE_LOOKUP, &phase_start);
 
 	if (found_tuple)
 	{
@@ -1087,6 +1309,7 @@ process_remote_update(StringInfo s)
 		}
 #endif
 
+		apply_timing_start(&phase_start);
 		get_local_tuple_origin(TTS_TUP(oldslot), &local_ts, &local_node_id);
 
 		/*
@@ -1112,7 +1335,9 @@ process_remote_update(StringInfo s)
 			pgactive_conflict_log_serverlog(apply_conflict);
 
 			pgactive_count_update_conflict();
+			pgactive_count_relation_conflict(relid, pgactiveConflictType_UpdateUpdate);
 		}
+		apply_timing_end(pgactive_APPLY_PHASE_CONFLICT, &phase_start);
 
 		if (apply_update)
 		{
@@ -1134,12 +1359,14 @@ process_remote_update(StringInfo s)
 				ExecStoreHeapTuple(user_tuple, newslot, true);
 			}
 
+			apply_timing_start(&phase_start);
 #if PG_VERSION_NUM >= 160000
 			simple_table_tuple_update(rel->rel,
 									  &(oldslot->tts_tid),
 									  newslot,
 									  estate->es_snapshot,
 									  &update_indexes);
+			apply_timing_end(pgactive_APPLY_PHASE_HEAP_WRITE, &phase_start);
 
 			if (update_indexes != TU_None)
 #elif PG_VERSION_NUM >= 120000
@@ -1148,20 +1375,29 @@ process_remote_update(StringInfo s)
 									  newslot,
 									  estate->es_snapshot,
 									  &update_indexes);
+			apply_timing_end(pgactive_APPLY_PHASE_HEAP_WRITE, &phase_start);
 
 			if (update_indexes)
 #else
 			simple_heap_update(rel->rel, &(TTS_TUP(oldslot)->t_self), TTS_TUP(newslot));
+			apply_timing_end(pgactive_APPLY_PHASE_HEAP_WRITE, &phase_start);
 #endif
-			UserTableUpdateIndexes(estate, newslot, relinfo);
+			{
+				apply_timing_start(&phase_start);
+				UserTableUpdateIndexes(estate, newslot, relinfo);
+				apply_timing_end(pgactive_APPLY_PHASE_INDEX_UPDATE, &phase_start);
+			}
 			pgactive_count_update();
+			pgactive_count_relation_update(relid);
 		}
 
 		/* Log conflict to table */
 		if (log_update)
 		{
+			apply_timing_start(&phase_start);
 			pgactive_conflict_log_table(apply_conflict);
 			pgactive_conflict_logging_cleanup();
+			apply_timing_end(pgactive_APPLY_PHASE_CONFLICT, &phase_start);
 		}
 	}
 	else
@@ -1176,6 +1412,9 @@ process_remote_update(StringInfo s)
 		pgactiveApplyConflict *apply_conflict;
 		pgactiveConflictResolution resolution;
 
+		apply_timing_start(&phase_start);
+		TRACE_PGACTIVE_CONFLICT_DETECTED(relid, pgactiveConflictType_UpdateDelete);
+
 		remote_tuple = heap_form_tuple(RelationGetDescr(rel->rel),
 									   new_tuple.values,
 									   new_tuple.isnull);
@@ -1188,6 +1427,7 @@ process_remote_update(StringInfo s)
 														0, &skip);
 
 		pgactive_count_update_conflict();
+		pgactive_count_relation_conflict(relid, pgactiveConflictType_UpdateDelete);
 
 		if (skip)
 			resolution = pgactiveConflictResolution_ConflictTriggerSkipChange;
@@ -1196,6 +1436,8 @@ process_remote_update(StringInfo s)
 		else
 			resolution = pgactiveConflictResolution_DefaultSkipChange;
 
+		TRACE_PGACTIVE_CONFLICT_RESOLVED(relid, pgactiveConflictType_UpdateDelete,
+										 resolution);
 
 		apply_conflict = pgactive_make_apply_conflict(
 													  pgactiveConflictType_UpdateDelete, resolution, replication_origin_xid,
@@ -1224,6 +1466,7 @@ process_remote_update(StringInfo s)
 
 		pgactive_conflict_log_table(apply_conflict);
 		pgactive_conflict_logging_cleanup();
+		apply_timing_end(pgactive_APPLY_PHASE_CONFLICT, &phase_start);
 	}
 
 	PopActiveSnapshot();
@@ -1240,6 +1483,10 @@ process_remote_update(StringInfo s)
 	ExecResetTupleTable(estate->es_tupleTable, true);
 	FreeExecutorState(estate);
 
+	pgactive_count_relation_apply(relid, s->len, start);
+	apply_progress_change('U', s->len);
+	TRACE_PGACTIVE_APPLY_CHANGE_DONE(relid, 'U');
+
 	CommandCounterIncrement();
 
 	if (error_context_stack == &errcallback)
@@ -1262,9 +1509,14 @@ process_remote_delete(StringInfo s)
 	struct ActionErrCallbackArg cbarg;
 	ResultRelInfo *relinfo = makeNode(ResultRelInfo);
 	UserContext ucxt;
+	Oid			relid;
+	instr_time	start;
+	instr_time	phase_start;
 
 	Assert(pgactive_apply_worker != NULL);
 
+	pgactive_count_relation_start(&start);
+
 	xact_action_counter++;
 	memset(&cbarg, 0, sizeof(struct ActionErrCallbackArg));
 	cbarg.action_name = "DELETE";
@@ -1276,6 +1528,9 @@ process_remote_delete(StringInfo s)
 	pgactive_performing_work();
 
 	rel = read_rel(s, RowExclusiveLock, &cbarg);
+	relid = RelationGetRelid(rel->rel);
+	TRACE_PGACTIVE_APPLY_CHANGE_START(relid, 'D');
+	apply_progress_relation(relid);
 
 	if (pgactive_apply_as_table_owner)
 	{
@@ -1298,6 +1553,7 @@ process_remote_delete(StringInfo s)
 		if (pgactive_apply_as_table_owner)
 			RestoreUserContext(&ucxt);
 		pgactive_table_close(rel, NoLock);
+		TRACE_PGACTIVE_APPLY_CHANGE_DONE(relid, 'D');
 		return;
 	}
 
@@ -1309,7 +1565,9 @@ process_remote_delete(StringInfo s)
 	ExecSetSlotDescriptor(oldslot, RelationGetDescr(rel->rel));
 #endif
 
+	apply_timing_start(&phase_start);
 	read_tuple_parts(s, rel, &oldtup);
+	apply_timing_end(pgactive_APPLY_PHASE_DECODE, &phase_start);
 
 	/* lookup index to build scankey */
 	if (rel->rel->rd_indexvalid == 0)
@@ -1348,12 +1606,17 @@ process_remote_delete(StringInfo s)
 	build_index_scan_key(skey, rel->rel, idxrel, &oldtup);
 
 	/* try to find tuple via a (candidate|primary) key */
+	apply_timing_start(&phase_start);
 	found_old = find_pkey_tuple(skey, rel, idxrel, oldslot, true, LockTupleExclusive);
+	apply_timing_end(pgactive_APPLY_PHASE_LOOKUP, &phase_start);
 
 	if (found_old)
 	{
+		apply_timing_start(&phase_start);
 		simple_heap_delete(rel->rel, &(TTS_TUP(oldslot)->t_self));
+		apply_timing_end(pgactive_APPLY_PHASE_HEAP_WRITE, &phase_start);
 		pgactive_count_delete();
+		pgactive_count_relation_delete(relid);
 	}
 	else
 	{
@@ -1376,7 +1639,10 @@ process_remote_delete(StringInfo s)
 					user_tuple = NULL;
 		pgactiveApplyConflict *apply_conflict;
 
+		apply_timing_start(&phase_start);
+		TRACE_PGACTIVE_CONFLICT_DETECTED(relid, pgactiveConflictType_DeleteDelete);
 		pgactive_count_delete_conflict();
+		pgactive_count_relation_conflict(relid, pgactiveConflictType_DeleteDelete);
 
 		/* Since the local tuple is missing, fill slot from the received data. */
 		remote_tuple = heap_form_tuple(RelationGetDescr(rel->rel),
@@ -1412,6 +1678,10 @@ process_remote_delete(StringInfo s)
 			ereport(ERROR,
 					(errmsg("DELETE vs DELETE handler returned a row which isn't allowed")));
 
+		TRACE_PGACTIVE_CONFLICT_RESOLVED(relid, pgactiveConflictType_DeleteDelete,
+										 skip ? pgactiveConflictResolution_ConflictTriggerSkipChange :
+										 pgactiveConflictResolution_DefaultSkipChange);
+
 		apply_conflict = pgactive_make_apply_conflict(
 													  pgactiveConflictType_DeleteDelete,
 													  skip ? pgactiveConflictResolution_ConflictTriggerSkipChange :
@@ -1422,6 +1692,7 @@ process_remote_delete(StringInfo s)
 		pgactive_conflict_log_serverlog(apply_conflict);
 		pgactive_conflict_log_table(apply_conflict);
 		pgactive_conflict_logging_cleanup();
+		apply_timing_end(pgactive_APPLY_PHASE_CONFLICT, &phase_start);
 	}
 
 	PopActiveSnapshot();
@@ -1437,6 +1708,10 @@ process_remote_delete(StringInfo s)
 	ExecResetTupleTable(estate->es_tupleTable, true);
 	FreeExecutorState(estate);
 
+	pgactive_count_relation_apply(relid, s->len, start);
+	apply_progress_change('D', s->len);
+	TRACE_PGACTIVE_APPLY_CHANGE_DONE(relid, 'D');
+
 	CommandCounterIncrement();
 
 	if (error_context_stack == &errcallback)
@@ -1582,6 +1857,8 @@ check_apply_update(pgactiveConflictType conflict_type,
 		return;
 	}
 
+	TRACE_PGACTIVE_CONFLICT_DETECTED(RelationGetRelid(rel->rel), conflict_type);
+
 	/*
 	 * Decide whether to keep the remote or local tuple based on a conflict
 	 * trigger (if defined) or last-update-wins.
@@ -1614,6 +1891,8 @@ check_apply_update(pgactiveConflictType conflict_type,
 			*log_update = true;
 			*perform_update = false;
 			*resolution = pgactiveConflictResolution_ConflictTriggerSkipChange;
+			TRACE_PGACTIVE_CONFLICT_RESOLVED(RelationGetRelid(rel->rel),
+											 conflict_type, *resolution);
 			return;
 		}
 		else if (*new_tuple)
@@ -1622,6 +1901,8 @@ check_apply_update(pgactiveConflictType conflict_type,
 			*log_update = true;
 			*perform_update = true;
 			*resolution = pgactiveConflictResolution_ConflictTriggerReturnedTuple;
+			TRACE_PGACTIVE_CONFLICT_RESOLVED(RelationGetRelid(rel->rel),
+											 conflict_type, *resolution);
 			return;
 		}
 
@@ -1638,6 +1919,9 @@ check_apply_update(pgactiveConflictType conflict_type,
 									   replorigin_session_origin_timestamp,
 									   perform_update, log_update,
 									   resolution);
+
+	TRACE_PGACTIVE_CONFLICT_RESOLVED(RelationGetRelid(rel->rel),
+									 conflict_type, *resolution);
 }
 
 static void
@@ -2176,6 +2460,99 @@ read_tuple_parts_error_badatts(pgactiveRelation * rel, TupleDesc desc, int rnatt
 			 errhint("This error arises if the number of columns on two nodes differ and pgactive cannot right-pad with nulls or ignore extra right-hand nulls. This is most commonly caused by unsafe use of the pgactive.skip_ddl_replication and/or pgactive.skip_ddl_locking settings.")));
 }
 
+/*
+ * Read one column of a tuple written by the output plugin's write_tuple().
+ *
+ * Data read in binary format points into the message buffer.
+ */
+static inline void
+read_datum(StringInfo s, Form_pg_attribute att, Datum *value, bool *isnull,
+		   bool *changed)
+{
+	char		kind;
+	const char *data;
+	int			len;
+
+	kind = pq_getmsgbyte(s);
+
+	*isnull = true;
+	*changed = true;
+
+	switch (kind)
+	{
+		case 'n':				/* null */
+			*value = 0xdeadbeef;
+			break;
+		case 'u':				/* unchanged column */
+			*changed = false;
+			*value = 0xdeadbeef;	/* make bad usage more obvious */
+			break;
+
+		case 'b':				/* binary format */
+			*isnull = false;
+			len = pq_getmsgint(s, 4);	/* read length */
+
+			data = pq_getmsgbytes(s, len);
+
+			/* and data */
+			if (att->attbyval)
+				*value = fetch_att(data, true, len);
+			else
+				*value = PointerGetDatum(data);
+			break;
+		case 's':				/* send/recv format */
+			{
+				Oid			typreceive;
+				Oid			typioparam;
+				StringInfoData buf;
+
+				*isnull = false;
+				len = pq_getmsgint(s, 4);	/* read length */
+
+				getTypeBinaryInputInfo(att->atttypid,
+									   &typreceive, &typioparam);
+
+				/*
+				 * Create StringInfo pointing into the bigger buffer. First
+				 * free the palloc-ed memory that initStringInfo gives to not
+				 * leak any memory.
+				 */
+				initStringInfo(&buf);
+				pfree(buf.data);
+				buf.data = (char *) pq_getmsgbytes(s, len);
+				buf.len = len;
+				*value = OidReceiveFunctionCall(typreceive, &buf, typioparam,
+												att->atttypmod);
+
+				if (buf.len != buf.cursor)
+					ereport(ERROR,
+							(errcode(ERRCODE_INVALID_BINARY_REPRESENTATION),
+							 errmsg("incorrect binary data format")));
+				break;
+			}
+		case 't':				/* text format */
+			{
+				Oid			typinput;
+				Oid			typioparam;
+
+				*isnull = false;
+				len = pq_getmsgint(s, 4);	/* read length */
+
+				getTypeInputInfo(att->atttypid, &typinput, &typioparam);
+				/* and data */
+				data = (char *) pq_getmsgbytes(s, len);
+				*value = OidInputFunctionCall(typinput, (char *) data,
+											  typioparam, att->atttypmod);
+			}
+			break;
+		default:
+			elog(ERROR, "unknown column type '%c'", kind);
+	}
+
+	if (att->attisdropped && !*isnull)
+		elog(ERROR, "data for dropped column");
+}
+
 static void
 read_tuple_parts(StringInfo s, pgactiveRelation * rel, pgactiveTupleData * tup)
 {
@@ -2198,91 +2575,8 @@ read_tuple_parts(StringInfo s, pgactiveRelation * rel, pgactiveTupleData * tup)
 
 	/* Consume remote data as long as there's a local column to put it in */
 	for (i = 0; i < Min(desc->natts, rnatts); i++)
-	{
-		FormData_pg_attribute *att = TupleDescAttr(desc, i);
-		char		kind;
-		const char *data;
-		int			len;
-
-		kind = pq_getmsgbyte(s);
-
-		switch (kind)
-		{
-			case 'n':			/* null */
-				/* already marked as null */
-				tup->values[i] = 0xdeadbeef;
-				break;
-			case 'u':			/* unchanged column */
-				tup->isnull[i] = true;
-				tup->changed[i] = false;
-				tup->values[i] = 0xdeadbeef;	/* make bad usage more obvious */
-
-				break;
-
-			case 'b':			/* binary format */
-				tup->isnull[i] = false;
-				len = pq_getmsgint(s, 4);	/* read length */
-
-				data = pq_getmsgbytes(s, len);
-
-				/* and data */
-				if (att->attbyval)
-					tup->values[i] = fetch_att(data, true, len);
-				else
-					tup->values[i] = PointerGetDatum(data);
-				break;
-			case 's':			/* send/recv format */
-				{
-					Oid			typreceive;
-					Oid			typioparam;
-					StringInfoData buf;
-
-					tup->isnull[i] = false;
-					len = pq_getmsgint(s, 4);	/* read length */
-
-					getTypeBinaryInputInfo(att->atttypid,
-										   &typreceive, &typioparam);
-
-					/*
-					 * Create StringInfo pointing into the bigger buffer.
-					 * First free the palloc-ed memory that initStringInfo
-					 * gives to not leak any memory.
-					 */
-					initStringInfo(&buf);
-					pfree(buf.data);
-					buf.data = (char *) pq_getmsgbytes(s, len);
-					buf.len = len;
-					tup->values[i] = OidReceiveFunctionCall(
-															typreceive, &buf, typioparam, att->atttypmod);
-
-					if (buf.len != buf.cursor)
-						ereport(ERROR,
-								(errcode(ERRCODE_INVALID_BINARY_REPRESENTATION),
-								 errmsg("incorrect binary data format")));
-					break;
-				}
-			case 't':			/* text format */
-				{
-					Oid			typinput;
-					Oid			typioparam;
-
-					tup->isnull[i] = false;
-					len = pq_getmsgint(s, 4);	/* read length */
-
-					getTypeInputInfo(att->atttypid, &typinput, &typioparam);
-					/* and data */
-					data = (char *) pq_getmsgbytes(s, len);
-					tup->values[i] = OidInputFunctionCall(
-														  typinput, (char *) data, typioparam, att->atttypmod);
-				}
-				break;
-			default:
-				elog(ERROR, "unknown column type '%c'", kind);
-		}
-
-		if (att->attisdropped && !tup->isnull[i])
-			elog(ERROR, "data for dropped column");
-	}
+		read_datum(s, TupleDescAttr(desc, i), &tup->values[i],
+				   &tup->isnull[i], &tup->changed[i]);
 
 	/*
 	 * Handle some remote rows that are narrower than the local table. Hotfix
@@ -2569,6 +2863,8 @@ pgactive_send_feedback(PGconn *conn, XLogRecPtr recvpos, int64 now, bool force)
 		return false;
 	}
 
+	TRACE_PGACTIVE_FEEDBACK_SENT(recvpos, flushpos, writepos);
+
 	if (recvpos > last_recvpos)
 		last_recvpos = recvpos;
 	if (writepos > last_writepos)
@@ -2709,6 +3005,7 @@ pgactive_apply_work(PGconn *streamConn)
 	{
 		int			rc;
 		int			r;
+		instr_time	phase_start;
 
 		if (ConfigReloadPending)
 		{
@@ -2725,10 +3022,13 @@ pgactive_apply_work(PGconn *streamConn)
 		 * necessary, but is awakened if postmaster dies.  That way the
 		 * background process goes away immediately in an emergency.
 		 */
+		apply_timing_start(&phase_start);
 		rc = pgactiveWaitLatchOrSocket(&MyProc->procLatch,
 									   WL_SOCKET_READABLE | WL_LATCH_SET |
 									   WL_TIMEOUT | WL_POSTMASTER_DEATH,
-									   fd, 1000L, PG_WAIT_EXTENSION);
+									   fd, 1000L,
+									   pgactive_wait_event(pgactive_WAIT_APPLY_NETWORK_READ));
+		apply_timing_end(pgactive_APPLY_PHASE_NETWORK_WAIT, &phase_start);
 
 		ResetLatch(&MyProc->procLatch);
 		CHECK_FOR_INTERRUPTS();
@@ -2853,10 +3153,25 @@ pgactive_apply_work(PGconn *streamConn)
 
 		}
 
+		pgactive_apply_worker->last_received_lsn = last_received;
+		apply_timing_flush();
+		if (!IsTransactionState())
+			pgactive_conflict_logging_flush();
+
 		/* confirm all writes at once */
 		pgactive_send_feedback(streamConn, last_received,
 							   GetCurrentTimestamp(), false);
 
+#if PG_VERSION_NUM >= 180000
+
+		/*
+		 * Commits only flush replication stats once in a while, make sure the
+		 * rest gets out while we're idle.
+		 */
+		if (!IsTransactionState())
+			pgstat_report_stat(false);
+#endif
+
 		if (first_time)
 		{
 			/*
@@ -2886,7 +3201,8 @@ pgactive_apply_work(PGconn *streamConn)
 
 			rc = pgactiveWaitLatch(&MyProc->procLatch,
 								   WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
-								   300000L, PG_WAIT_EXTENSION);
+								   300000L,
+								   pgactive_wait_event(pgactive_WAIT_APPLY_PAUSED));
 			ResetLatch(&MyProc->procLatch);
 
 			if (rc & WL_LATCH_SET)
@@ -3077,6 +3393,7 @@ pgactive_apply_main(Datum main_arg)
 
 		if (IsTransactionState())
 			pgactive_count_rollback();
+		apply_progress_end();
 		PG_RE_THROW();
 	}
 	PG_END_TRY();
@@ -3099,3 +3416,22 @@ GetpgactiveApplyWorkerShmemPtr(void)
 {
 	return pgactive_apply_worker;
 }
+
+/*
+ * Entry points into the tuple decoding above for the codec benchmarks in
+ * pgactive_bench.c.
+ */
+void
+pgactive_read_tuple(StringInfo s, pgactiveRelation * rel, pgactiveTupleData * tup)
+{
+	read_tuple_parts(s, rel, tup);
+}
+
+void
+pgactive_read_datum(StringInfo s, Form_pg_attribute att, Datum *value,
+					bool *isnull)
+{
+	bool		changed;
+
+	read_datum(s, att, value, isnull, &changed);
+}
@@ -0,0 +1,492 @@
+/* -------------------------------------------------------------------------
+ *
+ * pgactive_backlog.c
+ *		Summary of the changes pending on a pgactive slot
+ *
+ * Copyright (C) 2012-2015, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *		pgactive_backlog.c
+ *
+ * -------------------------------------------------------------------------
+ *
+ * pgactive.pgactive_backlog_summary() tells what a peer still has to receive
+ * from a slot, without consuming it: the changes per relation and action,
+ * the largest transactions and the transactions per replication origin.
+ *
+ * The slot is copied to a temporary slot, whose changes are peeked with the
+ * output plugin in "interactive" mode. For a copy made by this backend the
+ * output plugin doesn't send anything, but hands every transaction and change
+ * to the functions below, along with the size it'd have on the wire. Working
+ * on a copy means the slot can be summarized while its walsender is
+ * streaming from it.
+ *
+ * Only aggregates are kept, so memory use depends on the number of relations
+ * changed but not on the size of the backlog; the reorder buffer spills large
+ * transactions to disk as usual while decoding.
+ */
+#include "postgres.h"
+
+#include "pgactive.h"
+
+#include "fmgr.h"
+#include "funcapi.h"
+#include "miscadmin.h"
+
+#include "catalog/pg_type.h"
+
+#include "executor/spi.h"
+
+#include "replication/origin.h"
+
+#include "utils/builtins.h"
+#include "utils/hsearch.h"
+#include "utils/memutils.h"
+#include "utils/pg_lsn.h"
+#include "utils/timestamp.h"
+
+PGDLLEXPORT Datum pgactive_backlog_summary(PG_FUNCTION_ARGS);
+
+PG_FUNCTION_INFO_V1(pgactive_backlog_summary);
+
+#define pgactive_BACKLOG_SUMMARY_COLS 11
+
+/* how many of the largest transactions are reported */
+#define pgactive_BACKLOG_TOP_XACTS 10
+
+typedef struct pgactiveBacklogRelationKey
+{
+	Oid			relid;
+	char		action;
+}			pgactiveBacklogRelationKey;
+
+typedef struct pgactiveBacklogRelation
+{
+	pgactiveBacklogRelationKey key; /* hash key, must be first */
+	int64		changes;
+	int64		bytes;
+}			pgactiveBacklogRelation;
+
+typedef struct pgactiveBacklogOrigin
+{
+	RepOriginId origin;			/* hash key, must be first */
+	/* transactions and changes that would be sent, and all changes decoded */
+	int64		xacts;
+	int64		changes;
+	int64		bytes;
+	int64		decoded;
+}			pgactiveBacklogOrigin;
+
+typedef struct pgactiveBacklogXact
+{
+	TransactionId xid;
+	RepOriginId origin;
+	XLogRecPtr	end_lsn;
+	TimestampTz committs;
+	/* changes decoded, and how many of them would be sent */
+	int64		decoded;
+	int64		changes;
+	int64		bytes;
+}			pgactiveBacklogXact;
+
+typedef struct pgactiveBacklogSummary
+{
+	/* slot being summarized, and the temporary copy decoded */
+	char	   *slot_name;
+	char	   *copy_name;
+
+	HTAB	   *relations;
+	HTAB	   *origins;
+
+	/* transaction being decoded */
+	pgactiveBacklogXact current;
+
+	/* largest transactions, by bytes sent */
+	pgactiveBacklogXact top[pgactive_BACKLOG_TOP_XACTS];
+	int			ntop;
+
+	/* transactions that would be sent, and all changes decoded */
+	int64		xacts;
+	int64		changes;
+	int64		bytes;
+	int64		decoded;
+	XLogRecPtr	last_end_lsn;
+	TimestampTz last_committs;
+}			pgactiveBacklogSummary;
+
+/* summary being collected by this backend, if any */
+static pgactiveBacklogSummary * backlog_summary = NULL;
+
+/*
+ * Is slot_name the slot copied to collect a summary in this backend?
+ *
+ * If so, returns the name of the slot it's a copy of, whose name identifies
+ * the peer, otherwise NULL.
+ */
+const char *
+pgactive_backlog_source_slot(const char *slot_name)
+{
+	if (backlog_summary == NULL ||
+		strcmp(slot_name, backlog_summary->copy_name) != 0)
+		return NULL;
+
+	return backlog_summary->slot_name;
+}
+
+void
+pgactive_backlog_begin_txn(TransactionId xid, RepOriginId origin)
+{
+	Assert(backlog_summary != NULL);
+
+	memset(&backlog_summary->current, 0, sizeof(pgactiveBacklogXact));
+	backlog_summary->current.xid = xid;
+	backlog_summary->current.origin = origin;
+}
+
+/*
+ * Account for a change of the current transaction, and if it would be sent,
+ * the bytes it takes on the wire.
+ */
+void
+pgactive_backlog_change(Oid relid, char action, Size bytes, bool sent)
+{
+	pgactiveBacklogXact *xact = &backlog_summary->current;
+	pgactiveBacklogRelationKey key;
+	pgactiveBacklogRelation *rel;
+	bool		found;
+
+	xact->decoded++;
+	if (!sent)
+		return;
+
+	xact->changes++;
+	xact->bytes += bytes;
+
+	memset(&key, 0, sizeof(key));
+	key.relid = relid;
+	key.action = action;
+	rel = hash_search(backlog_summary->relations, &key, HASH_ENTER, &found);
+	if (!found)
+	{
+		rel->changes = 0;
+		rel->bytes = 0;
+	}
+	rel->changes++;
+	rel->bytes += bytes;
+}
+
+void
+pgactive_backlog_commit_txn(XLogRecPtr end_lsn, TimestampTz committs, bool sent)
+{
+	pgactiveBacklogSummary *s = backlog_summary;
+	pgactiveBacklogXact *xact = &s->current;
+	pgactiveBacklogOrigin *origin;
+	bool		found;
+
+	xact->end_lsn = end_lsn;
+	xact->committs = committs;
+
+	origin = hash_search(s->origins, &xact->origin, HASH_ENTER, &found);
+	if (!found)
+	{
+		origin->xacts = 0;
+		origin->changes = 0;
+		origin->bytes = 0;
+		origin->decoded = 0;
+	}
+	origin->decoded += xact->decoded;
+
+	s->decoded += xact->decoded;
+	s->last_end_lsn = end_lsn;
+	s->last_committs = committs;
+
+	if (!sent)
+		return;
+
+	origin->xacts++;
+	origin->changes += xact->changes;
+	origin->bytes += xact->bytes;
+
+	s->xacts++;
+	s->changes += xact->changes;
+	s->bytes += xact->bytes;
+
+	/* keep the largest transactions, replacing the smallest of them */
+	if (s->ntop < pgactive_BACKLOG_TOP_XACTS)
+		s->top[s->ntop++] = *xact;
+	else
+	{
+		int			smallest = 0;
+		int			i;
+
+		for (i = 1; i < s->ntop; i++)
+		{
+			if (s->top[i].bytes < s->top[smallest].bytes)
+				smallest = i;
+		}
+
+		if (xact->bytes > s->top[smallest].bytes)
+			s->top[smallest] = *xact;
+	}
+}
+
+static int
+backlog_xact_cmp(const void *a, const void *b)
+{
+	const pgactiveBacklogXact *xa = a;
+	const pgactiveBacklogXact *xb = b;
+
+	if (xa->bytes != xb->bytes)
+		return xa->bytes > xb->bytes ? -1 : 1;
+	if (xa->end_lsn != xb->end_lsn)
+		return xa->end_lsn < xb->end_lsn ? -1 : 1;
+	return 0;
+}
+
+static const char *
+backlog_action_name(char action)
+{
+	switch (action)
+	{
+		case 'I':
+			return "INSERT";
+		case 'U':
+			return "UPDATE";
+		case 'D':
+			return "DELETE";
+		default:
+			elog(ERROR, "unknown action %c", action);
+	}
+}
+
+/* Set the origin column, left NULL for changes made on this node */
+static void
+backlog_origin_datum(RepOriginId origin, Datum *value, bool *isnull)
+{
+	char	   *riname;
+
+	if (origin == InvalidRepOriginId)
+		*isnull = true;
+	else if (replorigin_by_oid(origin, true, &riname))
+		*value = CStringGetTextDatum(riname);
+	else
+	{
+		char		oidbuf[12];
+
+		snprintf(oidbuf, sizeof(oidbuf), "%u", origin);
+		*value = CStringGetTextDatum(oidbuf);
+	}
+}
+
+/*
+ * Run a query returning a single row and column, or no row, over SPI.
+ */
+static bool
+backlog_spi_execute(const char *query, int nargs, Oid *argtypes, Datum *args)
+{
+	int			ret;
+
+	ret = SPI_execute_with_args(query, nargs, argtypes, args, NULL, false, 0);
+	if (ret != SPI_OK_SELECT)
+		elog(ERROR, "SPI_execute_with_args failed: %s", SPI_result_code_string(ret));
+
+	return SPI_processed > 0;
+}
+
+static void
+backlog_collect(pgactiveBacklogSummary * s, XLogRecPtr upto_lsn, bool upto_isnull)
+{
+	Oid			argtypes[3] = {NAMEOID, NAMEOID, LSNOID};
+	Datum		args[3];
+	NameData	slot_name;
+	NameData	copy_name;
+	char	   *plugin;
+
+	namestrcpy(&slot_name, s->slot_name);
+	namestrcpy(&copy_name, s->copy_name);
+	args[0] = NameGetDatum(&slot_name);
+	args[1] = NameGetDatum(&copy_name);
+	args[2] = LSNGetDatum(upto_lsn);
+
+	if (SPI_connect() != SPI_OK_CONNECT)
+		elog(ERROR, "SPI_connect failed");
+
+	if (!backlog_spi_execute("SELECT plugin FROM pg_catalog.pg_replication_slots WHERE slot_name = $1",
+							 1, argtypes, args))
+		ereport(ERROR,
+				(errcode(ERRCODE_UNDEFINED_OBJECT),
+				 errmsg("replication slot \"%s\" does not exist", s->slot_name)));
+
+	plugin = SPI_getvalue(SPI_tuptable->vals[0], SPI_tuptable->tupdesc, 1);
+	if (plugin == NULL || strcmp(plugin, "pgactive") != 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("replication slot \"%s\" is not a pgactive slot", s->slot_name)));
+
+	backlog_spi_execute("SELECT pg_catalog.pg_copy_logical_replication_slot($1, $2, true)",
+						2, argtypes, args);
+
+	/* the output plugin only accumulates into s, no rows come back */
+	if (upto_isnull)
+		backlog_spi_execute("SELECT count(*) FROM pg_catalog.pg_logical_slot_peek_binary_changes($2, NULL, NULL, 'interactive', 'true')",
+							2, argtypes, args);
+	else
+		backlog_spi_execute("SELECT count(*) FROM pg_catalog.pg_logical_slot_peek_binary_changes($2, $3, NULL, 'interactive', 'true')",
+							3, argtypes, args);
+
+	backlog_spi_execute("SELECT pg_catalog.pg_drop_replication_slot($2)",
+						2, argtypes, args);
+
+	if (SPI_finish() != SPI_OK_FINISH)
+		elog(ERROR, "SPI_finish failed");
+}
+
+/*
+ * Summarize the changes a slot has yet to send, up to upto_lsn or all of
+ * them if NULL.
+ */
+Datum
+pgactive_backlog_summary(PG_FUNCTION_ARGS)
+{
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	MemoryContext summary_context;
+	MemoryContext oldcontext;
+	pgactiveBacklogSummary *s;
+	HASHCTL		info;
+	HASH_SEQ_STATUS status;
+	pgactiveBacklogRelation *rel;
+	pgactiveBacklogOrigin *origin;
+	Datum		values[pgactive_BACKLOG_SUMMARY_COLS];
+	bool		nulls[pgactive_BACKLOG_SUMMARY_COLS];
+	int			i;
+
+	if (PG_ARGISNULL(0))
+		ereport(ERROR,
+				(errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
+				 errmsg("slot name must not be null")));
+
+	if (backlog_summary != NULL)
+		elog(ERROR, "a backlog summary is already being collected");
+
+	/* Construct the tuplestore and tuple descriptor */
+	InitMaterializedSRF(fcinfo, 0);
+
+	summary_context = AllocSetContextCreate(CurrentMemoryContext,
+											"pgactive backlog summary",
+											ALLOCSET_DEFAULT_SIZES);
+	oldcontext = MemoryContextSwitchTo(summary_context);
+
+	s = palloc0(sizeof(pgactiveBacklogSummary));
+	s->slot_name = pstrdup(NameStr(*PG_GETARG_NAME(0)));
+	s->copy_name = psprintf("pgactive_backlog_%d", MyProcPid);
+
+	memset(&info, 0, sizeof(info));
+	info.keysize = sizeof(pgactiveBacklogRelationKey);
+	info.entrysize = sizeof(pgactiveBacklogRelation);
+	info.hcxt = summary_context;
+	s->relations = hash_create("pgactive backlog relations", 64, &info,
+							   HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+
+	memset(&info, 0, sizeof(info));
+	info.keysize = sizeof(RepOriginId);
+	info.entrysize = sizeof(pgactiveBacklogOrigin);
+	info.hcxt = summary_context;
+	s->origins = hash_create("pgactive backlog origins", 8, &info,
+							 HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+
+	MemoryContextSwitchTo(oldcontext);
+
+	/*
+	 * The copy's startup callback runs when it's created already, so the
+	 * summary has to be known to the output plugin before that.
+	 */
+	backlog_summary = s;
+	PG_TRY();
+	{
+		backlog_collect(s, PG_ARGISNULL(1) ? InvalidXLogRecPtr : PG_GETARG_LSN(1),
+						PG_ARGISNULL(1));
+	}
+	PG_FINALLY();
+	{
+		backlog_summary = NULL;
+	}
+	PG_END_TRY();
+
+	/* totals */
+	memset(values, 0, sizeof(values));
+	memset(nulls, 1, sizeof(nulls));
+	values[0] = CStringGetTextDatum("total");
+	nulls[0] = false;
+	if (s->last_end_lsn != InvalidXLogRecPtr)
+	{
+		values[5] = LSNGetDatum(s->last_end_lsn);
+		nulls[5] = false;
+		values[6] = TimestampTzGetDatum(s->last_committs);
+		nulls[6] = false;
+	}
+	values[7] = Int64GetDatum(s->xacts);
+	values[8] = Int64GetDatum(s->changes);
+	values[9] = Int64GetDatum(s->bytes);
+	values[10] = Int64GetDatum(s->decoded);
+	nulls[7] = nulls[8] = nulls[9] = nulls[10] = false;
+	tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc, values, nulls);
+
+	/* changes per relation and action */
+	hash_seq_init(&status, s->relations);
+	while ((rel = hash_seq_search(&status)) != NULL)
+	{
+		memset(values, 0, sizeof(values));
+		memset(nulls, 1, sizeof(nulls));
+		values[0] = CStringGetTextDatum("relation");
+		values[1] = ObjectIdGetDatum(rel->key.relid);
+		values[2] = CStringGetTextDatum(backlog_action_name(rel->key.action));
+		values[8] = Int64GetDatum(rel->changes);
+		values[9] = Int64GetDatum(rel->bytes);
+		nulls[0] = nulls[1] = nulls[2] = nulls[8] = nulls[9] = false;
+		tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc, values, nulls);
+	}
+
+	/* largest transactions */
+	qsort(s->top, s->ntop, sizeof(pgactiveBacklogXact), backlog_xact_cmp);
+	for (i = 0; i < s->ntop; i++)
+	{
+		pgactiveBacklogXact *xact = &s->top[i];
+
+		memset(values, 0, sizeof(values));
+		memset(nulls, 1, sizeof(nulls));
+		values[0] = CStringGetTextDatum("transaction");
+		nulls[0] = false;
+		nulls[3] = false;
+		backlog_origin_datum(xact->origin, &values[3], &nulls[3]);
+		values[4] = TransactionIdGetDatum(xact->xid);
+		values[5] = LSNGetDatum(xact->end_lsn);
+		values[6] = TimestampTzGetDatum(xact->committs);
+		values[8] = Int64GetDatum(xact->changes);
+		values[9] = Int64GetDatum(xact->bytes);
+		values[10] = Int64GetDatum(xact->decoded);
+		nulls[4] = nulls[5] = nulls[6] = nulls[8] = nulls[9] = nulls[10] = false;
+		tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc, values, nulls);
+	}
+
+	/* transactions per origin */
+	hash_seq_init(&status, s->origins);
+	while ((origin = hash_seq_search(&status)) != NULL)
+	{
+		memset(values, 0, sizeof(values));
+		memset(nulls, 1, sizeof(nulls));
+		values[0] = CStringGetTextDatum("origin");
+		nulls[0] = false;
+		nulls[3] = false;
+		backlog_origin_datum(origin->origin, &values[3], &nulls[3]);
+		values[7] = Int64GetDatum(origin->xacts);
+		values[8] = Int64GetDatum(origin->changes);
+		values[9] = Int64GetDatum(origin->bytes);
+		values[10] = Int64GetDatum(origin->decoded);
+		nulls[7] = nulls[8] = nulls[9] = nulls[10] = false;
+		tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc, values, nulls);
+	}
+
+	MemoryContextDelete(summary_context);
+
+	PG_RETURN_VOID();
+}
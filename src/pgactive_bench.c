@@ -0,0 +1,425 @@
+/* -------------------------------------------------------------------------
+ *
+ * pgactive_bench.c
+ *		Microbenchmarks of the replication protocol's tuple codec
+ *
+ * Copyright (C) 2012-2015, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *		pgactive_bench.c
+ *
+ * -------------------------------------------------------------------------
+ *
+ * pgactive._bench_encode() and pgactive._bench_roundtrip() run rows of a
+ * table through the output plugin's tuple encoding and the apply worker's
+ * decoding in-process, so their cost can be measured without a replication
+ * connection in the way. Rows are encoded as they're sent to a peer running
+ * the same build, i.e. as with the "interactive" output plugin option.
+ *
+ * Both report the time and the bytes per row spent on whole tuples, followed
+ * by the same numbers for each column on its own. Allocations made for a row
+ * are released after each one, as the walsender and the apply worker do after
+ * each change, and that's part of the time measured.
+ *
+ * These are meant for development only; test/bench/pgactive_codec_bench.pl
+ * runs them over tables of the common column types.
+ */
+#include "postgres.h"
+
+#include "pgactive.h"
+
+#include "fmgr.h"
+#include "funcapi.h"
+#include "miscadmin.h"
+
+#include "access/heaptoast.h"
+#include "access/htup_details.h"
+#include "access/tableam.h"
+
+#include "catalog/pg_class.h"
+
+#include "executor/tuptable.h"
+
+#include "portability/instr_time.h"
+
+#include "utils/acl.h"
+#include "utils/builtins.h"
+#include "utils/datum.h"
+#include "utils/memutils.h"
+#include "utils/rel.h"
+#include "utils/snapmgr.h"
+
+PG_FUNCTION_INFO_V1(pgactive_bench_encode);
+PG_FUNCTION_INFO_V1(pgactive_bench_roundtrip);
+
+#define pgactive_BENCH_COLS 6
+
+/* Timings and sizes of the encoding of a tuple or one of its columns */
+typedef struct pgactiveBenchResult
+{
+	char		format;			/* how non-null values are sent, or 'n' */
+	uint64		bytes;
+	double		encode_ns;
+	double		decode_ns;
+}			pgactiveBenchResult;
+
+/*
+ * Read up to nrows rows of a table, with any out of line toasted values
+ * fetched the way decoding reassembles them before they get to the output
+ * plugin.
+ */
+static HeapTuple *
+bench_read_rows(Relation rel, int nrows, int *nread)
+{
+	HeapTuple  *tuples = palloc(sizeof(HeapTuple) * nrows);
+	TableScanDesc scan;
+	TupleTableSlot *slot;
+	int			n = 0;
+
+	slot = table_slot_create(rel, NULL);
+	scan = table_beginscan(rel, GetActiveSnapshot(), 0, NULL);
+
+	while (n < nrows && table_scan_getnextslot(scan, ForwardScanDirection, slot))
+	{
+		bool		should_free;
+		HeapTuple	tuple = ExecFetchSlotHeapTuple(slot, false, &should_free);
+
+		if (HeapTupleHasExternal(tuple))
+			tuples[n] = toast_flatten_tuple(tuple, RelationGetDescr(rel));
+		else
+			tuples[n] = heap_copytuple(tuple);
+
+		if (should_free)
+			heap_freetuple(tuple);
+		n++;
+	}
+
+	table_endscan(scan);
+	ExecDropSingleTupleTableSlot(slot);
+
+	*nread = n;
+	return tuples;
+}
+
+/* Format of the first non-null value in an encoded buffer */
+static char
+bench_format(StringInfo buf, int *offsets, int nrows)
+{
+	int			i;
+
+	for (i = 0; i < nrows; i++)
+	{
+		char		format = buf->data[offsets[i]];
+
+		if (format != 'n')
+			return format;
+	}
+
+	return 'n';
+}
+
+/* Point s at the encoding of row i in buf */
+static void
+bench_message(StringInfo s, StringInfo buf, int *offsets, int i)
+{
+	s->data = buf->data + offsets[i];
+	s->len = offsets[i + 1] - offsets[i];
+	s->maxlen = s->len;
+	s->cursor = 0;
+}
+
+/*
+ * Time encoding and, if wanted, decoding whole tuples.
+ *
+ * With verify the decoded values are compared to the ones stored in the
+ * table, outside of the timed loops.
+ */
+static void
+bench_tuples(pgactiveRelation * rel, HeapTuple *tuples, int nrows,
+			 bool decode, bool verify, MemoryContext rowcxt,
+			 pgactiveBenchResult * res)
+{
+	TupleDesc	desc = RelationGetDescr(rel->rel);
+	StringInfoData buf;
+	StringInfoData s;
+	pgactiveTupleData *tup = palloc(sizeof(pgactiveTupleData));
+	int		   *offsets = palloc(sizeof(int) * (nrows + 1));
+	MemoryContext oldcxt;
+	instr_time	start;
+	instr_time	duration;
+	int			i;
+
+	initStringInfo(&buf);
+
+	oldcxt = MemoryContextSwitchTo(rowcxt);
+
+	INSTR_TIME_SET_CURRENT(start);
+	for (i = 0; i < nrows; i++)
+	{
+		offsets[i] = buf.len;
+		pgactive_write_tuple(&buf, rel->rel, tuples[i]);
+		MemoryContextReset(rowcxt);
+	}
+	INSTR_TIME_SET_CURRENT(duration);
+	INSTR_TIME_SUBTRACT(duration, start);
+	offsets[nrows] = buf.len;
+
+	res->format = 'T';			/* not reported */
+	res->bytes = buf.len;
+	res->encode_ns = INSTR_TIME_GET_DOUBLE(duration) * 1e9;
+	res->decode_ns = 0;
+
+	if (decode)
+	{
+		INSTR_TIME_SET_CURRENT(start);
+		for (i = 0; i < nrows; i++)
+		{
+			bench_message(&s, &buf, offsets, i);
+			pgactive_read_tuple(&s, rel, tup);
+			MemoryContextReset(rowcxt);
+		}
+		INSTR_TIME_SET_CURRENT(duration);
+		INSTR_TIME_SUBTRACT(duration, start);
+
+		res->decode_ns = INSTR_TIME_GET_DOUBLE(duration) * 1e9;
+	}
+
+	for (i = 0; verify && i < nrows; i++)
+	{
+		Datum		values[MaxTupleAttributeNumber];
+		bool		isnull[MaxTupleAttributeNumber];
+		int			j;
+
+		heap_deform_tuple(tuples[i], desc, values, isnull);
+
+		bench_message(&s, &buf, offsets, i);
+		pgactive_read_tuple(&s, rel, tup);
+
+		for (j = 0; j < desc->natts; j++)
+		{
+			Form_pg_attribute att = TupleDescAttr(desc, j);
+
+			if (att->attisdropped)
+				continue;
+
+			if (isnull[j] != tup->isnull[j] ||
+				(!isnull[j] && !datum_image_eq(values[j], tup->values[j],
+											   att->attbyval, att->attlen)))
+				ereport(ERROR,
+						(errcode(ERRCODE_DATA_EXCEPTION),
+						 errmsg("value of column \"%s\" of relation \"%s\" changed in round trip",
+								NameStr(att->attname),
+								RelationGetRelationName(rel->rel))));
+		}
+
+		MemoryContextReset(rowcxt);
+	}
+
+	MemoryContextSwitchTo(oldcxt);
+
+	pfree(offsets);
+	pfree(tup);
+	pfree(buf.data);
+}
+
+/*
+ * Time encoding and, if wanted, decoding a single column of the tuples.
+ */
+static void
+bench_column(Form_pg_attribute att, Datum *values, bool *isnull, int nrows,
+			 bool decode, MemoryContext rowcxt, pgactiveBenchResult * res)
+{
+	StringInfoData buf;
+	StringInfoData s;
+	int		   *offsets = palloc(sizeof(int) * (nrows + 1));
+	MemoryContext oldcxt;
+	instr_time	start;
+	instr_time	duration;
+	int			i;
+
+	initStringInfo(&buf);
+
+	oldcxt = MemoryContextSwitchTo(rowcxt);
+
+	INSTR_TIME_SET_CURRENT(start);
+	for (i = 0; i < nrows; i++)
+	{
+		offsets[i] = buf.len;
+		pgactive_write_datum(&buf, att, values[i], isnull[i]);
+		MemoryContextReset(rowcxt);
+	}
+	INSTR_TIME_SET_CURRENT(duration);
+	INSTR_TIME_SUBTRACT(duration, start);
+	offsets[nrows] = buf.len;
+
+	res->format = bench_format(&buf, offsets, nrows);
+	res->bytes = buf.len;
+	res->encode_ns = INSTR_TIME_GET_DOUBLE(duration) * 1e9;
+	res->decode_ns = 0;
+
+	if (decode)
+	{
+		INSTR_TIME_SET_CURRENT(start);
+		for (i = 0; i < nrows; i++)
+		{
+			Datum		value;
+			bool		null;
+
+			bench_message(&s, &buf, offsets, i);
+			pgactive_read_datum(&s, att, &value, &null);
+			MemoryContextReset(rowcxt);
+		}
+		INSTR_TIME_SET_CURRENT(duration);
+		INSTR_TIME_SUBTRACT(duration, start);
+
+		res->decode_ns = INSTR_TIME_GET_DOUBLE(duration) * 1e9;
+	}
+
+	MemoryContextSwitchTo(oldcxt);
+
+	pfree(offsets);
+	pfree(buf.data);
+}
+
+static void
+bench_put_result(ReturnSetInfo *rsinfo, Form_pg_attribute att,
+				 pgactiveBenchResult * res, int nrows, bool decode)
+{
+	Datum		values[pgactive_BENCH_COLS];
+	bool		nulls[pgactive_BENCH_COLS];
+
+	memset(nulls, 0, sizeof(nulls));
+
+	if (att != NULL)
+	{
+		values[0] = CStringGetTextDatum(NameStr(att->attname));
+		values[1] = CStringGetTextDatum(format_type_with_typemod(att->atttypid,
+																 att->atttypmod));
+		values[2] = CharGetDatum(res->format);
+	}
+	else
+	{
+		/* whole tuples */
+		nulls[0] = true;
+		nulls[1] = true;
+		nulls[2] = true;
+	}
+	values[3] = Float8GetDatum((double) res->bytes / nrows);
+	values[4] = Float8GetDatum(res->encode_ns / nrows);
+	if (decode)
+		values[5] = Float8GetDatum(res->decode_ns / nrows);
+
+	tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc, values, nulls);
+}
+
+static void
+pgactive_bench_codec(FunctionCallInfo fcinfo, bool decode)
+{
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	Oid			relid = PG_GETARG_OID(0);
+	int32		nrows = PG_GETARG_INT32(1);
+	pgactiveRelation *rel;
+	TupleDesc	desc;
+	AclResult	aclresult;
+	MemoryContext benchcxt;
+	MemoryContext rowcxt;
+	MemoryContext oldcxt;
+	HeapTuple  *tuples;
+	Datum	   *values;
+	bool	   *isnull;
+	pgactiveBenchResult res;
+	int			nread;
+	int			i;
+	int			j;
+
+	if (nrows <= 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("n_rows must be greater than zero")));
+
+	InitMaterializedSRF(fcinfo, 0);
+
+	rel = pgactive_table_open(relid, AccessShareLock);
+
+	if (rel->rel->rd_rel->relkind != RELKIND_RELATION)
+		ereport(ERROR,
+				(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+				 errmsg("\"%s\" is not a table", RelationGetRelationName(rel->rel))));
+
+	aclresult = pg_class_aclcheck(relid, GetUserId(), ACL_SELECT);
+	if (aclresult != ACLCHECK_OK)
+		aclcheck_error(aclresult, OBJECT_TABLE, RelationGetRelationName(rel->rel));
+
+	desc = RelationGetDescr(rel->rel);
+
+	benchcxt = AllocSetContextCreate(CurrentMemoryContext,
+									 "pgactive codec benchmark",
+									 ALLOCSET_DEFAULT_SIZES);
+	rowcxt = AllocSetContextCreate(benchcxt,
+								   "pgactive codec benchmark row",
+								   ALLOCSET_DEFAULT_SIZES);
+	oldcxt = MemoryContextSwitchTo(benchcxt);
+
+	tuples = bench_read_rows(rel->rel, nrows, &nread);
+	if (nread == 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_NO_DATA_FOUND),
+				 errmsg("relation \"%s\" has no rows", RelationGetRelationName(rel->rel))));
+
+	/* Catalog lookups are cached after the first round */
+	bench_tuples(rel, tuples, Min(nread, 10), decode, false, rowcxt, &res);
+
+	bench_tuples(rel, tuples, nread, decode, decode, rowcxt, &res);
+	bench_put_result(rsinfo, NULL, &res, nread, decode);
+
+	values = palloc(sizeof(Datum) * nread);
+	isnull = palloc(sizeof(bool) * nread);
+
+	for (j = 0; j < desc->natts; j++)
+	{
+		Form_pg_attribute att = TupleDescAttr(desc, j);
+
+		if (att->attisdropped)
+			continue;
+
+		CHECK_FOR_INTERRUPTS();
+
+		for (i = 0; i < nread; i++)
+			values[i] = heap_getattr(tuples[i], j + 1, desc, &isnull[i]);
+
+		bench_column(att, values, isnull, nread, decode, rowcxt, &res);
+		bench_put_result(rsinfo, att, &res, nread, decode);
+	}
+
+	MemoryContextSwitchTo(oldcxt);
+	MemoryContextDelete(benchcxt);
+
+	pgactive_table_close(rel, NoLock);
+}
+
+/*
+ * pgactive._bench_encode(relation regclass, n_rows integer)
+ *
+ * Time the encoding of up to n_rows rows of a table by the output plugin.
+ */
+Datum
+pgactive_bench_encode(PG_FUNCTION_ARGS)
+{
+	pgactive_bench_codec(fcinfo, false);
+
+	PG_RETURN_VOID();
+}
+
+/*
+ * pgactive._bench_roundtrip(relation regclass, n_rows integer)
+ *
+ * Time the encoding of up to n_rows rows of a table by the output plugin and
+ * their decoding by the apply worker, and check that they come out unchanged.
+ */
+Datum
+pgactive_bench_roundtrip(PG_FUNCTION_ARGS)
+{
+	pgactive_bench_codec(fcinfo, true);
+
+	PG_RETURN_VOID();
+}
@@ -376,6 +376,23 @@ pgactive_parse_slot_name(const char *sname, pgactiveNodeId * remote, Oid *local_
 	}
 }
 
+/*
+ * Is this the name of a slot for a peer node? Other slots using the pgactive
+ * output plugin, like the temporary copies pgactive_backlog_summary() decodes
+ * from, have names that don't parse.
+ */
+bool
+pgactive_is_node_slot_name(const char *sname)
+{
+	pgactiveNodeId remote;
+	Oid			local_dboid;
+	NameData	replication_name;
+
+	return sscanf(sname, pgactive_SLOT_NAME_FORMAT,
+				  &local_dboid, &remote.sysid, &remote.timeline, &remote.dboid,
+				  NameStr(replication_name)) == 4;
+}
+
 /*
  * Format a replication origin / replication identifier (riident, replident)
  * name from a (sysid,timeline,dboid tuple).
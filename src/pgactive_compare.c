@@ -0,0 +1,1287 @@
+/* -------------------------------------------------------------------------
+ *
+ * pgactive_compare.c
+ *		Compare the contents of a table with a peer node
+ *
+ * Copyright (C) 2012-2015, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *		pgactive_compare.c
+ *
+ * -------------------------------------------------------------------------
+ *
+ * pgactive_compare_table() finds the primary key ranges of a table whose
+ * contents differ between the local node and a peer, without shipping the
+ * rows themselves. Both nodes hash every row of a key range and sum up the
+ * hashes of each of up to pgactive_COMPARE_FANOUT buckets splitting the range
+ * into equally populated parts. Buckets whose row count or digest differ are
+ * split up in turn, the way one descends a Merkle tree, until they hold no
+ * more than pgactive_COMPARE_LEAF_ROWS rows on either node and get reported.
+ *
+ * The queries of each step run on both nodes at the same time, the local one
+ * while the remote one is in flight. Both sides read from a snapshot taken
+ * once each node replayed the changes the other had committed before the
+ * comparison started, or up to the WAL positions the caller chose, see
+ * compare_sync_snapshots().
+ *
+ * pgactive_resync_range() repairs such a key range by making its rows on the
+ * local node match the peer's, in a transaction that isn't replicated.
+ */
+#include "postgres.h"
+
+#include "pgactive.h"
+#include "pgactive_internal.h"
+
+#include "fmgr.h"
+#include "funcapi.h"
+#include "libpq-fe.h"
+#include "miscadmin.h"
+
+#include "access/genam.h"
+#include "access/table.h"
+#include "access/xact.h"
+#include "access/xlog.h"
+
+#include "catalog/objectaddress.h"
+#include "catalog/pg_type.h"
+
+#include "executor/spi.h"
+
+#include "utils/acl.h"
+#include "utils/array.h"
+#include "utils/builtins.h"
+#include "utils/guc.h"
+#include "utils/lsyscache.h"
+#include "utils/pg_lsn.h"
+#include "utils/rel.h"
+#include "utils/relcache.h"
+#include "utils/snapmgr.h"
+
+PG_FUNCTION_INFO_V1(pgactive_compare_table);
+PG_FUNCTION_INFO_V1(pgactive_resync_range);
+
+/* Number of buckets a differing key range is split into */
+#define pgactive_COMPARE_FANOUT		16
+
+/* Key ranges with no more rows than this on either node get reported */
+#define pgactive_COMPARE_LEAF_ROWS	1000
+
+/* What the generated queries need to know about the compared table */
+typedef struct pgactiveCompareTable
+{
+	char	   *relname;		/* schema qualified */
+	char	   *from;			/* relname, with ONLY if needed */
+	int			nkeys;
+	char	  **keycols;		/* quoted names of the key columns */
+	char	  **keytypes;		/* qualified types of the key columns */
+	char	   *keyrow;			/* ROW(key1, key2, ...) */
+	char	   *keylist;		/* key1, key2, ... */
+	char	   *rowhash;		/* 64-bit hash of a whole row */
+	int			ncols;
+	char	  **cols;			/* quoted names of the non-generated columns */
+} pgactiveCompareTable;
+
+/*
+ * A differing key range, its bounds are the text values of the key columns;
+ * lo is inclusive, hi exclusive and NULL bounds leave the range open.
+ */
+typedef struct pgactiveCompareRange
+{
+	char	  **lo;
+	char	  **hi;
+	int64		local_rows;
+	int64		remote_rows;
+} pgactiveCompareRange;
+
+typedef struct pgactiveCompareBucket
+{
+	int64		nrows;
+	char	   *digest;
+} pgactiveCompareBucket;
+
+/*
+ * Settings the text output of a row depends on, pinned on both nodes so that
+ * equal rows hash equally regardless of how each session is configured.
+ */
+static const char *const compare_settings[][2] = {
+	{"TimeZone", "UTC"},
+	{"DateStyle", "ISO, MDY"},
+	{"IntervalStyle", "postgres"},
+	{"extra_float_digits", "3"},
+	{"bytea_output", "hex"},
+};
+
+/*
+ * Pin the settings of the local session for the rest of the current
+ * transaction; the caller undoes this with AtEOXact_GUC(true, nestlevel).
+ */
+static int
+compare_pin_local_settings(void)
+{
+	int			nestlevel = NewGUCNestLevel();
+	int			i;
+
+	for (i = 0; i < lengthof(compare_settings); i++)
+		(void) set_config_option(compare_settings[i][0], compare_settings[i][1],
+								 PGC_USERSET, PGC_S_SESSION,
+								 GUC_ACTION_SAVE, true, 0, false);
+
+	return nestlevel;
+}
+
+/*
+ * Query pinning the settings of a remote session for the rest of its
+ * transaction.
+ */
+static char *
+compare_pin_remote_settings_query(void)
+{
+	StringInfoData query;
+	int			i;
+
+	initStringInfo(&query);
+	appendStringInfoString(&query, "SELECT ");
+	for (i = 0; i < lengthof(compare_settings); i++)
+		appendStringInfo(&query, "%spg_catalog.set_config(%s, %s, true)",
+						 i > 0 ? ", " : "",
+						 quote_literal_cstr(compare_settings[i][0]),
+						 quote_literal_cstr(compare_settings[i][1]));
+
+	return query.data;
+}
+
+/*
+ * Look up the primary key of the table to compare, check the privileges
+ * needed on it and lock it against concurrent DDL for the rest of the
+ * transaction.
+ */
+static void
+compare_get_table(Oid relid, AclMode mode, pgactiveCompareTable * t)
+{
+	Relation	rel;
+	Relation	idxrel;
+	TupleDesc	desc;
+	AclResult	aclresult;
+	StringInfoData keyrow;
+	StringInfoData keylist;
+	StringInfoData rowhash;
+	int			i;
+
+	rel = table_open(relid, AccessShareLock);
+
+	if (rel->rd_rel->relkind != RELKIND_RELATION &&
+		rel->rd_rel->relkind != RELKIND_PARTITIONED_TABLE)
+		ereport(ERROR,
+				(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+				 errmsg("\"%s\" is not a table", RelationGetRelationName(rel))));
+
+	aclresult = pg_class_aclcheck(relid, GetUserId(), mode);
+	if (aclresult != ACLCHECK_OK)
+		aclcheck_error(aclresult, get_relkind_objtype(rel->rd_rel->relkind),
+					   RelationGetRelationName(rel));
+
+	/* Fills in rd_pkindex */
+	list_free(RelationGetIndexList(rel));
+	if (!OidIsValid(rel->rd_pkindex))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("table \"%s\" has no primary key",
+						RelationGetRelationName(rel))));
+
+	t->relname = quote_qualified_identifier(get_namespace_name(RelationGetNamespace(rel)),
+											RelationGetRelationName(rel));
+	t->from = psprintf("%s%s",
+					   rel->rd_rel->relkind == RELKIND_RELATION ? "ONLY " : "",
+					   t->relname);
+
+	desc = RelationGetDescr(rel);
+	idxrel = index_open(rel->rd_pkindex, AccessShareLock);
+
+	initStringInfo(&keyrow);
+	initStringInfo(&keylist);
+	t->nkeys = idxrel->rd_index->indnkeyatts;
+	t->keycols = palloc(sizeof(char *) * t->nkeys);
+	t->keytypes = palloc(sizeof(char *) * t->nkeys);
+	for (i = 0; i < t->nkeys; i++)
+	{
+		Form_pg_attribute att = TupleDescAttr(desc, idxrel->rd_index->indkey.values[i] - 1);
+
+		t->keycols[i] = pstrdup(quote_identifier(NameStr(att->attname)));
+		appendStringInfo(&keylist, "%s%s", i > 0 ? ", " : "", t->keycols[i]);
+		t->keytypes[i] = format_type_extended(att->atttypid, att->atttypmod,
+											  FORMAT_TYPE_TYPEMOD_GIVEN |
+											  FORMAT_TYPE_FORCE_QUALIFY);
+	}
+	appendStringInfo(&keyrow, "ROW(%s)", keylist.data);
+	t->keyrow = keyrow.data;
+	t->keylist = keylist.data;
+
+	index_close(idxrel, AccessShareLock);
+
+	initStringInfo(&rowhash);
+	appendStringInfoString(&rowhash, "pg_catalog.hashtextextended(ROW(");
+	t->ncols = 0;
+	t->cols = palloc(sizeof(char *) * desc->natts);
+	for (i = 0; i < desc->natts; i++)
+	{
+		Form_pg_attribute att = TupleDescAttr(desc, i);
+
+		if (att->attisdropped)
+			continue;
+
+		appendStringInfo(&rowhash, "%s%s",
+						 rowhash.data[rowhash.len - 1] == '(' ? "" : ", ",
+						 quote_identifier(NameStr(att->attname)));
+
+		if (!att->attgenerated)
+			t->cols[t->ncols++] = pstrdup(quote_identifier(NameStr(att->attname)));
+	}
+	appendStringInfoString(&rowhash, ")::text, 0)");
+	t->rowhash = rowhash.data;
+
+	table_close(rel, NoLock);
+}
+
+/*
+ * Find the DSN and identity of a ready peer node by name.
+ *
+ * SPI must be connected.
+ */
+static char *
+compare_get_peer(const char *node_name, pgactiveNodeId * peer)
+{
+	Oid			argtypes[1] = {TEXTOID};
+	Datum		values[1];
+	pgactiveNodeId myid;
+	char	   *dsn;
+	int			ret;
+
+	values[0] = CStringGetTextDatum(node_name);
+	ret = SPI_execute_with_args("SELECT node_sysid, node_timeline, node_dboid, node_dsn "
+								"FROM pgactive.pgactive_nodes "
+								"WHERE node_name = $1 AND node_status = 'r'",
+								1, argtypes, values, NULL, false, 1);
+	if (ret != SPI_OK_SELECT)
+		elog(ERROR, "SPI error while querying pgactive.pgactive_nodes");
+
+	if (SPI_processed == 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_UNDEFINED_OBJECT),
+				 errmsg("node \"%s\" is not a ready pgactive node", node_name)));
+
+	if (sscanf(SPI_getvalue(SPI_tuptable->vals[0], SPI_tuptable->tupdesc, 1),
+			   UINT64_FORMAT, &peer->sysid) != 1)
+		elog(ERROR, "could not parse sysid of node \"%s\"", node_name);
+	peer->timeline = DatumGetObjectId(DirectFunctionCall1(oidin,
+														  CStringGetDatum(SPI_getvalue(SPI_tuptable->vals[0], SPI_tuptable->tupdesc, 2))));
+	peer->dboid = DatumGetObjectId(DirectFunctionCall1(oidin,
+													   CStringGetDatum(SPI_getvalue(SPI_tuptable->vals[0], SPI_tuptable->tupdesc, 3))));
+	dsn = SPI_getvalue(SPI_tuptable->vals[0], SPI_tuptable->tupdesc, 4);
+
+	pgactive_make_my_nodeid(&myid);
+	if (pgactive_nodeid_eq(&myid, peer))
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("node \"%s\" is the local node", node_name)));
+
+	if (dsn == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("node \"%s\" has no DSN", node_name)));
+
+	return dsn;
+}
+
+/*
+ * Wait on the peer for this node to replay what had been written there up to
+ * remote_lsn.
+ */
+static void
+compare_wait_remote_replay(PGconn *conn, const pgactiveNodeId * const peer,
+						   XLogRecPtr remote_lsn)
+{
+	pgactiveNodeId myid;
+	NameData	remote_slot;
+	const char *params[2];
+	PGresult   *res;
+
+	pgactive_make_my_nodeid(&myid);
+	pgactive_slot_name(&remote_slot, &myid, peer->dboid);
+
+	params[0] = NameStr(remote_slot);
+	params[1] = DatumGetCString(DirectFunctionCall1(pg_lsn_out,
+													LSNGetDatum(remote_lsn)));
+	res = PQexecParams(conn,
+					   "SELECT pgactive.pgactive_wait_for_slots_confirmed_flush_lsn($1, $2)",
+					   2, NULL, params, NULL, NULL, 0);
+	if (PQresultStatus(res) != PGRES_TUPLES_OK)
+		ereport(ERROR,
+				(errmsg("could not wait for replay of remote changes up to %X/%X",
+						LSN_FORMAT_ARGS(remote_lsn)),
+				 errdetail("Querying remote failed with: %s", PQresultErrorMessage(res))));
+	PQclear(res);
+}
+
+/*
+ * Make the snapshots both nodes compare the table at consistent with each
+ * other, as far as the changes committed before the comparison are concerned.
+ *
+ * Wait for the peer to replay what has been written locally so far, start a
+ * repeatable read transaction on the peer and, with wait_remote, wait for
+ * this node to replay what had been written there up to that point. The
+ * caller then takes the local snapshot.
+ *
+ * A valid want_local_lsn or want_remote_lsn replaces the WAL position of that
+ * node that is waited for; it can't be ahead of the node's current position.
+ * Snapshots can only be taken of the present, so this doesn't compare the
+ * table as it was at those positions, it just doesn't wait for later changes.
+ *
+ * Rows changed on either node while this runs may still differ.
+ */
+static void
+compare_sync_snapshots(PGconn *conn, const pgactiveNodeId * const peer,
+					   XLogRecPtr want_local_lsn, XLogRecPtr want_remote_lsn,
+					   XLogRecPtr *local_lsn, XLogRecPtr *remote_lsn,
+					   bool wait_remote)
+{
+	NameData	local_slot;
+	Oid			argtypes[2] = {NAMEOID, LSNOID};
+	Datum		values[2];
+	pgactiveRemoteQuery queries[4];
+
+	pgactive_slot_name(&local_slot, peer, MyDatabaseId);
+
+	*local_lsn = GetXLogInsertRecPtr();
+	if (!XLogRecPtrIsInvalid(want_local_lsn))
+	{
+		if (want_local_lsn > *local_lsn)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("local_lsn %X/%X is ahead of the current WAL insert position %X/%X",
+							LSN_FORMAT_ARGS(want_local_lsn),
+							LSN_FORMAT_ARGS(*local_lsn))));
+		*local_lsn = want_local_lsn;
+	}
+	values[0] = NameGetDatum(&local_slot);
+	values[1] = LSNGetDatum(*local_lsn);
+	if (SPI_execute_with_args("SELECT pgactive.pgactive_wait_for_slots_confirmed_flush_lsn($1, $2)",
+							  2, argtypes, values, NULL,
+							  false, 0) != SPI_OK_SELECT)
+		elog(ERROR, "SPI error while waiting for slot \"%s\"",
+			 NameStr(local_slot));
+
+	/* The first query of the transaction takes its snapshot */
+	memset(queries, 0, sizeof(queries));
+	queries[0].query = pgactive_ext_version_query;
+	queries[1].query = "BEGIN TRANSACTION ISOLATION LEVEL REPEATABLE READ READ ONLY";
+	queries[2].query = "SELECT pg_catalog.pg_current_wal_insert_lsn()";
+	queries[3].query = compare_pin_remote_settings_query();
+	pgactive_exec_pipeline(conn, queries, lengthof(queries));
+
+	pgactive_ensure_ext_installed_result(queries[0].res);
+
+	if (PQresultStatus(queries[1].res) != PGRES_COMMAND_OK ||
+		PQresultStatus(queries[2].res) != PGRES_TUPLES_OK ||
+		PQresultStatus(queries[3].res) != PGRES_TUPLES_OK)
+		ereport(ERROR,
+				(errmsg("could not start transaction on remote node"),
+				 errdetail("Querying remote failed with: %s",
+						   PQresultErrorMessage(PQresultStatus(queries[1].res) != PGRES_COMMAND_OK ?
+												queries[1].res :
+												PQresultStatus(queries[2].res) != PGRES_TUPLES_OK ?
+												queries[2].res : queries[3].res))));
+
+	*remote_lsn = DatumGetLSN(DirectFunctionCall1Coll(pg_lsn_in, InvalidOid,
+													  CStringGetDatum(PQgetvalue(queries[2].res, 0, 0))));
+
+	pgactive_clear_pipeline(queries, lengthof(queries));
+
+	if (!XLogRecPtrIsInvalid(want_remote_lsn))
+	{
+		if (want_remote_lsn > *remote_lsn)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("remote_lsn %X/%X is ahead of the current WAL insert position %X/%X of the peer node",
+							LSN_FORMAT_ARGS(want_remote_lsn),
+							LSN_FORMAT_ARGS(*remote_lsn))));
+		*remote_lsn = want_remote_lsn;
+	}
+
+	if (wait_remote)
+		compare_wait_remote_replay(conn, peer, *remote_lsn);
+}
+
+/* Append a key value ROW('v1'::type1, ...) to a query */
+static void
+compare_append_key(StringInfo query, const pgactiveCompareTable * t, char **key)
+{
+	int			i;
+
+	appendStringInfoString(query, "ROW(");
+	for (i = 0; i < t->nkeys; i++)
+		appendStringInfo(query, "%s%s::%s", i > 0 ? ", " : "",
+						 quote_literal_cstr(key[i]), t->keytypes[i]);
+	appendStringInfoChar(query, ')');
+}
+
+/*
+ * Append a list of columns, each prefixed with "alias." unless alias is
+ * NULL.
+ */
+static void
+compare_append_columns(StringInfo query, char **cols, int ncols,
+					   const char *alias)
+{
+	int			i;
+
+	for (i = 0; i < ncols; i++)
+		appendStringInfo(query, "%s%s%s%s", i > 0 ? ", " : "",
+						 alias != NULL ? alias : "", alias != NULL ? "." : "",
+						 cols[i]);
+}
+
+/* Append the conditions limiting a query to a key range */
+static void
+compare_append_bounds(StringInfo query, const pgactiveCompareTable * t,
+					  char **lo, char **hi)
+{
+	if (lo != NULL)
+	{
+		appendStringInfo(query, " AND %s >= ", t->keyrow);
+		compare_append_key(query, t, lo);
+	}
+	if (hi != NULL)
+	{
+		appendStringInfo(query, " AND %s < ", t->keyrow);
+		compare_append_key(query, t, hi);
+	}
+}
+
+/* Append FROM and WHERE clauses selecting the rows of a key range */
+static void
+compare_append_range(StringInfo query, const pgactiveCompareTable * t,
+					 char **lo, char **hi)
+{
+	appendStringInfo(query, " FROM %s WHERE true", t->from);
+	compare_append_bounds(query, t, lo, hi);
+}
+
+/*
+ * Query the row count and digest of each bucket of a key range, split by the
+ * given bounds; bucket i holds the keys from bounds[i - 1] to bounds[i].
+ */
+static char *
+compare_bucket_query(const pgactiveCompareTable * t,
+					 const pgactiveCompareRange * range,
+					 char ***bounds, int nbounds)
+{
+	StringInfoData query;
+	int			i;
+
+	initStringInfo(&query);
+	appendStringInfoString(&query, "SELECT ");
+	if (nbounds == 0)
+		appendStringInfoString(&query, "0");
+	else
+	{
+		appendStringInfoString(&query, "CASE");
+		for (i = 0; i < nbounds; i++)
+		{
+			appendStringInfo(&query, " WHEN %s < ", t->keyrow);
+			compare_append_key(&query, t, bounds[i]);
+			appendStringInfo(&query, " THEN %d", i);
+		}
+		appendStringInfo(&query, " ELSE %d END", nbounds);
+	}
+	appendStringInfo(&query, ", count(*), sum(%s)::text", t->rowhash);
+	compare_append_range(&query, t, range->lo, range->hi);
+	appendStringInfoString(&query, " GROUP BY 1");
+
+	return query.data;
+}
+
+/*
+ * Query the keys splitting nrows rows of a key range into equally populated
+ * buckets.
+ *
+ * Each bound is found from the previous one by skipping step keys in the
+ * primary key index, so the range is walked once in key order rather than
+ * sorted and numbered as a whole.
+ */
+static char *
+compare_split_query(const pgactiveCompareTable * t,
+					const pgactiveCompareRange * range, int64 nrows)
+{
+	StringInfoData query;
+	int64		step = (nrows + pgactive_COMPARE_FANOUT - 1) / pgactive_COMPARE_FANOUT;
+	int			i;
+
+	Assert(step > 0);
+
+	initStringInfo(&query);
+	appendStringInfoString(&query, "WITH RECURSIVE pgactive_bounds(pgactive_n");
+	for (i = 0; i < t->nkeys; i++)
+		appendStringInfo(&query, ", pgactive_k%d", i);
+	appendStringInfo(&query, ") AS (SELECT 1, s.* FROM (SELECT %s", t->keylist);
+	compare_append_range(&query, t, range->lo, range->hi);
+	appendStringInfo(&query, " ORDER BY %s OFFSET " INT64_FORMAT " LIMIT 1) s",
+					 t->keylist, step);
+	appendStringInfo(&query, " UNION ALL SELECT b.pgactive_n + 1, s.* FROM pgactive_bounds b, LATERAL (SELECT %s",
+					 t->keylist);
+	compare_append_range(&query, t, range->lo, range->hi);
+	appendStringInfo(&query, " AND %s > ROW(", t->keyrow);
+	for (i = 0; i < t->nkeys; i++)
+		appendStringInfo(&query, "%sb.pgactive_k%d", i > 0 ? ", " : "", i);
+	appendStringInfo(&query, ") ORDER BY %s OFFSET " INT64_FORMAT " LIMIT 1) s",
+					 t->keylist, step - 1);
+	appendStringInfo(&query, " WHERE b.pgactive_n < %d) SELECT ",
+					 pgactive_COMPARE_FANOUT - 1);
+	for (i = 0; i < t->nkeys; i++)
+		appendStringInfo(&query, "%spgactive_k%d::text", i > 0 ? ", " : "", i);
+	appendStringInfoString(&query, " FROM pgactive_bounds ORDER BY pgactive_n");
+
+	return query.data;
+}
+
+static void
+compare_remote_send(PGconn *conn, const char *query)
+{
+	if (PQsendQuery(conn, query) != 1)
+		ereport(ERROR,
+				(errmsg("could not send query to remote node: %s",
+						PQerrorMessage(conn)),
+				 errdetail("Query: %s", query)));
+}
+
+/*
+ * Wait for the next result of a query sent with compare_remote_send() to
+ * arrive, without blocking interrupts.
+ */
+static void
+compare_remote_wait(PGconn *conn, const char *query)
+{
+	while (PQisBusy(conn))
+	{
+		int			rc;
+
+		rc = pgactiveWaitLatchOrSocket(MyLatch,
+									   WL_LATCH_SET | WL_SOCKET_READABLE |
+									   WL_EXIT_ON_PM_DEATH,
+									   PQsocket(conn), 0L,
+									   pgactive_wait_event(pgactive_WAIT_COMPARE_REMOTE));
+		ResetLatch(MyLatch);
+
+		CHECK_FOR_INTERRUPTS();
+
+		if ((rc & WL_SOCKET_READABLE) && PQconsumeInput(conn) == 0)
+			ereport(ERROR,
+					(errmsg("could not receive query result from remote node: %s",
+							PQerrorMessage(conn)),
+					 errdetail("Query: %s", query)));
+	}
+}
+
+static PGresult *
+compare_remote_result(PGconn *conn, const char *query)
+{
+	PGresult   *res;
+	PGresult   *next;
+
+	compare_remote_wait(conn, query);
+	res = PQgetResult(conn);
+	while ((next = PQgetResult(conn)) != NULL)
+		PQclear(next);
+
+	if (PQresultStatus(res) != PGRES_TUPLES_OK)
+	{
+		char	   *msg = pstrdup(PQresultErrorMessage(res));
+
+		PQclear(res);
+		ereport(ERROR,
+				(errmsg("could not compare table data on remote node: %s", msg),
+				 errdetail("Query: %s", query)));
+	}
+
+	return res;
+}
+
+/*
+ * Find the bounds splitting a key range, on whichever node has more rows in
+ * it so that each bucket ends up smaller than the range on that node.
+ */
+static char ***
+compare_split(PGconn *conn, const pgactiveCompareTable * t,
+			  const pgactiveCompareRange * range, int *nbounds)
+{
+	char	   *query;
+	char	 ***bounds;
+	int			i,
+				j;
+
+	if (range->remote_rows > range->local_rows)
+	{
+		PGresult   *res;
+
+		query = compare_split_query(t, range, range->remote_rows);
+		compare_remote_send(conn, query);
+		res = compare_remote_result(conn, query);
+
+		*nbounds = PQntuples(res);
+		bounds = palloc(sizeof(char **) * (*nbounds));
+		for (i = 0; i < *nbounds; i++)
+		{
+			bounds[i] = palloc(sizeof(char *) * t->nkeys);
+			for (j = 0; j < t->nkeys; j++)
+				bounds[i][j] = pstrdup(PQgetvalue(res, i, j));
+		}
+		PQclear(res);
+	}
+	else
+	{
+		query = compare_split_query(t, range, range->local_rows);
+		if (SPI_execute(query, true, 0) != SPI_OK_SELECT)
+			elog(ERROR, "SPI error while splitting key range");
+
+		*nbounds = SPI_processed;
+		bounds = palloc(sizeof(char **) * (*nbounds));
+		for (i = 0; i < *nbounds; i++)
+		{
+			bounds[i] = palloc(sizeof(char *) * t->nkeys);
+			for (j = 0; j < t->nkeys; j++)
+				bounds[i][j] = SPI_getvalue(SPI_tuptable->vals[i],
+											SPI_tuptable->tupdesc, j + 1);
+		}
+	}
+
+	pfree(query);
+	return bounds;
+}
+
+/*
+ * Run a bucket query on both nodes at once, filling the local and remote
+ * bucket arrays of nbuckets entries each.
+ */
+static void
+compare_buckets(PGconn *conn, const char *query, int nbuckets,
+				pgactiveCompareBucket * local, pgactiveCompareBucket * remote)
+{
+	PGresult   *res;
+	uint64		i;
+	int			row;
+	int			bucket;
+
+	memset(local, 0, sizeof(pgactiveCompareBucket) * nbuckets);
+	memset(remote, 0, sizeof(pgactiveCompareBucket) * nbuckets);
+
+	compare_remote_send(conn, query);
+
+	if (SPI_execute(query, true, 0) != SPI_OK_SELECT)
+		elog(ERROR, "SPI error while hashing table rows");
+
+	for (i = 0; i < SPI_processed; i++)
+	{
+		HeapTuple	tup = SPI_tuptable->vals[i];
+		TupleDesc	desc = SPI_tuptable->tupdesc;
+
+		bucket = atoi(SPI_getvalue(tup, desc, 1));
+		Assert(bucket >= 0 && bucket < nbuckets);
+		local[bucket].nrows = DatumGetInt64(DirectFunctionCall1(int8in,
+																CStringGetDatum(SPI_getvalue(tup, desc, 2))));
+		local[bucket].digest = SPI_getvalue(tup, desc, 3);
+	}
+
+	res = compare_remote_result(conn, query);
+	for (row = 0; row < PQntuples(res); row++)
+	{
+		bucket = atoi(PQgetvalue(res, row, 0));
+		if (bucket < 0 || bucket >= nbuckets)
+			elog(ERROR, "unexpected bucket %d in remote result", bucket);
+		remote[bucket].nrows = DatumGetInt64(DirectFunctionCall1(int8in,
+																 CStringGetDatum(PQgetvalue(res, row, 1))));
+		remote[bucket].digest = pstrdup(PQgetvalue(res, row, 2));
+	}
+	PQclear(res);
+}
+
+static bool
+compare_bucket_differs(const pgactiveCompareBucket * local,
+					   const pgactiveCompareBucket * remote)
+{
+	if (local->nrows != remote->nrows)
+		return true;
+	if (local->nrows == 0)
+		return false;
+	return strcmp(local->digest, remote->digest) != 0;
+}
+
+static Datum
+compare_key_datum(const pgactiveCompareTable * t, char **key)
+{
+	Datum	   *elems = palloc(sizeof(Datum) * t->nkeys);
+	int			i;
+
+	for (i = 0; i < t->nkeys; i++)
+		elems[i] = CStringGetTextDatum(key[i]);
+
+	return PointerGetDatum(construct_array(elems, t->nkeys, TEXTOID, -1,
+										   false, TYPALIGN_INT));
+}
+
+/*
+ * Compare the contents of a table with a peer node, returning the key ranges
+ * that differ.
+ *
+ * The optional local_lsn and remote_lsn choose the WAL positions up to which
+ * each node has to have replayed the other's changes, instead of the current
+ * ones.
+ */
+Datum
+pgactive_compare_table(PG_FUNCTION_ARGS)
+{
+#define pgactive_COMPARE_TABLE_COLS	4
+	Oid			relid;
+	char	   *node_name;
+	XLogRecPtr	want_local_lsn = InvalidXLogRecPtr;
+	XLogRecPtr	want_remote_lsn = InvalidXLogRecPtr;
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	pgactiveCompareTable t;
+	pgactiveNodeId peer;
+	char	   *dsn;
+	PGconn	   *conn;
+	XLogRecPtr	local_lsn;
+	XLogRecPtr	remote_lsn;
+	int64		ndiffs = 0;
+	int			nestlevel;
+
+	if (PG_ARGISNULL(0) || PG_ARGISNULL(1))
+		ereport(ERROR,
+				(errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
+				 errmsg("relation and node_name must not be NULL")));
+	relid = PG_GETARG_OID(0);
+	node_name = text_to_cstring(PG_GETARG_TEXT_PP(1));
+	if (!PG_ARGISNULL(2))
+		want_local_lsn = PG_GETARG_LSN(2);
+	if (!PG_ARGISNULL(3))
+		want_remote_lsn = PG_GETARG_LSN(3);
+
+	if (IsolationUsesXactSnapshot())
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("pgactive_compare_table cannot run in a REPEATABLE READ or SERIALIZABLE transaction"),
+				 errhint("The comparison takes its own snapshot once the peer node caught up with this one.")));
+
+	InitMaterializedSRF(fcinfo, 0);
+
+	compare_get_table(relid, ACL_SELECT, &t);
+
+	if (SPI_connect() != SPI_OK_CONNECT)
+		elog(ERROR, "SPI_connect failed");
+
+	dsn = compare_get_peer(node_name, &peer);
+
+	conn = pgactive_connect_nonrepl(dsn, "compare", true, true);
+
+	PG_ENSURE_ERROR_CLEANUP(pgactive_cleanup_conn_close,
+							PointerGetDatum(&conn));
+	{
+		pgactiveCompareBucket local[pgactive_COMPARE_FANOUT];
+		pgactiveCompareBucket remote[pgactive_COMPARE_FANOUT];
+		pgactiveCompareRange *range;
+		List	   *pending = NIL;
+		char	   *query;
+
+		compare_sync_snapshots(conn, &peer, want_local_lsn, want_remote_lsn,
+							   &local_lsn, &remote_lsn, true);
+		nestlevel = compare_pin_local_settings();
+
+		/* Read only SPI queries use the active snapshot */
+		PushActiveSnapshot(GetTransactionSnapshot());
+
+		range = palloc0(sizeof(pgactiveCompareRange));
+		query = compare_bucket_query(&t, range, NULL, 0);
+		compare_buckets(conn, query, 1, local, remote);
+		pfree(query);
+
+		if (compare_bucket_differs(&local[0], &remote[0]))
+		{
+			range->local_rows = local[0].nrows;
+			range->remote_rows = remote[0].nrows;
+			pending = lappend(pending, range);
+		}
+
+		/*
+		 * Descend into differing ranges depth first, so they are reported in
+		 * key order.
+		 */
+		while (pending != NIL)
+		{
+			List	   *children = NIL;
+			char	 ***bounds;
+			int			nbounds;
+			int			i;
+
+			CHECK_FOR_INTERRUPTS();
+
+			range = (pgactiveCompareRange *) linitial(pending);
+			pending = list_delete_first(pending);
+
+			if (Max(range->local_rows, range->remote_rows) <= pgactive_COMPARE_LEAF_ROWS)
+			{
+				Datum		values[pgactive_COMPARE_TABLE_COLS];
+				bool		nulls[pgactive_COMPARE_TABLE_COLS];
+
+				memset(nulls, 0, sizeof(nulls));
+
+				if (range->lo != NULL)
+					values[0] = compare_key_datum(&t, range->lo);
+				else
+					nulls[0] = true;
+				if (range->hi != NULL)
+					values[1] = compare_key_datum(&t, range->hi);
+				else
+					nulls[1] = true;
+				values[2] = Int64GetDatum(range->local_rows);
+				values[3] = Int64GetDatum(range->remote_rows);
+
+				tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc,
+									 values, nulls);
+				ndiffs++;
+				continue;
+			}
+
+			bounds = compare_split(conn, &t, range, &nbounds);
+			Assert(nbounds > 0 && nbounds < pgactive_COMPARE_FANOUT);
+
+			query = compare_bucket_query(&t, range, bounds, nbounds);
+			compare_buckets(conn, query, nbounds + 1, local, remote);
+			pfree(query);
+
+			for (i = 0; i <= nbounds; i++)
+			{
+				pgactiveCompareRange *child;
+
+				if (!compare_bucket_differs(&local[i], &remote[i]))
+					continue;
+
+				child = palloc(sizeof(pgactiveCompareRange));
+				child->lo = i == 0 ? range->lo : bounds[i - 1];
+				child->hi = i == nbounds ? range->hi : bounds[i];
+				child->local_rows = local[i].nrows;
+				child->remote_rows = remote[i].nrows;
+				children = lappend(children, child);
+			}
+
+			pending = list_concat(children, pending);
+		}
+
+		PopActiveSnapshot();
+		AtEOXact_GUC(true, nestlevel);
+	}
+	PG_END_ENSURE_ERROR_CLEANUP(pgactive_cleanup_conn_close,
+								PointerGetDatum(&conn));
+
+	PQfinish(conn);
+	SPI_finish();
+
+	elog(DEBUG1, "compared table %s with node \"%s\" after replay up to %X/%X locally and %X/%X on the node, " INT64_FORMAT " key ranges differ",
+		 t.relname, node_name, LSN_FORMAT_ARGS(local_lsn),
+		 LSN_FORMAT_ARGS(remote_lsn), ndiffs);
+
+	PG_RETURN_VOID();
+#undef pgactive_COMPARE_TABLE_COLS
+}
+
+/*
+ * Get one of the key range bounds passed to pgactive_resync_range.
+ */
+static char **
+resync_get_key(const pgactiveCompareTable * t, ArrayType *arr,
+			   const char *argname)
+{
+	Datum	   *elems;
+	bool	   *nulls;
+	int			nelems;
+	char	  **key;
+	int			i;
+
+	deconstruct_array(arr, TEXTOID, -1, false, TYPALIGN_INT,
+					  &elems, &nulls, &nelems);
+
+	if (nelems != t->nkeys)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("%s must have one value for each of the %d primary key columns of table %s",
+						argname, t->nkeys, t->relname)));
+
+	key = palloc(sizeof(char *) * nelems);
+	for (i = 0; i < nelems; i++)
+	{
+		if (nulls[i])
+			ereport(ERROR,
+					(errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
+					 errmsg("%s must not contain NULL values", argname)));
+		key[i] = TextDatumGetCString(elems[i]);
+	}
+
+	return key;
+}
+
+/*
+ * Run a query, waiting for it interruptibly as it may wait for locks. Returns
+ * the result of its last statement, or the one starting a COPY.
+ */
+static PGresult *
+resync_exec(PGconn *conn, const char *query, ExecStatusType expected)
+{
+	PGresult   *res = NULL;
+	PGresult   *next;
+
+	compare_remote_send(conn, query);
+	for (;;)
+	{
+		compare_remote_wait(conn, query);
+		next = PQgetResult(conn);
+		if (next == NULL)
+			break;
+
+		PQclear(res);
+		res = next;
+		if (PQresultStatus(res) == PGRES_COPY_OUT ||
+			PQresultStatus(res) == PGRES_COPY_IN)
+			break;
+	}
+
+	if (PQresultStatus(res) != expected)
+	{
+		char	   *msg = pstrdup(PQresultErrorMessage(res));
+
+		PQclear(res);
+		ereport(ERROR,
+				(errmsg("could not resync key range: %s", msg),
+				 errdetail("Query: %s", query)));
+	}
+
+	return res;
+}
+
+static void
+resync_finish_command(PGconn *conn, const char *query)
+{
+	PGresult   *res;
+
+	res = PQgetResult(conn);
+	if (PQresultStatus(res) != PGRES_COMMAND_OK)
+	{
+		char	   *msg = pstrdup(PQresultErrorMessage(res));
+
+		PQclear(res);
+		ereport(ERROR,
+				(errmsg("could not resync key range: %s", msg),
+				 errdetail("Query: %s", query)));
+	}
+	PQclear(res);
+
+	while ((res = PQgetResult(conn)) != NULL)
+		PQclear(res);
+}
+
+/*
+ * Stream the rows of the key range from the peer into the temporary table
+ * of the local transaction.
+ */
+static void
+resync_copy(PGconn *remote_conn, PGconn *local_conn,
+			const char *copy_out, const char *copy_in)
+{
+	char	   *copybuf;
+	int			len;
+
+	PQclear(resync_exec(remote_conn, copy_out, PGRES_COPY_OUT));
+	PQclear(resync_exec(local_conn, copy_in, PGRES_COPY_IN));
+
+	while ((len = PQgetCopyData(remote_conn, &copybuf, false)) > 0)
+	{
+		if (PQputCopyData(local_conn, copybuf, len) != 1)
+			ereport(ERROR,
+					(errmsg("writing to destination table failed"),
+					 errdetail("Destination connection reported: %s",
+							   PQerrorMessage(local_conn))));
+		PQfreemem(copybuf);
+	}
+
+	if (len != -1)
+		ereport(ERROR,
+				(errmsg("reading from origin table/query failed"),
+				 errdetail("Source connection returned %d: %s",
+						   len, PQerrorMessage(remote_conn))));
+
+	resync_finish_command(remote_conn, copy_out);
+
+	if (PQputCopyEnd(local_conn, NULL) != 1)
+		ereport(ERROR,
+				(errmsg("sending copy-completion to destination connection failed"),
+				 errdetail("Destination connection reported: %s",
+						   PQerrorMessage(local_conn))));
+
+	resync_finish_command(local_conn, copy_in);
+}
+
+/*
+ * Run one of the DML statements of a resync, logging the key of each row it
+ * changed, and return the number of rows changed.
+ */
+static int64
+resync_apply(PGconn *conn, const char *query, const char *action,
+			 const pgactiveCompareTable * t, const char *node_name)
+{
+	PGresult   *res = resync_exec(conn, query, PGRES_TUPLES_OK);
+	int64		nrows = PQntuples(res);
+	int			row;
+
+	for (row = 0; row < PQntuples(res); row++)
+		elog(LOG, "%s row with key %s of table %s to match node \"%s\"",
+			 action, PQgetvalue(res, row, 0), t->relname, node_name);
+
+	PQclear(res);
+	return nrows;
+}
+
+/*
+ * Make the rows of a key range of a table on the local node match the rows a
+ * peer node has in it.
+ *
+ * The peer's rows are copied into a temporary table over a loopback
+ * connection to the local node with pgactive.do_not_replicate set, which then
+ * deletes, updates and inserts local rows so they match and commits, all in a
+ * single transaction that isn't replicated to other nodes. Like the apply
+ * workers, it runs with session_replication_role = replica.
+ */
+Datum
+pgactive_resync_range(PG_FUNCTION_ARGS)
+{
+#define pgactive_RESYNC_RANGE_COLS	3
+	Oid			relid;
+	char	   *node_name;
+	char	  **lo = NULL;
+	char	  **hi = NULL;
+	TupleDesc	tupdesc;
+	Datum		values[pgactive_RESYNC_RANGE_COLS];
+	bool		nulls[pgactive_RESYNC_RANGE_COLS];
+	pgactiveCompareTable t;
+	pgactiveNodeId peer;
+	pgactiveNodeId myid;
+	pgactiveNodeInfo *local_node;
+	char	   *dsn;
+	char	   *servername;
+	char	   *local_dsn;
+	PGconn	   *remote_conn;
+	PGconn	   *local_conn;
+	XLogRecPtr	local_lsn;
+	XLogRecPtr	remote_lsn;
+	int64		ndeleted = 0;
+	int64		nupdated = 0;
+	int64		ninserted = 0;
+
+	if (PG_ARGISNULL(0) || PG_ARGISNULL(1))
+		ereport(ERROR,
+				(errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
+				 errmsg("relation and node name must not be NULL")));
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	relid = PG_GETARG_OID(0);
+	node_name = text_to_cstring(PG_GETARG_TEXT_PP(1));
+
+	compare_get_table(relid, ACL_SELECT | ACL_INSERT | ACL_UPDATE | ACL_DELETE, &t);
+
+	if (!PG_ARGISNULL(2))
+		lo = resync_get_key(&t, PG_GETARG_ARRAYTYPE_P(2), "key_lo");
+	if (!PG_ARGISNULL(3))
+		hi = resync_get_key(&t, PG_GETARG_ARRAYTYPE_P(3), "key_hi");
+
+	if (SPI_connect() != SPI_OK_CONNECT)
+		elog(ERROR, "SPI_connect failed");
+
+	dsn = compare_get_peer(node_name, &peer);
+
+	pgactive_make_my_nodeid(&myid);
+	local_node = pgactive_nodes_get_local_info(&myid);
+	if (local_node == NULL || local_node->local_dsn == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("local node has no DSN")));
+
+	/* See pgactive_init_exec_dump_restore() about appending the options */
+	servername = get_connect_string(local_node->local_dsn);
+	local_dsn = psprintf("%s options='-c pgactive.do_not_replicate=on "
+						 "-c session_replication_role=replica'",
+						 servername == NULL ? local_node->local_dsn : servername);
+
+	remote_conn = pgactive_connect_nonrepl(dsn, "resync", true, true);
+
+	PG_ENSURE_ERROR_CLEANUP(pgactive_cleanup_conn_close,
+							PointerGetDatum(&remote_conn));
+	{
+		local_conn = pgactive_connect_nonrepl(local_dsn, "resync", true, true);
+
+		PG_ENSURE_ERROR_CLEANUP(pgactive_cleanup_conn_close,
+								PointerGetDatum(&local_conn));
+		{
+			StringInfoData copy_out;
+			StringInfoData query;
+			StringInfoData keymatch;
+			char	  **nonkeys;
+			int			nnonkeys = 0;
+			PGresult   *res;
+			XLogRecPtr	snapshot_lsn;
+			int			i,
+						j;
+
+			/* Columns the rows are matched by, and those to update */
+			initStringInfo(&keymatch);
+			appendStringInfoString(&keymatch, "ROW(");
+			compare_append_columns(&keymatch, t.keycols, t.nkeys, "t");
+			appendStringInfoString(&keymatch, ") = ROW(");
+			compare_append_columns(&keymatch, t.keycols, t.nkeys, "s");
+			appendStringInfoChar(&keymatch, ')');
+
+			nonkeys = palloc(sizeof(char *) * t.ncols);
+			for (i = 0; i < t.ncols; i++)
+			{
+				for (j = 0; j < t.nkeys; j++)
+					if (strcmp(t.cols[i], t.keycols[j]) == 0)
+						break;
+				if (j == t.nkeys)
+					nonkeys[nnonkeys++] = t.cols[i];
+			}
+
+			/*
+			 * Replay what the peer has written so far, while the apply
+			 * worker isn't blocked by the lock below yet.
+			 */
+			res = PQexec(remote_conn, "SELECT pg_catalog.pg_current_wal_insert_lsn()");
+			if (PQresultStatus(res) != PGRES_TUPLES_OK)
+				ereport(ERROR,
+						(errmsg("could not get WAL position of remote node"),
+						 errdetail("Querying remote failed with: %s",
+								   PQresultErrorMessage(res))));
+			remote_lsn = DatumGetLSN(DirectFunctionCall1Coll(pg_lsn_in, InvalidOid,
+															 CStringGetDatum(PQgetvalue(res, 0, 0))));
+			PQclear(res);
+			compare_wait_remote_replay(remote_conn, &peer, remote_lsn);
+
+			/*
+			 * Block concurrent changes to the table, including those of the
+			 * apply workers, until the key range has been brought in line.
+			 * The lock is taken before the peer's snapshot, so that no local
+			 * change that snapshot may lack can slip in before the rows are
+			 * compared. The rows are copied in text form, read them with the
+			 * settings the peer wrote them with.
+			 */
+			initStringInfo(&query);
+			appendStringInfo(&query,
+							 "BEGIN;\n"
+							 "%s;\n"
+							 "LOCK TABLE %s IN EXCLUSIVE MODE",
+							 compare_pin_remote_settings_query(), t.relname);
+			PQclear(resync_exec(local_conn, query.data, PGRES_COMMAND_OK));
+
+			/*
+			 * Once the peer replayed everything written here, take its
+			 * snapshot. Don't wait for this node to replay the peer again,
+			 * the apply worker may be blocked by the lock. Changes the peer
+			 * made in between are in the snapshot and get applied here once
+			 * more after the resync, to the same effect.
+			 */
+			compare_sync_snapshots(remote_conn, &peer, InvalidXLogRecPtr,
+								   InvalidXLogRecPtr, &local_lsn, &snapshot_lsn,
+								   false);
+
+			resetStringInfo(&query);
+			appendStringInfoString(&query,
+								   "CREATE TEMP TABLE pgactive_resync ON COMMIT DROP AS SELECT ");
+			compare_append_columns(&query, t.cols, t.ncols, NULL);
+			appendStringInfo(&query, " FROM %s WITH NO DATA", t.from);
+			PQclear(resync_exec(local_conn, query.data, PGRES_COMMAND_OK));
+
+			initStringInfo(&copy_out);
+			appendStringInfoString(&copy_out, "COPY (SELECT ");
+			compare_append_columns(&copy_out, t.cols, t.ncols, NULL);
+			compare_append_range(&copy_out, &t, lo, hi);
+			appendStringInfoString(&copy_out, ") TO STDOUT");
+
+			resetStringInfo(&query);
+			appendStringInfoString(&query, "COPY pg_temp.pgactive_resync (");
+			compare_append_columns(&query, t.cols, t.ncols, NULL);
+			appendStringInfoString(&query, ") FROM STDIN");
+
+			resync_copy(remote_conn, local_conn, copy_out.data, query.data);
+
+			resetStringInfo(&query);
+			appendStringInfo(&query, "DELETE FROM %s AS t WHERE true", t.from);
+			compare_append_bounds(&query, &t, lo, hi);
+			appendStringInfo(&query,
+							 " AND NOT EXISTS (SELECT 1 FROM pg_temp.pgactive_resync s WHERE %s)"
+							 " RETURNING %s::text",
+							 keymatch.data, t.keyrow);
+			ndeleted = resync_apply(local_conn, query.data, "deleted", &t, node_name);
+
+			/*
+			 * Rows are compared by their binary image, as not all types have
+			 * an equality operator.
+			 */
+			if (nnonkeys > 0)
+			{
+				resetStringInfo(&query);
+				appendStringInfo(&query, "UPDATE %s AS t SET (", t.from);
+				compare_append_columns(&query, nonkeys, nnonkeys, NULL);
+				appendStringInfoString(&query, ") = ROW(");
+				compare_append_columns(&query, nonkeys, nnonkeys, "s");
+				appendStringInfo(&query,
+								 ") FROM pg_temp.pgactive_resync s WHERE %s AND ROW(",
+								 keymatch.data);
+				compare_append_columns(&query, nonkeys, nnonkeys, "t");
+				appendStringInfoString(&query, ") *<> ROW(");
+				compare_append_columns(&query, nonkeys, nnonkeys, "s");
+				appendStringInfo(&query, ") RETURNING %s::text", t.keyrow);
+				nupdated = resync_apply(local_conn, query.data, "updated", &t, node_name);
+			}
+
+			resetStringInfo(&query);
+			appendStringInfo(&query, "INSERT INTO %s (", t.relname);
+			compare_append_columns(&query, t.cols, t.ncols, NULL);
+			appendStringInfoString(&query, ") SELECT ");
+			compare_append_columns(&query, t.cols, t.ncols, "s");
+			appendStringInfo(&query,
+							 " FROM pg_temp.pgactive_resync s"
+							 " WHERE NOT EXISTS (SELECT 1 FROM %s t WHERE %s)"
+							 " RETURNING %s::text",
+							 t.from, keymatch.data, t.keyrow);
+			ninserted = resync_apply(local_conn, query.data, "inserted", &t, node_name);
+
+			PQclear(resync_exec(local_conn, "COMMIT", PGRES_COMMAND_OK));
+		}
+		PG_END_ENSURE_ERROR_CLEANUP(pgactive_cleanup_conn_close,
+									PointerGetDatum(&local_conn));
+
+		PQfinish(local_conn);
+	}
+	PG_END_ENSURE_ERROR_CLEANUP(pgactive_cleanup_conn_close,
+								PointerGetDatum(&remote_conn));
+
+	PQfinish(remote_conn);
+	SPI_finish();
+
+	elog(LOG, "resynced key range of table %s from node \"%s\" after replay up to %X/%X locally and %X/%X on the node: " INT64_FORMAT " rows deleted, " INT64_FORMAT " updated, " INT64_FORMAT " inserted",
+		 t.relname, node_name, LSN_FORMAT_ARGS(local_lsn),
+		 LSN_FORMAT_ARGS(remote_lsn), ndeleted, nupdated, ninserted);
+
+	memset(nulls, 0, sizeof(nulls));
+	values[0] = Int64GetDatum(ndeleted);
+	values[1] = Int64GetDatum(nupdated);
+	values[2] = Int64GetDatum(ninserted);
+
+	PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls)));
+#undef pgactive_RESYNC_RANGE_COLS
+}
@@ -16,6 +16,7 @@
 
 #include "funcapi.h"
 
+#include "access/sysattr.h"
 #include "access/xact.h"
 
 #include "catalog/index.h"
@@ -25,15 +26,19 @@
 
 #include "tcop/tcopprot.h"
 
+#include "mb/pg_wchar.h"
+
 #include "replication/origin.h"
 
 #include "utils/builtins.h"
 #include "utils/guc.h"
+#include "utils/hsearch.h"
 #include "utils/json.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/pg_lsn.h"
 #include "utils/rel.h"
+#include "utils/timestamp.h"
 #include "utils/typcache.h"
 #include "catalog/pg_enum.h"
 
@@ -41,6 +46,8 @@
 bool		pgactive_log_conflicts_to_table = true;
 bool		pgactive_log_conflicts_to_logfile = false;
 bool		pgactive_conflict_logging_include_tuples = false;
+int			pgactive_conflict_logging_sample_limit = -1;
+int			pgactive_conflict_logging_sample_interval = 60000;
 
 static Oid	pgactiveConflictTypeOid = InvalidOid;
 static Oid	pgactiveConflictResolutionOid = InvalidOid;
@@ -52,6 +59,36 @@ static Oid	pgactiveConflictHistorySeqId = InvalidOid;
 /* We want our own memory ctx to clean up easily & reliably */
 static MemoryContext conflict_log_context;
 
+/*
+ * Conflicts of one type on one relation seen by this apply worker in the
+ * current sampling interval, see pgactive.conflict_logging_sample_limit.
+ * Conflicts beyond the limit are only counted here, along with the keys of
+ * the first few, and reported in a summary once the interval is over.
+ */
+#define CONFLICT_SAMPLE_KEYS 3
+#define CONFLICT_SAMPLE_KEY_LEN 128
+#define CONFLICT_RESOLUTION_COUNT (pgactiveConflictResolution_UnhandledTxAbort + 1)
+
+typedef struct ConflictSampleKey
+{
+	Oid			relid;
+	pgactiveConflictType conflict_type;
+} ConflictSampleKey;
+
+typedef struct ConflictSample
+{
+	ConflictSampleKey key;
+	char		relname[2 * NAMEDATALEN + 6];
+	TimestampTz interval_start;
+	int64		logged;
+	int64		suppressed;
+	int64		resolutions[CONFLICT_RESOLUTION_COUNT];
+	int			nkeys;
+	char		keys[CONFLICT_SAMPLE_KEYS][CONFLICT_SAMPLE_KEY_LEN];
+} ConflictSample;
+
+static HTAB *conflict_samples = NULL;
+
 /*
  * Perform syscache lookups etc for pgactive conflict logging.
  *
@@ -103,11 +140,10 @@ pgactive_conflict_logging_cleanup(void)
 }
 
 
-/* Get the enum oid for a given pgactiveConflictType */
-static Datum
-pgactive_conflict_type_get_datum(pgactiveConflictType conflict_type)
+/* Get the enum name for a given pgactiveConflictType */
+static char *
+pgactive_conflict_type_get_name(pgactiveConflictType conflict_type)
 {
-	Oid			conflict_type_oid;
 	char	   *enumname = NULL;
 
 	switch (conflict_type)
@@ -132,6 +168,16 @@ pgactive_conflict_type_get_datum(pgactiveConflictType conflict_type)
 			break;
 	}
 	Assert(enumname != NULL);
+	return enumname;
+}
+
+/* Get the enum oid for a given pgactiveConflictType */
+static Datum
+pgactive_conflict_type_get_datum(pgactiveConflictType conflict_type)
+{
+	Oid			conflict_type_oid;
+	char	   *enumname = pgactive_conflict_type_get_name(conflict_type);
+
 	conflict_type_oid = pgactiveGetSysCacheOid2(ENUMTYPOIDNAME, Anum_pg_enum_oid,
 												pgactiveConflictTypeOid, CStringGetDatum(enumname));
 	if (conflict_type_oid == InvalidOid)
@@ -385,7 +431,7 @@ pgactive_conflict_log_table(pgactiveApplyConflict * conflict)
 	if (!IsTransactionState())
 		elog(ERROR, "attempt to log conflict without surrounding transaction");
 
-	if (!pgactive_log_conflicts_to_table)
+	if (!pgactive_log_conflicts_to_table || conflict->suppressed)
 		/* No logging enabled and we don't own any memory, just bail */
 		return;
 
@@ -593,7 +639,7 @@ pgactive_conflict_log_serverlog(pgactiveApplyConflict * conflict)
 
 #define CONFLICT_MSG_PREFIX "CONFLICT: remote %s:"
 
-	if (!pgactive_log_conflicts_to_logfile)
+	if (!pgactive_log_conflicts_to_logfile || conflict->suppressed)
 		return;
 
 	/* Create text representation of the PKEY tuple */
@@ -635,6 +681,218 @@ pgactive_conflict_log_serverlog(pgactiveApplyConflict * conflict)
 }
 
 
+/*
+ * Format the replica identity columns of a conflicting row into buf, cut to
+ * CONFLICT_SAMPLE_KEY_LEN.
+ */
+static void
+conflict_sample_key(char *buf, Relation rel, TupleTableSlot *slot)
+{
+	TupleDesc	desc = RelationGetDescr(rel);
+	Bitmapset  *keyattrs;
+	StringInfoData s;
+	bool		first = true;
+	int			len;
+	int			i;
+
+	keyattrs = RelationGetIndexAttrBitmap(rel, INDEX_ATTR_BITMAP_IDENTITY_KEY);
+
+	initStringInfo(&s);
+	appendStringInfoChar(&s, '(');
+	for (i = 0; i < desc->natts; i++)
+	{
+		Form_pg_attribute att = TupleDescAttr(desc, i);
+		Datum		value;
+		bool		isnull;
+
+		if (att->attisdropped ||
+			!bms_is_member(att->attnum - FirstLowInvalidHeapAttributeNumber,
+						   keyattrs))
+			continue;
+
+		if (!first)
+			appendStringInfoString(&s, ", ");
+		first = false;
+
+		appendStringInfo(&s, "%s=", quote_identifier(NameStr(att->attname)));
+		value = slot_getattr(slot, att->attnum, &isnull);
+		if (isnull)
+			appendStringInfoString(&s, "NULL");
+		else
+		{
+			Oid			typoutput;
+			bool		typisvarlena;
+
+			getTypeOutputInfo(att->atttypid, &typoutput, &typisvarlena);
+			appendStringInfoString(&s, OidOutputFunctionCall(typoutput, value));
+		}
+	}
+	appendStringInfoChar(&s, ')');
+
+	len = pg_mbcliplen(s.data, s.len, CONFLICT_SAMPLE_KEY_LEN - 1);
+	memcpy(buf, s.data, len);
+	buf[len] = '\0';
+
+	pfree(s.data);
+	bms_free(keyattrs);
+}
+
+/*
+ * Log the conflicts of a sample that weren't logged in full, if any.
+ */
+static void
+conflict_sample_report(ConflictSample *sample, TimestampTz now)
+{
+	StringInfoData resolutions;
+	StringInfoData keys;
+	long		secs;
+	int			usecs;
+	int			i;
+
+	if (sample->suppressed == 0)
+		return;
+
+	initStringInfo(&resolutions);
+	for (i = 0; i < CONFLICT_RESOLUTION_COUNT; i++)
+	{
+		if (sample->resolutions[i] == 0)
+			continue;
+		if (resolutions.len > 0)
+			appendStringInfoString(&resolutions, ", ");
+		appendStringInfo(&resolutions, "%s %lld",
+						 pgactive_conflict_resolution_get_name(i),
+						 (long long) sample->resolutions[i]);
+	}
+
+	initStringInfo(&keys);
+	for (i = 0; i < sample->nkeys; i++)
+	{
+		if (i > 0)
+			appendStringInfoString(&keys, ", ");
+		appendStringInfoString(&keys, sample->keys[i]);
+	}
+
+	TimestampDifference(sample->interval_start, now, &secs, &usecs);
+
+	ereport(LOG,
+			(errcode(ERRCODE_INTEGRITY_CONSTRAINT_VIOLATION),
+			 errmsg("CONFLICT: %lld more %s conflicts on %s in the last %ld seconds were not logged",
+					(long long) sample->suppressed,
+					pgactive_conflict_type_get_name(sample->key.conflict_type),
+					sample->relname[0] != '\0' ? sample->relname : "(none)",
+					secs),
+			 errdetail("%lld conflicts were logged in full. Resolutions: %s. Sample keys: %s.",
+					   (long long) sample->logged, resolutions.data,
+					   keys.len > 0 ? keys.data : "(none)")));
+
+	pfree(resolutions.data);
+	pfree(keys.data);
+}
+
+/*
+ * Decide whether a conflict is to be logged in full, or only counted for a
+ * summary because pgactive.conflict_logging_sample_limit conflicts of its type
+ * on its relation have already been logged in the current interval.
+ */
+static bool
+conflict_sample(pgactiveConflictType conflict_type,
+				pgactiveConflictResolution resolution,
+				pgactiveRelation * rel, TupleTableSlot *key_tuple)
+{
+	ConflictSampleKey key;
+	ConflictSample *sample;
+	TimestampTz now;
+	bool		found;
+
+	if (pgactive_conflict_logging_sample_limit < 0 ||
+		(!pgactive_log_conflicts_to_table && !pgactive_log_conflicts_to_logfile))
+		return true;
+
+	if (conflict_samples == NULL)
+	{
+		HASHCTL		ctl;
+
+		memset(&ctl, 0, sizeof(ctl));
+		ctl.keysize = sizeof(ConflictSampleKey);
+		ctl.entrysize = sizeof(ConflictSample);
+		ctl.hcxt = TopMemoryContext;
+		conflict_samples = hash_create("pgactive conflict samples", 64, &ctl,
+									   HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	}
+
+	memset(&key, 0, sizeof(key));
+	key.relid = rel != NULL ? RelationGetRelid(rel->rel) : InvalidOid;
+	key.conflict_type = conflict_type;
+
+	now = GetCurrentTimestamp();
+	sample = hash_search(conflict_samples, &key, HASH_ENTER, &found);
+	if (!found)
+	{
+		memset((char *) sample + sizeof(ConflictSampleKey), 0,
+			   sizeof(ConflictSample) - sizeof(ConflictSampleKey));
+		if (rel != NULL)
+			strlcpy(sample->relname,
+					quote_qualified_identifier(get_namespace_name(RelationGetNamespace(rel->rel)),
+											   RelationGetRelationName(rel->rel)),
+					sizeof(sample->relname));
+		sample->interval_start = now;
+	}
+	else if (TimestampDifferenceExceeds(sample->interval_start, now,
+										pgactive_conflict_logging_sample_interval))
+	{
+		conflict_sample_report(sample, now);
+		sample->interval_start = now;
+		sample->logged = 0;
+		sample->suppressed = 0;
+		memset(sample->resolutions, 0, sizeof(sample->resolutions));
+		sample->nkeys = 0;
+	}
+
+	if (sample->logged < pgactive_conflict_logging_sample_limit)
+	{
+		sample->logged++;
+		return true;
+	}
+
+	sample->suppressed++;
+	sample->resolutions[resolution]++;
+	if (sample->nkeys < CONFLICT_SAMPLE_KEYS && rel != NULL && key_tuple != NULL)
+		conflict_sample_key(sample->keys[sample->nkeys++], rel->rel, key_tuple);
+
+	return false;
+}
+
+/*
+ * Report the conflicts that weren't logged in full during the sampling
+ * intervals that have ended, and forget about relations and conflict types
+ * that saw no conflicts in them. Called by the apply worker after commits and
+ * while it is idle, outside of a transaction.
+ */
+void
+pgactive_conflict_logging_flush(void)
+{
+	HASH_SEQ_STATUS status;
+	ConflictSample *sample;
+	TimestampTz now;
+
+	if (conflict_samples == NULL)
+		return;
+
+	now = GetCurrentTimestamp();
+	hash_seq_init(&status, conflict_samples);
+	while ((sample = hash_seq_search(&status)) != NULL)
+	{
+		if (!TimestampDifferenceExceeds(sample->interval_start, now,
+										pgactive_conflict_logging_sample_interval))
+			continue;
+
+		conflict_sample_report(sample, now);
+
+		if (hash_search(conflict_samples, &sample->key, HASH_REMOVE, NULL) == NULL)
+			elog(ERROR, "conflict sample hash table corrupted");
+	}
+}
+
 /*
  * Allocate a pgactiveApplyConflict object and fill it with the given conflict
  * details, plus additional current system state (including current xid).
@@ -667,6 +925,18 @@ pgactive_make_apply_conflict(pgactiveConflictType conflict_type,
 	conflict->conflict_type = conflict_type;
 	conflict->conflict_resolution = resolution;
 
+	conflict->suppressed = !conflict_sample(conflict_type, resolution,
+											conflict_relation,
+											remote_tuple != NULL ? remote_tuple : local_tuple);
+	if (conflict->suppressed)
+	{
+		/* only counted, see conflict_sample() */
+		conflict->local_tuple_null = true;
+		conflict->remote_tuple_null = true;
+		MemoryContextSwitchTo(old_context);
+		return conflict;
+	}
+
 	conflict->local_conflict_txid = GetTopTransactionIdIfAny();
 	conflict->local_conflict_lsn = GetXLogInsertRecPtr();
 	conflict->local_conflict_time = GetCurrentTimestamp();
@@ -19,9 +19,18 @@
 
 #include "fmgr.h"
 #include "funcapi.h"
+#include "miscadmin.h"
+
+#if PG_VERSION_NUM >= 180000
+#include "access/genam.h"
+#include "access/table.h"
+#include "catalog/pg_replication_origin.h"
+#endif
 
 #include "nodes/execnodes.h"
 
+#include "portability/instr_time.h"
+
 #include "replication/origin.h"
 
 #include "storage/fd.h"
@@ -29,6 +38,10 @@
 #include "storage/spin.h"
 
 #include "utils/builtins.h"
+#include "utils/hsearch.h"
+#if PG_VERSION_NUM >= 180000
+#include "utils/pgstat_internal.h"
+#endif
 
 /*
  * Statistics about logical replication
@@ -36,10 +49,8 @@
  * whenever this struct is changed, pgactive_count_version needs to be increased so
  * on-disk values aren't reused
  */
-typedef struct pgactiveCountSlot
+typedef struct pgactiveCountCounters
 {
-	RepOriginId node_id;
-
 	/* we use int64 to make sure we can export to sql, there is uint64 there */
 	int64		nr_commit;
 	int64		nr_rollback;
@@ -52,17 +63,110 @@ typedef struct pgactiveCountSlot
 	int64		nr_delete_conflict;
 
 	int64		nr_disconnect;
+}			pgactiveCountCounters;
+
+typedef struct pgactiveCountSlot
+{
+	RepOriginId node_id;
+	pgactiveCountCounters counters;
 }			pgactiveCountSlot;
 
+#if PG_VERSION_NUM >= 180000
+
+/*
+ * On PostgreSQL 18 and newer the per-node counters are a custom kind of the
+ * cumulative statistics system, with one entry per replication origin. That
+ * gets us regular flushes, consistent snapshots and resets from core, so the
+ * slots below and the stats file are only used on older versions.
+ *
+ * The kind id must be unique among the loaded extensions, see
+ * https://wiki.postgresql.org/wiki/CustomCumulativeStats where extensions
+ * reserve theirs. pgactive's is 27, which has to stay listed for pgactive
+ * there; the reference guide documents it as taken. It must never change,
+ * as the stats file stores entries by kind id and the counters saved under
+ * the old id would be lost.
+ */
+#define PGSTAT_KIND_pgactive	27
+
+typedef struct PgStatShared_pgactiveCount
+{
+	PgStatShared_Common header;
+	pgactiveCountCounters stats;
+}			PgStatShared_pgactiveCount;
+
+static bool pgactive_count_flush_cb(PgStat_EntryRef *entry_ref, bool nowait);
+
+static const PgStat_KindInfo pgactive_count_kind_info = {
+	.name = "pgactive",
+	.fixed_amount = false,
+	.accessed_across_databases = true,
+	.write_to_file = true,
+	.shared_size = sizeof(PgStatShared_pgactiveCount),
+	.shared_data_off = offsetof(PgStatShared_pgactiveCount, stats),
+	.shared_data_len = sizeof(((PgStatShared_pgactiveCount *) 0)->stats),
+	.pending_size = sizeof(pgactiveCountCounters),
+	.flush_pending_cb = pgactive_count_flush_cb,
+};
+#endif
+
+/*
+ * Per-relation statistics about logical replication, kept in a shared hash
+ * table keyed by database, peer node and relation.
+ *
+ * These aren't persisted across restarts.
+ */
+typedef struct pgactiveCountRelationKey
+{
+	Oid			dboid;
+	Oid			relid;
+	RepOriginId node_id;
+}			pgactiveCountRelationKey;
+
+typedef struct pgactiveCountRelationCounters
+{
+	int64		nr_insert;
+	int64		nr_update;
+	int64		nr_delete;
+
+	int64		nr_insert_insert_conflict;
+	int64		nr_update_update_conflict;
+	int64		nr_update_delete_conflict;
+	int64		nr_delete_delete_conflict;
+
+	int64		bytes_received;
+	instr_time	apply_time;
+}			pgactiveCountRelationCounters;
+
+typedef struct pgactiveCountRelationEntry
+{
+	pgactiveCountRelationKey key;	/* hash key, must be first */
+	pgactiveCountRelationCounters counters;
+}			pgactiveCountRelationEntry;
+
+/*
+ * Backend-local accumulator for the relations changed by the transaction
+ * being applied, flushed to the shared hash on commit so the apply hot path
+ * never touches shared memory.
+ */
+typedef struct pgactiveCountRelationPending
+{
+	Oid			relid;			/* hash key, must be first */
+	bool		pending;
+	pgactiveCountRelationCounters counters;
+}			pgactiveCountRelationPending;
+
 /*
  * Shared memory header for the stats module.
  */
 typedef struct pgactiveCountControl
 {
 	LWLockId	lock;
+	/* protects pgactiveCountRelationHash */
+	LWLockId	relation_lock;
 	pgactiveCountSlot slots[FLEXIBLE_ARRAY_MEMBER];
 }			pgactiveCountControl;
 
+#if PG_VERSION_NUM < 180000
 /*
  * Header of a stats disk serialization, used to detect old files, changed
  * parameters and such.
@@ -79,6 +183,7 @@ static const uint32 pgactive_count_magic = 0x5e51A7;
 
 /* everytime the stored data format changes, increase */
 static const uint32 pgactive_count_version = 2;
+#endif
 
 /* shortcut for the finding pgactiveCountControl in memory */
 static pgactiveCountControl * pgactiveCountCtl = NULL;
@@ -86,23 +191,47 @@ static pgactiveCountControl * pgactiveCountCtl = NULL;
 /* how many nodes have we built shmem for */
 static Size pgactive_count_nnodes = 0;
 
+#if PG_VERSION_NUM < 180000
 /* offset in the pgactiveCountControl->slots "our" backend is in */
 static int	MyCountOffsetIdx = -1;
+#endif
+
+/* node "our" backend counts statistics for */
+static RepOriginId MyCountNodeId = InvalidRepOriginId;
+
+/* shared per-relation statistics, NULL if disabled */
+static HTAB *pgactiveCountRelationHash = NULL;
+
+/* per-relation statistics not yet flushed to shared memory */
+static HTAB *pgactiveCountRelationLocal = NULL;
+static pgactiveCountRelationPending **pending_relations = NULL;
+static int	nr_pending_relations = 0;
+static int	max_pending_relations = 0;
+static pgactiveCountRelationPending *last_pending_relation = NULL;
 
 static shmem_startup_hook_type prev_shmem_startup_hook = NULL;
 
 static void pgactive_count_shmem_startup(void);
-static void pgactive_count_shmem_shutdown(int code, Datum arg);
 static Size pgactive_count_shmem_size(void);
 
+#if PG_VERSION_NUM < 180000
+static void pgactive_count_shmem_shutdown(int code, Datum arg);
 static void pgactive_count_serialize(void);
 static void pgactive_count_unserialize(void);
+#endif
 
 #define pgactive_COUNT_STAT_COLS 12
+#define pgactive_COUNT_STAT_RELATION_COLS 12
 
 PGDLLEXPORT Datum pgactive_get_stats(PG_FUNCTION_ARGS);
+PGDLLEXPORT Datum pgactive_stats_reset(PG_FUNCTION_ARGS);
+PGDLLEXPORT Datum pgactive_get_stat_relation(PG_FUNCTION_ARGS);
+PGDLLEXPORT Datum pgactive_stat_relation_reset(PG_FUNCTION_ARGS);
 
 PG_FUNCTION_INFO_V1(pgactive_get_stats);
+PG_FUNCTION_INFO_V1(pgactive_stats_reset);
+PG_FUNCTION_INFO_V1(pgactive_get_stat_relation);
+PG_FUNCTION_INFO_V1(pgactive_stat_relation_reset);
 
 static Size
 pgactive_count_shmem_size(void)
@@ -110,7 +239,9 @@ pgactive_count_shmem_size(void)
 	Size		size = 0;
 
 	size = add_size(size, sizeof(pgactiveCountControl));
+#if PG_VERSION_NUM < 180000
 	size = add_size(size, mul_size(pgactive_count_nnodes, sizeof(pgactiveCountSlot)));
+#endif
 
 	return size;
 }
@@ -128,13 +259,64 @@ pgactive_count_shmem_init(int nnodes)
 	pgactive_count_nnodes = (Size) nnodes;
 
 	RequestAddinShmemSpace(pgactive_count_shmem_size());
-	/* lock for slot acquiration */
-	RequestNamedLWLockTranche("pgactive_count", 1);
+	RequestAddinShmemSpace(hash_estimate_size(pgactive_max_stat_relations,
+											  sizeof(pgactiveCountRelationEntry)));
+	/* lock for slot acquiration, and one for the per-relation hash */
+	RequestNamedLWLockTranche("pgactive_count", 2);
 
 	prev_shmem_startup_hook = shmem_startup_hook;
 	shmem_startup_hook = pgactive_count_shmem_startup;
 }
 
+#if PG_VERSION_NUM >= 180000
+/*
+ * Register the custom statistics kind. Has to happen while loading
+ * shared_preload_libraries, before shared memory is sized.
+ */
+void
+pgactive_count_register_kind(void)
+{
+	Assert(process_shared_preload_libraries_in_progress);
+
+	pgstat_register_kind(PGSTAT_KIND_pgactive, &pgactive_count_kind_info);
+}
+
+/* Add the counters in from to those in to */
+#define pgactive_COUNT_ACCUM(to, from) \
+	do { \
+		(to)->nr_commit += (from)->nr_commit; \
+		(to)->nr_rollback += (from)->nr_rollback; \
+		(to)->nr_insert += (from)->nr_insert; \
+		(to)->nr_insert_conflict += (from)->nr_insert_conflict; \
+		(to)->nr_update += (from)->nr_update; \
+		(to)->nr_update_conflict += (from)->nr_update_conflict; \
+		(to)->nr_delete += (from)->nr_delete; \
+		(to)->nr_delete_conflict += (from)->nr_delete_conflict; \
+		(to)->nr_disconnect += (from)->nr_disconnect; \
+	} while (0)
+
+/*
+ * Add the counters accumulated by this backend to the shared entry.
+ */
+static bool
+pgactive_count_flush_cb(PgStat_EntryRef *entry_ref, bool nowait)
+{
+	pgactiveCountCounters *pending = (pgactiveCountCounters *) entry_ref->pending;
+	PgStatShared_pgactiveCount *shared;
+
+	shared = (PgStatShared_pgactiveCount *) entry_ref->shared_stats;
+
+	if (!pgstat_lock_entry(entry_ref, nowait))
+		return false;
+
+	pgactive_COUNT_ACCUM(&shared->stats, pending);
+
+	pgstat_unlock_entry(entry_ref);
+
+	return true;
+}
+#endif
+
 static void
 pgactive_count_shmem_startup(void)
 {
@@ -151,19 +333,40 @@ pgactive_count_shmem_startup(void)
 	{
 		/* initialize */
 		memset(pgactiveCountCtl, 0, pgactive_count_shmem_size());
-		pgactiveCountCtl->lock = &(GetNamedLWLockTranche("pgactive_count"))->lock;
+		pgactiveCountCtl->lock = &(GetNamedLWLockTranche("pgactive_count"))[0].lock;
+		pgactiveCountCtl->relation_lock = &(GetNamedLWLockTranche("pgactive_count"))[1].lock;
+#if PG_VERSION_NUM < 180000
 		pgactive_count_unserialize();
+#endif
+	}
+
+	if (pgactive_max_stat_relations > 0)
+	{
+		HASHCTL		info;
+
+		memset(&info, 0, sizeof(info));
+		info.keysize = sizeof(pgactiveCountRelationKey);
+		info.entrysize = sizeof(pgactiveCountRelationEntry);
+		pgactiveCountRelationHash = ShmemInitHash("pgactive_count_relation",
+												  pgactive_max_stat_relations,
+												  pgactive_max_stat_relations,
+												  &info,
+												  HASH_ELEM | HASH_BLOBS);
 	}
 	LWLockRelease(AddinShmemInitLock);
 
+#if PG_VERSION_NUM < 180000
+
 	/*
 	 * If we're in the postmaster (or a standalone backend...), set up a shmem
 	 * exit hook to dump the statistics to disk.
 	 */
 	if (!IsUnderPostmaster)
 		on_shmem_exit(pgactive_count_shmem_shutdown, (Datum) 0);
+#endif
 }
 
+#if PG_VERSION_NUM < 180000
 static void
 pgactive_count_shmem_shutdown(int code, Datum arg)
 {
@@ -177,6 +380,7 @@ pgactive_count_shmem_shutdown(int code, Datum arg)
 	/* persist the file */
 	pgactive_count_serialize();
 }
+#endif
 
 /*
  * Find a statistics slot for a given RepOriginId and setup a local variable
@@ -186,9 +390,17 @@ pgactive_count_shmem_shutdown(int code, Datum arg)
 void
 pgactive_count_set_current_node(RepOriginId node_id)
 {
+#if PG_VERSION_NUM >= 180000
+	MyCountNodeId = node_id;
+
+	/* create the entry, so the node shows up before anything is counted */
+	(void) pgstat_get_entry_ref(PGSTAT_KIND_pgactive, InvalidOid, node_id,
+								true, NULL);
+#else
 	size_t		i;
 
 	MyCountOffsetIdx = -1;
+	MyCountNodeId = node_id;
 
 	LWLockAcquire(pgactiveCountCtl->lock, LW_EXCLUSIVE);
 
@@ -220,86 +432,409 @@ pgactive_count_set_current_node(RepOriginId node_id)
 		elog(PANIC, "could not find a pgactive count slot for %u", node_id);
 out:
 	LWLockRelease(pgactiveCountCtl->lock);
+#endif
 }
 
 /*
- * Statistic manipulation functions.
+ * Forget the statistics of a node whose replication origin is dropped, so
+ * they neither linger nor get inherited by a later origin with the same id.
+ *
+ * Origins can also be dropped without going through here, so it's also
+ * called for a newly created origin, whose id may have been used before.
+ */
+void
+pgactive_count_drop_node(RepOriginId node_id)
+{
+#if PG_VERSION_NUM >= 180000
+	if (!pgstat_drop_entry(PGSTAT_KIND_pgactive, InvalidOid, node_id))
+		pgstat_request_entry_refs_gc();
+#else
+	size_t		i;
+
+	LWLockAcquire(pgactiveCountCtl->lock, LW_EXCLUSIVE);
+	for (i = 0; i < pgactive_count_nnodes; i++)
+	{
+		if (pgactiveCountCtl->slots[i].node_id == node_id)
+		{
+			pgactiveCountCtl->slots[i].node_id = InvalidRepOriginId;
+			memset(&pgactiveCountCtl->slots[i].counters, 0,
+				   sizeof(pgactiveCountCounters));
+			break;
+		}
+	}
+	LWLockRelease(pgactiveCountCtl->lock);
+#endif
+}
+
+/*
+ * Return the counters of the node set by pgactive_count_set_current_node().
  *
  * We assume we don't have to do any locking for *our* slot since only one
- * backend will do writing there.
+ * backend will do writing there. With the cumulative statistics system these
+ * are backend-local pending counters, flushed by pgstat_report_stat().
+ */
+static inline pgactiveCountCounters *
+pgactive_count_current(void)
+{
+#if PG_VERSION_NUM >= 180000
+	PgStat_EntryRef *entry_ref;
+
+	Assert(MyCountNodeId != InvalidRepOriginId);
+	entry_ref = pgstat_prep_pending_entry(PGSTAT_KIND_pgactive, InvalidOid,
+										  MyCountNodeId, NULL);
+	return (pgactiveCountCounters *) entry_ref->pending;
+#else
+	Assert(MyCountOffsetIdx != -1);
+	return &pgactiveCountCtl->slots[MyCountOffsetIdx].counters;
+#endif
+}
+
+/*
+ * Statistic manipulation functions.
  */
 void
 pgactive_count_commit(void)
 {
-	Assert(MyCountOffsetIdx != -1);
-	pgactiveCountCtl->slots[MyCountOffsetIdx].nr_commit++;
+	pgactive_count_current()->nr_commit++;
 }
 
 void
 pgactive_count_rollback(void)
 {
-	Assert(MyCountOffsetIdx != -1);
-	pgactiveCountCtl->slots[MyCountOffsetIdx].nr_rollback++;
+	pgactive_count_current()->nr_rollback++;
 }
 
 void
 pgactive_count_insert(void)
 {
-	Assert(MyCountOffsetIdx != -1);
-	pgactiveCountCtl->slots[MyCountOffsetIdx].nr_insert++;
+	pgactive_count_current()->nr_insert++;
 }
 
 void
 pgactive_count_insert_conflict(void)
 {
-	Assert(MyCountOffsetIdx != -1);
-	pgactiveCountCtl->slots[MyCountOffsetIdx].nr_insert_conflict++;
+	pgactive_count_current()->nr_insert_conflict++;
 }
 
 void
 pgactive_count_update(void)
 {
-	Assert(MyCountOffsetIdx != -1);
-	pgactiveCountCtl->slots[MyCountOffsetIdx].nr_update++;
+	pgactive_count_current()->nr_update++;
 }
 
 void
 pgactive_count_update_conflict(void)
 {
-	Assert(MyCountOffsetIdx != -1);
-	pgactiveCountCtl->slots[MyCountOffsetIdx].nr_update_conflict++;
+	pgactive_count_current()->nr_update_conflict++;
 }
 
 void
 pgactive_count_delete(void)
 {
-	Assert(MyCountOffsetIdx != -1);
-	pgactiveCountCtl->slots[MyCountOffsetIdx].nr_delete++;
+	pgactive_count_current()->nr_delete++;
 }
 
 void
 pgactive_count_delete_conflict(void)
 {
-	Assert(MyCountOffsetIdx != -1);
-	pgactiveCountCtl->slots[MyCountOffsetIdx].nr_delete_conflict++;
+	pgactive_count_current()->nr_delete_conflict++;
 }
 
 void
 pgactive_count_disconnect(void)
 {
-	Assert(MyCountOffsetIdx != -1);
-	pgactiveCountCtl->slots[MyCountOffsetIdx].nr_disconnect++;
+	pgactive_count_current()->nr_disconnect++;
+}
+
+/*
+ * Find the backend-local per-relation accumulator for relid, remembering it
+ * for the next flush.
+ */
+static pgactiveCountRelationCounters *
+pgactive_count_relation_get(Oid relid)
+{
+	pgactiveCountRelationPending *entry;
+	bool		found;
+
+	if (last_pending_relation != NULL && last_pending_relation->relid == relid)
+		return &last_pending_relation->counters;
+
+	if (pgactiveCountRelationLocal == NULL)
+	{
+		HASHCTL		info;
+
+		memset(&info, 0, sizeof(info));
+		info.keysize = sizeof(Oid);
+		info.entrysize = sizeof(pgactiveCountRelationPending);
+		info.hcxt = TopMemoryContext;
+		pgactiveCountRelationLocal = hash_create("pgactive per-relation stats",
+												 64, &info,
+												 HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+
+		max_pending_relations = 16;
+		pending_relations = MemoryContextAlloc(TopMemoryContext,
+											   max_pending_relations * sizeof(pgactiveCountRelationPending *));
+	}
+
+	entry = hash_search(pgactiveCountRelationLocal, &relid, HASH_ENTER, &found);
+	if (!found)
+	{
+		entry->pending = false;
+		memset(&entry->counters, 0, sizeof(entry->counters));
+	}
+
+	if (!entry->pending)
+	{
+		if (nr_pending_relations >= max_pending_relations)
+		{
+			max_pending_relations *= 2;
+			pending_relations = repalloc(pending_relations,
+										 max_pending_relations * sizeof(pgactiveCountRelationPending *));
+		}
+		pending_relations[nr_pending_relations++] = entry;
+		entry->pending = true;
+	}
+
+	last_pending_relation = entry;
+
+	return &entry->counters;
+}
+
+/*
+ * Per-relation statistic manipulation functions.
+ *
+ * These only touch backend-local memory; pgactive_count_relation_flush()
+ * publishes the accumulated values.
+ */
+void
+pgactive_count_relation_insert(Oid relid)
+{
+	if (pgactiveCountRelationHash == NULL)
+		return;
+	pgactive_count_relation_get(relid)->nr_insert++;
+}
+
+void
+pgactive_count_relation_update(Oid relid)
+{
+	if (pgactiveCountRelationHash == NULL)
+		return;
+	pgactive_count_relation_get(relid)->nr_update++;
+}
+
+void
+pgactive_count_relation_delete(Oid relid)
+{
+	if (pgactiveCountRelationHash == NULL)
+		return;
+	pgactive_count_relation_get(relid)->nr_delete++;
+}
+
+void
+pgactive_count_relation_conflict(Oid relid, pgactiveConflictType conflict_type)
+{
+	pgactiveCountRelationCounters *counters;
+
+	if (pgactiveCountRelationHash == NULL)
+		return;
+
+	counters = pgactive_count_relation_get(relid);
+
+	switch (conflict_type)
+	{
+		case pgactiveConflictType_InsertInsert:
+			counters->nr_insert_insert_conflict++;
+			break;
+		case pgactiveConflictType_UpdateUpdate:
+			counters->nr_update_update_conflict++;
+			break;
+		case pgactiveConflictType_UpdateDelete:
+			counters->nr_update_delete_conflict++;
+			break;
+		case pgactiveConflictType_DeleteDelete:
+			counters->nr_delete_delete_conflict++;
+			break;
+		default:
+			break;
+	}
+}
+
+/*
+ * Note when the apply of a change starts, for pgactive_count_relation_apply().
+ * Leaves start zeroed if per-relation statistics are disabled, sparing the
+ * clock reads.
+ */
+void
+pgactive_count_relation_start(instr_time *start)
+{
+	if (pgactiveCountRelationHash != NULL)
+		INSTR_TIME_SET_CURRENT(*start);
+	else
+		INSTR_TIME_SET_ZERO(*start);
+}
+
+/*
+ * Account for a change message of nbytes received for relid, whose apply
+ * started at start.
+ */
+void
+pgactive_count_relation_apply(Oid relid, Size nbytes, instr_time start)
+{
+	pgactiveCountRelationCounters *counters;
+	instr_time	duration;
+
+	if (pgactiveCountRelationHash == NULL)
+		return;
+
+	INSTR_TIME_SET_CURRENT(duration);
+	INSTR_TIME_SUBTRACT(duration, start);
+
+	counters = pgactive_count_relation_get(relid);
+	counters->bytes_received += nbytes;
+	INSTR_TIME_ADD(counters->apply_time, duration);
+}
+
+/*
+ * Add the per-relation statistics accumulated since the last flush to shared
+ * memory. Called once per applied transaction.
+ */
+void
+pgactive_count_relation_flush(void)
+{
+	pgactiveCountRelationKey key;
+	bool		warned = false;
+	int			i;
+
+	if (nr_pending_relations == 0)
+		return;
+
+	Assert(MyCountNodeId != InvalidRepOriginId);
+
+	memset(&key, 0, sizeof(key));
+	key.dboid = MyDatabaseId;
+	key.node_id = MyCountNodeId;
+
+	LWLockAcquire(pgactiveCountCtl->relation_lock, LW_EXCLUSIVE);
+	for (i = 0; i < nr_pending_relations; i++)
+	{
+		pgactiveCountRelationPending *pending = pending_relations[i];
+		pgactiveCountRelationEntry *entry;
+		pgactiveCountRelationCounters *counters;
+
+		key.relid = pending->relid;
+		entry = hash_search(pgactiveCountRelationHash, &key,
+							HASH_FIND, NULL);
+
+		/*
+		 * The shared hash has no room past its initial size, don't let it
+		 * take memory from the rest of the shared memory segment.
+		 */
+		if (entry == NULL &&
+			hash_get_num_entries(pgactiveCountRelationHash) < pgactive_max_stat_relations)
+		{
+			entry = hash_search(pgactiveCountRelationHash, &key,
+								HASH_ENTER, NULL);
+			memset(&entry->counters, 0, sizeof(entry->counters));
+		}
+
+		if (entry == NULL)
+		{
+			if (!warned)
+				elog(DEBUG1, "pgactive per-relation statistics are full, increase pgactive.max_stat_relations");
+			warned = true;
+		}
+		else
+		{
+			counters = &entry->counters;
+			counters->nr_insert += pending->counters.nr_insert;
+			counters->nr_update += pending->counters.nr_update;
+			counters->nr_delete += pending->counters.nr_delete;
+			counters->nr_insert_insert_conflict += pending->counters.nr_insert_insert_conflict;
+			counters->nr_update_update_conflict += pending->counters.nr_update_update_conflict;
+			counters->nr_update_delete_conflict += pending->counters.nr_update_delete_conflict;
+			counters->nr_delete_delete_conflict += pending->counters.nr_delete_delete_conflict;
+			counters->bytes_received += pending->counters.bytes_received;
+			INSTR_TIME_ADD(counters->apply_time, pending->counters.apply_time);
+		}
+
+		pending->pending = false;
+		memset(&pending->counters, 0, sizeof(pending->counters));
+	}
+	LWLockRelease(pgactiveCountCtl->relation_lock);
+
+	nr_pending_relations = 0;
+	last_pending_relation = NULL;
+}
+
+static void
+pgactive_count_put_tuple(ReturnSetInfo *rsinfo, RepOriginId node_id,
+						 pgactiveCountCounters *counters)
+{
+	char	   *riname;
+	Datum		values[pgactive_COUNT_STAT_COLS];
+	bool		nulls[pgactive_COUNT_STAT_COLS];
+
+	memset(values, 0, sizeof(values));
+	memset(nulls, 0, sizeof(nulls));
+
+	replorigin_by_oid(node_id, false, &riname);
+
+	values[0] = ObjectIdGetDatum(node_id);
+	values[1] = ObjectIdGetDatum(node_id);
+	values[2] = CStringGetTextDatum(riname);
+	values[3] = Int64GetDatumFast(counters->nr_commit);
+	values[4] = Int64GetDatumFast(counters->nr_rollback);
+	values[5] = Int64GetDatumFast(counters->nr_insert);
+	values[6] = Int64GetDatumFast(counters->nr_insert_conflict);
+	values[7] = Int64GetDatumFast(counters->nr_update);
+	values[8] = Int64GetDatumFast(counters->nr_update_conflict);
+	values[9] = Int64GetDatumFast(counters->nr_delete);
+	values[10] = Int64GetDatumFast(counters->nr_delete_conflict);
+	values[11] = Int64GetDatumFast(counters->nr_disconnect);
+
+	tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc,
+						 values, nulls);
 }
 
 Datum
 pgactive_get_stats(PG_FUNCTION_ARGS)
 {
 	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+#if PG_VERSION_NUM >= 180000
+	Relation	rel;
+	SysScanDesc scan;
+	HeapTuple	tuple;
+#else
 	size_t		current_offset;
+#endif
 
 	/* Construct the tuplestore and tuple descriptor */
 	InitMaterializedSRF(fcinfo, 0);
 
+#if PG_VERSION_NUM >= 180000
+	/* statistics entries are keyed by replication origin */
+	rel = table_open(ReplicationOriginRelationId, AccessShareLock);
+	scan = systable_beginscan(rel, InvalidOid, false, NULL, 0, NULL);
+
+	while (HeapTupleIsValid(tuple = systable_getnext(scan)))
+	{
+		Form_pg_replication_origin origin;
+		pgactiveCountCounters *counters;
+
+		origin = (Form_pg_replication_origin) GETSTRUCT(tuple);
+
+		/* no stats here */
+		counters = (pgactiveCountCounters *)
+			pgstat_fetch_entry(PGSTAT_KIND_pgactive, InvalidOid, origin->roident);
+		if (counters == NULL)
+			continue;
+
+		pgactive_count_put_tuple(rsinfo, origin->roident, counters);
+	}
+
+	systable_endscan(scan);
+	table_close(rel, AccessShareLock);
+#else
 	/* don't let a node get created/vanish below us */
 	LWLockAcquire(pgactiveCountCtl->lock, LW_SHARED);
 
@@ -307,9 +842,6 @@ pgactive_get_stats(PG_FUNCTION_ARGS)
 		 current_offset++)
 	{
 		pgactiveCountSlot *slot;
-		char	   *riname;
-		Datum		values[pgactive_COUNT_STAT_COLS];
-		bool		nulls[pgactive_COUNT_STAT_COLS];
 
 		slot = &pgactiveCountCtl->slots[current_offset];
 
@@ -317,32 +849,258 @@ pgactive_get_stats(PG_FUNCTION_ARGS)
 		if (slot->node_id == InvalidRepOriginId)
 			continue;
 
+		pgactive_count_put_tuple(rsinfo, slot->node_id, &slot->counters);
+	}
+	LWLockRelease(pgactiveCountCtl->lock);
+#endif
+
+	PG_RETURN_VOID();
+}
+
+/*
+ * Append the counters of all nodes to a pgactive_metrics() document.
+ *
+ * The counters are copied first, so the lock isn't held while looking up the
+ * origin names.
+ */
+void
+pgactive_count_metrics(StringInfo out)
+{
+	static const struct
+	{
+		const char *name;
+		const char *help;
+		Size		offset;
+	}			metrics[] =
+	{
+		{"pgactive_commits_total", "Transactions applied from the node.",
+		offsetof(pgactiveCountCounters, nr_commit)},
+		{"pgactive_rollbacks_total", "Transactions from the node rolled back.",
+		offsetof(pgactiveCountCounters, nr_rollback)},
+		{"pgactive_inserts_total", "Rows inserted by changes from the node.",
+		offsetof(pgactiveCountCounters, nr_insert)},
+		{"pgactive_insert_conflicts_total", "Conflicts on inserts from the node.",
+		offsetof(pgactiveCountCounters, nr_insert_conflict)},
+		{"pgactive_updates_total", "Rows updated by changes from the node.",
+		offsetof(pgactiveCountCounters, nr_update)},
+		{"pgactive_update_conflicts_total", "Conflicts on updates from the node.",
+		offsetof(pgactiveCountCounters, nr_update_conflict)},
+		{"pgactive_deletes_total", "Rows deleted by changes from the node.",
+		offsetof(pgactiveCountCounters, nr_delete)},
+		{"pgactive_delete_conflicts_total", "Conflicts on deletes from the node.",
+		offsetof(pgactiveCountCounters, nr_delete_conflict)},
+		{"pgactive_disconnects_total", "Disconnections from the node.",
+		offsetof(pgactiveCountCounters, nr_disconnect)},
+	};
+	pgactiveCountSlot *slots;
+	int			nslots = 0;
+	char	  **names;
+	int			i;
+	int			j;
+#if PG_VERSION_NUM >= 180000
+	Relation	rel;
+	SysScanDesc scan;
+	HeapTuple	tuple;
+	int			maxslots = 8;
+
+	slots = palloc(sizeof(pgactiveCountSlot) * maxslots);
+
+	rel = table_open(ReplicationOriginRelationId, AccessShareLock);
+	scan = systable_beginscan(rel, InvalidOid, false, NULL, 0, NULL);
+
+	while (HeapTupleIsValid(tuple = systable_getnext(scan)))
+	{
+		Form_pg_replication_origin origin;
+		pgactiveCountCounters *counters;
+
+		origin = (Form_pg_replication_origin) GETSTRUCT(tuple);
+
+		counters = (pgactiveCountCounters *)
+			pgstat_fetch_entry(PGSTAT_KIND_pgactive, InvalidOid, origin->roident);
+		if (counters == NULL)
+			continue;
+
+		if (nslots >= maxslots)
+		{
+			maxslots *= 2;
+			slots = repalloc(slots, sizeof(pgactiveCountSlot) * maxslots);
+		}
+		slots[nslots].node_id = origin->roident;
+		slots[nslots].counters = *counters;
+		nslots++;
+	}
+
+	systable_endscan(scan);
+	table_close(rel, AccessShareLock);
+#else
+	size_t		current_offset;
+
+	slots = palloc(sizeof(pgactiveCountSlot) * Max(pgactive_count_nnodes, 1));
+
+	LWLockAcquire(pgactiveCountCtl->lock, LW_SHARED);
+	for (current_offset = 0; current_offset < pgactive_count_nnodes;
+		 current_offset++)
+	{
+		if (pgactiveCountCtl->slots[current_offset].node_id == InvalidRepOriginId)
+			continue;
+		slots[nslots++] = pgactiveCountCtl->slots[current_offset];
+	}
+	LWLockRelease(pgactiveCountCtl->lock);
+#endif
+
+	names = palloc(sizeof(char *) * Max(nslots, 1));
+	for (j = 0; j < nslots; j++)
+	{
+		if (!replorigin_by_oid(slots[j].node_id, true, &names[j]))
+			names[j] = psprintf("%u", slots[j].node_id);
+	}
+
+	for (i = 0; i < lengthof(metrics); i++)
+	{
+		pgactive_metrics_family(out, metrics[i].name, "counter", metrics[i].help);
+		for (j = 0; j < nslots; j++)
+		{
+			int64		value;
+
+			value = *(int64 *) ((char *) &slots[j].counters + metrics[i].offset);
+
+			appendStringInfo(out, "%s{origin=", metrics[i].name);
+			pgactive_metrics_label_value(out, names[j]);
+			appendStringInfo(out, "} " INT64_FORMAT "\n", value);
+		}
+	}
+
+	pfree(names);
+	pfree(slots);
+}
+
+/*
+ * Reset the statistics of all nodes.
+ */
+Datum
+pgactive_stats_reset(PG_FUNCTION_ARGS)
+{
+#if PG_VERSION_NUM >= 180000
+	pgstat_reset_of_kind(PGSTAT_KIND_pgactive);
+#else
+	size_t		current_offset;
+
+	LWLockAcquire(pgactiveCountCtl->lock, LW_EXCLUSIVE);
+	for (current_offset = 0; current_offset < pgactive_count_nnodes;
+		 current_offset++)
+		memset(&pgactiveCountCtl->slots[current_offset].counters, 0,
+			   sizeof(pgactiveCountCounters));
+	LWLockRelease(pgactiveCountCtl->lock);
+#endif
+
+	PG_RETURN_VOID();
+}
+
+/*
+ * Return the per-relation statistics of the current database.
+ */
+Datum
+pgactive_get_stat_relation(PG_FUNCTION_ARGS)
+{
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	HASH_SEQ_STATUS status;
+	pgactiveCountRelationEntry *entry;
+	pgactiveCountRelationEntry *entries;
+	int			nentries = 0;
+	int			i;
+
+	/* Construct the tuplestore and tuple descriptor */
+	InitMaterializedSRF(fcinfo, 0);
+
+	if (pgactiveCountRelationHash == NULL)
+		PG_RETURN_VOID();
+
+	/*
+	 * Copy the entries out so that looking up origin names doesn't happen
+	 * with the lock held.
+	 */
+	entries = palloc(sizeof(pgactiveCountRelationEntry) *
+					 Max(pgactive_max_stat_relations, 1));
+
+	LWLockAcquire(pgactiveCountCtl->relation_lock, LW_SHARED);
+	hash_seq_init(&status, pgactiveCountRelationHash);
+	while ((entry = hash_seq_search(&status)) != NULL)
+	{
+		if (entry->key.dboid != MyDatabaseId)
+			continue;
+		if (nentries >= pgactive_max_stat_relations)
+		{
+			hash_seq_term(&status);
+			break;
+		}
+		entries[nentries++] = *entry;
+	}
+	LWLockRelease(pgactiveCountCtl->relation_lock);
+
+	for (i = 0; i < nentries; i++)
+	{
+		pgactiveCountRelationCounters *counters = &entries[i].counters;
+		char	   *riname;
+		Datum		values[pgactive_COUNT_STAT_RELATION_COLS];
+		bool		nulls[pgactive_COUNT_STAT_RELATION_COLS];
+
 		memset(values, 0, sizeof(values));
 		memset(nulls, 0, sizeof(nulls));
 
-		replorigin_by_oid(slot->node_id, false, &riname);
-
-		values[0] = ObjectIdGetDatum(slot->node_id);
-		values[1] = ObjectIdGetDatum(slot->node_id);
-		values[2] = CStringGetTextDatum(riname);
-		values[3] = Int64GetDatumFast(slot->nr_commit);
-		values[4] = Int64GetDatumFast(slot->nr_rollback);
-		values[5] = Int64GetDatumFast(slot->nr_insert);
-		values[6] = Int64GetDatumFast(slot->nr_insert_conflict);
-		values[7] = Int64GetDatumFast(slot->nr_update);
-		values[8] = Int64GetDatumFast(slot->nr_update_conflict);
-		values[9] = Int64GetDatumFast(slot->nr_delete);
-		values[10] = Int64GetDatumFast(slot->nr_delete_conflict);
-		values[11] = Int64GetDatumFast(slot->nr_disconnect);
+		if (replorigin_by_oid(entries[i].key.node_id, true, &riname))
+			values[1] = CStringGetTextDatum(riname);
+		else
+			nulls[1] = true;
+
+		values[0] = ObjectIdGetDatum(entries[i].key.node_id);
+		values[2] = ObjectIdGetDatum(entries[i].key.relid);
+		values[3] = Int64GetDatumFast(counters->nr_insert);
+		values[4] = Int64GetDatumFast(counters->nr_update);
+		values[5] = Int64GetDatumFast(counters->nr_delete);
+		values[6] = Int64GetDatumFast(counters->nr_insert_insert_conflict);
+		values[7] = Int64GetDatumFast(counters->nr_update_update_conflict);
+		values[8] = Int64GetDatumFast(counters->nr_update_delete_conflict);
+		values[9] = Int64GetDatumFast(counters->nr_delete_delete_conflict);
+		values[10] = Int64GetDatumFast(counters->bytes_received);
+		values[11] = Float8GetDatumFast(INSTR_TIME_GET_MILLISEC(counters->apply_time));
 
 		tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc,
 							 values, nulls);
 	}
-	LWLockRelease(pgactiveCountCtl->lock);
+
+	pfree(entries);
+
+	PG_RETURN_VOID();
+}
+
+/*
+ * Discard the per-relation statistics of the current database.
+ */
+Datum
+pgactive_stat_relation_reset(PG_FUNCTION_ARGS)
+{
+	HASH_SEQ_STATUS status;
+	pgactiveCountRelationEntry *entry;
+
+	if (pgactiveCountRelationHash == NULL)
+		PG_RETURN_VOID();
+
+	LWLockAcquire(pgactiveCountCtl->relation_lock, LW_EXCLUSIVE);
+
+	hash_seq_init(&status, pgactiveCountRelationHash);
+	while ((entry = hash_seq_search(&status)) != NULL)
+	{
+		if (entry->key.dboid != MyDatabaseId)
+			continue;
+
+		hash_search(pgactiveCountRelationHash, &entry->key, HASH_REMOVE, NULL);
+	}
+	LWLockRelease(pgactiveCountCtl->relation_lock);
 
 	PG_RETURN_VOID();
 }
 
+#if PG_VERSION_NUM < 180000
 /*
  * Write the pgactive stats from shared memory to a file
  */
@@ -499,3 +1257,4 @@ zero_file:
 	 */
 	pgactive_count_serialize();
 }
+#endif
@@ -125,7 +125,13 @@ static void print_msg(VerbosityLevelEnum level, const char *fmt, ...)
 static int	run_pg_ctl(char *cmdargv[],
 					   int cmdargc_total,
 					   int cmdargc_current);
-static void run_basebackup(const char *remote_connstr, const char *data_dir);
+static void run_basebackup(const char *remote_connstr, const char *data_dir,
+						   const char *incremental_manifest);
+#if PG_VERSION_NUM >= 170000
+static void run_incremental_basebackup(const char *remote_connstr,
+									   const char *data_dir,
+									   const char *prior_backup);
+#endif
 static void wait_postmaster_connection(const char *connstr);
 static void wait_for_end_recovery(const char *connstr);
 static void wait_postmaster_shutdown(void);
@@ -166,6 +172,7 @@ static void pgactive_node_start(PGconn *conn, char *node_name, char *remote_conn
 static RemoteInfo * get_remote_info(char *connstr);
 
 static void initialize_data_dir(char *data_dir, char *connstr,
+								char *incremental_from,
 								char *postgresql_conf, char *pg_hba_conf);
 static bool check_data_dir(char *data_dir, RemoteInfo * remoteinfo);
 
@@ -253,6 +260,7 @@ main(int argc, char **argv)
 	char	   *recovery_conf = NULL;
 #endif
 	char	   *replication_sets = NULL;
+	char	   *incremental_from = NULL;
 	bool		use_existing_data_dir;
 	int			pg_ctl_ret,
 				logfd;
@@ -281,6 +289,9 @@ main(int argc, char **argv)
 		{"replication-sets", required_argument, NULL, 9},
 #else
 		{"replication-sets", required_argument, NULL, 8},
+#endif
+#if PG_VERSION_NUM >= 170000
+		{"incremental-from", required_argument, NULL, 10},
 #endif
 		{"stop", no_argument, NULL, 's'},
 		{NULL, 0, NULL, 0}
@@ -395,6 +406,15 @@ main(int argc, char **argv)
 			case 8:
 				replication_sets = validate_replication_set_input(optarg);
 				break;
+#endif
+#if PG_VERSION_NUM >= 170000
+			case 10:
+				{
+					incremental_from = pg_strdup(optarg);
+					if (!path_file_exists(incremental_from, "backup_manifest"))
+						die(_("The specified prior backup directory does not contain a backup_manifest file."));
+					break;
+				}
 #endif
 			case 's':
 				stop = true;
@@ -467,6 +487,21 @@ main(int argc, char **argv)
 		remote_info->sysid != read_sysid(data_dir))
 		die(_("Local data directory is not basebackup of remote node.\n"));
 
+	if (incremental_from != NULL)
+	{
+		if (use_existing_data_dir)
+			die(_("Data directory must be empty or not exist when an incremental backup is taken.\n"));
+		if (remote_info->sysid != read_sysid(incremental_from))
+			die(_("Prior backup directory is not a backup of remote node.\n"));
+
+		/*
+		 * A server started from the backup would have removed its
+		 * backup_label, and may have modified it since.
+		 */
+		if (!path_file_exists(incremental_from, "backup_label"))
+			die(_("Prior backup directory has been started as a server and can't be used, the data directory of a detached node can't be reused.\n"));
+	}
+
 	print_msg(VERBOSITY_NORMAL,
 			  _("Detected %d pgactive database(s) on remote server\n"),
 			  remote_info->numdbs);
@@ -537,7 +572,7 @@ main(int argc, char **argv)
 	 */
 	initialize_data_dir(data_dir,
 						use_existing_data_dir ? NULL : remote_connstr,
-						postgresql_conf, pg_hba_conf);
+						incremental_from, postgresql_conf, pg_hba_conf);
 	snprintf(pid_file, MAXPGPATH, "%s/postmaster.pid", data_dir);
 
 	/*
@@ -751,6 +786,13 @@ usage(void)
 	printf(_("  -n, --node-name=NAME    name of the newly created node\n"));
 	printf(_("  --replication-sets=SETS comma separated list of replication set names to use\n"));
 	printf(_("  -s, --stop              stop the server once the initialization is done\n"));
+#if PG_VERSION_NUM >= 170000
+	printf(_("  --incremental-from=DIRECTORY\n"));
+	printf(_("                          earlier full backup of the remote node to take\n"));
+	printf(_("                          an incremental backup against, requires\n"));
+	printf(_("                          summarize_wal on the remote node, can't be\n"));
+	printf(_("                          the data directory of a detached node\n"));
+#endif
 	printf(_("  -v                      increase logging verbosity\n"));
 	printf(_("\nConfiguration files override:\n"));
 	printf(_("  --hba-conf              path to the new pg_hba.conf\n"));
@@ -871,15 +913,20 @@ run_pg_ctl(char *cmdargv[], int cmdargc_total, int cmdargc_current)
 
 /*
  * Run pg_basebackup to create the copy of the origin node.
+ *
+ * If incremental_manifest is given, take an incremental backup relative to
+ * the backup that manifest describes instead of a full one.
  */
 static void
-run_basebackup(const char *remote_connstr, const char *data_dir)
+run_basebackup(const char *remote_connstr, const char *data_dir,
+			   const char *incremental_manifest)
 {
 	char	   *exec_path = find_other_exec_or_die(argv0, "pg_basebackup");
 	char	   *cmdargv[10];
 	int			cmdargc;
 	char		arg_tmp1[MAXPGPATH];
 	char		arg_tmp2[MAXPGPATH];
+	char		arg_tmp3[MAXPGPATH];
 
 	snprintf(arg_tmp1, sizeof(arg_tmp1), "--pgdata=%s", data_dir);
 	snprintf(arg_tmp2, sizeof(arg_tmp2), "--dbname=%s", remote_connstr);
@@ -892,6 +939,13 @@ run_basebackup(const char *remote_connstr, const char *data_dir)
 	cmdargv[cmdargc++] = "--progress";
 	cmdargv[cmdargc++] = "--checkpoint=fast";
 
+	if (incremental_manifest != NULL)
+	{
+		snprintf(arg_tmp3, sizeof(arg_tmp3), "--incremental=%s",
+				 incremental_manifest);
+		cmdargv[cmdargc++] = arg_tmp3;
+	}
+
 	/* Run pg_basebackup in verbose mode if we are running in verbose mode. */
 	if (verbosity >= VERBOSITY_VERBOSE)
 		cmdargv[cmdargc++] = "--verbose";
@@ -903,6 +957,65 @@ run_basebackup(const char *remote_connstr, const char *data_dir)
 	pg_free(exec_path);
 }
 
+#if PG_VERSION_NUM >= 170000
+/*
+ * Create the copy of the origin node from an earlier full backup of it.
+ *
+ * Only the blocks changed on the origin node since the prior backup are
+ * transferred in an incremental backup, which pg_combinebackup then merges
+ * with the prior backup into the new data directory. The prior backup must
+ * not have been started as a server since, or the changes made by it would
+ * leak into the new node.
+ */
+static void
+run_incremental_basebackup(const char *remote_connstr, const char *data_dir,
+						   const char *prior_backup)
+{
+	char	   *exec_path;
+	char	   *cmdargv[10];
+	int			cmdargc;
+	char		incremental_dir[MAXPGPATH];
+	char		manifest[MAXPGPATH];
+	char		arg_tmp1[MAXPGPATH];
+
+	snprintf(incremental_dir, sizeof(incremental_dir), "%s.incremental",
+			 data_dir);
+	snprintf(manifest, sizeof(manifest), "%s/backup_manifest", prior_backup);
+
+	/* Leftover of an earlier failed run */
+	if (pg_check_dir(incremental_dir) > 0 && !rmtree(incremental_dir, true))
+		die(_("Could not remove directory \"%s\".\n"), incremental_dir);
+
+	run_basebackup(remote_connstr, incremental_dir, manifest);
+
+	print_msg(VERBOSITY_NORMAL,
+			  _("Combining incremental backup with prior backup...\n"));
+
+	exec_path = find_other_exec_or_die(argv0, "pg_combinebackup");
+	snprintf(arg_tmp1, sizeof(arg_tmp1), "--output=%s", data_dir);
+
+	cmdargc = 0;
+	cmdargv[cmdargc++] = exec_path;
+	cmdargv[cmdargc++] = arg_tmp1;
+
+	if (verbosity >= VERBOSITY_DEBUG)
+		cmdargv[cmdargc++] = "--debug";
+
+	cmdargv[cmdargc++] = (char *) prior_backup;
+	cmdargv[cmdargc++] = incremental_dir;
+	cmdargv[cmdargc++] = NULL;
+
+	print_msg(VERBOSITY_DEBUG, _("Executing pg_combinebackup command...\n"));
+	(void) execute_command(exec_path, cmdargv, false);
+	pg_free(exec_path);
+
+	if (!rmtree(incremental_dir, true))
+		print_msg(VERBOSITY_NORMAL,
+				  _("WARNING: could not remove directory \"%s\"\n"),
+				  incremental_dir);
+}
+#endif
+
 /*
  * Cleans specified files that were replicated via basebackup but we don't
  * want it.
@@ -920,20 +1033,30 @@ remove_unwanted_files(char *data_dir)
  * Init the datadir
  *
  * This function can either ensure provided datadir is a postgres datadir,
- * or create it using pg_basebackup.
+ * or create it using pg_basebackup, incrementally on top of a prior backup of
+ * the remote node if one is given.
  *
  * In any case, new postresql.conf and pg_hba.conf will be copied to the
  * datadir if they are provided.
  */
 static void
-initialize_data_dir(char *data_dir, char *connstr,
+initialize_data_dir(char *data_dir, char *connstr, char *incremental_from,
 					char *postgresql_conf, char *pg_hba_conf)
 {
+#if PG_VERSION_NUM >= 170000
+	if (connstr && incremental_from)
+	{
+		print_msg(VERBOSITY_NORMAL,
+				  _("Creating incremental backup of the remote node...\n"));
+		run_incremental_basebackup(connstr, data_dir, incremental_from);
+	}
+	else
+#endif
 	if (connstr)
 	{
 		print_msg(VERBOSITY_NORMAL,
 				  _("Creating base backup of the remote node...\n"));
-		run_basebackup(connstr, data_dir);
+		run_basebackup(connstr, data_dir, NULL);
 	}
 
 	remove_unwanted_files(data_dir);
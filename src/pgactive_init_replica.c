@@ -17,6 +17,7 @@
 #include "postgres.h"
 
 #include <errno.h>
+#include <signal.h>
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/wait.h>
@@ -52,16 +53,29 @@
 #include "storage/lwlock.h"
 #include "storage/proc.h"
 #include "storage/shmem.h"
+#if PG_VERSION_NUM >= 180000
+#include "storage/waiteventset.h"
+#endif
 
 #include "utils/builtins.h"
 #include "utils/memutils.h"
 #include "utils/pg_lsn.h"
 #include "utils/snapmgr.h"
+#include "utils/timestamp.h"
 #include "pgstat.h"
 
 char	   *pgactive_temp_dump_directory = NULL;
 
+/*
+ * Called while waiting for a command to finish; returns true if it did some
+ * work and wants to be called again right away.
+ */
+typedef bool (*pgactive_command_poll_cb) (void *arg);
+
 static void pgactive_execute_command(const char *cmd, char *cmdargv[]);
+static void pgactive_execute_command_ext(const char *cmd, char *cmdargv[],
+										 pgactive_command_poll_cb poll_cb,
+										 void *poll_arg);
 static void pgactive_get_replication_set_tables(pgactiveNodeInfo * node,
 												pgactiveNodeId * remote,
 												PGconn *conn,
@@ -71,16 +85,24 @@ static void pgactive_get_replication_set_tables(pgactiveNodeInfo * node,
 static void pgactive_init_exec_dump_restore(pgactiveNodeInfo * node,
 											char *snapshot,
 											pgactiveNodeId * remote,
-											PGconn *conn);
+											PGconn *conn,
+											bool resume);
+static void pgactive_init_exec_restore(char *restore_path, char **cmdargv,
+									   char *local_dsn, char *tmpdir,
+									   char *section, bool clean);
 static void pgactive_catchup_to_lsn(remote_node_info * ri, XLogRecPtr target_lsn);
 
+static const char *const pgactive_get_remote_lsn_query =
+"SELECT pg_current_wal_insert_lsn()";
+
+/*
+ * Get the LSN from the result of pgactive_get_remote_lsn_query.
+ */
 static XLogRecPtr
-pgactive_get_remote_lsn(PGconn *conn)
+pgactive_get_remote_lsn_result(PGresult *res)
 {
 	XLogRecPtr	lsn;
-	PGresult   *res;
 
-	res = PQexec(conn, "SELECT pg_current_wal_insert_lsn()");
 	if (PQresultStatus(res) != PGRES_TUPLES_OK)
 	{
 		elog(ERROR, "unable to get remote LSN: status %s: %s",
@@ -90,26 +112,42 @@ pgactive_get_remote_lsn(PGconn *conn)
 	Assert(!PQgetisnull(res, 0, 0));
 	lsn = DatumGetLSN(DirectFunctionCall1Coll(pg_lsn_in, InvalidOid,
 											  CStringGetDatum(PQgetvalue(res, 0, 0))));
-	PQclear(res);
 	return lsn;
 }
 
-static void
-pgactive_get_remote_ext_version(PGconn *pgconn, char **default_version,
-								char **installed_version)
+const char *const pgactive_ext_version_query =
+"SELECT default_version, installed_version "
+"FROM pg_catalog.pg_available_extensions WHERE name = 'pgactive';";
+
+/*
+ * Make sure the pgactive extension is installed on the other end. If it's a known
+ * extension but not present in the current DB error out and tell the user to
+ * activate pgactive then try again.
+ */
+void
+pgactive_ensure_ext_installed(PGconn *pgconn)
 {
 	PGresult   *res;
 
-	const char *q_pgactive_installed =
-		"SELECT default_version, installed_version "
-		"FROM pg_catalog.pg_available_extensions WHERE name = 'pgactive';";
+	res = PQexec(pgconn, pgactive_ext_version_query);
+	pgactive_ensure_ext_installed_result(res);
+	PQclear(res);
+}
 
-	res = PQexec(pgconn, q_pgactive_installed);
+/*
+ * The guts of pgactive_ensure_ext_installed, checking the result of
+ * pgactive_ext_version_query run by the caller, e.g. as part of a pipeline.
+ */
+void
+pgactive_ensure_ext_installed_result(PGresult *res)
+{
+	const char *default_version = NULL;
+	const char *installed_version = NULL;
 
 	if (PQresultStatus(res) != PGRES_TUPLES_OK)
 	{
 		elog(ERROR, "unable to get remote pgactive extension version; query %s failed with %s: %s",
-			 q_pgactive_installed, PQresStatus(PQresultStatus(res)), PQresultErrorMessage(res));
+			 pgactive_ext_version_query, PQresStatus(PQresultStatus(res)), PQresultErrorMessage(res));
 	}
 
 	if (PQntuples(res) == 1)
@@ -117,36 +155,15 @@ pgactive_get_remote_ext_version(PGconn *pgconn, char **default_version,
 		/*
 		 * pgactive ext is known to Pg, check install state.
 		 */
-		*default_version = pstrdup(PQgetvalue(res, 0, 0));
-		*installed_version = pstrdup(PQgetvalue(res, 0, 0));
-	}
-	else if (PQntuples(res) == 0)
-	{
-		/* pgactive ext is not known to Pg at all */
-		*default_version = NULL;
-		*installed_version = NULL;
+		default_version = PQgetvalue(res, 0, 0);
+		installed_version = PQgetvalue(res, 0, 0);
 	}
 	else
 	{
-		Assert(false);			/* Should not get >1 tuples */
+		/* pgactive ext is not known to Pg at all */
+		Assert(PQntuples(res) == 0);	/* Should not get >1 tuples */
 	}
 
-	PQclear(res);
-}
-
-/*
- * Make sure the pgactive extension is installed on the other end. If it's a known
- * extension but not present in the current DB error out and tell the user to
- * activate pgactive then try again.
- */
-void
-pgactive_ensure_ext_installed(PGconn *pgconn)
-{
-	char	   *default_version = NULL;
-	char	   *installed_version = NULL;
-
-	pgactive_get_remote_ext_version(pgconn, &default_version, &installed_version);
-
 	if (default_version == NULL || strcmp(default_version, "") == 0)
 	{
 		ereport(ERROR,
@@ -164,9 +181,6 @@ pgactive_ensure_ext_installed(PGconn *pgconn)
 				 errdetail("installed_version for entry 'pgactive' in pg_available_extensions is blank."),
 				 errhint("Run 'CREATE EXTENSION pgactive;'.")));
 	}
-
-	pfree(default_version);
-	pfree(installed_version);
 }
 
 /*
@@ -177,6 +191,42 @@ pgactive_ensure_ext_installed(PGconn *pgconn)
  */
 static void
 pgactive_execute_command(const char *cmd, char *cmdargv[])
+{
+	pgactive_execute_command_ext(cmd, cmdargv, NULL, NULL);
+}
+
+/*
+ * Terminate a command we gave up waiting for because of an error, so it
+ * doesn't keep running, and wait for it to exit.
+ */
+static void
+pgactive_execute_command_cleanup(int code, Datum arg)
+{
+	pid_t		pid = (pid_t) DatumGetInt32(arg);
+
+	if (kill(pid, SIGTERM) < 0 && errno != ESRCH)
+	{
+		ereport(LOG,
+				(errmsg("could not send signal to process %d: %m", (int) pid)));
+		return;
+	}
+
+	while (waitpid(pid, NULL, 0) < 0)
+	{
+		if (errno != EINTR)
+			break;
+	}
+}
+
+/*
+ * Like pgactive_execute_command, but calls poll_cb while the command runs.
+ *
+ * If poll_cb or anything else errors out while the command runs, the
+ * command is terminated.
+ */
+static void
+pgactive_execute_command_ext(const char *cmd, char *cmdargv[],
+							 pgactive_command_poll_cb poll_cb, void *poll_arg)
 {
 	pid_t		pid;
 	int			exitstatus;
@@ -220,24 +270,37 @@ pgactive_execute_command(const char *cmd, char *cmdargv[])
 			(errmsg("waiting for process %d to execute command \"%s\" for init_replica",
 					(int) pid, cmd)));
 
-	while (1)
+	PG_ENSURE_ERROR_CLEANUP(pgactive_execute_command_cleanup,
+							Int32GetDatum((int32) pid));
 	{
-		pid_t		res;
+		while (1)
+		{
+			pid_t		res;
 
-		res = waitpid(pid, &exitstatus, WNOHANG);
+			res = waitpid(pid, &exitstatus, WNOHANG);
 
-		if (res == pid)
-			break;
-		else if (res == -1 && errno != EINTR)
-			elog(FATAL, "error in waitpid() while waiting for process %d",
-				 pid);
+			if (res == pid)
+				break;
+			else if (res == -1 && errno != EINTR)
+				elog(FATAL, "error in waitpid() while waiting for process %d",
+					 pid);
 
-		(void) pgactiveWaitLatch(&MyProc->procLatch,
-								 WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
-								 1000L, PG_WAIT_EXTENSION);
-		ResetLatch(&MyProc->procLatch);
-		CHECK_FOR_INTERRUPTS();
+			if (poll_cb != NULL && poll_cb(poll_arg))
+			{
+				CHECK_FOR_INTERRUPTS();
+				continue;
+			}
+
+			(void) pgactiveWaitLatch(&MyProc->procLatch,
+									 WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
+									 poll_cb != NULL ? 100L : 1000L,
+									 pgactive_wait_event(pgactive_WAIT_INIT_CHILD_PROCESS));
+			ResetLatch(&MyProc->procLatch);
+			CHECK_FOR_INTERRUPTS();
+		}
 	}
+	PG_END_ENSURE_ERROR_CLEANUP(pgactive_execute_command_cleanup,
+								Int32GetDatum((int32) pid));
 
 	if (exitstatus != 0)
 	{
@@ -257,6 +320,199 @@ pgactive_execute_command(const char *cmd, char *cmdargv[])
 					cmd)));
 }
 
+/*
+ * Join progress reporting, see pgactive.pgactive_join_progress. Everything
+ * here runs in the per-db worker doing the join.
+ */
+static pgactiveJoinProgress *
+pgactive_join_progress(void)
+{
+	Assert(pgactive_worker_type == pgactive_WORKER_PERDB);
+	return &pgactive_worker_slot->data.perdb.join_progress;
+}
+
+/*
+ * Enter a new phase of the join, forgetting the counters of the previous one.
+ */
+static void
+pgactive_join_progress_set_phase(pgactiveJoinPhase phase)
+{
+	pgactiveJoinProgress *progress = pgactive_join_progress();
+	TimestampTz now = GetCurrentTimestamp();
+
+	SpinLockAcquire(&progress->mutex);
+	/* a retried join keeps its start time */
+	if (progress->phase == pgactive_JOIN_PHASE_NONE ||
+		progress->phase == pgactive_JOIN_PHASE_DONE)
+		progress->join_start = now;
+	progress->phase = phase;
+	progress->phase_start = now;
+	progress->tables_total = -1;
+	progress->tables_done = -1;
+	progress->bytes_total = -1;
+	progress->bytes_done = -1;
+	progress->current_table[0] = '\0';
+	progress->jobs_total = -1;
+	progress->jobs_busy = -1;
+	progress->catchup_start_lsn = InvalidXLogRecPtr;
+	progress->catchup_target_lsn = InvalidXLogRecPtr;
+	progress->catchup_lsn = InvalidXLogRecPtr;
+	SpinLockRelease(&progress->mutex);
+}
+
+static void
+pgactive_join_progress_set_totals(int tables_total, int64 bytes_total,
+								  int jobs_total)
+{
+	pgactiveJoinProgress *progress = pgactive_join_progress();
+
+	SpinLockAcquire(&progress->mutex);
+	progress->tables_total = tables_total;
+	progress->bytes_total = bytes_total;
+	progress->jobs_total = jobs_total;
+	SpinLockRelease(&progress->mutex);
+}
+
+/*
+ * Report work done in the current phase. current_table is left alone if
+ * NULL.
+ */
+static void
+pgactive_join_progress_update(int tables_done, int64 bytes_done,
+							  int jobs_busy, const char *current_table)
+{
+	pgactiveJoinProgress *progress = pgactive_join_progress();
+
+	SpinLockAcquire(&progress->mutex);
+	progress->tables_done = tables_done;
+	progress->bytes_done = bytes_done;
+	progress->jobs_busy = jobs_busy;
+	if (current_table != NULL)
+		strlcpy(progress->current_table, current_table,
+				sizeof(progress->current_table));
+	SpinLockRelease(&progress->mutex);
+}
+
+/*
+ * Report the remote LSN catchup has replayed up to; the first one reported
+ * is where catchup is taken to have started.
+ */
+static void
+pgactive_join_progress_catchup(XLogRecPtr target_lsn, XLogRecPtr lsn)
+{
+	pgactiveJoinProgress *progress = pgactive_join_progress();
+
+	SpinLockAcquire(&progress->mutex);
+	progress->catchup_target_lsn = target_lsn;
+	if (lsn != InvalidXLogRecPtr)
+	{
+		if (progress->catchup_start_lsn == InvalidXLogRecPtr)
+			progress->catchup_start_lsn = lsn;
+		progress->catchup_lsn = lsn;
+	}
+	SpinLockRelease(&progress->mutex);
+}
+
+/*
+ * Estimate how many tables with how much data there are on the remote node,
+ * as totals for the join methods that leave moving the data to pg_dump.
+ * Replication sets aren't taken into account.
+ */
+static void
+pgactive_join_progress_estimate(PGconn *conn, int *ntables, int64 *nbytes)
+{
+	PGresult   *res;
+
+	res = PQexec(conn,
+				 "SELECT pg_catalog.count(*), "
+				 "pg_catalog.coalesce(pg_catalog.sum(pg_catalog.pg_relation_size(c.oid)), 0)\n"
+				 "FROM pg_catalog.pg_class c\n"
+				 "JOIN pg_catalog.pg_namespace n ON n.oid = c.relnamespace\n"
+				 "WHERE c.relkind = 'r' AND c.relpersistence <> 't'\n"
+				 "AND n.nspname NOT IN ('pg_catalog', 'information_schema', 'pgactive')\n"
+				 "AND n.nspname !~ '^pg_toast'");
+
+	/* Not worth failing the join over */
+	if (PQresultStatus(res) != PGRES_TUPLES_OK || PQntuples(res) != 1)
+	{
+		elog(DEBUG1, "could not estimate size of remote tables: %s",
+			 PQerrorMessage(conn));
+		*ntables = -1;
+		*nbytes = -1;
+	}
+	else
+	{
+		*ntables = atoi(PQgetvalue(res, 0, 0));
+		*nbytes = strtoi64(PQgetvalue(res, 0, 1), NULL, 10);
+	}
+	PQclear(res);
+}
+
+/*
+ * Count the table data files in a directory format dump and their total
+ * size along with the rest of the dump.
+ */
+static void
+pgactive_join_progress_scan_dump(const char *dir, int *ndatafiles,
+								 int64 *nbytes)
+{
+	DIR		   *d;
+	struct dirent *de;
+
+	*ndatafiles = 0;
+	*nbytes = 0;
+
+	d = AllocateDir(dir);
+	if (d == NULL)
+		return;
+
+	while ((de = ReadDir(d, dir)) != NULL)
+	{
+		char		path[MAXPGPATH];
+		struct stat st;
+
+		snprintf(path, sizeof(path), "%s/%s", dir, de->d_name);
+		if (stat(path, &st) != 0 || !S_ISREG(st.st_mode))
+			continue;
+
+		/* <dumpId>.dat, possibly with a compression suffix */
+		if (strstr(de->d_name, ".dat") != NULL &&
+			strcmp(de->d_name, "toc.dat") != 0)
+			(*ndatafiles)++;
+		*nbytes += st.st_size;
+	}
+
+	FreeDir(d);
+}
+
+/*
+ * pgactive_command_poll_cb reporting how far pg_dump has got writing the
+ * dump, at most once a second.
+ */
+typedef struct pgactiveInitDumpWatch
+{
+	const char *dir;
+	TimestampTz last_scan;
+}			pgactiveInitDumpWatch;
+
+static bool
+pgactive_init_dump_poll(void *arg)
+{
+	pgactiveInitDumpWatch *watch = (pgactiveInitDumpWatch *) arg;
+	TimestampTz now = GetCurrentTimestamp();
+	int			ndatafiles;
+	int64		nbytes;
+
+	if (!TimestampDifferenceExceeds(watch->last_scan, now, 1000))
+		return false;
+	watch->last_scan = now;
+
+	pgactive_join_progress_scan_dump(watch->dir, &ndatafiles, &nbytes);
+	pgactive_join_progress_update(ndatafiles, nbytes, -1, NULL);
+
+	return false;
+}
+
 static void
 pgactive_get_replication_set_tables(pgactiveNodeInfo * node,
 									pgactiveNodeId * remote,
@@ -333,98 +589,1379 @@ found:
 }
 
 /*
- * Copy the contents of a remote node using pg_dump and apply it to the local
- * node using pg_restore. Runs during node join creation to bring up a new
- * logical replica from an existing node. The remote dump is taken from the
- * start position of a slot on the remote end to ensure that we never replay
- * changes included in the dump and never miss changes.
- *
- * When asked, only pg_dump the data not the schema (data defnintions). User
- * must ensure node has all required schema objects before logically joining
- * the node to pgactive group, otherwise, an error is emitted from here.
+ * Large tables are split into ranges of this many blocks for the copy based
+ * initial data sync, so that they can be copied over several connections.
  */
-static void
-pgactive_init_exec_dump_restore(pgactiveNodeInfo * node,
-								char *snapshot,
-								pgactiveNodeId * remote,
-								PGconn *conn)
+#define pgactive_INIT_COPY_CHUNK_PAGES	131072
+
+/*
+ * A table copied by the copy based initial data sync. Once all its items have
+ * been copied it's recorded in pgactive.pgactive_init_progress.
+ */
+typedef struct pgactiveInitCopyTable
 {
-#define pgactive_MAX_NO_OF_NON_TABLE_OPTS	10
+	char	   *relname;
+	int			nitems_left;	/* items not copied yet */
+	int64		nrows;			/* rows copied by finished items */
+	bool		started;
+}			pgactiveInitCopyTable;
 
-	char		tmpdir[MAXPGPATH];
-	char		pgactive_dump_path[MAXPGPATH];
-	char		pgactive_restore_path[MAXPGPATH];
-	StringInfo	origin_dsn = makeStringInfo();
-	StringInfo	local_dsn = makeStringInfo();
-	uint32		bin_version;
-	char	   *o_servername;
-	char	   *l_servername;
-	char	  **cmdargv;
-	int			cmdargc;
-	char		arg_jobs[12];
-	char		arg_tmp1[MAXPGPATH];
-	char		arg_tmp2[MAXPGPATH];
-	pgactiveNodeId myid;
-	List	   *tables = NIL;
-	ListCell   *lc;
-	bool		is_include_set = false;
-	bool		is_exclude_set = false;
-	List	   *table_args = NIL;
+/*
+ * A unit of work of the copy based initial data sync: a whole table, or a
+ * range of blocks of a large table.
+ */
+typedef struct pgactiveInitCopyItem
+{
+	pgactiveInitCopyTable *table;
+	char	   *copy_out;		/* COPY ... TO STDOUT run on the remote node */
+	char	   *copy_in;		/* COPY ... FROM STDIN run on the local node */
+	int64		nbytes;			/* remote size estimate, for progress reports */
+}			pgactiveInitCopyItem;
 
-	if (pgactive_find_other_exec(my_exec_path, pgactive_DUMP_CMD, &bin_version,
-								 &pgactive_dump_path[0]) < 0)
-	{
-		elog(ERROR, "pgactive node init failed to find " pgactive_DUMP_CMD
-			 " relative to binary %s",
-			 my_exec_path);
-	}
-	if (bin_version / 10000 != PG_VERSION_NUM / 10000)
-	{
-		elog(ERROR, "pgactive node init found " pgactive_DUMP_CMD
-			 " with wrong major version %d.%d, expected %d.%d",
-			 bin_version / 100 / 100, bin_version / 100 % 100,
-			 PG_VERSION_NUM / 100 / 100, PG_VERSION_NUM / 100 % 100);
-	}
+/*
+ * A remote connection that imported the init snapshot, paired with a local
+ * connection the rows it sends are written to.
+ */
+typedef struct pgactiveInitCopyPipe
+{
+	PGconn	   *remote_conn;
+	PGconn	   *local_conn;
+	pgactiveInitCopyItem *item; /* item being copied, NULL if idle */
+}			pgactiveInitCopyPipe;
 
-	if (pgactive_find_other_exec(my_exec_path, pgactive_RESTORE_CMD, &bin_version,
-								 &pgactive_restore_path[0]) < 0)
-	{
-		elog(ERROR, "pgactive node init failed to find " pgactive_RESTORE_CMD
-			 " relative to binary %s",
-			 my_exec_path);
-	}
-	if (bin_version / 10000 != PG_VERSION_NUM / 10000)
+typedef struct pgactiveInitCopyState
+{
+	int			maxpipes;		/* allocated pipes */
+	int			npipes;			/* connected pipes */
+	pgactiveInitCopyPipe *pipes;
+	WaitEventSet *wes;
+	const char *snapshot;		/* init snapshot the remote side runs under */
+	bool		resume;			/* local tables may hold rows of a failed copy */
+	int			ntables_done;
+	int64		bytes_done;		/* nbytes of the items copied */
+}			pgactiveInitCopyState;
+
+static void
+pgactive_init_copy_cleanup(int code, Datum arg)
+{
+	pgactiveInitCopyState *state = (pgactiveInitCopyState *) DatumGetPointer(arg);
+	int			i;
+
+	for (i = 0; i < state->maxpipes; i++)
 	{
-		elog(ERROR, "pgactive node init found " pgactive_RESTORE_CMD
-			 " with wrong major version %d.%d, expected %d.%d",
-			 bin_version / 100 / 100, bin_version / 100 % 100,
-			 PG_VERSION_NUM / 100 / 100, PG_VERSION_NUM / 100 % 100);
+		if (state->pipes[i].remote_conn != NULL)
+			PQfinish(state->pipes[i].remote_conn);
+		state->pipes[i].remote_conn = NULL;
+
+		if (state->pipes[i].local_conn != NULL)
+			PQfinish(state->pipes[i].local_conn);
+		state->pipes[i].local_conn = NULL;
 	}
 
-	o_servername = get_connect_string(node->init_from_dsn);
-	pgactive_make_my_nodeid(&myid);
-	appendStringInfo(origin_dsn, "%s %s %s application_name='pgactive:" UINT64_FORMAT ":init dump'",
-					 pgactive_default_apply_connection_options,
-					 pgactive_extra_apply_connection_options,
-					 (o_servername == NULL ? node->init_from_dsn : o_servername),
-					 myid.sysid);
+	if (state->wes != NULL)
+		FreeWaitEventSet(state->wes);
+	state->wes = NULL;
+}
 
-	/*
-	 * Suppress replication of changes applied via pg_restore back to the
-	 * local node.
-	 *
-	 * TODO: This should PQconninfoParse, modify the options keyword or add
-	 * it, and reconstruct the string using the functions from pg_dumpall
-	 * (also to be used for init_copy). Simply appending the options instead
-	 * is a bit dodgy.
-	 */
-	l_servername = get_connect_string(node->local_dsn);
-	appendStringInfo(local_dsn, "%s application_name='pgactive:" UINT64_FORMAT ":init restore' "
-					 "options='-c pgactive.do_not_replicate=on "
+/*
+ * Open one pipe of the copy based initial data sync. The remote end runs in a
+ * repeatable read transaction that imported the init snapshot, so every pipe
+ * sees exactly the data the catchup slot starts after.
+ */
+static void
+pgactive_init_copy_connect(pgactiveInitCopyPipe * pipe, const char *origin_dsn,
+						   const char *local_dsn, const char *snapshot)
+{
+	PGresult   *res;
+	char	   *query;
 
-	/*
-	 * remove for now "-c pgactive.permit_unsafe_ddl_commands=on "
-	 */
+	pipe->remote_conn = PQconnectdb(origin_dsn);
+	if (PQstatus(pipe->remote_conn) != CONNECTION_OK)
+		ereport(ERROR,
+				(errmsg("could not connect to the remote server for initial data copy: %s",
+						GetPQerrorMessage(pipe->remote_conn))));
+
+	query = psprintf("BEGIN TRANSACTION ISOLATION LEVEL REPEATABLE READ, READ ONLY;\n"
+					 "SET TRANSACTION SNAPSHOT '%s';", snapshot);
+	res = PQexec(pipe->remote_conn, query);
+	if (PQresultStatus(res) != PGRES_COMMAND_OK)
+		ereport(ERROR,
+				(errmsg("could not import snapshot %s for initial data copy", snapshot),
+				 errdetail("Query '%s': %s", query,
+						   PQerrorMessage(pipe->remote_conn))));
+	PQclear(res);
+	pfree(query);
+
+	pipe->local_conn = PQconnectdb(local_dsn);
+	if (PQstatus(pipe->local_conn) != CONNECTION_OK)
+		ereport(ERROR,
+				(errmsg("could not connect to the local server for initial data copy: %s",
+						GetPQerrorMessage(pipe->local_conn))));
+}
+
+static pgactiveInitCopyItem *
+pgactive_init_copy_make_item(pgactiveInitCopyTable * table, const char *columns,
+							 const char *filter, BlockNumber npages)
+{
+	pgactiveInitCopyItem *item = palloc(sizeof(pgactiveInitCopyItem));
+	bool		has_columns = (columns[0] != '\0');
+
+	item->table = table;
+	item->nbytes = (int64) npages * BLCKSZ;
+	table->nitems_left++;
+	item->copy_out = psprintf("COPY (SELECT %s FROM ONLY %s %s) TO STDOUT",
+							  columns, table->relname, filter);
+	item->copy_in = psprintf("COPY %s %s%s%s FROM STDIN",
+							 table->relname,
+							 has_columns ? "(" : "", columns,
+							 has_columns ? ")" : "");
+
+	return item;
+}
+
+/*
+ * Build the list of things to copy from the remote node, largest tables first.
+ *
+ * This mirrors what pg_dump would dump the data of: user tables, and rows
+ * of extension configuration tables matching their dump condition, but not
+ * the pgactive catalogs that pgactive_sync_nodes takes care of. Tables
+ * larger than pgactive_INIT_COPY_CHUNK_PAGES are split into block ranges if
+ * the remote node can scan them by TID range. Tables in done_tables have been
+ * copied by an earlier attempt and are skipped.
+ *
+ * When resuming, the remaining tables are copied under a new snapshot while
+ * catch-up replays the changes made to them since the join's slot was
+ * created, some of which the copy already has. Replaying an INSERT again is
+ * only harmless if there's a key to find the row by, so resuming is refused
+ * while a table without a primary key or replica identity index is left.
+ */
+static List *
+pgactive_init_copy_get_items(PGconn *conn, List *tables, bool is_include_set,
+							 bool is_exclude_set, List *done_tables,
+							 bool resume, int *ntables)
+{
+	StringInfoData query;
+	PGresult   *res;
+	List	   *items = NIL;
+	bool		split = (PQserverVersion(conn) >= 140000);
+	int			i;
+
+	initStringInfo(&query);
+	appendStringInfoString(&query,
+						   "WITH extcfg AS (\n"
+						   "  SELECT cfg.reloid, cfg.cond\n"
+						   "  FROM pg_catalog.pg_extension e,\n"
+						   "  LATERAL pg_catalog.unnest(e.extconfig, e.extcondition) AS cfg(reloid, cond))\n"
+						   "SELECT pg_catalog.format('%I.%I', n.nspname, c.relname),\n"
+						   "  (SELECT pg_catalog.string_agg(pg_catalog.quote_ident(a.attname), ', ' ORDER BY a.attnum)\n"
+						   "   FROM pg_catalog.pg_attribute a\n"
+						   "   WHERE a.attrelid = c.oid AND a.attnum > 0\n"
+						   "   AND NOT a.attisdropped AND a.attgenerated = ''),\n"
+						   "  c.relpages, x.cond,\n"
+						   "  EXISTS (SELECT 1 FROM pg_catalog.pg_index i\n"
+						   "          WHERE i.indrelid = c.oid AND (i.indisprimary OR i.indisreplident))\n"
+						   "FROM pg_catalog.pg_class c\n"
+						   "JOIN pg_catalog.pg_namespace n ON n.oid = c.relnamespace\n"
+						   "LEFT JOIN extcfg x ON x.reloid = c.oid\n"
+						   "WHERE c.relkind = 'r' AND c.relpersistence <> 't'\n"
+						   "AND n.nspname NOT IN ('pg_catalog', 'information_schema')\n"
+						   "AND n.nspname !~ '^pg_toast'\n"
+						   "AND c.oid NOT IN ('pgactive.pgactive_nodes'::pg_catalog.regclass,\n"
+						   "                  'pgactive.pgactive_connections'::pg_catalog.regclass)\n"
+						   "AND (x.reloid IS NOT NULL OR NOT EXISTS (\n"
+						   "  SELECT 1 FROM pg_catalog.pg_depend d\n"
+						   "  WHERE d.classid = 'pg_catalog.pg_class'::pg_catalog.regclass\n"
+						   "  AND d.objid = c.oid AND d.deptype = 'e'))\n");
+
+	if (is_include_set || is_exclude_set)
+	{
+		ListCell   *lc;
+		bool		first = true;
+
+		appendStringInfo(&query,
+						 "AND c.oid %s (\n"
+						 "  SELECT pg_catalog.to_regclass(t) FROM pg_catalog.unnest(ARRAY[",
+						 is_include_set ? "IN" : "NOT IN");
+
+		foreach(lc, tables)
+		{
+			char	   *table = (char *) lfirst(lc);
+			char	   *literal = PQescapeLiteral(conn, table, strlen(table));
+
+			if (literal == NULL)
+				elog(ERROR, "could not quote table name %s: %s",
+					 table, PQerrorMessage(conn));
+
+			appendStringInfo(&query, "%s%s", first ? "" : ", ", literal);
+			PQfreemem(literal);
+			first = false;
+		}
+
+		appendStringInfoString(&query,
+							   "]::text[]) AS t\n"
+							   "  WHERE pg_catalog.to_regclass(t) IS NOT NULL)\n");
+	}
+
+	appendStringInfoString(&query, "ORDER BY c.relpages DESC");
+
+	res = PQexec(conn, query.data);
+	if (PQresultStatus(res) != PGRES_TUPLES_OK)
+		ereport(ERROR,
+				(errmsg("could not get tables to copy from remote node"),
+				 errdetail("Querying remote failed with: %s",
+						   PQerrorMessage(conn))));
+
+	*ntables = 0;
+
+	for (i = 0; i < PQntuples(res); i++)
+	{
+		char	   *relname = PQgetvalue(res, i, 0);
+		char	   *columns = PQgetisnull(res, i, 1) ? "" : PQgetvalue(res, i, 1);
+		BlockNumber relpages = (BlockNumber) Max(atoi(PQgetvalue(res, i, 2)), 0);
+		char	   *cond = PQgetisnull(res, i, 3) ? NULL : PQgetvalue(res, i, 3);
+		pgactiveInitCopyTable *table;
+		BlockNumber start;
+
+		if (list_member(done_tables, makeString(relname)))
+			continue;
+
+		if (resume && strcmp(PQgetvalue(res, i, 4), "t") != 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+					 errmsg("previous init failed and cannot be resumed, manual cleanup is required"),
+					 errdetail("Table %s has no primary key or replica identity index and its data has yet to be copied, so changes replayed to it after copying it again would duplicate rows.",
+							   relname),
+					 errhint("Remove all replication identifiers and slots corresponding to this node from the init target node then drop and recreate this database and try again.")));
+
+		table = palloc0(sizeof(pgactiveInitCopyTable));
+		table->relname = pstrdup(relname);
+		(*ntables)++;
+
+		if (!split || cond != NULL || relpages <= pgactive_INIT_COPY_CHUNK_PAGES)
+		{
+			items = lappend(items,
+							pgactive_init_copy_make_item(table, columns,
+														 cond != NULL ? cond : "",
+														 relpages));
+			continue;
+		}
+
+		/*
+		 * relpages is only an estimate, so the first range is open at the
+		 * bottom and the last one open at the top.
+		 */
+		for (start = 0; start < relpages; start += pgactive_INIT_COPY_CHUNK_PAGES)
+		{
+			BlockNumber end = start + pgactive_INIT_COPY_CHUNK_PAGES;
+			char		filter[64];
+
+			if (start == 0)
+				snprintf(filter, sizeof(filter), "WHERE ctid < '(%u,0)'", end);
+			else if (end >= relpages)
+				snprintf(filter, sizeof(filter), "WHERE ctid >= '(%u,0)'", start);
+			else
+				snprintf(filter, sizeof(filter),
+						 "WHERE ctid >= '(%u,0)' AND ctid < '(%u,0)'",
+						 start, end);
+
+			items = lappend(items,
+							pgactive_init_copy_make_item(table, columns, filter,
+														 Min(end, relpages) - start));
+		}
+	}
+
+	PQclear(res);
+	pfree(query.data);
+
+	return items;
+}
+
+/*
+ * Set local sequences to the values they have in the init snapshot, as the
+ * data section of a dump would. Sequences that weren't restored locally are
+ * skipped.
+ */
+static void
+pgactive_init_copy_sequences(PGconn *remote_conn, PGconn *local_conn)
+{
+	StringInfoData query;
+	PGresult   *res;
+	int			i;
+
+	res = PQexec(remote_conn,
+				 "SELECT pg_catalog.format('%I.%I', s.schemaname, s.sequencename), s.last_value\n"
+				 "FROM pg_catalog.pg_sequences s\n"
+				 "WHERE s.last_value IS NOT NULL\n"
+				 "AND NOT EXISTS (\n"
+				 "  SELECT 1 FROM pg_catalog.pg_depend d\n"
+				 "  WHERE d.classid = 'pg_catalog.pg_class'::pg_catalog.regclass\n"
+				 "  AND d.objid = pg_catalog.format('%I.%I', s.schemaname, s.sequencename)::pg_catalog.regclass\n"
+				 "  AND d.deptype = 'e')");
+	if (PQresultStatus(res) != PGRES_TUPLES_OK)
+		ereport(ERROR,
+				(errmsg("could not get sequences to copy from remote node"),
+				 errdetail("Querying remote failed with: %s",
+						   PQerrorMessage(remote_conn))));
+
+	if (PQntuples(res) == 0)
+	{
+		PQclear(res);
+		return;
+	}
+
+	initStringInfo(&query);
+	for (i = 0; i < PQntuples(res); i++)
+	{
+		char	   *seqname = PQgetvalue(res, i, 0);
+		char	   *literal = PQescapeLiteral(local_conn, seqname, strlen(seqname));
+
+		if (literal == NULL)
+			elog(ERROR, "could not quote sequence name %s: %s",
+				 seqname, PQerrorMessage(local_conn));
+
+		appendStringInfo(&query,
+						 "SELECT pg_catalog.setval(s, %s, true) "
+						 "FROM pg_catalog.to_regclass(%s) AS s WHERE s IS NOT NULL;\n",
+						 PQgetvalue(res, i, 1), literal);
+		PQfreemem(literal);
+	}
+	PQclear(res);
+
+	res = PQexec(local_conn, query.data);
+	if (PQresultStatus(res) != PGRES_TUPLES_OK)
+		ereport(ERROR,
+				(errmsg("could not set local sequence values"),
+				 errdetail("Query failed with: %s",
+						   PQerrorMessage(local_conn))));
+	PQclear(res);
+	pfree(query.data);
+}
+
+/*
+ * Report progress of the copy to pgactive.pgactive_join_progress.
+ */
+static void
+pgactive_init_copy_report(pgactiveInitCopyState * state,
+						  const char *current_table)
+{
+	int			busy = 0;
+	int			i;
+
+	for (i = 0; i < state->npipes; i++)
+		if (state->pipes[i].item != NULL)
+			busy++;
+
+	pgactive_join_progress_update(state->ntables_done, state->bytes_done,
+								  busy, current_table);
+}
+
+static void
+pgactive_init_copy_start(pgactiveInitCopyState * state,
+						 pgactiveInitCopyPipe * pipe, pgactiveInitCopyItem * item)
+{
+	PGresult   *res;
+
+	/*
+	 * A table an earlier attempt didn't finish copying may already hold some
+	 * of its rows; start over with it.
+	 */
+	if (state->resume && !item->table->started)
+	{
+		char	   *query = psprintf("TRUNCATE ONLY %s", item->table->relname);
+
+		res = PQexec(pipe->local_conn, query);
+		if (PQresultStatus(res) != PGRES_COMMAND_OK)
+			ereport(ERROR,
+					(errmsg("could not truncate partially copied table %s",
+							item->table->relname),
+					 errdetail("Query '%s': %s", query,
+							   PQerrorMessage(pipe->local_conn))));
+		PQclear(res);
+		pfree(query);
+	}
+	item->table->started = true;
+
+	res = PQexec(pipe->remote_conn, item->copy_out);
+	if (PQresultStatus(res) != PGRES_COPY_OUT)
+		ereport(ERROR,
+				(errmsg("execution of COPY ... TO stdout failed"),
+				 errdetail("Query '%s': %s", item->copy_out,
+						   PQerrorMessage(pipe->remote_conn))));
+	PQclear(res);
+
+	res = PQexec(pipe->local_conn, item->copy_in);
+	if (PQresultStatus(res) != PGRES_COPY_IN)
+		ereport(ERROR,
+				(errmsg("execution of COPY ... FROM stdin failed"),
+				 errdetail("Query '%s': %s", item->copy_in,
+						   PQerrorMessage(pipe->local_conn))));
+	PQclear(res);
+
+	pipe->item = item;
+
+	pgactive_init_copy_report(state, item->table->relname);
+}
+
+/*
+ * Check that a finished COPY succeeded, returning the number of rows it
+ * processed.
+ */
+static int64
+pgactive_init_copy_check_result(PGconn *conn, const char *query)
+{
+	PGresult   *res;
+	int64		nrows = 0;
+
+	while ((res = PQgetResult(conn)) != NULL)
+	{
+		if (PQresultStatus(res) != PGRES_COMMAND_OK)
+			ereport(ERROR,
+					(errmsg("initial data copy failed"),
+					 errdetail("Query '%s': %s", query, PQerrorMessage(conn))));
+		nrows += strtoi64(PQcmdTuples(res), NULL, 10);
+		PQclear(res);
+	}
+
+	return nrows;
+}
+
+/*
+ * Record that all data of a table has been copied, so that a restarted join
+ * doesn't copy it again. This goes over the local connection the data was
+ * written with, which doesn't replicate its changes.
+ */
+static void
+pgactive_init_copy_table_done(pgactiveInitCopyState * state, PGconn *local_conn,
+							  pgactiveInitCopyTable * table)
+{
+	PGresult   *res;
+	const char *values[3];
+	char		nrows[32];
+
+	snprintf(nrows, sizeof(nrows), INT64_FORMAT, table->nrows);
+	values[0] = table->relname;
+	values[1] = nrows;
+	values[2] = state->snapshot;
+
+	res = PQexecParams(local_conn,
+					   "INSERT INTO pgactive.pgactive_init_progress (step, relname, nrows, snapshot) "
+					   "VALUES ('data', $1, $2, $3) "
+					   "ON CONFLICT (step, relname) DO UPDATE "
+					   "SET nrows = EXCLUDED.nrows, snapshot = EXCLUDED.snapshot, "
+					   "completed_at = EXCLUDED.completed_at",
+					   3, NULL, values, NULL, NULL, 0);
+	if (PQresultStatus(res) != PGRES_COMMAND_OK)
+		ereport(ERROR,
+				(errmsg("could not record initial data copy progress of table %s",
+						table->relname),
+				 errdetail("Query failed with: %s",
+						   PQerrorMessage(local_conn))));
+	PQclear(res);
+
+	elog(DEBUG1, "finished initial data copy of table %s, " INT64_FORMAT " rows",
+		 table->relname, table->nrows);
+}
+
+/*
+ * Move the rows the remote node has sent so far for the pipe's item to the
+ * local node without waiting for more. Returns true if anything was done;
+ * the pipe becomes idle once the item has been copied completely.
+ */
+static bool
+pgactive_init_copy_pump(pgactiveInitCopyState * state,
+						pgactiveInitCopyPipe * pipe)
+{
+	pgactiveInitCopyTable *table = pipe->item->table;
+	char	   *copybuf;
+	int			len;
+	bool		progress = false;
+
+	if (PQconsumeInput(pipe->remote_conn) == 0)
+		ereport(ERROR,
+				(errmsg("reading from origin table/query failed"),
+				 errdetail("Source connection reported: %s",
+						   PQerrorMessage(pipe->remote_conn))));
+
+	while ((len = PQgetCopyData(pipe->remote_conn, &copybuf, true)) > 0)
+	{
+		if (PQputCopyData(pipe->local_conn, copybuf, len) != 1)
+			ereport(ERROR,
+					(errmsg("writing to destination table failed"),
+					 errdetail("Destination connection reported: %s",
+							   PQerrorMessage(pipe->local_conn))));
+		PQfreemem(copybuf);
+		progress = true;
+	}
+
+	if (len == 0)
+		return progress;
+
+	if (len != -1)
+		ereport(ERROR,
+				(errmsg("reading from origin table/query failed"),
+				 errdetail("Source connection returned %d: %s",
+						   len, PQerrorMessage(pipe->remote_conn))));
+
+	pgactive_init_copy_check_result(pipe->remote_conn, pipe->item->copy_out);
+
+	if (PQputCopyEnd(pipe->local_conn, NULL) != 1)
+		ereport(ERROR,
+				(errmsg("sending copy-completion to destination connection failed"),
+				 errdetail("Destination connection reported: %s",
+						   PQerrorMessage(pipe->local_conn))));
+
+	table->nrows += pgactive_init_copy_check_result(pipe->local_conn,
+													pipe->item->copy_in);
+
+	elog(DEBUG1, "finished initial data copy step for table %s",
+		 table->relname);
+
+	if (--table->nitems_left == 0)
+	{
+		pgactive_init_copy_table_done(state, pipe->local_conn, table);
+		state->ntables_done++;
+	}
+
+	state->bytes_done += pipe->item->nbytes;
+	pipe->item = NULL;
+
+	pgactive_init_copy_report(state, NULL);
+
+	return true;
+}
+
+/*
+ * Copy table data of the remote node as of the init snapshot to the local
+ * node over pgactive.init_node_parallel_jobs pairs of connections.
+ *
+ * All pipes are driven from this process: whenever a pipe is idle it starts
+ * copying the next item, and rows are forwarded to the local node as they
+ * arrive from the remote node. The schema must already have been restored
+ * without indexes and constraints, which are built afterwards.
+ *
+ * When resuming a failed join, tables in done_tables are left alone and the
+ * other ones are emptied before being copied again.
+ */
+static void
+pgactive_init_copy_data(const char *origin_dsn, const char *local_dsn,
+						const char *snapshot, List *tables,
+						bool is_include_set, bool is_exclude_set,
+						List *done_tables, bool resume)
+{
+	pgactiveInitCopyState state;
+	List	   *items;
+	int			nitems;
+	int			ntables;
+	int			next_item = 0;
+	int			ndone = 0;
+	int64		bytes_total = 0;
+	int			i;
+	ListCell   *lc;
+
+	memset(&state, 0, sizeof(state));
+	state.maxpipes = pgactive_init_node_parallel_jobs;
+	state.pipes = palloc0(sizeof(pgactiveInitCopyPipe) * state.maxpipes);
+	state.snapshot = snapshot;
+	state.resume = resume;
+
+	PG_ENSURE_ERROR_CLEANUP(pgactive_init_copy_cleanup,
+							PointerGetDatum(&state));
+	{
+		/* The first pipe also finds out what there is to copy */
+		state.npipes = 1;
+		pgactive_init_copy_connect(&state.pipes[0], origin_dsn, local_dsn,
+								   snapshot);
+
+		items = pgactive_init_copy_get_items(state.pipes[0].remote_conn,
+											 tables, is_include_set,
+											 is_exclude_set, done_tables,
+											 resume, &ntables);
+		nitems = list_length(items);
+
+		pgactive_init_copy_sequences(state.pipes[0].remote_conn,
+									 state.pipes[0].local_conn);
+
+		for (; state.npipes < Min(state.maxpipes, nitems);
+			 state.npipes++)
+			pgactive_init_copy_connect(&state.pipes[state.npipes], origin_dsn,
+									   local_dsn, snapshot);
+
+		ereport(LOG,
+				(errmsg("copying initial data of %d tables in %d steps over %d connections",
+						ntables, nitems, state.npipes)));
+
+		foreach(lc, items)
+			bytes_total += ((pgactiveInitCopyItem *) lfirst(lc))->nbytes;
+		pgactive_join_progress_set_totals(ntables, bytes_total, state.npipes);
+		pgactive_init_copy_report(&state, NULL);
+
+#if PG_VERSION_NUM >= 170000
+		state.wes = CreateWaitEventSet(NULL, state.npipes + 2);
+#else
+		state.wes = CreateWaitEventSet(CurrentMemoryContext, state.npipes + 2);
+#endif
+		AddWaitEventToSet(state.wes, WL_LATCH_SET, PGINVALID_SOCKET,
+						  MyLatch, NULL);
+		AddWaitEventToSet(state.wes, WL_EXIT_ON_PM_DEATH, PGINVALID_SOCKET,
+						  NULL, NULL);
+		for (i = 0; i < state.npipes; i++)
+			AddWaitEventToSet(state.wes, WL_SOCKET_READABLE,
+							  PQsocket(state.pipes[i].remote_conn),
+							  NULL, NULL);
+
+		while (ndone < nitems)
+		{
+			bool		progress = false;
+
+			CHECK_FOR_INTERRUPTS();
+
+			for (i = 0; i < state.npipes; i++)
+			{
+				pgactiveInitCopyPipe *pipe = &state.pipes[i];
+
+				if (pipe->item == NULL)
+				{
+					if (next_item >= nitems)
+						continue;
+
+					pgactive_init_copy_start(&state, pipe,
+											 list_nth(items, next_item++));
+				}
+
+				if (pgactive_init_copy_pump(&state, pipe))
+					progress = true;
+
+				if (pipe->item == NULL)
+					ndone++;
+			}
+
+			/*
+			 * Every pipe has drained what libpq had buffered, wait for more
+			 * data to arrive on any of them.
+			 */
+			if (!progress)
+			{
+				WaitEvent	event;
+
+				(void) WaitEventSetWait(state.wes, 1000L, &event, 1,
+										pgactive_wait_event(pgactive_WAIT_INIT_COPY_DATA));
+				ResetLatch(MyLatch);
+			}
+		}
+	}
+	PG_END_ENSURE_ERROR_CLEANUP(pgactive_init_copy_cleanup,
+								PointerGetDatum(&state));
+
+	pgactive_init_copy_cleanup(0, PointerGetDatum(&state));
+
+	foreach(lc, items)
+	{
+		pgactiveInitCopyItem *item = (pgactiveInitCopyItem *) lfirst(lc);
+
+		ListCell   *next = lnext(items, lc);
+
+		/* Items of a table are adjacent, the last one frees it */
+		if (next == NULL ||
+			((pgactiveInitCopyItem *) lfirst(next))->table != item->table)
+		{
+			pfree(item->table->relname);
+			pfree(item->table);
+		}
+		pfree(item->copy_out);
+		pfree(item->copy_in);
+	}
+	list_free_deep(items);
+	pfree(state.pipes);
+}
+
+/*
+ * Restore a dump taken by pgactive_init_exec_dump_restore to the local node,
+ * optionally only the given section of it. With clean, objects a failed
+ * earlier restore may have left behind are dropped before being recreated.
+ */
+static void
+pgactive_init_exec_restore(char *restore_path, char **cmdargv,
+						   char *local_dsn, char *tmpdir, char *section,
+						   bool clean)
+{
+	char		arg_jobs[12];
+	char		arg_dbname[MAXPGPATH];
+	int			cmdargc;
+
+	snprintf(arg_jobs, sizeof(arg_jobs), "--jobs=%d", pgactive_init_node_parallel_jobs);
+	snprintf(arg_dbname, sizeof(arg_dbname), "--dbname=%s", local_dsn);
+
+	cmdargc = 0;
+	cmdargv[cmdargc++] = restore_path;
+	cmdargv[cmdargc++] = "--exit-on-error";
+	cmdargv[cmdargc++] = arg_jobs;
+	cmdargv[cmdargc++] = "--format=directory";
+	cmdargv[cmdargc++] = arg_dbname;
+	if (section != NULL)
+		cmdargv[cmdargc++] = section;
+	if (clean)
+	{
+		cmdargv[cmdargc++] = "--clean";
+		cmdargv[cmdargc++] = "--if-exists";
+	}
+	cmdargv[cmdargc++] = tmpdir;
+	cmdargv[cmdargc++] = NULL;
+
+	pgactive_execute_command(restore_path, cmdargv);
+}
+
+/*
+ * A local connection of the pipelined initial data sync, loading one data
+ * file that pg_dump has finished writing.
+ */
+typedef struct pgactiveInitLoad
+{
+	PGconn	   *conn;
+	FILE	   *file;			/* data file being loaded, NULL if idle */
+	char	   *copy_stmt;
+	char		path[MAXPGPATH];
+}			pgactiveInitLoad;
+
+typedef struct pgactiveInitLoadState
+{
+	const char *dir;
+	const char *local_dsn;
+	int			nloads;
+	pgactiveInitLoad *loads;
+	int			nloaded;
+	int64		bytes_loaded;
+}			pgactiveInitLoadState;
+
+static void
+pgactive_init_load_cleanup(int code, Datum arg)
+{
+	pgactiveInitLoadState *state = (pgactiveInitLoadState *) DatumGetPointer(arg);
+	int			i;
+
+	for (i = 0; i < state->nloads; i++)
+	{
+		if (state->loads[i].file != NULL)
+			FreeFile(state->loads[i].file);
+		state->loads[i].file = NULL;
+
+		if (state->loads[i].conn != NULL)
+			PQfinish(state->loads[i].conn);
+		state->loads[i].conn = NULL;
+	}
+}
+
+/*
+ * Report progress of the load to pgactive.pgactive_join_progress.
+ * copy_stmt is the COPY statement of a load that has just been started.
+ */
+static void
+pgactive_init_load_report(pgactiveInitLoadState * state, const char *copy_stmt)
+{
+	char		table[2 * NAMEDATALEN + 6];
+	int			busy = 0;
+	int			i;
+
+	for (i = 0; i < state->nloads; i++)
+		if (state->loads[i].file != NULL)
+			busy++;
+
+	/* COPY <qualified name> [(<columns>)] FROM stdin; */
+	table[0] = '\0';
+	if (copy_stmt != NULL && strncmp(copy_stmt, "COPY ", 5) == 0)
+	{
+		const char *p = copy_stmt + 5;
+		bool		quoted = false;
+		int			len = 0;
+
+		for (; *p != '\0' && (quoted || *p != ' ') && len < sizeof(table) - 1; p++)
+		{
+			if (*p == '"')
+				quoted = !quoted;
+			table[len++] = *p;
+		}
+		table[len] = '\0';
+	}
+
+	pgactive_join_progress_update(state->nloaded, state->bytes_loaded, busy,
+								  table[0] != '\0' ? table : NULL);
+}
+
+/*
+ * Start loading the next data file pg_dump has announced as complete, if
+ * any. pg_dump writes the COPY statement of a data file <dumpId>.dat to
+ * <dumpId>.ready once it has finished writing the data file.
+ */
+static bool
+pgactive_init_load_start(pgactiveInitLoadState * state, pgactiveInitLoad * load,
+						 DIR **dir)
+{
+	struct dirent *de;
+
+	if (*dir == NULL)
+	{
+		/* pg_dump creates the directory, it may not be there yet */
+		*dir = AllocateDir(state->dir);
+		if (*dir == NULL)
+			return false;
+	}
+
+	while ((de = ReadDir(*dir, state->dir)) != NULL)
+	{
+		char		ready_path[MAXPGPATH];
+		size_t		namelen = strlen(de->d_name);
+		FILE	   *fp;
+		StringInfoData copy_stmt;
+		char		buf[1024];
+		size_t		nread;
+		PGresult   *res;
+
+		if (namelen <= strlen(".ready") ||
+			strcmp(de->d_name + namelen - strlen(".ready"), ".ready") != 0)
+			continue;
+
+		snprintf(ready_path, sizeof(ready_path), "%s/%s", state->dir,
+				 de->d_name);
+		snprintf(load->path, sizeof(load->path), "%s/%.*s.dat", state->dir,
+				 (int) (namelen - strlen(".ready")), de->d_name);
+
+		fp = AllocateFile(ready_path, PG_BINARY_R);
+		if (fp == NULL)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not open file \"%s\": %m", ready_path)));
+
+		initStringInfo(&copy_stmt);
+		while ((nread = fread(buf, 1, sizeof(buf), fp)) > 0)
+			appendBinaryStringInfo(&copy_stmt, buf, nread);
+		if (ferror(fp))
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not read file \"%s\": %m", ready_path)));
+		FreeFile(fp);
+
+		if (unlink(ready_path) != 0)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not remove file \"%s\": %m", ready_path)));
+
+		if (load->conn == NULL)
+		{
+			load->conn = PQconnectdb(state->local_dsn);
+			if (PQstatus(load->conn) != CONNECTION_OK)
+				ereport(ERROR,
+						(errmsg("could not connect to the local server for initial data restore: %s",
+								GetPQerrorMessage(load->conn))));
+		}
+
+		res = PQexec(load->conn, copy_stmt.data);
+		if (PQresultStatus(res) != PGRES_COPY_IN)
+			ereport(ERROR,
+					(errmsg("execution of COPY ... FROM stdin failed"),
+					 errdetail("Query '%s': %s", copy_stmt.data,
+							   PQerrorMessage(load->conn))));
+		PQclear(res);
+
+		load->file = AllocateFile(load->path, PG_BINARY_R);
+		if (load->file == NULL)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not open file \"%s\": %m", load->path)));
+		load->copy_stmt = copy_stmt.data;
+
+		pgactive_init_load_report(state, load->copy_stmt);
+
+		return true;
+	}
+
+	return false;
+}
+
+/*
+ * Send the next chunk of the data file being loaded; once it has been sent
+ * completely, finish the COPY and remove the file.
+ */
+static void
+pgactive_init_load_step(pgactiveInitLoadState * state, pgactiveInitLoad * load)
+{
+	char		buf[65536];
+	size_t		nread;
+
+	nread = fread(buf, 1, sizeof(buf), load->file);
+	if (nread > 0 && PQputCopyData(load->conn, buf, nread) != 1)
+		ereport(ERROR,
+				(errmsg("writing to destination table failed"),
+				 errdetail("Destination connection reported: %s",
+						   PQerrorMessage(load->conn))));
+	state->bytes_loaded += nread;
+
+	if (nread == sizeof(buf))
+		return;
+
+	if (ferror(load->file))
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not read file \"%s\": %m", load->path)));
+
+	if (PQputCopyEnd(load->conn, NULL) != 1)
+		ereport(ERROR,
+				(errmsg("sending copy-completion to destination connection failed"),
+				 errdetail("Destination connection reported: %s",
+						   PQerrorMessage(load->conn))));
+
+	pgactive_init_copy_check_result(load->conn, load->copy_stmt);
+
+	FreeFile(load->file);
+	load->file = NULL;
+
+	if (unlink(load->path) != 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not remove file \"%s\": %m", load->path)));
+
+	pfree(load->copy_stmt);
+	load->copy_stmt = NULL;
+	state->nloaded++;
+}
+
+/*
+ * pgactive_command_poll_cb of the pipelined initial data sync: start loading
+ * completed data files on idle connections and feed each busy connection
+ * another chunk of its file.
+ */
+static bool
+pgactive_init_load_poll(void *arg)
+{
+	pgactiveInitLoadState *state = (pgactiveInitLoadState *) arg;
+	DIR		   *dir = NULL;
+	bool		progress = false;
+	int			i;
+
+	for (i = 0; i < state->nloads; i++)
+	{
+		pgactiveInitLoad *load = &state->loads[i];
+
+		if (load->file == NULL &&
+			!pgactive_init_load_start(state, load, &dir))
+			continue;
+
+		pgactive_init_load_step(state, load);
+		progress = true;
+	}
+
+	if (dir != NULL)
+		FreeDir(dir);
+
+	if (progress)
+		pgactive_init_load_report(state, NULL);
+
+	return progress;
+}
+
+/*
+ * Dump table data of the remote node as of the init snapshot and restore it
+ * to the local node while the dump is still running.
+ *
+ * pg_dump announces every table data file it has completed, which is then
+ * loaded over one of pgactive.init_node_parallel_jobs local connections and
+ * removed, so scratch space only has to hold the tables in flight. Whatever
+ * else the data section contains (sequence values, large objects) is
+ * restored with pg_restore once the dump has finished.
+ */
+static void
+pgactive_init_pipeline_data(char *dump_path, char *restore_path,
+							char **cmdargv, char *origin_dsn,
+							char *local_dsn, char *snapshot, char *tmpdir,
+							List *table_args)
+{
+	pgactiveInitLoadState state;
+	char		datadir[MAXPGPATH];
+	char		list_path[MAXPGPATH];
+	char		filtered_list_path[MAXPGPATH];
+	char		arg_jobs[12];
+	char		arg_snapshot[MAXPGPATH];
+	char		arg_file[MAXPGPATH];
+	char		arg_dbname[MAXPGPATH];
+	char		line[MAXPGPATH];
+	FILE	   *list_file;
+	FILE	   *filtered_list_file;
+	int			cmdargc;
+	ListCell   *lc;
+
+	snprintf(datadir, sizeof(datadir), "%s/data", tmpdir);
+
+	snprintf(arg_jobs, sizeof(arg_jobs), "--jobs=%d", pgactive_init_node_parallel_jobs);
+	snprintf(arg_snapshot, sizeof(arg_snapshot), "--snapshot=%s", snapshot);
+	snprintf(arg_file, sizeof(arg_file), "--file=%s", datadir);
+
+	cmdargc = 0;
+	cmdargv[cmdargc++] = dump_path;
+	cmdargv[cmdargc++] = "--exclude-table=pgactive.pgactive_nodes";
+	cmdargv[cmdargc++] = "--exclude-table=pgactive.pgactive_connections";
+	cmdargv[cmdargc++] = "--pgactive-init-node";
+	cmdargv[cmdargc++] = "--pgactive-pipeline";
+	cmdargv[cmdargc++] = "--data-only";
+	cmdargv[cmdargc++] = "--compress=0";
+	cmdargv[cmdargc++] = "--no-sync";
+	cmdargv[cmdargc++] = arg_jobs;
+	cmdargv[cmdargc++] = arg_snapshot;
+	cmdargv[cmdargc++] = "--format=directory";
+	cmdargv[cmdargc++] = arg_file;
+	cmdargv[cmdargc++] = origin_dsn;
+	foreach(lc, table_args)
+		cmdargv[cmdargc++] = (char *) lfirst(lc);
+	cmdargv[cmdargc++] = NULL;
+
+	memset(&state, 0, sizeof(state));
+	state.dir = datadir;
+	state.local_dsn = local_dsn;
+	state.nloads = pgactive_init_node_parallel_jobs;
+	state.loads = palloc0(sizeof(pgactiveInitLoad) * state.nloads);
+
+	PG_ENSURE_ERROR_CLEANUP(pgactive_init_load_cleanup,
+							PointerGetDatum(&state));
+	{
+		pgactive_execute_command_ext(dump_path, cmdargv,
+									 pgactive_init_load_poll, &state);
+
+		/* Load what pg_dump completed after we last looked */
+		while (pgactive_init_load_poll(&state))
+			CHECK_FOR_INTERRUPTS();
+	}
+	PG_END_ENSURE_ERROR_CLEANUP(pgactive_init_load_cleanup,
+								PointerGetDatum(&state));
+
+	pgactive_init_load_cleanup(0, PointerGetDatum(&state));
+	pfree(state.loads);
+
+	ereport(LOG,
+			(errmsg("restored data of %d tables while dumping them",
+					state.nloaded)));
+
+	/*
+	 * Restore the rest of the data section, leaving out the table data that
+	 * has already been loaded and removed.
+	 */
+	snprintf(list_path, sizeof(list_path), "%s/data.list", tmpdir);
+	snprintf(filtered_list_path, sizeof(filtered_list_path),
+			 "%s/data_remaining.list", tmpdir);
+	snprintf(arg_file, sizeof(arg_file), "--file=%s", list_path);
+
+	cmdargc = 0;
+	cmdargv[cmdargc++] = restore_path;
+	cmdargv[cmdargc++] = "--list";
+	cmdargv[cmdargc++] = "--format=directory";
+	cmdargv[cmdargc++] = arg_file;
+	cmdargv[cmdargc++] = datadir;
+	cmdargv[cmdargc++] = NULL;
+
+	pgactive_execute_command(restore_path, cmdargv);
+
+	list_file = AllocateFile(list_path, PG_BINARY_R);
+	if (list_file == NULL)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not open file \"%s\": %m", list_path)));
+	filtered_list_file = AllocateFile(filtered_list_path, PG_BINARY_W);
+	if (filtered_list_file == NULL)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not create file \"%s\": %m", filtered_list_path)));
+
+	while (fgets(line, sizeof(line), list_file) != NULL)
+	{
+		if (strstr(line, " TABLE DATA ") != NULL)
+			continue;
+		if (fputs(line, filtered_list_file) == EOF)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not write file \"%s\": %m", filtered_list_path)));
+	}
+	if (ferror(list_file))
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not read file \"%s\": %m", list_path)));
+
+	FreeFile(list_file);
+	if (FreeFile(filtered_list_file) != 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not write file \"%s\": %m", filtered_list_path)));
+
+	snprintf(arg_file, sizeof(arg_file), "--use-list=%s", filtered_list_path);
+	snprintf(arg_dbname, sizeof(arg_dbname), "--dbname=%s", local_dsn);
+
+	cmdargc = 0;
+	cmdargv[cmdargc++] = restore_path;
+	cmdargv[cmdargc++] = "--exit-on-error";
+	cmdargv[cmdargc++] = "--format=directory";
+	cmdargv[cmdargc++] = arg_file;
+	cmdargv[cmdargc++] = arg_dbname;
+	cmdargv[cmdargc++] = datadir;
+	cmdargv[cmdargc++] = NULL;
+
+	pgactive_execute_command(restore_path, cmdargv);
+}
+
+/*
+ * Run a query against pgactive.pgactive_init_progress over a new local
+ * connection. local_dsn suppresses replication of the changes made, the
+ * progress of a join is only of interest to the joining node.
+ */
+static PGresult *
+pgactive_init_progress_exec(const char *local_dsn, const char *query,
+							int nparams, const char *const *values)
+{
+	PGconn	   *conn;
+	PGresult   *res;
+
+	conn = PQconnectdb(local_dsn);
+	if (PQstatus(conn) != CONNECTION_OK)
+	{
+		char	   *msg = pchomp(PQerrorMessage(conn));
+
+		PQfinish(conn);
+		ereport(ERROR,
+				(errmsg("could not connect to the local server to record join progress: %s",
+						msg)));
+	}
+
+	res = PQexecParams(conn, query, nparams, NULL, values, NULL, NULL, 0);
+	if (PQresultStatus(res) != PGRES_COMMAND_OK &&
+		PQresultStatus(res) != PGRES_TUPLES_OK)
+	{
+		char	   *msg = pchomp(PQerrorMessage(conn));
+
+		PQclear(res);
+		PQfinish(conn);
+		ereport(ERROR,
+				(errmsg("could not access join progress"),
+				 errdetail("Query '%s' failed with: %s", query, msg)));
+	}
+
+	PQfinish(conn);
+
+	return res;
+}
+
+/*
+ * Record that a step of the join other than copying a table's data is done.
+ * schema_position is only recorded with the schema step.
+ */
+static void
+pgactive_init_progress_step_done(const char *local_dsn, const char *step,
+								 const char *snapshot,
+								 const char *schema_position)
+{
+	char	   *query;
+	const char *values[2];
+
+	values[0] = snapshot;
+	values[1] = schema_position;
+	query = psprintf("INSERT INTO pgactive.pgactive_init_progress (step, snapshot, schema_position) "
+					 "VALUES ('%s', $1, $2) ON CONFLICT (step, relname) DO NOTHING",
+					 step);
+	PQclear(pgactive_init_progress_exec(local_dsn, query, 2, values));
+	pfree(query);
+}
+
+/*
+ * Get the position of the remote node's schema: a fingerprint of the
+ * definitions of its tables' columns, indexes and constraints. A join can
+ * only resume if it didn't change since its tables were created, or the
+ * tables it restored won't match what it copies into them, and catch-up would
+ * replay DDL that the data copied under the new snapshot already reflects.
+ *
+ * Only catalog columns go into it, not functions like pg_get_indexdef() that
+ * look at the latest catalog contents, so it's what the snapshot sees.
+ *
+ * With snapshot the query runs under that snapshot, otherwise conn must be
+ * in the transaction that exported the snapshot to look at.
+ */
+static char *
+pgactive_init_get_schema_position(PGconn *conn, const char *snapshot)
+{
+	PGresult   *res;
+	char	   *query;
+	char	   *position;
+
+	if (snapshot != NULL)
+	{
+		query = psprintf("BEGIN TRANSACTION ISOLATION LEVEL REPEATABLE READ, READ ONLY;\n"
+						 "SET TRANSACTION SNAPSHOT '%s';", snapshot);
+		res = PQexec(conn, query);
+		if (PQresultStatus(res) != PGRES_COMMAND_OK)
+			ereport(ERROR,
+					(errmsg("could not import snapshot %s on remote node", snapshot),
+					 errdetail("Query '%s': %s", query, PQerrorMessage(conn))));
+		PQclear(res);
+		pfree(query);
+	}
+
+	res = PQexec(conn,
+				 "SELECT pg_catalog.md5(COALESCE(pg_catalog.string_agg(d.def, ',' ORDER BY d.def), ''))\n"
+				 "FROM pg_catalog.pg_class c\n"
+				 "JOIN pg_catalog.pg_namespace n ON n.oid = c.relnamespace,\n"
+				 "LATERAL (\n"
+				 "  SELECT pg_catalog.format('%s column %s %s %s', c.oid, a.attname,\n"
+				 "    pg_catalog.format_type(a.atttypid, a.atttypmod), a.attnotnull)\n"
+				 "  FROM pg_catalog.pg_attribute a\n"
+				 "  WHERE a.attrelid = c.oid AND a.attnum > 0 AND NOT a.attisdropped\n"
+				 "  UNION ALL\n"
+				 "  SELECT pg_catalog.format('%s index %s %s %s %s %s %s %s', c.oid, i.indexrelid,\n"
+				 "    i.indisunique, i.indisprimary, i.indkey, i.indclass, i.indexprs, i.indpred)\n"
+				 "  FROM pg_catalog.pg_index i\n"
+				 "  WHERE i.indrelid = c.oid\n"
+				 "  UNION ALL\n"
+				 "  SELECT pg_catalog.format('%s constraint %s %s %s %s %s %s', c.oid, o.conname,\n"
+				 "    o.contype, o.conkey, o.confrelid, o.confkey, o.conbin)\n"
+				 "  FROM pg_catalog.pg_constraint o\n"
+				 "  WHERE o.conrelid = c.oid) AS d(def)\n"
+				 "WHERE c.relkind IN ('r', 'p')\n"
+				 "AND n.nspname NOT IN ('pg_catalog', 'information_schema', 'pgactive')\n"
+				 "AND n.nspname !~ '^pg_toast'");
+	if (PQresultStatus(res) != PGRES_TUPLES_OK || PQntuples(res) != 1)
+		ereport(ERROR,
+				(errmsg("could not get schema position of remote node"),
+				 errdetail("Querying remote failed with: %s",
+						   PQerrorMessage(conn))));
+	position = pstrdup(PQgetvalue(res, 0, 0));
+	PQclear(res);
+
+	if (snapshot != NULL)
+	{
+		res = PQexec(conn, "COMMIT");
+		if (PQresultStatus(res) != PGRES_COMMAND_OK)
+			ereport(ERROR,
+					(errmsg("could not commit transaction on remote node"),
+					 errdetail("Querying remote failed with: %s",
+							   PQerrorMessage(conn))));
+		PQclear(res);
+	}
+
+	return position;
+}
+
+/*
+ * Copy the contents of a remote node using pg_dump and apply it to the local
+ * node using pg_restore. Runs during node join creation to bring up a new
+ * logical replica from an existing node. The remote dump is taken from the
+ * start position of a slot on the remote end to ensure that we never replay
+ * changes included in the dump and never miss changes.
+ *
+ * When asked, only pg_dump the data not the schema (data defnintions). User
+ * must ensure node has all required schema objects before logically joining
+ * the node to pgactive group, otherwise, an error is emitted from here.
+ *
+ * With pgactive.init_node_data_sync_method = copy or pipeline the schema is
+ * dumped separately. Its pre-data section is restored first, table data is
+ * then copied with pgactive_init_copy_data or pgactive_init_pipeline_data
+ * and the post-data section (indexes, constraints, triggers) is restored
+ * last, in parallel.
+ *
+ * The copy method records each finished step in
+ * pgactive.pgactive_init_progress. With resume, a join that failed while
+ * copying data continues from there using a new snapshot: restored schema and
+ * copied tables are kept, the remaining tables are copied again. Changes
+ * made on the remote node in between are replayed from the join's slot.
+ * That's refused if the remote node's schema changed in between, or if a
+ * table left to copy has no key to replay changes to it by.
+ */
+static void
+pgactive_init_exec_dump_restore(pgactiveNodeInfo * node,
+								char *snapshot,
+								pgactiveNodeId * remote,
+								PGconn *conn,
+								bool resume)
+{
+#define pgactive_MAX_NO_OF_NON_TABLE_OPTS	14
+
+	char		tmpdir[MAXPGPATH];
+	char		pgactive_dump_path[MAXPGPATH];
+	char		pgactive_restore_path[MAXPGPATH];
+	StringInfo	origin_dsn = makeStringInfo();
+	StringInfo	local_dsn = makeStringInfo();
+	uint32		bin_version;
+	char	   *o_servername;
+	char	   *l_servername;
+	char	  **cmdargv;
+	int			cmdargc;
+	char		arg_jobs[12];
+	char		arg_tmp1[MAXPGPATH];
+	char		arg_tmp2[MAXPGPATH];
+	pgactiveNodeId myid;
+	List	   *tables = NIL;
+	ListCell   *lc;
+	bool		is_include_set = false;
+	bool		is_exclude_set = false;
+	List	   *table_args = NIL;
+	int			sync_method = pgactive_init_node_data_sync_method;
+	bool		data_only = pgactive_get_data_only_node_init(MyDatabaseId);
+	bool		schema_dump;
+	bool		schema_done = false;
+	bool		post_data_done = false;
+	List	   *done_tables = NIL;
+	int			ntables;
+	int64		nbytes;
+
+	/* Only the copy method keeps track of what it has done */
+	if (resume)
+		sync_method = pgactive_INIT_NODE_DATA_SYNC_COPY;
+	schema_dump = (sync_method != pgactive_INIT_NODE_DATA_SYNC_DUMP);
+
+	if (pgactive_find_other_exec(my_exec_path, pgactive_DUMP_CMD, &bin_version,
+								 &pgactive_dump_path[0]) < 0)
+	{
+		elog(ERROR, "pgactive node init failed to find " pgactive_DUMP_CMD
+			 " relative to binary %s",
+			 my_exec_path);
+	}
+	if (bin_version / 10000 != PG_VERSION_NUM / 10000)
+	{
+		elog(ERROR, "pgactive node init found " pgactive_DUMP_CMD
+			 " with wrong major version %d.%d, expected %d.%d",
+			 bin_version / 100 / 100, bin_version / 100 % 100,
+			 PG_VERSION_NUM / 100 / 100, PG_VERSION_NUM / 100 % 100);
+	}
+
+	if (pgactive_find_other_exec(my_exec_path, pgactive_RESTORE_CMD, &bin_version,
+								 &pgactive_restore_path[0]) < 0)
+	{
+		elog(ERROR, "pgactive node init failed to find " pgactive_RESTORE_CMD
+			 " relative to binary %s",
+			 my_exec_path);
+	}
+	if (bin_version / 10000 != PG_VERSION_NUM / 10000)
+	{
+		elog(ERROR, "pgactive node init found " pgactive_RESTORE_CMD
+			 " with wrong major version %d.%d, expected %d.%d",
+			 bin_version / 100 / 100, bin_version / 100 % 100,
+			 PG_VERSION_NUM / 100 / 100, PG_VERSION_NUM / 100 % 100);
+	}
+
+	o_servername = get_connect_string(node->init_from_dsn);
+	pgactive_make_my_nodeid(&myid);
+	appendStringInfo(origin_dsn, "%s %s %s application_name='pgactive:" UINT64_FORMAT ":init dump'",
+					 pgactive_default_apply_connection_options,
+					 pgactive_extra_apply_connection_options,
+					 (o_servername == NULL ? node->init_from_dsn : o_servername),
+					 myid.sysid);
+
+	/*
+	 * Suppress replication of changes applied via pg_restore back to the
+	 * local node.
+	 *
+	 * TODO: This should PQconninfoParse, modify the options keyword or add
+	 * it, and reconstruct the string using the functions from pg_dumpall
+	 * (also to be used for init_copy). Simply appending the options instead
+	 * is a bit dodgy.
+	 */
+	l_servername = get_connect_string(node->local_dsn);
+	appendStringInfo(local_dsn, "%s application_name='pgactive:" UINT64_FORMAT ":init restore' "
+					 "options='-c pgactive.do_not_replicate=on "
+
+	/*
+	 * remove for now "-c pgactive.permit_unsafe_ddl_commands=on "
+	 */
 					 "-c pgactive.skip_ddl_replication=on "
 
 	/*
@@ -434,6 +1971,54 @@ pgactive_init_exec_dump_restore(pgactiveNodeInfo * node,
 					 (l_servername == NULL ? node->local_dsn : l_servername),
 					 myid.sysid);
 
+	if (!resume)
+		PQclear(pgactive_init_progress_exec(local_dsn->data,
+											"DELETE FROM pgactive.pgactive_init_progress",
+											0, NULL));
+	else
+	{
+		PGresult   *res;
+		int			i;
+		char	   *schema_position;
+		char	   *recorded_position = NULL;
+
+		res = pgactive_init_progress_exec(local_dsn->data,
+										  "SELECT step, relname, schema_position FROM pgactive.pgactive_init_progress",
+										  0, NULL);
+		for (i = 0; i < PQntuples(res); i++)
+		{
+			char	   *step = PQgetvalue(res, i, 0);
+
+			if (strcmp(step, "schema") == 0)
+			{
+				schema_done = true;
+				if (!PQgetisnull(res, i, 2))
+					recorded_position = pstrdup(PQgetvalue(res, i, 2));
+			}
+			else if (strcmp(step, "post-data") == 0)
+				post_data_done = true;
+			else if (strcmp(step, "data") == 0)
+				done_tables = lappend(done_tables,
+									  makeString(pstrdup(PQgetvalue(res, i, 1))));
+		}
+		PQclear(res);
+
+		schema_position = pgactive_init_get_schema_position(conn, NULL);
+		if (recorded_position == NULL ||
+			strcmp(recorded_position, schema_position) != 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+					 errmsg("previous init failed and cannot be resumed, manual cleanup is required"),
+					 errdetail("The schema of the upstream node changed since the failed init created the tables, from position \"%s\" to \"%s\".",
+							   recorded_position ? recorded_position : "",
+							   schema_position),
+					 errhint("Remove all replication identifiers and slots corresponding to this node from the init target node then drop and recreate this database and try again.")));
+
+		ereport(LOG,
+				(errmsg("resuming initial data copy, data of %d tables has been copied already",
+						list_length(done_tables))));
+	}
+
 	snprintf(tmpdir, sizeof(tmpdir), "%s/%s-" UINT64_FORMAT "-%s.%d",
 			 pgactive_temp_dump_directory, TEMP_DUMP_DIR_PREFIX,
 			 GetSystemIdentifier(), snapshot, getpid());
@@ -470,50 +2055,70 @@ pgactive_init_exec_dump_restore(pgactiveNodeInfo * node,
 		cmdargv = (char **) palloc0((pgactive_MAX_NO_OF_NON_TABLE_OPTS + list_length(tables))
 									* sizeof(char *));
 
-		/* Get contents from remote node with pg_dump */
-		snprintf(arg_jobs, sizeof(arg_jobs), "--jobs=%d", pgactive_init_node_parallel_jobs);
-		snprintf(arg_tmp1, sizeof(arg_tmp1), "--snapshot=%s", snapshot);
-		snprintf(arg_tmp2, sizeof(arg_tmp2), "--file=%s", tmpdir);
-
-		cmdargc = 0;
-		cmdargv[cmdargc++] = pgactive_dump_path;
-		cmdargv[cmdargc++] = "--exclude-table=pgactive.pgactive_nodes";
-		cmdargv[cmdargc++] = "--exclude-table=pgactive.pgactive_connections";
-		cmdargv[cmdargc++] = "--pgactive-init-node";
-		cmdargv[cmdargc++] = arg_jobs;
-		cmdargv[cmdargc++] = arg_tmp1;
-		cmdargv[cmdargc++] = "--format=directory";
-		cmdargv[cmdargc++] = arg_tmp2;
-		cmdargv[cmdargc++] = origin_dsn->data;
-
-		if (pgactive_get_data_only_node_init(MyDatabaseId))
-			cmdargv[cmdargc++] = "--data-only";
-
 		foreach(lc, tables)
 		{
 			char	   *table = (char *) lfirst(lc);
 			char		table_arg[2 * NAMEDATALEN]; /* For option name + table
 													 * name */
-			char	   *ptr;
 
 			if (is_include_set)
 				snprintf(table_arg, (2 * NAMEDATALEN), "--table=%s", table);
 			else if (is_exclude_set)
 				snprintf(table_arg, (2 * NAMEDATALEN), "--exclude-table=%s", table);
 
-			ptr = pstrdup(table_arg);
-			table_args = lappend(table_args, ptr);
-			cmdargv[cmdargc++] = ptr;
+			table_args = lappend(table_args, pstrdup(table_arg));
 		}
 
-		cmdargv[cmdargc++] = NULL;
+		/*
+		 * Get contents from remote node with pg_dump. There's nothing to dump
+		 * here when the schema is dumped separately and only data is wanted,
+		 * or has been restored completely by an earlier attempt.
+		 */
+		if (!(schema_dump && (data_only || post_data_done)))
+		{
+			snprintf(arg_jobs, sizeof(arg_jobs), "--jobs=%d", pgactive_init_node_parallel_jobs);
+			snprintf(arg_tmp1, sizeof(arg_tmp1), "--snapshot=%s", snapshot);
+			snprintf(arg_tmp2, sizeof(arg_tmp2), "--file=%s", tmpdir);
+
+			cmdargc = 0;
+			cmdargv[cmdargc++] = pgactive_dump_path;
+			cmdargv[cmdargc++] = "--exclude-table=pgactive.pgactive_nodes";
+			cmdargv[cmdargc++] = "--exclude-table=pgactive.pgactive_connections";
+			cmdargv[cmdargc++] = "--pgactive-init-node";
+			cmdargv[cmdargc++] = arg_jobs;
+			cmdargv[cmdargc++] = arg_tmp1;
+			cmdargv[cmdargc++] = "--format=directory";
+			cmdargv[cmdargc++] = arg_tmp2;
+			cmdargv[cmdargc++] = origin_dsn->data;
+
+			if (schema_dump)
+			{
+				cmdargv[cmdargc++] = "--section=pre-data";
+				cmdargv[cmdargc++] = "--section=post-data";
+			}
+			else if (data_only)
+				cmdargv[cmdargc++] = "--data-only";
 
-		pgactive_execute_command(pgactive_dump_path, cmdargv);
+			foreach(lc, table_args)
+				cmdargv[cmdargc++] = (char *) lfirst(lc);
 
-		list_free_deep(tables);
-		tables = NIL;
-		list_free_deep(table_args);
-		table_args = NIL;
+			cmdargv[cmdargc++] = NULL;
+
+			pgactive_join_progress_set_phase(pgactive_JOIN_PHASE_DUMPING);
+			if (schema_dump)
+				pgactive_execute_command(pgactive_dump_path, cmdargv);
+			else
+			{
+				pgactiveInitDumpWatch watch = {tmpdir, 0};
+
+				/* The dump is compressed, its size says little */
+				pgactive_join_progress_estimate(conn, &ntables, &nbytes);
+				pgactive_join_progress_set_totals(ntables, -1,
+												  pgactive_init_node_parallel_jobs);
+				pgactive_execute_command_ext(pgactive_dump_path, cmdargv,
+											 pgactive_init_dump_poll, &watch);
+			}
+		}
 
 		/*
 		 * We don't need this flag anymore after the dump finishes, so reset
@@ -524,20 +2129,85 @@ pgactive_init_exec_dump_restore(pgactiveNodeInfo * node,
 		/*
 		 * Restore contents from remote node on to local node with pg_restore.
 		 */
+		if (!schema_dump)
+		{
+			/* pg_restore doesn't tell how far it got */
+			pgactive_join_progress_set_phase(pgactive_JOIN_PHASE_RESTORING);
+			pgactive_join_progress_scan_dump(tmpdir, &ntables, &nbytes);
+			pgactive_join_progress_set_totals(ntables, nbytes,
+											  pgactive_init_node_parallel_jobs);
+
+			pgactive_init_exec_restore(pgactive_restore_path, cmdargv,
+									   local_dsn->data, tmpdir, NULL, false);
+		}
+		else if (sync_method == pgactive_INIT_NODE_DATA_SYNC_COPY)
+		{
+			if (!schema_done)
+			{
+				pgactive_join_progress_set_phase(pgactive_JOIN_PHASE_RESTORING_SCHEMA);
+				if (!data_only)
+					pgactive_init_exec_restore(pgactive_restore_path, cmdargv,
+											   local_dsn->data, tmpdir,
+											   "--section=pre-data", false);
+				pgactive_init_progress_step_done(local_dsn->data, "schema",
+												 snapshot,
+												 pgactive_init_get_schema_position(conn, snapshot));
+
+				/* The user supplied indexes and constraints too */
+				if (data_only)
+				{
+					pgactive_init_progress_step_done(local_dsn->data,
+													 "post-data", snapshot,
+													 NULL);
+					post_data_done = true;
+				}
+			}
 
-		snprintf(arg_jobs, sizeof(arg_jobs), "--jobs=%d", pgactive_init_node_parallel_jobs);
-		snprintf(arg_tmp1, sizeof(arg_tmp1), "--dbname=%s", local_dsn->data);
+			pgactive_join_progress_set_phase(pgactive_JOIN_PHASE_COPYING_DATA);
+			pgactive_init_copy_data(origin_dsn->data, local_dsn->data,
+									snapshot, tables, is_include_set,
+									is_exclude_set, done_tables, resume);
 
-		cmdargc = 0;
-		cmdargv[cmdargc++] = pgactive_restore_path;
-		cmdargv[cmdargc++] = "--exit-on-error";
-		cmdargv[cmdargc++] = arg_jobs;
-		cmdargv[cmdargc++] = "--format=directory";
-		cmdargv[cmdargc++] = arg_tmp1;
-		cmdargv[cmdargc++] = tmpdir;
-		cmdargv[cmdargc++] = NULL;
+			if (!post_data_done)
+			{
+				pgactive_join_progress_set_phase(pgactive_JOIN_PHASE_BUILDING_INDEXES);
+				pgactive_init_exec_restore(pgactive_restore_path, cmdargv,
+										   local_dsn->data, tmpdir,
+										   "--section=post-data", resume);
+				pgactive_init_progress_step_done(local_dsn->data, "post-data",
+												 snapshot, NULL);
+			}
+		}
+		else
+		{
+			pgactive_join_progress_set_phase(pgactive_JOIN_PHASE_RESTORING_SCHEMA);
+			if (!data_only)
+				pgactive_init_exec_restore(pgactive_restore_path, cmdargv,
+										   local_dsn->data, tmpdir,
+										   "--section=pre-data", false);
+
+			pgactive_join_progress_set_phase(pgactive_JOIN_PHASE_COPYING_DATA);
+			pgactive_join_progress_estimate(conn, &ntables, &nbytes);
+			pgactive_join_progress_set_totals(ntables, nbytes,
+											  pgactive_init_node_parallel_jobs);
+			pgactive_init_pipeline_data(pgactive_dump_path,
+										pgactive_restore_path, cmdargv,
+										origin_dsn->data, local_dsn->data,
+										snapshot, tmpdir, table_args);
+
+			pgactive_join_progress_set_phase(pgactive_JOIN_PHASE_BUILDING_INDEXES);
+			if (!data_only)
+				pgactive_init_exec_restore(pgactive_restore_path, cmdargv,
+										   local_dsn->data, tmpdir,
+										   "--section=post-data", false);
+		}
 
-		pgactive_execute_command(pgactive_restore_path, cmdargv);
+		list_free_deep(tables);
+		tables = NIL;
+		list_free_deep(table_args);
+		table_args = NIL;
+		list_free(done_tables);
+		done_tables = NIL;
 		pfree(cmdargv);
 	}
 	PG_END_ENSURE_ERROR_CLEANUP(destroy_temp_dump_dir,
@@ -704,6 +2374,120 @@ pgactive_insert_remote_conninfo(PGconn *conn, pgactiveConnectionConfig * myconfi
 #undef _pgactive_JOIN_NODE_PRIVATE
 }
 
+/* How often peers slow to create our slots are reported, in milliseconds */
+#define pgactive_INIT_SLOT_REPORT_INTERVAL	10000
+
+/*
+ * A peer a joining node creates its replication slot on.
+ */
+typedef struct pgactiveInitSlotPeer
+{
+	const char *dsn;
+	PGconn	   *conn;			/* creating the slot, NULL once done */
+	PGconn	   *monitor_conn;	/* finds out what slot creation waits for */
+	pgactiveNodeId remote;
+	NameData	slot_name;
+	char	   *remote_ident;
+}			pgactiveInitSlotPeer;
+
+typedef struct pgactiveInitSlotState
+{
+	int			npeers;
+	pgactiveInitSlotPeer *peers;
+}			pgactiveInitSlotState;
+
+static void
+pgactive_init_slots_cleanup(int code, Datum arg)
+{
+	pgactiveInitSlotState *state = (pgactiveInitSlotState *) DatumGetPointer(arg);
+	int			i;
+
+	for (i = 0; i < state->npeers; i++)
+	{
+		pgactiveInitSlotPeer *peer = &state->peers[i];
+
+		if (peer->conn != NULL)
+			PQfinish(peer->conn);
+		peer->conn = NULL;
+		if (peer->monitor_conn != NULL)
+			PQfinish(peer->monitor_conn);
+		peer->monitor_conn = NULL;
+	}
+}
+
+/*
+ * Log what a peer's walsender creating our slot is waiting for: the
+ * transactions it found running when it started, which show up as holding
+ * the locks it waits on.
+ */
+static void
+pgactive_init_report_slot_blockers(pgactiveInitSlotPeer * peer, long waited_secs)
+{
+	PGresult   *res;
+	const char *values[1];
+	char		pid[12];
+	int			i;
+
+	if (peer->monitor_conn == NULL)
+	{
+		peer->monitor_conn = pgactive_connect_nonrepl(peer->dsn,
+													  "slot creation monitor",
+													  true, false);
+		if (PQstatus(peer->monitor_conn) != CONNECTION_OK)
+		{
+			ereport(LOG,
+					(errmsg("still waiting for replication slot creation on node " pgactive_NODEID_FORMAT_WITHNAME " after %ld seconds",
+							pgactive_NODEID_FORMAT_WITHNAME_ARGS(peer->remote),
+							waited_secs),
+					 errdetail("Could not connect to the node to find out why: %s",
+							   GetPQerrorMessage(peer->monitor_conn))));
+			PQfinish(peer->monitor_conn);
+			peer->monitor_conn = NULL;
+			return;
+		}
+	}
+
+	snprintf(pid, sizeof(pid), "%d", PQbackendPID(peer->conn));
+	values[0] = pid;
+
+	res = PQexecParams(peer->monitor_conn,
+					   "SELECT a.pid, a.backend_xid, pg_catalog.now() - a.xact_start,\n"
+					   "  a.state, a.application_name, pg_catalog.left(a.query, 128)\n"
+					   "FROM pg_catalog.pg_stat_activity a\n"
+					   "WHERE a.pid = ANY (pg_catalog.pg_blocking_pids($1::pg_catalog.int4))",
+					   1, NULL, values, NULL, NULL, 0);
+	if (PQresultStatus(res) != PGRES_TUPLES_OK)
+	{
+		ereport(LOG,
+				(errmsg("still waiting for replication slot creation on node " pgactive_NODEID_FORMAT_WITHNAME " after %ld seconds",
+						pgactive_NODEID_FORMAT_WITHNAME_ARGS(peer->remote),
+						waited_secs),
+				 errdetail("Querying the node for what it waits for failed with: %s",
+						   PQerrorMessage(peer->monitor_conn))));
+		PQclear(res);
+		return;
+	}
+
+	if (PQntuples(res) == 0)
+		ereport(LOG,
+				(errmsg("still waiting for replication slot creation on node " pgactive_NODEID_FORMAT_WITHNAME " after %ld seconds",
+						pgactive_NODEID_FORMAT_WITHNAME_ARGS(peer->remote),
+						waited_secs),
+				 errdetail("No transaction is blocking it, the node has yet to log a snapshot of its running transactions.")));
+
+	for (i = 0; i < PQntuples(res); i++)
+		ereport(LOG,
+				(errmsg("replication slot creation on node " pgactive_NODEID_FORMAT_WITHNAME " waits for transaction %s of backend %s after %ld seconds",
+						pgactive_NODEID_FORMAT_WITHNAME_ARGS(peer->remote),
+						PQgetisnull(res, i, 1) ? "(none)" : PQgetvalue(res, i, 1),
+						PQgetvalue(res, i, 0), waited_secs),
+				 errdetail("Transaction running for %s, state \"%s\", application \"%s\", query: %s",
+						   PQgetvalue(res, i, 2), PQgetvalue(res, i, 3),
+						   PQgetvalue(res, i, 4), PQgetvalue(res, i, 5))));
+
+	PQclear(res);
+}
+
 /*
  * Find all connections other than our own using the copy of
  * pgactive.pgactive_connections that we acquired from the remote server during
@@ -712,7 +2496,14 @@ pgactive_insert_remote_conninfo(PGconn *conn, pgactiveConnectionConfig * myconfi
  *
  * If the slot already exists from a prior attempt we'll leave it
  * alone. It'll be advanced when we start replaying from it anyway,
- * and it's guaranteed to retain more than the WAL we need.
+ * and it's guaranteed to retain more than the WAL we need. That's also the
+ * case when an error made us give up on slot creations still in flight: the
+ * peers finish creating those slots without us recording their local
+ * replication identifiers, so the next attempt finds them there.
+ *
+ * Creating a logical slot waits for all transactions running on the peer
+ * that have an xid assigned to finish, so slots are created on all peers at
+ * once and peers that take long are reported along with what they wait for.
  */
 static void
 pgactive_init_make_other_slots(void)
@@ -720,6 +2511,14 @@ pgactive_init_make_other_slots(void)
 	List	   *configs;
 	ListCell   *lc;
 	MemoryContext old_context;
+	pgactiveInitSlotState state;
+	pgactiveNodeId myid;
+	int			npending = 0;
+	int			i;
+	TimestampTz start_time;
+	TimestampTz last_report;
+
+	pgactive_make_my_nodeid(&myid);
 
 	Assert(!IsTransactionState());
 	StartTransactionCommand();
@@ -728,50 +2527,187 @@ pgactive_init_make_other_slots(void)
 	MemoryContextSwitchTo(old_context);
 	CommitTransactionCommand();
 
-	foreach(lc, configs)
-	{
-		pgactiveConnectionConfig *cfg = lfirst(lc);
-		PGconn	   *conn;
-		NameData	slot_name;
-		pgactiveNodeId remote,
-					myid;
-
-		pgactive_make_my_nodeid(&myid);
+	state.npeers = 0;
+	state.peers = palloc0(sizeof(pgactiveInitSlotPeer) * list_length(configs));
 
-		if (pgactive_nodeid_eq(&cfg->remote_node, &myid))
+	PG_ENSURE_ERROR_CLEANUP(pgactive_init_slots_cleanup,
+							PointerGetDatum(&state));
+	{
+		foreach(lc, configs)
 		{
+			pgactiveConnectionConfig *cfg = lfirst(lc);
+			pgactiveInitSlotPeer *peer;
+			RepOriginId origin_id;
+			char	   *query;
+
 			/* Don't make a slot pointing to ourselves */
-			continue;
-			pgactive_free_connection_config(cfg);
+			if (pgactive_nodeid_eq(&cfg->remote_node, &myid))
+				continue;
+
+			peer = &state.peers[state.npeers++];
+			peer->conn = pgactive_connect(cfg->dsn, "make replication slot",
+										  &peer->remote);
+			peer->dsn = cfg->dsn;
+
+			/* Ensure the slot points to the node the conn info says it should */
+			if (!pgactive_nodeid_eq(&cfg->remote_node, &peer->remote))
+			{
+				ereport(ERROR,
+						(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+						 errmsg("system identification mismatch between connection and slot"),
+						 errdetail("Connection for " pgactive_NODEID_FORMAT_WITHNAME " resulted in slot on node " pgactive_NODEID_FORMAT_WITHNAME " instead of expected node.",
+								   pgactive_NODEID_FORMAT_WITHNAME_ARGS(cfg->remote_node),
+								   pgactive_NODEID_FORMAT_WITHNAME_ARGS(peer->remote))));
+			}
+
+			pgactive_slot_name(&peer->slot_name, &myid, peer->remote.dboid);
+			peer->remote_ident = pgactive_replident_name(&peer->remote, myid.dboid);
+
+			/*
+			 * The local replication identifier is created once the slot
+			 * exists, so if it's there the slot is too.
+			 */
+			StartTransactionCommand();
+			origin_id = replorigin_by_name(peer->remote_ident, true);
+			CommitTransactionCommand();
+
+			if (OidIsValid(origin_id))
+			{
+				elog(DEBUG2, "ensured existence of slot %s on " pgactive_NODEID_FORMAT_WITHNAME,
+					 NameStr(peer->slot_name),
+					 pgactive_NODEID_FORMAT_WITHNAME_ARGS(peer->remote));
+
+				/* No replication for now, just close the connection */
+				PQfinish(peer->conn);
+				peer->conn = NULL;
+				continue;
+			}
+
+			query = pgactive_create_slot_command(&peer->slot_name);
+
+			elog(DEBUG3, "sending replication command: %s", query);
+
+			if (!PQsendQuery(peer->conn, query))
+				ereport(ERROR,
+						(errmsg("could not send replication command \"%s\": %s",
+								query, PQerrorMessage(peer->conn))));
+			pfree(query);
+
+			npending++;
 		}
 
-		conn = pgactive_establish_connection_and_slot(cfg->dsn,
-													  "make replication slot",
-													  &slot_name,
-													  &remote,
-													  NULL,
-													  NULL);
+		if (npending > 0)
+			elog(INFO, "creating replication slots on %d nodes", npending);
 
-		/* Ensure the slot points to the node the conn info says it should */
-		if (!pgactive_nodeid_eq(&cfg->remote_node, &remote))
+		start_time = last_report = GetCurrentTimestamp();
+
+		while (npending > 0)
 		{
-			ereport(ERROR,
-					(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
-					 errmsg("system identification mismatch between connection and slot"),
-					 errdetail("Connection for " pgactive_NODEID_FORMAT_WITHNAME " resulted in slot on node " pgactive_NODEID_FORMAT_WITHNAME " instead of expected node.",
-							   pgactive_NODEID_FORMAT_WITHNAME_ARGS(cfg->remote_node),
-							   pgactive_NODEID_FORMAT_WITHNAME_ARGS(remote))));
-		}
+			WaitEventSet *wes;
+			WaitEvent	event;
+			TimestampTz now;
 
-		/* No replication for now, just close the connection */
-		PQfinish(conn);
+			CHECK_FOR_INTERRUPTS();
+
+			for (i = 0; i < state.npeers; i++)
+			{
+				pgactiveInitSlotPeer *peer = &state.peers[i];
+				PGresult   *res;
+
+				if (peer->conn == NULL)
+					continue;
+
+				if (PQconsumeInput(peer->conn) == 0)
+					ereport(ERROR,
+							(errmsg("could not receive result of replication slot creation on node " pgactive_NODEID_FORMAT_WITHNAME ": %s",
+									pgactive_NODEID_FORMAT_WITHNAME_ARGS(peer->remote),
+									PQerrorMessage(peer->conn))));
+
+				if (PQisBusy(peer->conn))
+					continue;
+
+				res = PQgetResult(peer->conn);
+				if (pgactive_slot_exists_result(res))
+					elog(LOG, "reusing replication slot \"%s\" on node " pgactive_NODEID_FORMAT_WITHNAME " left behind by an earlier attempt",
+						 NameStr(peer->slot_name),
+						 pgactive_NODEID_FORMAT_WITHNAME_ARGS(peer->remote));
+				else if (PQresultStatus(res) != PGRES_TUPLES_OK)
+					ereport(ERROR,
+							(errmsg("could not create replication slot \"%s\" on node " pgactive_NODEID_FORMAT_WITHNAME ": status %s: %s",
+									NameStr(peer->slot_name),
+									pgactive_NODEID_FORMAT_WITHNAME_ARGS(peer->remote),
+									PQresStatus(PQresultStatus(res)),
+									PQresultErrorMessage(res))));
+				PQclear(res);
+				while ((res = PQgetResult(peer->conn)) != NULL)
+					PQclear(res);
+
+				/* We want the new identifier on stable storage immediately */
+				StartTransactionCommand();
+				ForceSyncCommit();
+				pgactive_count_drop_node(replorigin_create(peer->remote_ident));
+				CommitTransactionCommand();
+
+				elog(DEBUG2, "created slot %s on " pgactive_NODEID_FORMAT_WITHNAME,
+					 NameStr(peer->slot_name),
+					 pgactive_NODEID_FORMAT_WITHNAME_ARGS(peer->remote));
+
+				PQfinish(peer->conn);
+				peer->conn = NULL;
+				npending--;
+			}
+
+			if (npending == 0)
+				break;
+
+			now = GetCurrentTimestamp();
+			if (TimestampDifferenceExceeds(last_report, now,
+										   pgactive_INIT_SLOT_REPORT_INTERVAL))
+			{
+				for (i = 0; i < state.npeers; i++)
+				{
+					if (state.peers[i].conn != NULL)
+						pgactive_init_report_slot_blockers(&state.peers[i],
+														   (now - start_time) / USECS_PER_SEC);
+				}
+				last_report = now;
+			}
 
-		elog(DEBUG2, "ensured existence of slot %s on " pgactive_NODEID_FORMAT_WITHNAME,
-			 NameStr(slot_name), pgactive_NODEID_FORMAT_WITHNAME_ARGS(remote));
+#if PG_VERSION_NUM >= 170000
+			wes = CreateWaitEventSet(NULL, npending + 2);
+#else
+			wes = CreateWaitEventSet(CurrentMemoryContext, npending + 2);
+#endif
+			AddWaitEventToSet(wes, WL_LATCH_SET, PGINVALID_SOCKET,
+							  MyLatch, NULL);
+			AddWaitEventToSet(wes, WL_EXIT_ON_PM_DEATH, PGINVALID_SOCKET,
+							  NULL, NULL);
+			for (i = 0; i < state.npeers; i++)
+			{
+				if (state.peers[i].conn != NULL)
+					AddWaitEventToSet(wes, WL_SOCKET_READABLE,
+									  PQsocket(state.peers[i].conn),
+									  NULL, NULL);
+			}
 
-		pgactive_free_connection_config(cfg);
+			(void) WaitEventSetWait(wes, pgactive_INIT_SLOT_REPORT_INTERVAL,
+									&event, 1,
+									pgactive_wait_event(pgactive_WAIT_INIT_CREATE_SLOTS));
+			FreeWaitEventSet(wes);
+			ResetLatch(MyLatch);
+		}
 	}
+	PG_END_ENSURE_ERROR_CLEANUP(pgactive_init_slots_cleanup,
+								PointerGetDatum(&state));
+
+	pgactive_init_slots_cleanup(0, PointerGetDatum(&state));
 
+	for (i = 0; i < state.npeers; i++)
+		pfree(state.peers[i].remote_ident);
+	pfree(state.peers);
+
+	foreach(lc, configs)
+		pgactive_free_connection_config((pgactiveConnectionConfig *) lfirst(lc));
 	list_free(configs);
 }
 
@@ -791,6 +2727,8 @@ pgactive_init_wait_for_slot_creation(void)
 			   *prev = NULL;
 #endif
 	pgactiveNodeId myid;
+	TimestampTz start_time;
+	TimestampTz last_report;
 
 	pgactive_make_my_nodeid(&myid);
 
@@ -843,16 +2781,24 @@ pgactive_init_wait_for_slot_creation(void)
 	 * This works by checking for pgactive_WORKER_WALSENDER in the worker
 	 * array. The reason for checking this way is that the worker structure
 	 * for pgactive_WORKER_WALSENDER is setup from startup_cb which is called
-	 * after the consistent point was reached.
+	 * after the consistent point was reached. The walsender sets our latch
+	 * once it has done so.
 	 */
+	start_time = last_report = GetCurrentTimestamp();
+
 	while (true)
 	{
 		int			found = 0;
 		int			slotoff;
+		StringInfoData missing;
+		TimestampTz now;
+
+		initStringInfo(&missing);
 
 		foreach(lc, configs)
 		{
 			pgactiveConnectionConfig *cfg = lfirst(lc);
+			bool		cfg_found = false;
 
 			if (pgactive_nodeid_eq(&cfg->remote_node, &myid))
 			{
@@ -871,18 +2817,51 @@ pgactive_init_wait_for_slot_creation(void)
 				if (pgactive_nodeid_eq(&cfg->remote_node, &w->data.walsnd.remote_node) &&
 					w->worker_proc &&
 					w->worker_proc->databaseId == MyDatabaseId)
+				{
 					found++;
+					cfg_found = true;
+				}
 			}
 			LWLockRelease(pgactiveWorkerCtl->lock);
+
+			if (!cfg_found)
+				appendStringInfo(&missing, "%s" pgactive_NODEID_FORMAT_WITHNAME,
+								 missing.len > 0 ? ", " : "",
+								 pgactive_NODEID_FORMAT_WITHNAME_ARGS(cfg->remote_node));
 		}
 
 		if (found == list_length(configs))
+		{
+			pfree(missing.data);
 			break;
+		}
 
 		elog(DEBUG2, "found %u of %u expected slots, sleeping",
 			 (uint32) found, (uint32) list_length(configs));
 
-		pg_usleep(100000);
+		now = GetCurrentTimestamp();
+		if (TimestampDifferenceExceeds(last_report, now,
+									   pgactive_INIT_SLOT_REPORT_INTERVAL))
+		{
+			ereport(LOG,
+					(errmsg("still waiting for inbound slots from %d of %d nodes after %ld seconds",
+							list_length(configs) - found, list_length(configs),
+							(long) ((now - start_time) / USECS_PER_SEC)),
+					 errdetail("Waiting for nodes %s.", missing.data)));
+			last_report = now;
+		}
+		pfree(missing.data);
+
+		/*
+		 * The timeout is only a safety net in case a walsender exits before
+		 * we've seen it.
+		 */
+		(void) WaitLatch(MyLatch,
+						 WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
+						 pgactive_INIT_SLOT_REPORT_INTERVAL,
+						 pgactive_wait_event(pgactive_WAIT_INIT_INBOUND_SLOTS));
+		ResetLatch(MyLatch);
+
 		CHECK_FOR_INTERRUPTS();
 	}
 
@@ -898,34 +2877,24 @@ pgactive_init_wait_for_slot_creation(void)
  *
  * Does nothing if the remote peer doesn't support explicit DDL lock requests.
  *
- * ERRORs if the lock attempt fails. Caller should be prepared to retry
- * the attempt or the whole operations containing it.
+ * pgactive_ddl_lock_remote_result ERRORs if the lock attempt failed. Caller
+ * should be prepared to retry the attempt or the whole operations containing
+ * it.
  */
+static const char *const pgactive_ddl_lock_remote_query =
+"DO LANGUAGE plpgsql $$\n"
+"BEGIN\n"
+"	IF EXISTS (SELECT 1 FROM pg_proc WHERE proname = 'pgactive_acquire_global_lock' AND pronamespace = (SELECT oid FROM pg_namespace WHERE nspname = 'pgactive')) THEN\n"
+"		PERFORM pgactive.pgactive_acquire_global_lock('ddl_lock');\n"
+"	END IF;\n"
+"END; $$;\n";
+
 static void
-pgactive_ddl_lock_remote(PGconn *conn, pgactiveLockType mode)
+pgactive_ddl_lock_remote_result(PGresult *res)
 {
-	PGresult   *res;
-
-	/* Currently only supports pgactive_LOCK_DDL mode 'cos I'm lazy */
-	if (mode != pgactive_LOCK_DDL)
-		elog(ERROR, "remote DDL locking only supports mode = 'ddl'");
-
-	res = PQexec(conn,
-				 "DO LANGUAGE plpgsql $$\n"
-				 "BEGIN\n"
-				 "	IF EXISTS (SELECT 1 FROM pg_proc WHERE proname = 'pgactive_acquire_global_lock' AND pronamespace = (SELECT oid FROM pg_namespace WHERE nspname = 'pgactive')) THEN\n"
-				 "		PERFORM pgactive.pgactive_acquire_global_lock('ddl_lock');\n"
-				 "	END IF;\n"
-				 "END; $$;\n");
-
 	if (PQresultStatus(res) != PGRES_COMMAND_OK)
-	{
-		PQclear(res);
 		elog(ERROR, "failed to acquire global DDL lock on remote peer: %s",
-			 PQerrorMessage(conn));
-	}
-
-	PQclear(res);
+			 PQresultErrorMessage(res));
 }
 
 /*
@@ -944,23 +2913,12 @@ static void
 pgactive_nodes_set_remote_status_ready(PGconn *conn)
 {
 	PGresult   *res;
-	char	   *values[3];
+	const char *values[3];
 	char		local_sysid[32],
 				local_timeline[32],
 				local_dboid[32];
 	int			node_seq_id;
-
-	res = PQexec(conn, "BEGIN ISOLATION LEVEL READ COMMITTED;");
-	if (PQresultStatus(res) != PGRES_COMMAND_OK)
-	{
-		PQclear(res);
-		elog(ERROR, "failed to start tx on remote peer: %s", PQerrorMessage(conn));
-	}
-
-	pgactive_ddl_lock_remote(conn, pgactive_LOCK_DDL);
-
-	/* DDL lock renders this somewhat redundant but you can't be too careful */
-	res = PQexec(conn, "LOCK TABLE pgactive.pgactive_nodes IN EXCLUSIVE MODE;");
+	pgactiveRemoteQuery queries[4];
 
 	stringify_my_node_identity(local_sysid, sizeof(local_sysid),
 							   local_timeline, sizeof(local_timeline),
@@ -969,6 +2927,17 @@ pgactive_nodes_set_remote_status_ready(PGconn *conn)
 	values[1] = &local_timeline[0];
 	values[2] = &local_dboid[0];
 
+	/*
+	 * Everything up to the commit goes to the remote in a single pipeline,
+	 * any failure aborts the remote transaction.
+	 */
+	memset(queries, 0, sizeof(queries));
+	queries[0].query = "BEGIN ISOLATION LEVEL READ COMMITTED;";
+	queries[1].query = pgactive_ddl_lock_remote_query;
+
+	/* DDL lock renders this somewhat redundant but you can't be too careful */
+	queries[2].query = "LOCK TABLE pgactive.pgactive_nodes IN EXCLUSIVE MODE;";
+
 	/*
 	 * Update our node status to 'r'eady, and grab the lowest free node
 	 * node_seq_id in the process.
@@ -977,50 +2946,57 @@ pgactive_nodes_set_remote_status_ready(PGconn *conn)
 	 * be replaying new changes from it once we see that status and the ID
 	 * generator is based on timestamps.
 	 */
-	res = PQexecParams(conn,
-					   "UPDATE pgactive.pgactive_nodes\n"
-					   "SET node_status = " pgactive_NODE_STATUS_READY_S ",\n"
-					   "    node_seq_id = coalesce(\n"
-					   "         -- lowest free ID if one has been released (right anti-join)\n"
-					   "         (select min(x)\n"
-					   "          from\n"
-					   "            (select * from pgactive.pgactive_nodes where node_status not in (" pgactive_NODE_STATUS_KILLED_S ")) n\n"
-					   "            right join generate_series(1, (select max(n2.node_seq_id) from pgactive.pgactive_nodes n2)) s(x)\n"
-					   "              on (n.node_seq_id = x)\n"
-					   "            where n.node_seq_id is null),\n"
-					   "         -- otherwise next-greatest ID\n"
-					   "         (select coalesce(max(node_seq_id),0) + 1 from pgactive.pgactive_nodes where node_status not in (" pgactive_NODE_STATUS_KILLED_S ")))\n"
-					   "WHERE (node_sysid, node_timeline, node_dboid) = ($1, $2, $3)\n"
-					   "RETURNING node_seq_id\n",
-					   3, NULL, (const char **) values, NULL, NULL, 0);
+	queries[3].query =
+		"UPDATE pgactive.pgactive_nodes\n"
+		"SET node_status = " pgactive_NODE_STATUS_READY_S ",\n"
+		"    node_seq_id = coalesce(\n"
+		"         -- lowest free ID if one has been released (right anti-join)\n"
+		"         (select min(x)\n"
+		"          from\n"
+		"            (select * from pgactive.pgactive_nodes where node_status not in (" pgactive_NODE_STATUS_KILLED_S ")) n\n"
+		"            right join generate_series(1, (select max(n2.node_seq_id) from pgactive.pgactive_nodes n2)) s(x)\n"
+		"              on (n.node_seq_id = x)\n"
+		"            where n.node_seq_id is null),\n"
+		"         -- otherwise next-greatest ID\n"
+		"         (select coalesce(max(node_seq_id),0) + 1 from pgactive.pgactive_nodes where node_status not in (" pgactive_NODE_STATUS_KILLED_S ")))\n"
+		"WHERE (node_sysid, node_timeline, node_dboid) = ($1, $2, $3)\n"
+		"RETURNING node_seq_id\n";
+	queries[3].nparams = 3;
+	queries[3].params = values;
+
+	pgactive_exec_pipeline(conn, queries, lengthof(queries));
+
+	if (PQresultStatus(queries[0].res) != PGRES_COMMAND_OK)
+		elog(ERROR, "failed to start tx on remote peer: %s",
+			 PQresultErrorMessage(queries[0].res));
+
+	pgactive_ddl_lock_remote_result(queries[1].res);
 
+	if (PQresultStatus(queries[2].res) != PGRES_COMMAND_OK)
+		elog(ERROR, "failed to lock pgactive.pgactive_nodes on remote peer: %s",
+			 PQresultErrorMessage(queries[2].res));
+
+	res = queries[3].res;
 	if (PQresultStatus(res) != PGRES_TUPLES_OK)
-	{
-		PQclear(res);
 		elog(ERROR, "failed to update my pgactive.pgactive_nodes entry on remote server: %s",
-			 PQerrorMessage(conn));
-	}
+			 PQresultErrorMessage(res));
 
 	if (PQntuples(res) != 1)
-	{
-		PQclear(res);
 		elog(ERROR, "failed to update my pgactive.pgactive_nodes entry on remote server: affected %d rows instead of expected 1",
 			 PQntuples(res));
-	}
 
 	Assert(PQnfields(res) == 1);
 
 	if (PQgetisnull(res, 0, 0))
-	{
-		PQclear(res);
 		elog(ERROR, "assigned node sequence ID is unexpectedly null");
-	}
 
 	node_seq_id = atoi(PQgetvalue(res, 0, 0));
 
 	elog(DEBUG1, "pgactive node finishing join assigned global seq id %d",
 		 node_seq_id);
 
+	pgactive_clear_pipeline(queries, lengthof(queries));
+
 	res = PQexec(conn, "COMMIT;");
 	if (PQresultStatus(res) != PGRES_COMMAND_OK)
 	{
@@ -1045,7 +3021,8 @@ pgactive_wait_for_local_node_ready(void)
 	{
 		(void) pgactiveWaitLatch(&MyProc->procLatch,
 								 WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
-								 1000L, PG_WAIT_EXTENSION);
+								 1000L,
+								 pgactive_wait_event(pgactive_WAIT_INIT_NODE_READY));
 		ResetLatch(&MyProc->procLatch);
 		CHECK_FOR_INTERRUPTS();
 
@@ -1073,15 +3050,8 @@ pgactive_wait_for_local_node_ready(void)
  * introduced, at which point WAL messages should handle this. See comments on
  * call site.
  */
-static void
-perform_pointless_transaction(PGconn *conn, pgactiveNodeInfo * node)
-{
-	PGresult   *res;
-
-	res = PQexec(conn, "CREATE TEMP TABLE pgactive_init(a int) ON COMMIT DROP");
-	Assert(PQresultStatus(res) == PGRES_COMMAND_OK);
-	PQclear(res);
-}
+static const char *const perform_pointless_transaction_query =
+"CREATE TEMP TABLE pgactive_init(a int) ON COMMIT DROP";
 
 /*
  * Set a standalone node, i.e one that's not initializing from another peer, to
@@ -1102,6 +3072,77 @@ pgactive_init_standalone_node(pgactiveNodeInfo * local_node)
 	CommitTransactionCommand();
 }
 
+/*
+ * Can a join that failed while copying initial data continue where it
+ * stopped? That's the case once its schema has been restored with the copy
+ * data sync method.
+ */
+static bool
+pgactive_init_can_resume(void)
+{
+	bool		found;
+	int			ret;
+
+	StartTransactionCommand();
+	SPI_connect();
+	PushActiveSnapshot(GetTransactionSnapshot());
+
+	ret = SPI_execute("SELECT 1 FROM pgactive.pgactive_init_progress "
+					  "WHERE step = 'schema'", true, 1);
+	if (ret != SPI_OK_SELECT)
+		elog(ERROR, "SPI error while querying pgactive.pgactive_init_progress");
+
+	found = (SPI_processed > 0);
+
+	PopActiveSnapshot();
+	SPI_finish();
+	CommitTransactionCommand();
+
+	return found;
+}
+
+/*
+ * Export a snapshot from the remote node to resume a failed join with. The
+ * transaction stays open until pgactive_init_release_snapshot.
+ */
+static void
+pgactive_init_export_snapshot(PGconn *conn, char *snapshot)
+{
+	PGresult   *res;
+
+	res = PQexec(conn, "BEGIN ISOLATION LEVEL REPEATABLE READ, READ ONLY");
+	if (PQresultStatus(res) != PGRES_COMMAND_OK)
+		ereport(ERROR,
+				(errmsg("could not start transaction on remote node"),
+				 errdetail("Querying remote failed with: %s",
+						   PQerrorMessage(conn))));
+	PQclear(res);
+
+	res = PQexec(conn, "SELECT pg_catalog.pg_export_snapshot()");
+	if (PQresultStatus(res) != PGRES_TUPLES_OK || PQntuples(res) != 1)
+		ereport(ERROR,
+				(errmsg("could not export snapshot on remote node"),
+				 errdetail("Querying remote failed with: %s",
+						   PQerrorMessage(conn))));
+
+	strlcpy(snapshot, PQgetvalue(res, 0, 0), NAMEDATALEN);
+	PQclear(res);
+}
+
+static void
+pgactive_init_release_snapshot(PGconn *conn)
+{
+	PGresult   *res;
+
+	res = PQexec(conn, "COMMIT");
+	if (PQresultStatus(res) != PGRES_COMMAND_OK)
+		ereport(ERROR,
+				(errmsg("could not commit transaction on remote node"),
+				 errdetail("Querying remote failed with: %s",
+						   PQerrorMessage(conn))));
+	PQclear(res);
+}
+
 /*
  * Initialize the database, from a remote node if necessary.
  */
@@ -1111,6 +3152,7 @@ pgactive_init_replica(pgactiveNodeInfo * local_node)
 	pgactiveNodeStatus status;
 	PGconn	   *nonrepl_init_conn;
 	pgactiveConnectionConfig *local_conn_config;
+	bool		resume = false;
 
 	status = local_node->status;
 
@@ -1208,8 +3250,24 @@ pgactive_init_replica(pgactiveNodeInfo * local_node)
 			case pgactive_NODE_STATUS_COPYING_INITIAL_DATA:
 
 				/*
-				 * A previous init attempt seems to have failed. Clean up,
-				 * then fall through to start setup again.
+				 * A previous init attempt seems to have failed. If it copied
+				 * data with pgactive.init_node_data_sync_method = copy and
+				 * got as far as restoring the schema, the tables it didn't
+				 * finish copying can be copied again under a new snapshot.
+				 * The slot it created is reused; replaying from it applies
+				 * everything committed on the remote node since the failed
+				 * attempt's snapshot.
+				 */
+				if (pgactive_init_can_resume())
+				{
+					elog(INFO, "resuming previous init attempt");
+					resume = true;
+					break;
+				}
+
+				/*
+				 * Otherwise there's no way back. Clean up, then fall through
+				 * to start setup again.
 				 *
 				 * We can't just re-use the slot and replication identifier
 				 * that were created last time (if they were), because we have
@@ -1239,30 +3297,37 @@ pgactive_init_replica(pgactiveNodeInfo * local_node)
 				break;
 		}
 
-		if (status == pgactive_NODE_STATUS_BEGINNING_INIT)
+		if (status == pgactive_NODE_STATUS_BEGINNING_INIT || resume)
 		{
 			char		init_snapshot[NAMEDATALEN] = {0};
 			PGconn	   *init_repl_conn = NULL;
 			NameData	slot_name;
 			pgactiveNodeId remote;
 
-			elog(INFO, "initializing node");
+			pgactive_join_progress_set_phase(pgactive_JOIN_PHASE_INITIALIZING);
 
-			status = pgactive_NODE_STATUS_COPYING_INITIAL_DATA;
-			pgactive_nodes_set_local_status(status, pgactive_NODE_STATUS_BEGINNING_INIT);
+			if (!resume)
+			{
+				elog(INFO, "initializing node");
 
-			/*
-			 * Force the node to read-only while we initialize. This is
-			 * persistent, so it'll stay read only through restarts and
-			 * retries until we finish init.
-			 */
-			StartTransactionCommand();
-			pgactive_set_node_read_only_guts(local_node->name, true, true);
-			CommitTransactionCommand();
+				status = pgactive_NODE_STATUS_COPYING_INITIAL_DATA;
+				pgactive_nodes_set_local_status(status, pgactive_NODE_STATUS_BEGINNING_INIT);
+
+				/*
+				 * Force the node to read-only while we initialize. This is
+				 * persistent, so it'll stay read only through restarts and
+				 * retries until we finish init.
+				 */
+				StartTransactionCommand();
+				pgactive_set_node_read_only_guts(local_node->name, true, true);
+				CommitTransactionCommand();
+			}
 
 			/*
 			 * Now establish our slot on the target node, so we can replay
-			 * changes from that node. It'll be used in catchup mode.
+			 * changes from that node. It'll be used in catchup mode. When
+			 * resuming the slot exists already and we export a snapshot of
+			 * our own to copy the remaining data with.
 			 */
 			init_repl_conn =
 				pgactive_establish_connection_and_slot(local_node->init_from_dsn,
@@ -1270,7 +3335,10 @@ pgactive_init_replica(pgactiveNodeInfo * local_node)
 													   &slot_name,
 													   &remote,
 													   NULL,
-													   init_snapshot);
+													   resume ? NULL : init_snapshot);
+
+			if (resume)
+				pgactive_init_export_snapshot(nonrepl_init_conn, init_snapshot);
 
 			elog(INFO, "connected to target node " pgactive_NODEID_FORMAT_WITHNAME
 				 " with snapshot %s",
@@ -1283,7 +3351,11 @@ pgactive_init_replica(pgactiveNodeInfo * local_node)
 			 * mode slot created earlier.
 			 */
 			pgactive_init_exec_dump_restore(local_node, init_snapshot,
-											&remote, nonrepl_init_conn);
+											&remote, nonrepl_init_conn,
+											resume);
+
+			if (resume)
+				pgactive_init_release_snapshot(nonrepl_init_conn);
 
 			/*
 			 * TODO DYNCONF copy replication identifier state
@@ -1312,6 +3384,7 @@ pgactive_init_replica(pgactiveNodeInfo * local_node)
 			 * from the init node to our node.
 			 */
 			elog(DEBUG1, "syncing pgactive_nodes and pgactive_connections");
+			pgactive_join_progress_set_phase(pgactive_JOIN_PHASE_SYNCING_NODES);
 			pgactive_sync_nodes(nonrepl_init_conn, local_node);
 
 			status = pgactive_NODE_STATUS_CATCHUP;
@@ -1325,6 +3398,7 @@ pgactive_init_replica(pgactiveNodeInfo * local_node)
 		{
 			XLogRecPtr	min_remote_lsn;
 			remote_node_info ri;
+			pgactiveRemoteQuery catchup_queries[3];
 
 			/*
 			 * Launch outbound connections to all other nodes. It doesn't
@@ -1341,6 +3415,7 @@ pgactive_init_replica(pgactiveNodeInfo * local_node)
 			 * from the peers yet so we won't see DDL lock requests or
 			 * replies.
 			 */
+			pgactive_join_progress_set_phase(pgactive_JOIN_PHASE_CREATING_SLOTS);
 			pgactive_init_make_other_slots();
 
 			/*
@@ -1359,14 +3434,15 @@ pgactive_init_replica(pgactiveNodeInfo * local_node)
 			 * do that right now is a DDL lock.
 			 */
 			elog(DEBUG3, "forcing all peers to flush pending transactions");
-			pgactive_ddl_lock_remote(nonrepl_init_conn, pgactive_LOCK_DDL);
+			memset(catchup_queries, 0, sizeof(catchup_queries));
+			catchup_queries[0].query = pgactive_ddl_lock_remote_query;
 
 			/*
 			 * Enter catchup mode and wait until we've replayed up to the LSN
 			 * the remote was at when we started catchup.
 			 */
 			elog(DEBUG3, "getting LSN to replay to in catchup mode");
-			min_remote_lsn = pgactive_get_remote_lsn(nonrepl_init_conn);
+			catchup_queries[1].query = pgactive_get_remote_lsn_query;
 
 			/*
 			 * Catchup cannot complete if there isn't at least one remote
@@ -1382,7 +3458,15 @@ pgactive_init_replica(pgactiveNodeInfo * local_node)
 			 * should take care of this.
 			 */
 			elog(DEBUG3, "forcing a new transaction on the target node");
-			perform_pointless_transaction(nonrepl_init_conn, local_node);
+			catchup_queries[2].query = perform_pointless_transaction_query;
+
+			/* All of the above takes a single round trip */
+			pgactive_exec_pipeline(nonrepl_init_conn, catchup_queries,
+								   lengthof(catchup_queries));
+			pgactive_ddl_lock_remote_result(catchup_queries[0].res);
+			min_remote_lsn = pgactive_get_remote_lsn_result(catchup_queries[1].res);
+			Assert(PQresultStatus(catchup_queries[2].res) == PGRES_COMMAND_OK);
+			pgactive_clear_pipeline(catchup_queries, lengthof(catchup_queries));
 
 			pgactive_get_remote_nodeinfo_internal(nonrepl_init_conn, &ri);
 
@@ -1438,6 +3522,7 @@ pgactive_init_replica(pgactiveNodeInfo * local_node)
 		 * request WAL message, so we need them to exist.
 		 */
 		elog(DEBUG1, "waiting for all inbound slots to be created");
+		pgactive_join_progress_set_phase(pgactive_JOIN_PHASE_CREATING_SLOTS);
 		pgactive_init_wait_for_slot_creation();
 
 		/*
@@ -1478,6 +3563,7 @@ pgactive_init_replica(pgactiveNodeInfo * local_node)
 		pgactive_set_node_read_only_guts(local_node->name, false, true);
 		CommitTransactionCommand();
 
+		pgactive_join_progress_set_phase(pgactive_JOIN_PHASE_DONE);
 		elog(INFO, "finished init_replica, ready to enter normal replication");
 	}
 	PG_END_ENSURE_ERROR_CLEANUP(pgactive_cleanup_conn_close,
@@ -1532,6 +3618,10 @@ pgactive_catchup_to_lsn(remote_node_info * ri, XLogRecPtr target_lsn)
 		 LSN_FORMAT_ARGS(target_lsn));
 
 	Assert(pgactive_worker_type == pgactive_WORKER_PERDB);
+
+	pgactive_join_progress_set_phase(pgactive_JOIN_PHASE_CATCHUP);
+	pgactive_join_progress_catchup(target_lsn, InvalidXLogRecPtr);
+
 	/* Create the shmem entry for the catchup worker */
 	LWLockAcquire(pgactiveWorkerCtl->lock, LW_EXCLUSIVE);
 	worker = pgactive_worker_shmem_alloc(pgactive_WORKER_APPLY, &worker_shmem_idx);
@@ -1593,10 +3683,14 @@ pgactive_catchup_to_lsn(remote_node_info * ri, XLogRecPtr target_lsn)
 		{
 			(void) pgactiveWaitLatch(&MyProc->procLatch,
 									 WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
-									 1000L, PG_WAIT_EXTENSION);
+									 1000L,
+									 pgactive_wait_event(pgactive_WAIT_INIT_WORKER_START));
 			ResetLatch(&MyProc->procLatch);
 			CHECK_FOR_INTERRUPTS();
 
+			pgactive_join_progress_catchup(target_lsn,
+										   catchup_worker->last_applied_lsn);
+
 			/* Is our worker still replaying? */
 			bgw_status = GetBackgroundWorkerPid(bgw_handle, &bgw_pid);
 		}
@@ -154,6 +154,7 @@
 
 #include "pgactive_locks.h"
 #include "pgactive_messaging.h"
+#include "pgactive_probes.h"
 
 #include "fmgr.h"
 #include "funcapi.h"
@@ -464,6 +465,19 @@ pgactive_locks_on_unlock(void)
 	}
 }
 
+/*
+ * Change the lock state of the current database. The caller must hold
+ * pgactive_locks_ctl->lock exclusively.
+ */
+static void
+pgactive_locks_set_state(pgactiveLockState state)
+{
+	TRACE_PGACTIVE_DDL_LOCK_STATE(pgactive_my_locks_database->dboid,
+								  pgactive_my_locks_database->lock_state,
+								  state);
+	pgactive_my_locks_database->lock_state = state;
+}
+
 /*
  * Set up a new lock_state to be applied on commit. No prior pending state may
  * be set.
@@ -655,7 +669,7 @@ pgactive_locks_startup(void)
 			pgactive_my_locks_database->lock_holder = node_id;
 			pgactive_my_locks_database->lockcount++;
 			pgactive_my_locks_database->lock_type = lock_type;
-			pgactive_my_locks_database->lock_state = pgactive_LOCKSTATE_PEER_CONFIRMED;
+			pgactive_locks_set_state(pgactive_LOCKSTATE_PEER_CONFIRMED);
 			/* A remote node might have held the local lock before restart */
 			elog(DEBUG1, "reacquiring local lock held before shutdown");
 		}
@@ -675,7 +689,7 @@ pgactive_locks_startup(void)
 			pgactive_my_locks_database->lock_holder = node_id;
 			pgactive_my_locks_database->lockcount++;
 			pgactive_my_locks_database->lock_type = lock_type;
-			pgactive_my_locks_database->lock_state = pgactive_LOCKSTATE_PEER_CATCHUP;
+			pgactive_locks_set_state(pgactive_LOCKSTATE_PEER_CATCHUP);
 			pgactive_my_locks_database->replay_confirmed = 0;
 			pgactive_my_locks_database->replay_confirmed_lsn = wait_for_lsn;
 
@@ -884,7 +898,7 @@ pgactive_lock_holder_xact_callback(XactEvent event, void *arg)
 		Assert(pgactive_my_locks_database->lock_holder_local_pid == MyProcPid);
 		pgactive_my_locks_database->lock_holder_local_pid = 0;
 		pgactive_my_locks_database->lock_type = pgactive_LOCK_NOLOCK;
-		pgactive_my_locks_database->lock_state = pgactive_LOCKSTATE_NOLOCK;
+		pgactive_locks_set_state(pgactive_LOCKSTATE_NOLOCK);
 		pgactive_my_locks_database->replay_confirmed = 0;
 		pgactive_my_locks_database->replay_confirmed_lsn = InvalidXLogRecPtr;
 		pgactive_my_locks_database->requestor = NULL;
@@ -928,8 +942,7 @@ pgactive_lock_state_xact_callback(XactEvent event, void *arg)
 	if (event == XACT_EVENT_COMMIT && pgactive_lock_state_xact_callback_info.pending)
 	{
 		Assert(LWLockHeldByMe((pgactive_locks_ctl->lock)));
-		pgactive_my_locks_database->lock_state
-			= pgactive_lock_state_xact_callback_info.commit_pending_lock_state;
+		pgactive_locks_set_state(pgactive_lock_state_xact_callback_info.commit_pending_lock_state);
 		pgactive_lock_state_xact_callback_info.pending = false;
 	}
 }
@@ -1150,7 +1163,7 @@ pgactive_acquire_ddl_lock(pgactiveLockType lock_type)
 	Assert(pgactive_my_locks_database->lock_holder_local_pid == MyProcPid);
 	pgactive_my_locks_database->requestor = &MyProc->procLatch;
 	pgactive_my_locks_database->lock_type = lock_type;
-	pgactive_my_locks_database->lock_state = pgactive_LOCKSTATE_ACQUIRE_TALLY_CONFIRMATIONS;
+	pgactive_locks_set_state(pgactive_LOCKSTATE_ACQUIRE_TALLY_CONFIRMATIONS);
 
 	/* lock looks to be free, try to acquire it */
 	pgactive_send_message(&s, false);
@@ -1222,7 +1235,8 @@ pgactive_acquire_ddl_lock(pgactiveLockType lock_type)
 
 		(void) pgactiveWaitLatch(&MyProc->procLatch,
 								 WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
-								 10000L, PG_WAIT_EXTENSION);
+								 10000L,
+								 pgactive_wait_event(pgactive_WAIT_DDL_LOCK_ACQUIRE));
 		ResetLatch(&MyProc->procLatch);
 		CHECK_FOR_INTERRUPTS();
 	}
@@ -1234,7 +1248,7 @@ pgactive_acquire_ddl_lock(pgactiveLockType lock_type)
 	pgactive_my_locks_database->acquire_declined = 0;
 	pgactive_my_locks_database->requestor = NULL;
 	Assert(pgactive_my_locks_database->lock_state == pgactive_LOCKSTATE_ACQUIRE_TALLY_CONFIRMATIONS);
-	pgactive_my_locks_database->lock_state = pgactive_LOCKSTATE_ACQUIRE_ACQUIRED;
+	pgactive_locks_set_state(pgactive_LOCKSTATE_ACQUIRE_ACQUIRED);
 
 	elog(ddl_lock_log_level(DDL_LOCK_TRACE_ACQUIRE_RELEASE),
 		 LOCKTRACE "DDL lock acquired in mode mode %s for " pgactive_NODEID_FORMAT_WITHNAME,
@@ -1312,7 +1326,7 @@ cancel_conflicting_transactions(void)
 
 
 	LWLockAcquire(pgactive_locks_ctl->lock, LW_EXCLUSIVE);
-	pgactive_my_locks_database->lock_state = pgactive_LOCKSTATE_PEER_CANCEL_XACTS;
+	pgactive_locks_set_state(pgactive_LOCKSTATE_PEER_CANCEL_XACTS);
 	LWLockRelease(pgactive_locks_ctl->lock);
 
 	killtime = TimestampTzPlusMilliseconds(GetCurrentTimestamp(),
@@ -1375,7 +1389,8 @@ cancel_conflicting_transactions(void)
 
 			(void) pgactiveWaitLatch(&MyProc->procLatch,
 									 WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
-									 waittime, PG_WAIT_EXTENSION);
+									 waittime,
+									 pgactive_wait_event(pgactive_WAIT_DDL_LOCK_CANCEL_XACTS));
 			ResetLatch(&MyProc->procLatch);
 			CHECK_FOR_INTERRUPTS();
 		}
@@ -1398,7 +1413,11 @@ cancel_conflicting_transactions(void)
 			if (p == 0)
 				conflict++;
 			else
+			{
+				pgstat_report_wait_start(pgactive_wait_event(pgactive_WAIT_DDL_LOCK_CANCEL_XACTS));
 				pg_usleep(1000);
+				pgstat_report_wait_end();
+			}
 
 			elog(ddl_lock_log_level(DDL_LOCK_TRACE_DEBUG),
 				 LOCKTRACE "signalling pid %d to terminate because of global DDL lock acquisition", p);
@@ -1437,7 +1456,7 @@ pgactive_request_replay_confirmation(void)
 
 	pgactive_my_locks_database->replay_confirmed = 0;
 	pgactive_my_locks_database->replay_confirmed_lsn = wait_for_lsn;
-	pgactive_my_locks_database->lock_state = pgactive_LOCKSTATE_PEER_CATCHUP;
+	pgactive_locks_set_state(pgactive_LOCKSTATE_PEER_CATCHUP);
 	LWLockRelease(pgactive_locks_ctl->lock);
 	pfree(s.data);
 }
@@ -2378,7 +2397,9 @@ pgactive_locks_check_dml(void)
 		CHECK_FOR_INTERRUPTS();
 
 		/* Probably can't use latch here easily, since init didn't happen yet. */
+		pgstat_report_wait_start(pgactive_wait_event(pgactive_WAIT_DDL_LOCK_DML_WAIT));
 		pg_usleep(10000L);
+		pgstat_report_wait_end();
 	}
 
 	/*
@@ -2435,7 +2456,8 @@ pgactive_locks_check_dml(void)
 
 			(void) pgactiveWaitLatch(&MyProc->procLatch,
 									 WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
-									 10000L, PG_WAIT_EXTENSION);
+									 10000L,
+									 pgactive_wait_event(pgactive_WAIT_DDL_LOCK_DML_WAIT));
 			ResetLatch(&MyProc->procLatch);
 			CHECK_FOR_INTERRUPTS();
 		}
@@ -2606,3 +2628,57 @@ pgactive_get_global_locks_info(PG_FUNCTION_ARGS)
 	returnTuple = heap_form_tuple(tupleDesc, values, isnull);
 	PG_RETURN_DATUM(HeapTupleGetDatum(returnTuple));
 }
+
+/*
+ * Append the global lock state of all databases to a pgactive_metrics()
+ * document.
+ */
+void
+pgactive_locks_metrics(StringInfo out)
+{
+	pgactiveLocksDBState *states;
+	int			nstates = 0;
+	int			i;
+
+	states = palloc(sizeof(pgactiveLocksDBState) * pgactive_max_databases);
+
+	LWLockAcquire(pgactive_locks_ctl->lock, LW_SHARED);
+	for (i = 0; i < pgactive_max_databases; i++)
+	{
+		if (pgactive_locks_ctl->dbstate[i].in_use)
+			memcpy(&states[nstates++], &pgactive_locks_ctl->dbstate[i],
+				   sizeof(pgactiveLocksDBState));
+	}
+	LWLockRelease(pgactive_locks_ctl->lock);
+
+	pgactive_metrics_family(out, "pgactive_global_lock_count", "gauge",
+							"Global locks held or being acquired in the database.");
+	for (i = 0; i < nstates; i++)
+	{
+		appendStringInfoString(out, "pgactive_global_lock_count{");
+		pgactive_metrics_database_label(out, states[i].dboid);
+		appendStringInfo(out, "} %d\n", states[i].lockcount);
+	}
+
+	pgactive_metrics_family(out, "pgactive_global_lock_state", "gauge",
+							"State and type of the global lock of the database, always 1.");
+	for (i = 0; i < nstates; i++)
+	{
+		appendStringInfoString(out, "pgactive_global_lock_state{");
+		pgactive_metrics_database_label(out, states[i].dboid);
+		appendStringInfo(out, ",state=\"%s\",type=\"%s\"} 1\n",
+						 pgactive_lock_state_to_name(states[i].lock_state),
+						 pgactive_lock_type_to_name(states[i].lock_type));
+	}
+
+	pgactive_metrics_family(out, "pgactive_global_lock_nodes", "gauge",
+							"Peers whose confirmation global locks of the database wait for.");
+	for (i = 0; i < nstates; i++)
+	{
+		appendStringInfoString(out, "pgactive_global_lock_nodes{");
+		pgactive_metrics_database_label(out, states[i].dboid);
+		appendStringInfo(out, "} %d\n", states[i].nnodes);
+	}
+
+	pfree(states);
+}
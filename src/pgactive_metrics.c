@@ -0,0 +1,524 @@
+/* -------------------------------------------------------------------------
+ *
+ * pgactive_metrics.c
+ *		Export of pgactive's shared memory state in Prometheus format
+ *
+ * Copyright (C) 2012-2015, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *		pgactive_metrics.c
+ *
+ * -------------------------------------------------------------------------
+ *
+ * pgactive.pgactive_metrics() returns what pgactive_get_stats(),
+ * pgactive_get_workers_info(), pgactive_get_global_locks_info() and
+ * pgactive_get_local_replication_lag() report, along with the state of
+ * pgactive's replication slots, for all databases at once, as a single
+ * document in the Prometheus text exposition format.
+ *
+ * Each part of shared memory is copied under a single acquisition of the
+ * lock protecting it, and only formatted once the lock has been released, so
+ * a scrape holds each lock for as short as possible and sees each part in a
+ * consistent state. The parts are copied one after the other rather than
+ * under all locks at once, so they may be a few moments apart.
+ */
+#include "postgres.h"
+
+#include "pgactive.h"
+#include "pgactive_internal.h"
+#include "pgactive_locks.h"
+
+#include "fmgr.h"
+#include "miscadmin.h"
+
+#include "access/xlog.h"
+
+#include "commands/dbcommands.h"
+
+#include "replication/slot.h"
+#include "replication/walsender_private.h"
+
+#include "storage/lwlock.h"
+#include "storage/spin.h"
+
+#include "utils/builtins.h"
+#include "utils/timestamp.h"
+
+PG_FUNCTION_INFO_V1(pgactive_metrics);
+
+/* What's copied of a worker's shared memory slot */
+typedef struct pgactiveMetricsWorker
+{
+	pgactiveWorker worker;
+
+	/* walsenders only: database of the slot, and the walsender's positions */
+	Oid			dboid;
+	XLogRecPtr	sent;
+	XLogRecPtr	write;
+	XLogRecPtr	flush;
+	XLogRecPtr	apply;
+}			pgactiveMetricsWorker;
+
+/* What's copied of a replication slot */
+typedef struct pgactiveMetricsSlot
+{
+	NameData	name;
+	NameData	plugin;
+	Oid			dboid;
+	XLogRecPtr	restart_lsn;
+	XLogRecPtr	confirmed_flush;
+}			pgactiveMetricsSlot;
+
+/*
+ * Start a metric family. All samples of a family have to follow its header.
+ */
+void
+pgactive_metrics_family(StringInfo out, const char *name, const char *type,
+						const char *help)
+{
+	appendStringInfo(out, "# HELP %s %s\n# TYPE %s %s\n",
+					 name, help, name, type);
+}
+
+/*
+ * Append a label value, escaped as the exposition format requires.
+ */
+void
+pgactive_metrics_label_value(StringInfo out, const char *value)
+{
+	const char *p;
+
+	appendStringInfoChar(out, '"');
+	for (p = value; *p; p++)
+	{
+		if (*p == '\\' || *p == '"')
+		{
+			appendStringInfoChar(out, '\\');
+			appendStringInfoChar(out, *p);
+		}
+		else if (*p == '\n')
+			appendStringInfoString(out, "\\n");
+		else
+			appendStringInfoChar(out, *p);
+	}
+	appendStringInfoChar(out, '"');
+}
+
+/*
+ * Append the database label of dboid, named if the database still exists.
+ */
+void
+pgactive_metrics_database_label(StringInfo out, Oid dboid)
+{
+	char	   *datname = get_database_name(dboid);
+	char		oidbuf[12];
+
+	if (datname == NULL)
+	{
+		snprintf(oidbuf, sizeof(oidbuf), "%u", dboid);
+		datname = oidbuf;
+	}
+
+	appendStringInfoString(out, "database=");
+	pgactive_metrics_label_value(out, datname);
+}
+
+/* Timestamps are exported as seconds since the Unix epoch */
+static double
+metrics_timestamp(TimestampTz ts)
+{
+	return (double) ts / USECS_PER_SEC +
+		(double) (POSTGRES_EPOCH_JDATE - UNIX_EPOCH_JDATE) * SECS_PER_DAY;
+}
+
+static void
+append_node_labels(StringInfo out, Oid dboid, const pgactiveNodeId * const node)
+{
+	pgactive_metrics_database_label(out, dboid);
+	appendStringInfo(out, ",node_sysid=\"" UINT64_FORMAT "\",node_timeline=\"%u\",node_dboid=\"%u\"",
+					 node->sysid, node->timeline, node->dboid);
+}
+
+/*
+ * Copy the worker slots in use, along with the positions of the walsenders.
+ */
+static pgactiveMetricsWorker *
+snapshot_workers(int *nworkers)
+{
+	pgactiveMetricsWorker *workers;
+	int			n = 0;
+	int			i;
+
+	workers = palloc0(sizeof(pgactiveMetricsWorker) * pgactive_max_workers);
+
+	LWLockAcquire(pgactiveWorkerCtl->lock, LW_SHARED);
+	for (i = 0; i < pgactive_max_workers; i++)
+	{
+		pgactiveWorker *w = &pgactiveWorkerCtl->slots[i];
+		pgactiveMetricsWorker *m = &workers[n];
+
+		if (w->worker_type == pgactive_WORKER_EMPTY_SLOT)
+			continue;
+
+		memcpy(&m->worker, w, sizeof(pgactiveWorker));
+
+		if (w->worker_type == pgactive_WORKER_WALSENDER)
+		{
+			WalSnd	   *walsnd = w->data.walsnd.walsender;
+
+			/* the SQL interface has no walsender to report on */
+			if (walsnd == NULL || w->data.walsnd.slot == NULL)
+				continue;
+
+			m->dboid = w->data.walsnd.slot->data.database;
+
+			SpinLockAcquire(&walsnd->mutex);
+			if (walsnd->pid != w->worker_pid)
+			{
+				SpinLockRelease(&walsnd->mutex);
+				continue;
+			}
+			m->sent = walsnd->sentPtr;
+			m->write = walsnd->write;
+			m->flush = walsnd->flush;
+			m->apply = walsnd->apply;
+			SpinLockRelease(&walsnd->mutex);
+		}
+
+		n++;
+	}
+	LWLockRelease(pgactiveWorkerCtl->lock);
+
+	*nworkers = n;
+	return workers;
+}
+
+static void
+append_worker_metrics(StringInfo out)
+{
+	pgactiveMetricsWorker *workers;
+	XLogRecPtr	local_flush = GetFlushRecPtr();
+	int			nworkers;
+	int			counts[pgactive_WORKER_WALSENDER + 1] = {0};
+	int			i;
+	int			type;
+
+	workers = snapshot_workers(&nworkers);
+
+	for (i = 0; i < nworkers; i++)
+		counts[workers[i].worker.worker_type]++;
+
+	pgactive_metrics_family(out, "pgactive_workers", "gauge",
+							"Number of pgactive workers running, by type.");
+	for (type = pgactive_WORKER_APPLY; type <= pgactive_WORKER_WALSENDER; type++)
+	{
+		appendStringInfoString(out, "pgactive_workers{type=");
+		pgactive_metrics_label_value(out, pgactiveWorkerTypeNames[type]);
+		appendStringInfo(out, "} %d\n", counts[type]);
+	}
+
+	pgactive_metrics_family(out, "pgactive_worker_last_error_timestamp_seconds", "gauge",
+							"Time of the last error of a pgactive worker.");
+	for (i = 0; i < nworkers; i++)
+	{
+		pgactiveWorker *w = &workers[i].worker;
+		Oid			dboid;
+
+		if (w->last_error_info.errcode == PGACTIVE_ERRCODE_NONE)
+			continue;
+
+		if (w->worker_type == pgactive_WORKER_APPLY)
+			dboid = w->data.apply.dboid;
+		else if (w->worker_type == pgactive_WORKER_PERDB)
+			dboid = w->data.perdb.c_dboid;
+		else
+			dboid = workers[i].dboid;
+
+		appendStringInfoString(out, "pgactive_worker_last_error_timestamp_seconds{");
+		pgactive_metrics_database_label(out, dboid);
+		appendStringInfoString(out, ",type=");
+		pgactive_metrics_label_value(out, pgactiveWorkerTypeNames[w->worker_type]);
+		appendStringInfoString(out, ",error=");
+		pgactive_metrics_label_value(out, pgactiveErrorMessages[w->last_error_info.errcode]);
+		appendStringInfo(out, "} %.3f\n",
+						 metrics_timestamp(w->last_error_info.errtime));
+	}
+
+	/* Inbound connections, from the apply workers */
+	pgactive_metrics_family(out, "pgactive_apply_received_lsn", "gauge",
+							"Position in the peer's WAL the apply worker has received up to.");
+	for (i = 0; i < nworkers; i++)
+	{
+		pgactiveApplyWorker *aw = &workers[i].worker.data.apply;
+
+		if (workers[i].worker.worker_type != pgactive_WORKER_APPLY ||
+			aw->last_received_lsn == InvalidXLogRecPtr)
+			continue;
+
+		appendStringInfoString(out, "pgactive_apply_received_lsn{");
+		append_node_labels(out, aw->dboid, &aw->remote_node);
+		appendStringInfo(out, "} " UINT64_FORMAT "\n", aw->last_received_lsn);
+	}
+
+	pgactive_metrics_family(out, "pgactive_apply_applied_lsn", "gauge",
+							"Position in the peer's WAL the apply worker has applied up to.");
+	for (i = 0; i < nworkers; i++)
+	{
+		pgactiveApplyWorker *aw = &workers[i].worker.data.apply;
+
+		if (workers[i].worker.worker_type != pgactive_WORKER_APPLY ||
+			aw->last_applied_lsn == InvalidXLogRecPtr)
+			continue;
+
+		appendStringInfoString(out, "pgactive_apply_applied_lsn{");
+		append_node_labels(out, aw->dboid, &aw->remote_node);
+		appendStringInfo(out, "} " UINT64_FORMAT "\n", aw->last_applied_lsn);
+	}
+
+	pgactive_metrics_family(out, "pgactive_apply_lag_bytes", "gauge",
+							"Bytes of the peer's WAL received but not applied yet.");
+	for (i = 0; i < nworkers; i++)
+	{
+		pgactiveApplyWorker *aw = &workers[i].worker.data.apply;
+
+		if (workers[i].worker.worker_type != pgactive_WORKER_APPLY ||
+			aw->last_received_lsn == InvalidXLogRecPtr ||
+			aw->last_applied_lsn == InvalidXLogRecPtr)
+			continue;
+
+		appendStringInfoString(out, "pgactive_apply_lag_bytes{");
+		append_node_labels(out, aw->dboid, &aw->remote_node);
+		appendStringInfo(out, "} " UINT64_FORMAT "\n",
+						 aw->last_received_lsn > aw->last_applied_lsn ?
+						 aw->last_received_lsn - aw->last_applied_lsn : 0);
+	}
+
+	pgactive_metrics_family(out, "pgactive_apply_last_xact_commit_timestamp_seconds", "gauge",
+							"Commit time on the peer of the last transaction applied.");
+	for (i = 0; i < nworkers; i++)
+	{
+		pgactiveApplyWorker *aw = &workers[i].worker.data.apply;
+
+		if (workers[i].worker.worker_type != pgactive_WORKER_APPLY ||
+			aw->last_applied_xact_committs == 0)
+			continue;
+
+		appendStringInfoString(out, "pgactive_apply_last_xact_commit_timestamp_seconds{");
+		append_node_labels(out, aw->dboid, &aw->remote_node);
+		appendStringInfo(out, "} %.6f\n",
+						 metrics_timestamp(aw->last_applied_xact_committs));
+	}
+
+	pgactive_metrics_family(out, "pgactive_apply_last_xact_applied_timestamp_seconds", "gauge",
+							"Time the last transaction was applied.");
+	for (i = 0; i < nworkers; i++)
+	{
+		pgactiveApplyWorker *aw = &workers[i].worker.data.apply;
+
+		if (workers[i].worker.worker_type != pgactive_WORKER_APPLY ||
+			aw->last_applied_xact_committs == 0)
+			continue;
+
+		appendStringInfoString(out, "pgactive_apply_last_xact_applied_timestamp_seconds{");
+		append_node_labels(out, aw->dboid, &aw->remote_node);
+		appendStringInfo(out, "} %.6f\n",
+						 metrics_timestamp(aw->last_applied_xact_at));
+	}
+
+	/* Outbound connections, from the walsenders */
+	pgactive_metrics_family(out, "pgactive_walsender_lsn", "gauge",
+							"Position the walsender has sent up to, and the peer has reported writing, flushing and applying up to.");
+	for (i = 0; i < nworkers; i++)
+	{
+		pgactiveMetricsWorker *m = &workers[i];
+		static const char *const kinds[] = {"sent", "write", "flush", "apply"};
+		XLogRecPtr	positions[4];
+		int			j;
+
+		if (m->worker.worker_type != pgactive_WORKER_WALSENDER)
+			continue;
+
+		positions[0] = m->sent;
+		positions[1] = m->write;
+		positions[2] = m->flush;
+		positions[3] = m->apply;
+		for (j = 0; j < lengthof(kinds); j++)
+		{
+			appendStringInfoString(out, "pgactive_walsender_lsn{");
+			append_node_labels(out, m->dboid, &m->worker.data.walsnd.remote_node);
+			appendStringInfo(out, ",position=\"%s\"} " UINT64_FORMAT "\n",
+							 kinds[j], positions[j]);
+		}
+	}
+
+	pgactive_metrics_family(out, "pgactive_walsender_lag_bytes", "gauge",
+							"Bytes of local WAL flushed but not applied by the peer yet.");
+	for (i = 0; i < nworkers; i++)
+	{
+		pgactiveMetricsWorker *m = &workers[i];
+
+		if (m->worker.worker_type != pgactive_WORKER_WALSENDER ||
+			m->apply == InvalidXLogRecPtr)
+			continue;
+
+		appendStringInfoString(out, "pgactive_walsender_lag_bytes{");
+		append_node_labels(out, m->dboid, &m->worker.data.walsnd.remote_node);
+		appendStringInfo(out, "} " UINT64_FORMAT "\n",
+						 local_flush > m->apply ? local_flush - m->apply : 0);
+	}
+
+	pgactive_metrics_family(out, "pgactive_walsender_last_xact_commit_timestamp_seconds", "gauge",
+							"Commit time of the last transaction sent to the peer.");
+	for (i = 0; i < nworkers; i++)
+	{
+		pgactiveWalsenderWorker *ws = &workers[i].worker.data.walsnd;
+
+		if (workers[i].worker.worker_type != pgactive_WORKER_WALSENDER ||
+			ws->last_sent_xact_committs == 0)
+			continue;
+
+		appendStringInfoString(out, "pgactive_walsender_last_xact_commit_timestamp_seconds{");
+		append_node_labels(out, workers[i].dboid, &ws->remote_node);
+		appendStringInfo(out, "} %.6f\n",
+						 metrics_timestamp(ws->last_sent_xact_committs));
+	}
+
+	pfree(workers);
+}
+
+/*
+ * Copy the replication slots in use.
+ */
+static pgactiveMetricsSlot *
+snapshot_slots(int *nslots)
+{
+	pgactiveMetricsSlot *slots;
+	int			n = 0;
+	int			i;
+
+	slots = palloc0(sizeof(pgactiveMetricsSlot) * Max(max_replication_slots, 1));
+
+	if (max_replication_slots > 0)
+	{
+		LWLockAcquire(ReplicationSlotControlLock, LW_SHARED);
+		for (i = 0; i < max_replication_slots; i++)
+		{
+			ReplicationSlot *s = &ReplicationSlotCtl->replication_slots[i];
+			pgactiveMetricsSlot *m = &slots[n];
+
+			if (!s->in_use)
+				continue;
+
+			SpinLockAcquire(&s->mutex);
+			m->name = s->data.name;
+			m->plugin = s->data.plugin;
+			m->dboid = s->data.database;
+			m->restart_lsn = s->data.restart_lsn;
+			m->confirmed_flush = s->data.confirmed_flush;
+			SpinLockRelease(&s->mutex);
+
+			n++;
+		}
+		LWLockRelease(ReplicationSlotControlLock);
+	}
+
+	*nslots = n;
+	return slots;
+}
+
+/*
+ * Positions of the slots peers replicate from, and the WAL they hold back.
+ * Slots not named like pgactive's, such as the temporary copies of
+ * pgactive_backlog_summary, are left out.
+ */
+static void
+append_slot_metrics(StringInfo out)
+{
+	pgactiveMetricsSlot *slots;
+	pgactiveNodeId *nodes;
+	bool	   *ours;
+	XLogRecPtr	local_flush = GetFlushRecPtr();
+	int			nslots;
+	int			i;
+
+	slots = snapshot_slots(&nslots);
+
+	nodes = palloc(sizeof(pgactiveNodeId) * Max(nslots, 1));
+	ours = palloc0(sizeof(bool) * Max(nslots, 1));
+	for (i = 0; i < nslots; i++)
+	{
+		NameData	replication_name;
+		Oid			local_dboid;
+
+		ours[i] = strcmp(NameStr(slots[i].plugin), "pgactive") == 0 &&
+			sscanf(NameStr(slots[i].name), pgactive_SLOT_NAME_FORMAT,
+				   &local_dboid, &nodes[i].sysid, &nodes[i].timeline,
+				   &nodes[i].dboid, NameStr(replication_name)) == 4;
+	}
+
+	pgactive_metrics_family(out, "pgactive_slot_lsn", "gauge",
+							"Position the slot of a peer retains WAL from, and the peer has confirmed receiving up to.");
+	for (i = 0; i < nslots; i++)
+	{
+		if (!ours[i])
+			continue;
+
+		if (slots[i].restart_lsn != InvalidXLogRecPtr)
+		{
+			appendStringInfoString(out, "pgactive_slot_lsn{");
+			append_node_labels(out, slots[i].dboid, &nodes[i]);
+			appendStringInfoString(out, ",slot=");
+			pgactive_metrics_label_value(out, NameStr(slots[i].name));
+			appendStringInfo(out, ",position=\"restart\"} " UINT64_FORMAT "\n",
+							 slots[i].restart_lsn);
+		}
+		if (slots[i].confirmed_flush != InvalidXLogRecPtr)
+		{
+			appendStringInfoString(out, "pgactive_slot_lsn{");
+			append_node_labels(out, slots[i].dboid, &nodes[i]);
+			appendStringInfoString(out, ",slot=");
+			pgactive_metrics_label_value(out, NameStr(slots[i].name));
+			appendStringInfo(out, ",position=\"confirmed_flush\"} " UINT64_FORMAT "\n",
+							 slots[i].confirmed_flush);
+		}
+	}
+
+	pgactive_metrics_family(out, "pgactive_slot_retained_bytes", "gauge",
+							"Bytes of local WAL the slot of a peer keeps from being removed.");
+	for (i = 0; i < nslots; i++)
+	{
+		if (!ours[i] || slots[i].restart_lsn == InvalidXLogRecPtr)
+			continue;
+
+		appendStringInfoString(out, "pgactive_slot_retained_bytes{");
+		append_node_labels(out, slots[i].dboid, &nodes[i]);
+		appendStringInfoString(out, ",slot=");
+		pgactive_metrics_label_value(out, NameStr(slots[i].name));
+		appendStringInfo(out, "} " UINT64_FORMAT "\n",
+						 local_flush > slots[i].restart_lsn ?
+						 local_flush - slots[i].restart_lsn : 0);
+	}
+
+	pfree(ours);
+	pfree(nodes);
+	pfree(slots);
+}
+
+/*
+ * Report pgactive's shared memory state in Prometheus text exposition format,
+ * for all databases.
+ */
+Datum
+pgactive_metrics(PG_FUNCTION_ARGS)
+{
+	StringInfoData out;
+
+	initStringInfo(&out);
+
+	append_worker_metrics(&out);
+	append_slot_metrics(&out);
+	pgactive_count_metrics(&out);
+	pgactive_locks_metrics(&out);
+
+	PG_RETURN_TEXT_P(cstring_to_text_with_len(out.data, out.len));
+}
@@ -14,12 +14,20 @@
  */
 #include "postgres.h"
 
+#include <math.h>
+
 #include "fmgr.h"
+#include "funcapi.h"
 #include "miscadmin.h"
 
+#include "catalog/pg_type.h"
+
 #include "replication/slot.h"
 
+#include "utils/array.h"
+#include "utils/builtins.h"
 #include "utils/pg_lsn.h"
+#include "utils/timestamp.h"
 
 #include "storage/proc.h"
 
@@ -28,6 +36,88 @@
 #include "pgactive.h"
 
 PG_FUNCTION_INFO_V1(pgactive_wait_for_slots_confirmed_flush_lsn);
+PG_FUNCTION_INFO_V1(pgactive_get_join_progress);
+PG_FUNCTION_INFO_V1(pgactive_get_apply_timing);
+PG_FUNCTION_INFO_V1(pgactive_apply_timing_reset);
+PG_FUNCTION_INFO_V1(pgactive_get_apply_progress);
+PG_FUNCTION_INFO_V1(pgactive_get_walsender_stats);
+
+const char *const pgactiveJoinPhaseNames[] = {
+	[pgactive_JOIN_PHASE_NONE] = "none",
+	[pgactive_JOIN_PHASE_INITIALIZING] = "initializing",
+	[pgactive_JOIN_PHASE_DUMPING] = "dumping",
+	[pgactive_JOIN_PHASE_RESTORING_SCHEMA] = "restoring schema",
+	[pgactive_JOIN_PHASE_COPYING_DATA] = "copying data",
+	[pgactive_JOIN_PHASE_RESTORING] = "restoring",
+	[pgactive_JOIN_PHASE_BUILDING_INDEXES] = "building indexes",
+	[pgactive_JOIN_PHASE_SYNCING_NODES] = "syncing nodes",
+	[pgactive_JOIN_PHASE_CATCHUP] = "catchup",
+	[pgactive_JOIN_PHASE_CREATING_SLOTS] = "creating slots",
+	[pgactive_JOIN_PHASE_DONE] = "done",
+};
+
+const char *const pgactiveApplyPhaseNames[] = {
+	[pgactive_APPLY_PHASE_NETWORK_WAIT] = "network wait",
+	[pgactive_APPLY_PHASE_DECODE] = "decode",
+	[pgactive_APPLY_PHASE_LOOKUP] = "lookup",
+	[pgactive_APPLY_PHASE_HEAP_WRITE] = "heap write",
+	[pgactive_APPLY_PHASE_INDEX_UPDATE] = "index update",
+	[pgactive_APPLY_PHASE_CONFLICT] = "conflict",
+	[pgactive_APPLY_PHASE_DDL] = "ddl",
+	[pgactive_APPLY_PHASE_COMMIT] = "commit",
+};
+
+#if PG_VERSION_NUM >= 170000
+static const char *const pgactiveWaitEventNames[] = {
+	[pgactive_WAIT_APPLY_NETWORK_READ] = "PgactiveApplyNetworkRead",
+	[pgactive_WAIT_APPLY_DELAY] = "PgactiveApplyDelay",
+	[pgactive_WAIT_APPLY_PAUSED] = "PgactiveApplyPaused",
+	[pgactive_WAIT_APPLY_WORKER_EXIT] = "PgactiveApplyWorkerExit",
+	[pgactive_WAIT_DDL_LOCK_ACQUIRE] = "PgactiveDdlLockAcquire",
+	[pgactive_WAIT_DDL_LOCK_CANCEL_XACTS] = "PgactiveDdlLockCancelXacts",
+	[pgactive_WAIT_DDL_LOCK_DML_WAIT] = "PgactiveDdlLockDmlWait",
+	[pgactive_WAIT_SLOT_FLUSH] = "PgactiveSlotFlushWait",
+	[pgactive_WAIT_SUPERVISOR_MAIN] = "PgactiveSupervisorMain",
+	[pgactive_WAIT_SUPERVISOR_PERDB_START] = "PgactiveSupervisorPerdbStart",
+	[pgactive_WAIT_PERDB_MAIN] = "PgactivePerdbMain",
+	[pgactive_WAIT_PERDB_CONNECT_RETRY] = "PgactivePerdbConnectRetry",
+	[pgactive_WAIT_INIT_CHILD_PROCESS] = "PgactiveInitChildProcess",
+	[pgactive_WAIT_INIT_COPY_DATA] = "PgactiveInitCopyData",
+	[pgactive_WAIT_INIT_CREATE_SLOTS] = "PgactiveInitCreateSlots",
+	[pgactive_WAIT_INIT_INBOUND_SLOTS] = "PgactiveInitInboundSlots",
+	[pgactive_WAIT_INIT_NODE_READY] = "PgactiveInitNodeReady",
+	[pgactive_WAIT_INIT_WORKER_START] = "PgactiveInitWorkerStart",
+	[pgactive_WAIT_COMPARE_REMOTE] = "PgactiveCompareRemote",
+};
+
+StaticAssertDecl(lengthof(pgactiveWaitEventNames) == pgactive_WAIT_EVENT_COUNT,
+				 "pgactiveWaitEventNames out of sync with pgactiveWaitEvent");
+#endif
+
+/*
+ * Get the wait event to report while waiting at the given place.
+ *
+ * From PostgreSQL 17 extensions can name their wait events. The first time
+ * a process waits at a place its event is looked up, or registered if no
+ * process has done so yet, and the id is cached for later waits. Older
+ * versions only have the generic "Extension" event.
+ */
+uint32
+pgactive_wait_event(pgactiveWaitEvent event)
+{
+#if PG_VERSION_NUM >= 170000
+	static uint32 wait_event_ids[pgactive_WAIT_EVENT_COUNT];
+
+	Assert(event >= 0 && event < pgactive_WAIT_EVENT_COUNT);
+
+	if (wait_event_ids[event] == 0)
+		wait_event_ids[event] = WaitEventExtensionNew(pgactiveWaitEventNames[event]);
+
+	return wait_event_ids[event];
+#else
+	return PG_WAIT_EXTENSION;
+#endif
+}
 
 /*
  * Wait for the confirmed_flush_lsn of the specified slot, or all logical slots
@@ -95,10 +185,487 @@ pgactive_wait_for_slots_confirmed_flush_lsn(PG_FUNCTION_ARGS)
 
 		(void) pgactiveWaitLatch(&MyProc->procLatch,
 								 WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
-								 1000L, PG_WAIT_EXTENSION);
+								 1000L,
+								 pgactive_wait_event(pgactive_WAIT_SLOT_FLUSH));
 		ResetLatch(&MyProc->procLatch);
 		CHECK_FOR_INTERRUPTS();
 	} while (1);
 
 	PG_RETURN_VOID();
 }
+
+/*
+ * Extrapolate when the current phase of a join will be done from how much
+ * of its work got done since it started.
+ */
+static TimestampTz
+join_progress_estimate(pgactiveJoinProgress * progress, TimestampTz now)
+{
+	double		done;
+	double		left;
+	long		secs;
+	int			usecs;
+	double		elapsed;
+
+	if (progress->phase == pgactive_JOIN_PHASE_CATCHUP)
+	{
+		if (progress->catchup_start_lsn == InvalidXLogRecPtr ||
+			progress->catchup_lsn <= progress->catchup_start_lsn)
+			return 0;
+		done = progress->catchup_lsn - progress->catchup_start_lsn;
+		left = progress->catchup_target_lsn > progress->catchup_lsn ?
+			progress->catchup_target_lsn - progress->catchup_lsn : 0;
+	}
+	else if (progress->bytes_total > 0 && progress->bytes_done > 0)
+	{
+		done = progress->bytes_done;
+		left = Max(progress->bytes_total - progress->bytes_done, 0);
+	}
+	else if (progress->tables_total > 0 && progress->tables_done > 0)
+	{
+		done = progress->tables_done;
+		left = Max(progress->tables_total - progress->tables_done, 0);
+	}
+	else
+		return 0;
+
+	TimestampDifference(progress->phase_start, now, &secs, &usecs);
+	elapsed = secs * (double) USECS_PER_SEC + usecs;
+
+	return now + (TimestampTz) (elapsed * left / done);
+}
+
+/*
+ * Report the progress of the logical joins of all databases, as the per-db
+ * workers running them record it in shared memory. The last join of a
+ * database stays around with phase "done" as long as its per-db worker.
+ */
+Datum
+pgactive_get_join_progress(PG_FUNCTION_ARGS)
+{
+#define pgactive_JOIN_PROGRESS_COLS	16
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	TimestampTz now = GetCurrentTimestamp();
+	int			i;
+
+	InitMaterializedSRF(fcinfo, 0);
+
+	LWLockAcquire(pgactiveWorkerCtl->lock, LW_SHARED);
+	for (i = 0; i < pgactive_max_workers; i++)
+	{
+		pgactiveWorker *w = &pgactiveWorkerCtl->slots[i];
+		pgactiveJoinProgress progress;
+		Datum		values[pgactive_JOIN_PROGRESS_COLS] = {0};
+		bool		nulls[pgactive_JOIN_PROGRESS_COLS] = {0};
+		TimestampTz estimate;
+
+		if (w->worker_type != pgactive_WORKER_PERDB)
+			continue;
+
+		SpinLockAcquire(&w->data.perdb.join_progress.mutex);
+		memcpy(&progress, &w->data.perdb.join_progress, sizeof(progress));
+		SpinLockRelease(&w->data.perdb.join_progress.mutex);
+
+		if (progress.phase == pgactive_JOIN_PHASE_NONE)
+			continue;
+
+		values[0] = ObjectIdGetDatum(w->data.perdb.c_dboid);
+		if (w->worker_pid != 0)
+			values[1] = Int32GetDatum(w->worker_pid);
+		else
+			nulls[1] = true;
+		values[2] = CStringGetTextDatum(pgactiveJoinPhaseNames[progress.phase]);
+		values[3] = TimestampTzGetDatum(progress.join_start);
+		values[4] = TimestampTzGetDatum(progress.phase_start);
+
+		if (progress.tables_total >= 0)
+			values[5] = Int32GetDatum(progress.tables_total);
+		else
+			nulls[5] = true;
+		if (progress.tables_done >= 0)
+			values[6] = Int32GetDatum(progress.tables_done);
+		else
+			nulls[6] = true;
+		if (progress.bytes_total >= 0)
+			values[7] = Int64GetDatum(progress.bytes_total);
+		else
+			nulls[7] = true;
+		if (progress.bytes_done >= 0)
+			values[8] = Int64GetDatum(progress.bytes_done);
+		else
+			nulls[8] = true;
+		if (progress.current_table[0] != '\0')
+			values[9] = CStringGetTextDatum(progress.current_table);
+		else
+			nulls[9] = true;
+		if (progress.jobs_total >= 0)
+			values[10] = Int32GetDatum(progress.jobs_total);
+		else
+			nulls[10] = true;
+		if (progress.jobs_busy >= 0)
+			values[11] = Int32GetDatum(progress.jobs_busy);
+		else
+			nulls[11] = true;
+
+		if (progress.catchup_target_lsn != InvalidXLogRecPtr)
+			values[12] = LSNGetDatum(progress.catchup_target_lsn);
+		else
+			nulls[12] = true;
+		if (progress.catchup_lsn != InvalidXLogRecPtr)
+			values[13] = LSNGetDatum(progress.catchup_lsn);
+		else
+			nulls[13] = true;
+		if (progress.catchup_target_lsn != InvalidXLogRecPtr &&
+			progress.catchup_lsn != InvalidXLogRecPtr)
+			values[14] = Int64GetDatum(progress.catchup_target_lsn > progress.catchup_lsn ?
+									   progress.catchup_target_lsn - progress.catchup_lsn : 0);
+		else
+			nulls[14] = true;
+
+		estimate = join_progress_estimate(&progress, now);
+		if (progress.phase != pgactive_JOIN_PHASE_DONE && estimate != 0)
+			values[15] = TimestampTzGetDatum(estimate);
+		else
+			nulls[15] = true;
+
+		tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc,
+							 values, nulls);
+	}
+	LWLockRelease(pgactiveWorkerCtl->lock);
+
+	PG_RETURN_VOID();
+#undef pgactive_JOIN_PROGRESS_COLS
+}
+
+/*
+ * Estimate a percentile of the time spent in a phase of apply from its
+ * histogram, as the upper bound in milliseconds of the bucket it falls into.
+ */
+static double
+apply_timing_percentile(pgactiveApplyPhaseTiming *timing, double fraction)
+{
+	int64		target = (int64) ceil(timing->count * fraction);
+	int64		seen = 0;
+	int			i;
+
+	for (i = 0; i < pgactive_APPLY_TIMING_BUCKETS; i++)
+	{
+		seen += timing->buckets[i];
+		if (seen >= target)
+			break;
+	}
+	i = Min(i, pgactive_APPLY_TIMING_BUCKETS - 1);
+
+	return (double) (INT64CONST(2) << i) / 1000.0;
+}
+
+/*
+ * Report the time the apply workers spent in each phase of applying changes,
+ * as collected with pgactive.track_apply_timing on. One row is returned for
+ * each apply worker and phase.
+ */
+Datum
+pgactive_get_apply_timing(PG_FUNCTION_ARGS)
+{
+#define pgactive_APPLY_TIMING_COLS	14
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	int			i;
+
+	InitMaterializedSRF(fcinfo, 0);
+
+	LWLockAcquire(pgactiveWorkerCtl->lock, LW_SHARED);
+	for (i = 0; i < pgactive_max_workers; i++)
+	{
+		pgactiveWorker *w = &pgactiveWorkerCtl->slots[i];
+		pgactiveApplyWorker *aw = &w->data.apply;
+		pgactiveApplyTiming timing;
+		char		sysid_str[33];
+		int			phase;
+
+		if (w->worker_type != pgactive_WORKER_APPLY)
+			continue;
+
+		SpinLockAcquire(&aw->timing.mutex);
+		memcpy(&timing, &aw->timing, sizeof(timing));
+		SpinLockRelease(&aw->timing.mutex);
+
+		snprintf(sysid_str, sizeof(sysid_str), UINT64_FORMAT,
+				 aw->remote_node.sysid);
+
+		for (phase = 0; phase < pgactive_APPLY_PHASE_COUNT; phase++)
+		{
+			pgactiveApplyPhaseTiming *t = &timing.phases[phase];
+			Datum		values[pgactive_APPLY_TIMING_COLS] = {0};
+			bool		nulls[pgactive_APPLY_TIMING_COLS] = {0};
+			Datum		buckets[pgactive_APPLY_TIMING_BUCKETS];
+			int			j;
+
+			values[0] = CStringGetTextDatum(sysid_str);
+			values[1] = ObjectIdGetDatum(aw->remote_node.timeline);
+			values[2] = ObjectIdGetDatum(aw->remote_node.dboid);
+			values[3] = ObjectIdGetDatum(aw->dboid);
+			if (w->worker_pid != 0)
+				values[4] = Int32GetDatum(w->worker_pid);
+			else
+				nulls[4] = true;
+			values[5] = CStringGetTextDatum(pgactiveApplyPhaseNames[phase]);
+			values[6] = Int64GetDatum(t->count);
+			values[7] = Float8GetDatum(t->total_us / 1000.0);
+
+			if (t->count > 0)
+			{
+				values[8] = Float8GetDatum(t->total_us / 1000.0 / t->count);
+				values[9] = Float8GetDatum(apply_timing_percentile(t, 0.50));
+				values[10] = Float8GetDatum(apply_timing_percentile(t, 0.95));
+				values[11] = Float8GetDatum(apply_timing_percentile(t, 0.99));
+			}
+			else
+			{
+				nulls[8] = true;
+				nulls[9] = true;
+				nulls[10] = true;
+				nulls[11] = true;
+			}
+
+			for (j = 0; j < pgactive_APPLY_TIMING_BUCKETS; j++)
+				buckets[j] = Int64GetDatum(t->buckets[j]);
+			values[12] = PointerGetDatum(construct_array(buckets,
+														 pgactive_APPLY_TIMING_BUCKETS,
+														 INT8OID, sizeof(int64),
+														 FLOAT8PASSBYVAL,
+														 TYPALIGN_DOUBLE));
+
+			if (timing.reset_at != 0)
+				values[13] = TimestampTzGetDatum(timing.reset_at);
+			else
+				nulls[13] = true;
+
+			tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc,
+								 values, nulls);
+		}
+	}
+	LWLockRelease(pgactiveWorkerCtl->lock);
+
+	PG_RETURN_VOID();
+#undef pgactive_APPLY_TIMING_COLS
+}
+
+/*
+ * Discard the apply timing statistics of all apply workers.
+ *
+ * Time a worker has yet to add to shared memory is kept, so the first
+ * statistics after a reset may include a little time spent before it.
+ */
+Datum
+pgactive_apply_timing_reset(PG_FUNCTION_ARGS)
+{
+	TimestampTz now = GetCurrentTimestamp();
+	int			i;
+
+	LWLockAcquire(pgactiveWorkerCtl->lock, LW_SHARED);
+	for (i = 0; i < pgactive_max_workers; i++)
+	{
+		pgactiveWorker *w = &pgactiveWorkerCtl->slots[i];
+		pgactiveApplyTiming *timing = &w->data.apply.timing;
+
+		if (w->worker_type != pgactive_WORKER_APPLY)
+			continue;
+
+		SpinLockAcquire(&timing->mutex);
+		memset(timing->phases, 0, sizeof(timing->phases));
+		timing->reset_at = now;
+		SpinLockRelease(&timing->mutex);
+	}
+	LWLockRelease(pgactiveWorkerCtl->lock);
+
+	PG_RETURN_VOID();
+}
+
+/*
+ * Report the remote transaction each apply worker is applying, if any. The
+ * total number of changes is the upstream's count of what it decoded for the
+ * transaction, which includes changes that are filtered out before being
+ * sent, so the transaction may finish before reaching it.
+ */
+Datum
+pgactive_get_apply_progress(PG_FUNCTION_ARGS)
+{
+#define pgactive_APPLY_PROGRESS_COLS	17
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	TimestampTz now = GetCurrentTimestamp();
+	int			i;
+
+	InitMaterializedSRF(fcinfo, 0);
+
+	LWLockAcquire(pgactiveWorkerCtl->lock, LW_SHARED);
+	for (i = 0; i < pgactive_max_workers; i++)
+	{
+		pgactiveWorker *w = &pgactiveWorkerCtl->slots[i];
+		pgactiveApplyWorker *aw = &w->data.apply;
+		pgactiveApplyProgress progress;
+		Datum		values[pgactive_APPLY_PROGRESS_COLS] = {0};
+		bool		nulls[pgactive_APPLY_PROGRESS_COLS] = {0};
+		char		sysid_str[33];
+
+		if (w->worker_type != pgactive_WORKER_APPLY)
+			continue;
+
+		SpinLockAcquire(&aw->progress.mutex);
+		memcpy(&progress, &aw->progress, sizeof(progress));
+		SpinLockRelease(&aw->progress.mutex);
+
+		if (!TransactionIdIsValid(progress.xid))
+			continue;
+
+		snprintf(sysid_str, sizeof(sysid_str), UINT64_FORMAT,
+				 aw->remote_node.sysid);
+
+		values[0] = CStringGetTextDatum(sysid_str);
+		values[1] = ObjectIdGetDatum(aw->remote_node.timeline);
+		values[2] = ObjectIdGetDatum(aw->remote_node.dboid);
+		values[3] = ObjectIdGetDatum(aw->dboid);
+		if (w->worker_pid != 0)
+			values[4] = Int32GetDatum(w->worker_pid);
+		else
+			nulls[4] = true;
+		values[5] = TransactionIdGetDatum(progress.xid);
+		values[6] = LSNGetDatum(progress.commit_lsn);
+		values[7] = TimestampTzGetDatum(progress.committs);
+		values[8] = TimestampTzGetDatum(progress.started_at);
+		values[9] = DirectFunctionCall2(timestamp_mi,
+										TimestampTzGetDatum(now),
+										TimestampTzGetDatum(progress.started_at));
+		if (progress.changes_total >= 0)
+			values[10] = Int64GetDatum(progress.changes_total);
+		else
+			nulls[10] = true;
+		values[11] = Int64GetDatum(progress.inserts + progress.updates +
+								   progress.deletes);
+		values[12] = Int64GetDatum(progress.inserts);
+		values[13] = Int64GetDatum(progress.updates);
+		values[14] = Int64GetDatum(progress.deletes);
+		if (OidIsValid(progress.current_relid))
+			values[15] = ObjectIdGetDatum(progress.current_relid);
+		else
+			nulls[15] = true;
+		values[16] = Int64GetDatum(progress.bytes);
+
+		tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc,
+							 values, nulls);
+	}
+	LWLockRelease(pgactiveWorkerCtl->lock);
+
+	PG_RETURN_VOID();
+#undef pgactive_APPLY_PROGRESS_COLS
+}
+
+/* What's copied of a walsender's shared memory slot */
+typedef struct WalsenderStats
+{
+	pgactiveNodeId remote_node;
+	Oid			dboid;
+	NameData	slot_name;
+	pid_t		pid;
+	pgactiveWalsenderStats stats;
+}			WalsenderStats;
+
+/*
+ * Report the decoding statistics of the walsenders streaming to pgactive
+ * peers, along with the reorder buffer's spill and stream statistics of
+ * their slots on PostgreSQL 14 and newer.
+ */
+Datum
+pgactive_get_walsender_stats(PG_FUNCTION_ARGS)
+{
+#define pgactive_WALSENDER_STATS_COLS	23
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	WalsenderStats *walsenders;
+	int			nwalsenders = 0;
+	int			i;
+
+	InitMaterializedSRF(fcinfo, 0);
+
+	walsenders = palloc(sizeof(WalsenderStats) * pgactive_max_workers);
+
+	/* copy, so the slot statistics are looked up without the lock */
+	LWLockAcquire(pgactiveWorkerCtl->lock, LW_SHARED);
+	for (i = 0; i < pgactive_max_workers; i++)
+	{
+		pgactiveWorker *w = &pgactiveWorkerCtl->slots[i];
+		pgactiveWalsenderWorker *ws = &w->data.walsnd;
+		WalsenderStats *out = &walsenders[nwalsenders];
+
+		if (w->worker_type != pgactive_WORKER_WALSENDER || ws->slot == NULL)
+			continue;
+
+		out->remote_node = ws->remote_node;
+		out->dboid = ws->slot->data.database;
+		out->slot_name = ws->slot->data.name;
+		out->pid = w->worker_pid;
+		memcpy(&out->stats, &ws->stats, sizeof(pgactiveWalsenderStats));
+		nwalsenders++;
+	}
+	LWLockRelease(pgactiveWorkerCtl->lock);
+
+	for (i = 0; i < nwalsenders; i++)
+	{
+		WalsenderStats *ws = &walsenders[i];
+		Datum		values[pgactive_WALSENDER_STATS_COLS] = {0};
+		bool		nulls[pgactive_WALSENDER_STATS_COLS] = {0};
+		char		sysid_str[33];
+#if PG_VERSION_NUM >= 140000
+		PgStat_StatReplSlotEntry *slotstats;
+#endif
+		int			j;
+
+		snprintf(sysid_str, sizeof(sysid_str), UINT64_FORMAT,
+				 ws->remote_node.sysid);
+
+		values[0] = CStringGetTextDatum(sysid_str);
+		values[1] = ObjectIdGetDatum(ws->remote_node.timeline);
+		values[2] = ObjectIdGetDatum(ws->remote_node.dboid);
+		values[3] = ObjectIdGetDatum(ws->dboid);
+		values[4] = NameGetDatum(&ws->slot_name);
+		if (ws->pid != 0)
+			values[5] = Int32GetDatum(ws->pid);
+		else
+			nulls[5] = true;
+		values[6] = Int64GetDatum(ws->stats.xacts_sent);
+		values[7] = Int64GetDatum(ws->stats.xacts_filtered);
+		values[8] = Int64GetDatum(ws->stats.changes_decoded);
+		values[9] = Int64GetDatum(ws->stats.changes_filtered_origin);
+		values[10] = Int64GetDatum(ws->stats.changes_filtered_repset);
+		values[11] = Int64GetDatum(ws->stats.changes_sent);
+		values[12] = Int64GetDatum(ws->stats.bytes_sent);
+		values[13] = Int64GetDatum(ws->stats.bytes_binary);
+		values[14] = Int64GetDatum(ws->stats.bytes_sendrecv);
+		values[15] = Int64GetDatum(ws->stats.bytes_text);
+		values[16] = Float8GetDatum(INSTR_TIME_GET_MILLISEC(ws->stats.encode_time));
+
+#if PG_VERSION_NUM >= 140000
+		slotstats = pgstat_fetch_replslot(ws->slot_name);
+		if (slotstats != NULL)
+		{
+			values[17] = Int64GetDatum(slotstats->spill_txns);
+			values[18] = Int64GetDatum(slotstats->spill_count);
+			values[19] = Int64GetDatum(slotstats->spill_bytes);
+			values[20] = Int64GetDatum(slotstats->stream_txns);
+			values[21] = Int64GetDatum(slotstats->stream_count);
+			values[22] = Int64GetDatum(slotstats->stream_bytes);
+		}
+		else
+#endif
+		{
+			for (j = 17; j < pgactive_WALSENDER_STATS_COLS; j++)
+				nulls[j] = true;
+		}
+
+		tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc,
+							 values, nulls);
+	}
+
+	pfree(walsenders);
+
+	PG_RETURN_VOID();
+#undef pgactive_WALSENDER_STATS_COLS
+}
@@ -19,6 +19,7 @@
 
 #include "pgactive.h"
 #include "pgactive_internal.h"
+#include "pgactive_probes.h"
 #include "miscadmin.h"
 
 #include "access/sysattr.h"
@@ -107,6 +108,12 @@ typedef struct
 
 	int			num_replication_sets;
 	char	  **replication_sets;
+
+	/* decoding a slot copied by pgactive_backlog_summary(), send nothing */
+	bool		backlog_summary;
+
+	/* statistics in our walsender's shmem slot, NULL if not a walsender */
+	pgactiveWalsenderStats *stats;
 }			pgactiveOutputData;
 
 static pgactiveWalsenderWorker * pgactive_walsender_worker = NULL;
@@ -133,6 +140,8 @@ static void pg_decode_message(LogicalDecodingContext *ctx,
 
 /* private prototypes */
 static void write_rel(StringInfo out, Relation rel);
+static void write_change(pgactiveOutputData * data, StringInfo out,
+						 Relation relation, ReorderBufferChange *change);
 static void write_tuple(pgactiveOutputData * data, StringInfo out, Relation rel,
 						HeapTuple tuple);
 
@@ -360,6 +369,7 @@ pg_decode_startup(LogicalDecodingContext *ctx, OutputPluginOptions *opt, bool is
 	Oid			schema_oid;
 	bool		tx_started = false;
 	Oid			local_dboid;
+	const char *source_slot;
 
 	data = palloc0(sizeof(pgactiveOutputData));
 	data->context = AllocSetContextCreate(TopMemoryContext,
@@ -378,8 +388,14 @@ pg_decode_startup(LogicalDecodingContext *ctx, OutputPluginOptions *opt, bool is
 	data->pgactive_schema_oid = InvalidOid;
 	data->num_replication_sets = -1;
 
-	/* parse where the connection has to be from */
-	pgactive_parse_slot_name(NameStr(MyReplicationSlot->data.name),
+	/*
+	 * Parse where the connection has to be from. The copy of a slot made for
+	 * a backlog summary is named differently but stands for the same peer.
+	 */
+	source_slot = pgactive_backlog_source_slot(NameStr(MyReplicationSlot->data.name));
+	data->backlog_summary = source_slot != NULL;
+	pgactive_parse_slot_name(source_slot != NULL ? source_slot :
+							 NameStr(MyReplicationSlot->data.name),
 							 &data->remote_node, &local_dboid);
 
 	/* parse options passed in by the client */
@@ -628,6 +644,10 @@ pg_decode_startup(LogicalDecodingContext *ctx, OutputPluginOptions *opt, bool is
 	if (tx_started)
 		CommitTransactionCommand();
 
+	/* a backlog summary isn't streaming to the peer */
+	if (data->backlog_summary)
+		return;
+
 	/*
 	 * Everything looks ok. Acquire a shmem slot to represent us running.
 	 */
@@ -653,7 +673,22 @@ pg_decode_startup(LogicalDecodingContext *ctx, OutputPluginOptions *opt, bool is
 		pgactive_worker_slot->data.walsnd.last_sent_xact_id = InvalidTransactionId;
 		pgactive_worker_slot->data.walsnd.last_sent_xact_committs = 0;
 		pgactive_worker_slot->data.walsnd.last_sent_xact_at = 0;
+		memset(&pgactive_worker_slot->data.walsnd.stats, 0,
+			   sizeof(pgactiveWalsenderStats));
 		pgactive_walsender_worker = &pgactive_worker_slot->data.walsnd;
+		data->stats = &pgactive_walsender_worker->stats;
+
+		/*
+		 * The perdb worker of a node that's joining waits for walsenders of
+		 * its inbound slots to show up, wake it.
+		 */
+		{
+			pgactiveWorker *perdb;
+
+			if (find_perdb_worker_slot(MyDatabaseId, &perdb) >= pgactive_PER_DB_WORKER_SLOT_FOUND &&
+				perdb->data.perdb.proclatch != NULL)
+				SetLatch(perdb->data.perdb.proclatch);
+		}
 
 		LWLockRelease(pgactiveWorkerCtl->lock);
 	}
@@ -749,6 +784,28 @@ should_forward_change(LogicalDecodingContext *ctx, pgactiveOutputData * data,
 	}
 }
 
+/*
+ * Number of changes decoded for a transaction and its subtransactions. This
+ * includes changes that will be filtered out and decoding-internal entries,
+ * so it is an upper bound on what gets sent.
+ */
+static int64
+txn_change_count(ReorderBufferTXN *txn)
+{
+	int64		count = txn->nentries;
+	dlist_iter	iter;
+
+	dlist_foreach(iter, &txn->subtxns)
+	{
+		ReorderBufferTXN *subtxn = dlist_container(ReorderBufferTXN, node,
+												   iter.cur);
+
+		count += subtxn->nentries;
+	}
+
+	return count;
+}
+
 /*
  * BEGIN callback
  *
@@ -763,6 +820,12 @@ pg_decode_begin_txn(LogicalDecodingContext *ctx, ReorderBufferTXN *txn)
 
 	AssertVariableIsOfType(&pg_decode_begin_txn, LogicalDecodeBeginCB);
 
+	if (data->backlog_summary)
+	{
+		pgactive_backlog_begin_txn(txn->xid, txn->origin_id);
+		return;
+	}
+
 	if (!should_forward_changeset(ctx, txn->origin_id))
 		return;
 
@@ -777,6 +840,12 @@ pg_decode_begin_txn(LogicalDecodingContext *ctx, ReorderBufferTXN *txn)
 	if (data->forward_changesets)
 		flags |= pgactive_OUTPUT_TRANSACTION_HAS_ORIGIN;
 
+	/*
+	 * Let the downstream know how big the transaction is, for its progress
+	 * reporting. Receivers that predate the flag ignore the extra field.
+	 */
+	flags |= pgactive_OUTPUT_TRANSACTION_HAS_CHANGE_COUNT;
+
 	/* send the flags field its self */
 	pq_sendint(ctx->out, flags, 4);
 
@@ -808,6 +877,9 @@ pg_decode_begin_txn(LogicalDecodingContext *ctx, ReorderBufferTXN *txn)
 		pq_sendint64(ctx->out, txn->origin_lsn);
 	}
 
+	if (flags & pgactive_OUTPUT_TRANSACTION_HAS_CHANGE_COUNT)
+		pq_sendint64(ctx->out, txn_change_count(txn));
+
 	OutputPluginWrite(ctx, true);
 
 	return;
@@ -830,11 +902,22 @@ void
 pg_decode_commit_txn(LogicalDecodingContext *ctx, ReorderBufferTXN *txn,
 					 XLogRecPtr commit_lsn)
 {
+	pgactiveOutputData *data = ctx->output_plugin_private;
 	int			flags = 0;
 	TimestampTz committime;
 
+	if (data->backlog_summary)
+	{
+		pgactive_backlog_commit_txn(txn->end_lsn, TXN_COMMIT_TIME(txn),
+									should_forward_changeset(ctx, txn->origin_id));
+		return;
+	}
+
 	if (!should_forward_changeset(ctx, txn->origin_id))
+	{
+		data->stats->xacts_filtered++;
 		return;
+	}
 
 	OutputPluginPrepareWrite(ctx, true);
 	pq_sendbyte(ctx->out, 'C'); /* sending COMMIT */
@@ -859,12 +942,33 @@ pg_decode_commit_txn(LogicalDecodingContext *ctx, ReorderBufferTXN *txn,
 
 	committime = TXN_COMMIT_TIME(txn);
 
+	data->stats->xacts_sent++;
+
 	/* Save last sent transaction info */
 	pgactive_walsender_worker->last_sent_xact_id = txn->xid;
 	pgactive_walsender_worker->last_sent_xact_committs = committime;
 	pgactive_walsender_worker->last_sent_xact_at = GetCurrentTimestamp();
 }
 
+/*
+ * Protocol action of a change, for the output plugin's probes.
+ */
+static inline char
+change_action(ReorderBufferChange *change)
+{
+	switch (change->action)
+	{
+		case REORDER_BUFFER_CHANGE_INSERT:
+			return 'I';
+		case REORDER_BUFFER_CHANGE_UPDATE:
+			return 'U';
+		case REORDER_BUFFER_CHANGE_DELETE:
+			return 'D';
+		default:
+			return '?';
+	}
+}
+
 void
 pg_decode_change(LogicalDecodingContext *ctx, ReorderBufferTXN *txn,
 				 Relation relation, ReorderBufferChange *change)
@@ -872,6 +976,9 @@ pg_decode_change(LogicalDecodingContext *ctx, ReorderBufferTXN *txn,
 	pgactiveOutputData *data;
 	MemoryContext old;
 	pgactiveRelation *pgactive_relation;
+	int			out_start;
+	instr_time	encode_start;
+	instr_time	encode_end;
 
 #ifdef USE_ASSERT_CHECKING
 
@@ -894,76 +1001,126 @@ pg_decode_change(LogicalDecodingContext *ctx, ReorderBufferTXN *txn,
 	/* Avoid leaking memory by using and resetting our own context */
 	old = MemoryContextSwitchTo(data->context);
 
+	if (data->backlog_summary)
+	{
+		StringInfoData out;
+		bool		sent;
+
+		/* measure what would be sent, in our context like the rest */
+		sent = should_forward_changeset(ctx, txn->origin_id) &&
+			should_forward_change(ctx, data, pgactive_relation, change->action);
+		initStringInfo(&out);
+		if (sent)
+			write_change(data, &out, relation, change);
+
+		pgactive_backlog_change(RelationGetRelid(relation),
+								change_action(change), out.len, sent);
+		goto skip;
+	}
+
+	data->stats->changes_decoded++;
+
 	if (!should_forward_changeset(ctx, txn->origin_id))
+	{
+		data->stats->changes_filtered_origin++;
 		goto skip;
+	}
 
 	if (!should_forward_change(ctx, data, pgactive_relation, change->action))
+	{
+		data->stats->changes_filtered_repset++;
 		goto skip;
+	}
 
 	OutputPluginPrepareWrite(ctx, true);
+	out_start = ctx->out->len;
+
+	TRACE_PGACTIVE_OUTPUT_CHANGE_START(RelationGetRelid(relation),
+									   change_action(change));
+
+	INSTR_TIME_SET_CURRENT(encode_start);
+	write_change(data, ctx->out, relation, change);
+	INSTR_TIME_SET_CURRENT(encode_end);
+	INSTR_TIME_ACCUM_DIFF(data->stats->encode_time, encode_end, encode_start);
+
+	data->stats->changes_sent++;
+	data->stats->bytes_sent += ctx->out->len - out_start;
+
+	TRACE_PGACTIVE_OUTPUT_CHANGE_DONE(RelationGetRelid(relation),
+									  change_action(change),
+									  ctx->out->len - out_start);
+
+	OutputPluginWrite(ctx, true);
+
+skip:
+	MemoryContextSwitchTo(old);
+	MemoryContextReset(data->context);
+
+	pgactive_table_close(pgactive_relation, NoLock);
+}
 
+/*
+ * Write an INSERT, UPDATE or DELETE message for a change.
+ */
+static void
+write_change(pgactiveOutputData * data, StringInfo out, Relation relation,
+			 ReorderBufferChange *change)
+{
 	switch (change->action)
 	{
 		case REORDER_BUFFER_CHANGE_INSERT:
-			pq_sendbyte(ctx->out, 'I'); /* action INSERT */
-			write_rel(ctx->out, relation);
-			pq_sendbyte(ctx->out, 'N'); /* new tuple follows */
+			pq_sendbyte(out, 'I'); /* action INSERT */
+			write_rel(out, relation);
+			pq_sendbyte(out, 'N'); /* new tuple follows */
 #if PG_VERSION_NUM >= 170000
-			write_tuple(data, ctx->out, relation, change->data.tp.newtuple);
+			write_tuple(data, out, relation, change->data.tp.newtuple);
 #else
-			write_tuple(data, ctx->out, relation,
+			write_tuple(data, out, relation,
 						&change->data.tp.newtuple->tuple);
 #endif
 			break;
 		case REORDER_BUFFER_CHANGE_UPDATE:
-			pq_sendbyte(ctx->out, 'U'); /* action UPDATE */
-			write_rel(ctx->out, relation);
+			pq_sendbyte(out, 'U'); /* action UPDATE */
+			write_rel(out, relation);
 			if (change->data.tp.oldtuple != NULL)
 			{
-				pq_sendbyte(ctx->out, 'K'); /* old key follows */
+				pq_sendbyte(out, 'K'); /* old key follows */
 #if PG_VERSION_NUM >= 170000
-				write_tuple(data, ctx->out, relation,
+				write_tuple(data, out, relation,
 							change->data.tp.oldtuple);
 #else
-				write_tuple(data, ctx->out, relation,
+				write_tuple(data, out, relation,
 							&change->data.tp.oldtuple->tuple);
 #endif
 			}
-			pq_sendbyte(ctx->out, 'N'); /* new tuple follows */
+			pq_sendbyte(out, 'N'); /* new tuple follows */
 #if PG_VERSION_NUM >= 170000
-			write_tuple(data, ctx->out, relation, change->data.tp.newtuple);
+			write_tuple(data, out, relation, change->data.tp.newtuple);
 #else
-			write_tuple(data, ctx->out, relation,
+			write_tuple(data, out, relation,
 						&change->data.tp.newtuple->tuple);
 #endif
 			break;
 		case REORDER_BUFFER_CHANGE_DELETE:
-			pq_sendbyte(ctx->out, 'D'); /* action DELETE */
-			write_rel(ctx->out, relation);
+			pq_sendbyte(out, 'D'); /* action DELETE */
+			write_rel(out, relation);
 			if (change->data.tp.oldtuple != NULL)
 			{
-				pq_sendbyte(ctx->out, 'K'); /* old key follows */
+				pq_sendbyte(out, 'K'); /* old key follows */
 #if PG_VERSION_NUM >= 170000
-				write_tuple(data, ctx->out, relation,
+				write_tuple(data, out, relation,
 							change->data.tp.oldtuple);
 #else
-				write_tuple(data, ctx->out, relation,
+				write_tuple(data, out, relation,
 							&change->data.tp.oldtuple->tuple);
 #endif
 			}
 			else
-				pq_sendbyte(ctx->out, 'E'); /* empty */
+				pq_sendbyte(out, 'E'); /* empty */
 			break;
 		default:
 			Assert(false);
 	}
-	OutputPluginWrite(ctx, true);
-
-skip:
-	MemoryContextSwitchTo(old);
-	MemoryContextReset(data->context);
-
-	pgactive_table_close(pgactive_relation, NoLock);
 }
 
 /*
@@ -1036,6 +1193,127 @@ decide_datum_transfer(pgactiveOutputData * data,
 	}
 }
 
+/*
+ * Write one column of a tuple to the outputstream.
+ */
+static inline void
+write_datum(pgactiveOutputData * data, StringInfo out, Form_pg_attribute att,
+			Datum value, bool isnull)
+{
+	HeapTuple	typtup;
+	Form_pg_type typclass;
+	bool		use_binary = false;
+	bool		use_sendrecv = false;
+	int			start = out->len;
+
+	if (isnull || att->attisdropped)
+	{
+		pq_sendbyte(out, 'n');	/* null column */
+		return;
+	}
+	else if (att->attlen == -1 && VARATT_IS_EXTERNAL_ONDISK(DatumGetPointer(value)))
+	{
+		pq_sendbyte(out, 'u');	/* unchanged toast column */
+		return;
+	}
+
+	typtup = SearchSysCache1(TYPEOID, ObjectIdGetDatum(att->atttypid));
+	if (!HeapTupleIsValid(typtup))
+		elog(ERROR, "cache lookup failed for type %u", att->atttypid);
+	typclass = (Form_pg_type) GETSTRUCT(typtup);
+
+	decide_datum_transfer(data, att, typclass, &use_binary, &use_sendrecv);
+
+	if (use_binary)
+	{
+		pq_sendbyte(out, 'b');	/* binary data follows */
+
+		/* pass by value */
+		if (att->attbyval)
+		{
+			pq_sendint(out, att->attlen, 4);	/* length */
+
+			enlargeStringInfo(out, att->attlen);
+			store_att_byval(out->data + out->len, value, att->attlen);
+			out->len += att->attlen;
+			out->data[out->len] = '\0';
+		}
+		/* fixed length non-varlena pass-by-reference type */
+		else if (att->attlen > 0)
+		{
+			pq_sendint(out, att->attlen, 4);	/* length */
+
+			appendBinaryStringInfo(out, DatumGetPointer(value),
+								   att->attlen);
+		}
+		/* varlena type */
+		else if (att->attlen == -1)
+		{
+			char	   *data = DatumGetPointer(value);
+
+			/* send indirect datums inline */
+			if (VARATT_IS_EXTERNAL_INDIRECT(DatumGetPointer(value)))
+			{
+				struct varatt_indirect redirect;
+
+				VARATT_EXTERNAL_GET_POINTER(redirect, data);
+				data = (char *) redirect.pointer;
+			}
+
+			Assert(!VARATT_IS_EXTERNAL(data));
+
+			pq_sendint(out, VARSIZE_ANY(data), 4);	/* length */
+
+			appendBinaryStringInfo(out, data,
+								   VARSIZE_ANY(data));
+
+		}
+		else
+			elog(ERROR, "unsupported tuple type");
+	}
+	else if (use_sendrecv)
+	{
+		bytea	   *outputbytes;
+		int			len;
+
+		pq_sendbyte(out, 's');	/* 'send' data follows */
+
+		outputbytes =
+			OidSendFunctionCall(typclass->typsend, value);
+
+		len = VARSIZE(outputbytes) - VARHDRSZ;
+		pq_sendint(out, len, 4);	/* length */
+		pq_sendbytes(out, VARDATA(outputbytes), len);	/* data */
+		pfree(outputbytes);
+	}
+	else
+	{
+		char	   *outputstr;
+		int			len;
+
+		pq_sendbyte(out, 't');	/* 'text' data follows */
+
+		outputstr =
+			OidOutputFunctionCall(typclass->typoutput, value);
+		len = strlen(outputstr) + 1;
+		pq_sendint(out, len, 4);	/* length */
+		appendBinaryStringInfo(out, outputstr, len);	/* data */
+		pfree(outputstr);
+	}
+
+	if (data->stats != NULL)
+	{
+		if (use_binary)
+			data->stats->bytes_binary += out->len - start;
+		else if (use_sendrecv)
+			data->stats->bytes_sendrecv += out->len - start;
+		else
+			data->stats->bytes_text += out->len - start;
+	}
+
+	ReleaseSysCache(typtup);
+}
+
 /*
  * Write a tuple to the outputstream, in the most efficient format possible.
  */
@@ -1066,111 +1344,40 @@ write_tuple(pgactiveOutputData * data, StringInfo out, Relation rel,
 	heap_deform_tuple(tuple, desc, values, isnull);
 
 	for (i = 0; i < desc->natts; i++)
-	{
-		HeapTuple	typtup;
-		Form_pg_type typclass;
-		FormData_pg_attribute *att = TupleDescAttr(desc, i);
-
-		bool		use_binary = false;
-		bool		use_sendrecv = false;
-
-		if (isnull[i] || att->attisdropped)
-		{
-			pq_sendbyte(out, 'n');	/* null column */
-			continue;
-		}
-		else if (att->attlen == -1 && VARATT_IS_EXTERNAL_ONDISK(DatumGetPointer(values[i])))
-		{
-			pq_sendbyte(out, 'u');	/* unchanged toast column */
-			continue;
-		}
-
-		typtup = SearchSysCache1(TYPEOID, ObjectIdGetDatum(att->atttypid));
-		if (!HeapTupleIsValid(typtup))
-			elog(ERROR, "cache lookup failed for type %u", att->atttypid);
-		typclass = (Form_pg_type) GETSTRUCT(typtup);
-
-		decide_datum_transfer(data, att, typclass, &use_binary, &use_sendrecv);
-
-		if (use_binary)
-		{
-			pq_sendbyte(out, 'b');	/* binary data follows */
-
-			/* pass by value */
-			if (att->attbyval)
-			{
-				pq_sendint(out, att->attlen, 4);	/* length */
-
-				enlargeStringInfo(out, att->attlen);
-				store_att_byval(out->data + out->len, values[i], att->attlen);
-				out->len += att->attlen;
-				out->data[out->len] = '\0';
-			}
-			/* fixed length non-varlena pass-by-reference type */
-			else if (att->attlen > 0)
-			{
-				pq_sendint(out, att->attlen, 4);	/* length */
-
-				appendBinaryStringInfo(out, DatumGetPointer(values[i]),
-									   att->attlen);
-			}
-			/* varlena type */
-			else if (att->attlen == -1)
-			{
-				char	   *data = DatumGetPointer(values[i]);
-
-				/* send indirect datums inline */
-				if (VARATT_IS_EXTERNAL_INDIRECT(DatumGetPointer(values[i])))
-				{
-					struct varatt_indirect redirect;
-
-					VARATT_EXTERNAL_GET_POINTER(redirect, data);
-					data = (char *) redirect.pointer;
-				}
-
-				Assert(!VARATT_IS_EXTERNAL(data));
-
-				pq_sendint(out, VARSIZE_ANY(data), 4);	/* length */
-
-				appendBinaryStringInfo(out, data,
-									   VARSIZE_ANY(data));
-
-			}
-			else
-				elog(ERROR, "unsupported tuple type");
-		}
-		else if (use_sendrecv)
-		{
-			bytea	   *outputbytes;
-			int			len;
-
-			pq_sendbyte(out, 's');	/* 'send' data follows */
+		write_datum(data, out, TupleDescAttr(desc, i), values[i], isnull[i]);
+}
 
-			outputbytes =
-				OidSendFunctionCall(typclass->typsend, values[i]);
+/*
+ * Entry points into the tuple encoding above for the codec benchmarks in
+ * pgactive_bench.c. They encode data the way it's sent to a peer running the
+ * same build, i.e. as with the "interactive" option.
+ */
+static void
+init_interactive_output_data(pgactiveOutputData * data)
+{
+	memset(data, 0, sizeof(pgactiveOutputData));
+	data->allow_binary_protocol = true;
+	data->allow_sendrecv_protocol = true;
+	data->int_datetime_mismatch = false;
+}
 
-			len = VARSIZE(outputbytes) - VARHDRSZ;
-			pq_sendint(out, len, 4);	/* length */
-			pq_sendbytes(out, VARDATA(outputbytes), len);	/* data */
-			pfree(outputbytes);
-		}
-		else
-		{
-			char	   *outputstr;
-			int			len;
+void
+pgactive_write_tuple(StringInfo out, Relation rel, HeapTuple tuple)
+{
+	pgactiveOutputData data;
 
-			pq_sendbyte(out, 't');	/* 'text' data follows */
+	init_interactive_output_data(&data);
+	write_tuple(&data, out, rel, tuple);
+}
 
-			outputstr =
-				OidOutputFunctionCall(typclass->typoutput, values[i]);
-			len = strlen(outputstr) + 1;
-			pq_sendint(out, len, 4);	/* length */
-			appendBinaryStringInfo(out, outputstr, len);	/* data */
-			pfree(outputstr);
-		}
+void
+pgactive_write_datum(StringInfo out, Form_pg_attribute att, Datum value,
+					 bool isnull)
+{
+	pgactiveOutputData data;
 
-		ReleaseSysCache(typtup);
-	}
+	init_interactive_output_data(&data);
+	write_datum(&data, out, att, value, isnull);
 }
 
 static void
@@ -1179,6 +1386,11 @@ pg_decode_message(LogicalDecodingContext *ctx,
 				  bool transactional, const char *prefix,
 				  Size sz, const char *message)
 {
+	pgactiveOutputData *data = ctx->output_plugin_private;
+
+	if (data->backlog_summary)
+		return;
+
 	if (strcmp(prefix, pgactive_LOGICAL_MSG_PREFIX) == 0)
 	{
 		OutputPluginPrepareWrite(ctx, true);
@@ -47,6 +47,7 @@
 #include "utils/memutils.h"
 #include "utils/snapmgr.h"
 #include "utils/regproc.h"
+#include "utils/timestamp.h"
 
 PG_FUNCTION_INFO_V1(pgactive_connections_changed);
 
@@ -577,6 +578,10 @@ pgactive_maintain_db_workers(void)
 				if (strcmp("pgactive", NameStr(s->data.plugin)) != 0)
 					continue;
 
+				/* e.g. a copy pgactive_backlog_summary() decodes from */
+				if (!pgactive_is_node_slot_name(NameStr(s->data.name)))
+					continue;
+
 				if (we_were_dropped &&
 					s->data.database == myid.dboid)
 				{
@@ -682,9 +687,7 @@ pgactive_maintain_db_workers(void)
 	PushActiveSnapshot(GetTransactionSnapshot());
 	foreach(lcroname, rep_origin_to_remove)
 	{
-#if PG_VERSION_NUM < 140000
 		RepOriginId roident;
-#endif
 		char	   *roname = (char *) lfirst(lcroname);
 
 		/*
@@ -694,8 +697,8 @@ pgactive_maintain_db_workers(void)
 		 * RecoveryInProgress() test in pgactive_supervisor_worker_main().
 		 */
 		elog(DEBUG1, "dropping replication origin %s due to node detach", roname);
-#if PG_VERSION_NUM < 140000
 		roident = replorigin_by_name(roname, true);
+#if PG_VERSION_NUM < 140000
 		if (roident != InvalidRepOriginId)
 		{
 			replorigin_drop(roident, true);
@@ -705,6 +708,8 @@ pgactive_maintain_db_workers(void)
 		replorigin_drop_by_name(roname, true, true);
 		elog(LOG, "dropped replication origin %s due to node detach", roname);
 #endif
+		if (roident != InvalidRepOriginId)
+			pgactive_count_drop_node(roident);
 
 	}
 	PopActiveSnapshot();
@@ -1138,7 +1143,8 @@ check_local_node_connectability(void)
 
 				(void) pgactiveWaitLatch(MyLatch,
 										 WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
-										 waittime, PG_WAIT_EXTENSION);
+										 waittime,
+										 pgactive_wait_event(pgactive_WAIT_PERDB_CONNECT_RETRY));
 
 				ResetLatch(MyLatch);
 
@@ -1198,6 +1204,169 @@ check_local_node_connectability(void)
 	return;
 }
 
+/*
+ * Retention of the pgactive history tables. The per-db worker deletes rows
+ * older than the table's retention setting in batches, each in a transaction
+ * that isn't replicated, so every node prunes its own copy.
+ *
+ * Rows are judged by age only, whichever node queued them: peers that haven't
+ * received queued DDL or drops yet still get them, as the rows are decoded
+ * from the WAL their insertion wrote, not read back from the table.
+ */
+#define pgactive_PRUNE_INTERVAL_MS 60000L
+#define pgactive_PRUNE_MAX_BATCHES 100
+
+typedef struct pgactiveHistoryTable
+{
+	const char *relname;
+	int		   *retention;
+	const char *query;
+} pgactiveHistoryTable;
+
+static const pgactiveHistoryTable pgactiveHistoryTables[] = {
+	{
+		"pgactive_conflict_history",
+		&pgactive_conflict_history_retention,
+		"DELETE FROM pgactive.pgactive_conflict_history WHERE ctid = ANY (ARRAY(\n"
+		"SELECT ctid FROM pgactive.pgactive_conflict_history\n"
+		"WHERE local_conflict_time < pg_catalog.now() - pg_catalog.make_interval(secs => $1)\n"
+		"LIMIT $2))"
+	},
+	{
+		"pgactive_queued_commands",
+		&pgactive_queued_commands_retention,
+		"DELETE FROM pgactive.pgactive_queued_commands WHERE ctid = ANY (ARRAY(\n"
+		"SELECT ctid FROM pgactive.pgactive_queued_commands\n"
+		"WHERE queued_at < pg_catalog.now() - pg_catalog.make_interval(secs => $1)\n"
+		"LIMIT $2))"
+	},
+	{
+		"pgactive_queued_drops",
+		&pgactive_queued_drops_retention,
+		"DELETE FROM pgactive.pgactive_queued_drops WHERE ctid = ANY (ARRAY(\n"
+		"SELECT ctid FROM pgactive.pgactive_queued_drops\n"
+		"WHERE queued_at < pg_catalog.now() - pg_catalog.make_interval(secs => $1)\n"
+		"LIMIT $2))"
+	}
+};
+
+static bool
+pgactive_history_retention_enabled(void)
+{
+	int			i;
+
+	for (i = 0; i < lengthof(pgactiveHistoryTables); i++)
+	{
+		if (*pgactiveHistoryTables[i].retention >= 0)
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * Delete a batch of expired rows from a history table, returning how many
+ * were deleted.
+ */
+static uint64
+pgactive_prune_history_batch(const pgactiveHistoryTable *table)
+{
+	Oid			argtypes[2] = {FLOAT8OID, INT4OID};
+	Datum		values[2];
+	uint64		ndeleted;
+	int			ret;
+
+	values[0] = Float8GetDatum((double) *table->retention);
+	values[1] = Int32GetDatum(pgactive_history_prune_batch_size);
+
+	StartTransactionCommand();
+	if (SPI_connect() != SPI_OK_CONNECT)
+		elog(ERROR, "SPI_connect failed");
+	PushActiveSnapshot(GetTransactionSnapshot());
+
+	/* as with pgactive.do_not_replicate */
+	replorigin_session_origin = DoNotReplicateId;
+
+	ret = SPI_execute_with_args(table->query, 2, argtypes, values, NULL,
+								false, 0);
+	if (ret != SPI_OK_DELETE)
+		elog(ERROR, "pruning %s failed: %s", table->relname,
+			 SPI_result_code_string(ret));
+	ndeleted = SPI_processed;
+
+	if (SPI_finish() != SPI_OK_FINISH)
+		elog(ERROR, "SPI_finish failed");
+	PopActiveSnapshot();
+	CommitTransactionCommand();
+
+	replorigin_session_origin = InvalidRepOriginId;
+
+	return ndeleted;
+}
+
+/*
+ * Delete expired rows from the history tables with a retention set. Returns
+ * true if some are left because a table had more than
+ * pgactive_PRUNE_MAX_BATCHES batches of them, so that other per-db worker
+ * duties aren't held up for too long.
+ *
+ * Errors are logged rather than making the per-db worker exit; pruning is
+ * retried next time.
+ */
+static bool
+pgactive_prune_history(void)
+{
+	volatile bool more = false;
+	int			i;
+
+	for (i = 0; i < lengthof(pgactiveHistoryTables); i++)
+	{
+		const pgactiveHistoryTable *table = &pgactiveHistoryTables[i];
+		volatile uint64 total = 0;
+		int			nbatches;
+
+		if (*table->retention < 0)
+			continue;
+
+		pgstat_report_activity(STATE_RUNNING, table->query);
+
+		PG_TRY();
+		{
+			for (nbatches = 0; nbatches < pgactive_PRUNE_MAX_BATCHES; nbatches++)
+			{
+				uint64		ndeleted;
+
+				CHECK_FOR_INTERRUPTS();
+				if (ProcDiePending)
+					break;
+
+				ndeleted = pgactive_prune_history_batch(table);
+				total += ndeleted;
+				if (ndeleted < pgactive_history_prune_batch_size)
+					break;
+			}
+			if (nbatches == pgactive_PRUNE_MAX_BATCHES)
+				more = true;
+		}
+		PG_CATCH();
+		{
+			replorigin_session_origin = InvalidRepOriginId;
+			EmitErrorReport();
+			FlushErrorState();
+			AbortCurrentTransaction();
+		}
+		PG_END_TRY();
+
+		if (total > 0)
+			elog(DEBUG1, "pruned " UINT64_FORMAT " rows from pgactive.%s",
+				 total, table->relname);
+	}
+
+	pgstat_report_activity(STATE_IDLE, NULL);
+
+	return more;
+}
+
 /*
  * Each database with pgactive enabled on it has a static background worker,
  * registered at shared_preload_libraries time during postmaster start. This is
@@ -1218,6 +1387,9 @@ pgactive_perdb_worker_main(Datum main_arg)
 	pgactivePerdbWorker *perdb;
 	StringInfoData si;
 	pgactiveNodeId myid;
+	long		timeout;
+	TimestampTz last_prune = 0;
+	bool		prune_pending = false;
 
 	pqsignal(SIGUSR2, pgactive_perdb_worker_sigusr2_handler);
 
@@ -1335,6 +1507,21 @@ pgactive_perdb_worker_main(Datum main_arg)
 
 		pgstat_report_activity(STATE_IDLE, NULL);
 
+		timeout = 180000L;
+		if (pgactive_history_retention_enabled())
+		{
+			TimestampTz now = GetCurrentTimestamp();
+
+			if (prune_pending ||
+				TimestampDifferenceExceeds(last_prune, now,
+										   pgactive_PRUNE_INTERVAL_MS))
+			{
+				prune_pending = pgactive_prune_history();
+				last_prune = now;
+			}
+			timeout = prune_pending ? 1000L : pgactive_PRUNE_INTERVAL_MS;
+		}
+
 		/*
 		 * Background workers mustn't call usleep() or any direct equivalent:
 		 * instead, they may wait on their process latch, which sleeps as
@@ -1343,11 +1530,13 @@ pgactive_perdb_worker_main(Datum main_arg)
 		 *
 		 * We wake up everytime our latch gets set or if 180 seconds have
 		 * passed without events. That's a stopgap for the case a backend
-		 * committed txn changes but died before setting the latch.
+		 * committed txn changes but died before setting the latch. With a
+		 * history table retention set we also wake up to prune them.
 		 */
 		rc = pgactiveWaitLatch(&MyProc->procLatch,
 							   WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
-							   180000L, PG_WAIT_EXTENSION);
+							   timeout,
+							   pgactive_wait_event(pgactive_WAIT_PERDB_MAIN));
 		ResetLatch(&MyProc->procLatch);
 		CHECK_FOR_INTERRUPTS();
 
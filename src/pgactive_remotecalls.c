@@ -124,6 +124,93 @@ pgactive_cleanup_conn_close(int code, Datum connptr)
 	PQfinish(conn);
 }
 
+/*
+ * Run queries on a remote node in a single network round trip using libpq's
+ * pipeline mode. Each query must be a single statement, and runs in its own
+ * implicit transaction unless the queries open one explicitly, just as if
+ * they had been sent one after another. Results are stored in the queries
+ * array for the caller to check in order and to free with
+ * pgactive_clear_pipeline.
+ *
+ * Without pipeline mode, before PostgreSQL 14, the queries are simply run one
+ * after another.
+ */
+void
+pgactive_exec_pipeline(PGconn *conn, pgactiveRemoteQuery * queries, int nqueries)
+{
+	int			i;
+#if PG_VERSION_NUM >= 140000
+	PGresult   *res;
+
+	for (i = 0; i < nqueries; i++)
+		queries[i].res = NULL;
+
+	if (PQenterPipelineMode(conn) != 1)
+		ereport(ERROR,
+				(errmsg("could not enter pipeline mode on remote connection: %s",
+						PQerrorMessage(conn))));
+
+	for (i = 0; i < nqueries; i++)
+	{
+		if (PQsendQueryParams(conn, queries[i].query, queries[i].nparams, NULL,
+							  queries[i].params, NULL, NULL, 0) != 1 ||
+			PQpipelineSync(conn) != 1)
+			ereport(ERROR,
+					(errmsg("could not send query to remote node: %s",
+							PQerrorMessage(conn)),
+					 errdetail("Query: %s", queries[i].query)));
+	}
+
+	/*
+	 * Each query's results are followed by a NULL, then by the result of
+	 * the sync point that ends its implicit transaction.
+	 */
+	for (i = 0; i < nqueries; i++)
+	{
+		queries[i].res = PQgetResult(conn);
+		if (queries[i].res == NULL)
+			ereport(ERROR,
+					(errmsg("could not receive query result from remote node: %s",
+							PQerrorMessage(conn)),
+					 errdetail("Query: %s", queries[i].query)));
+
+		while ((res = PQgetResult(conn)) != NULL)
+			PQclear(res);
+
+		res = PQgetResult(conn);
+		if (PQresultStatus(res) != PGRES_PIPELINE_SYNC)
+			ereport(ERROR,
+					(errmsg("unexpected result status %s in pipeline on remote node: %s",
+							PQresStatus(PQresultStatus(res)),
+							PQerrorMessage(conn))));
+		PQclear(res);
+	}
+
+	if (PQexitPipelineMode(conn) != 1)
+		ereport(ERROR,
+				(errmsg("could not exit pipeline mode on remote connection: %s",
+						PQerrorMessage(conn))));
+#else
+	for (i = 0; i < nqueries; i++)
+		queries[i].res = PQexecParams(conn, queries[i].query,
+									  queries[i].nparams, NULL,
+									  queries[i].params, NULL, NULL, 0);
+#endif
+}
+
+void
+pgactive_clear_pipeline(pgactiveRemoteQuery * queries, int nqueries)
+{
+	int			i;
+
+	for (i = 0; i < nqueries; i++)
+	{
+		if (queries[i].res != NULL)
+			PQclear(queries[i].res);
+		queries[i].res = NULL;
+	}
+}
+
 /*
  * Frees contents of a remote_node_info (but not the struct its self)
  */
@@ -221,6 +308,9 @@ pgactive_copytable(PGconn *copyfrom_conn, PGconn *copyto_conn,
 /*
  * The implementation guts of pgactive_get_node_info, callable with a
  * pre-existing connection.
+ *
+ * All queries are sent in one pipeline, so this costs a single round trip to
+ * the remote node.
  */
 void
 pgactive_get_remote_nodeinfo_internal(PGconn *conn, struct remote_node_info *ri)
@@ -229,29 +319,54 @@ pgactive_get_remote_nodeinfo_internal(PGconn *conn, struct remote_node_info *ri)
 	int			i;
 	char	   *remote_pgactive_version_str;
 	int			parsed_version_num;
+	pgactiveRemoteQuery queries[] = {
+		{pgactive_ext_version_query},
 
-	/* Make sure pgactive is actually present and active on the remote */
-	pgactive_ensure_ext_installed(conn);
+		/*
+		 * Acquire remote node information. With this, we can also safely
+		 * find out if we're superuser at this point.
+		 */
+		{"SELECT pgactive.pgactive_version(), pgactive.pgactive_version_num(), "
+			"pgactive.pgactive_variant(), pgactive.pgactive_min_remote_version_num(), "
+			"pgactive.has_required_privs() AS hasrequiredprivs, "
+			"pgactive.pgactive_get_local_node_name() AS node_name, "
+			"current_database()::text AS dbname, "
+			"pg_database_size(current_database()) AS dbsize, "
+			"current_setting('pgactive.max_nodes') AS max_nodes, "
+			"current_setting('pgactive.skip_ddl_replication') AS skip_ddl_replication, "
+			"(select count(1) from pgactive.pgactive_connections WHERE 'include_rs' = ANY(conn_replication_sets)) as nb_include_rs, "
+			"count(1) FROM pgactive.pgactive_nodes WHERE node_status NOT IN (pgactive.pgactive_node_status_to_char('pgactive_NODE_STATUS_KILLED'));"},
+
+		/* Database collation */
+		{"SELECT datcollate, datctype FROM pg_database "
+			"WHERE datname = current_database();"},
+
+		/* The remote node identity */
+		{"SELECT sysid, timeline, dboid "
+			"FROM pgactive.pgactive_get_local_nodeid();"},
+
+		/* The remote node status */
+		{"SELECT node_status FROM pgactive.pgactive_nodes WHERE "
+			"(node_sysid, node_timeline, node_dboid) = pgactive.pgactive_get_local_nodeid();"},
+
+		/* Total indexes size on the remote node */
+		{"SELECT sum(pg_indexes_size(r.oid)) AS indexessize "
+			"FROM pg_class r JOIN pg_namespace n "
+			"ON relnamespace = n.oid WHERE n.nspname NOT IN "
+			"('pg_catalog', 'pgactive', 'information_schema') "
+			"AND relkind = 'r' AND relpersistence = 'p';"}
+	};
+
+	pgactive_exec_pipeline(conn, queries, lengthof(queries));
 
-	/*
-	 * Acquire remote node information. With this, we can also safely find out
-	 * if we're superuser at this point.
-	 */
-	res = PQexec(conn, "SELECT pgactive.pgactive_version(), pgactive.pgactive_version_num(), "
-				 "pgactive.pgactive_variant(), pgactive.pgactive_min_remote_version_num(), "
-				 "pgactive.has_required_privs() AS hasrequiredprivs, "
-				 "pgactive.pgactive_get_local_node_name() AS node_name, "
-				 "current_database()::text AS dbname, "
-				 "pg_database_size(current_database()) AS dbsize, "
-				 "current_setting('pgactive.max_nodes') AS max_nodes, "
-				 "current_setting('pgactive.skip_ddl_replication') AS skip_ddl_replication, "
-				 "(select count(1) from pgactive.pgactive_connections WHERE 'include_rs' = ANY(conn_replication_sets)) as nb_include_rs, "
-				 "count(1) FROM pgactive.pgactive_nodes WHERE node_status NOT IN (pgactive.pgactive_node_status_to_char('pgactive_NODE_STATUS_KILLED'));");
+	/* Make sure pgactive is actually present and active on the remote */
+	pgactive_ensure_ext_installed_result(queries[0].res);
 
+	res = queries[1].res;
 	if (PQresultStatus(res) != PGRES_TUPLES_OK)
 		ereport(ERROR,
 				(errmsg("unable to get pgactive information from remote node"),
-				 errdetail("Querying remote failed with: %s", PQerrorMessage(conn))));
+				 errdetail("Querying remote failed with: %s", PQresultErrorMessage(res))));
 
 	Assert(PQnfields(res) == 12);
 	Assert(PQntuples(res) == 1);
@@ -274,7 +389,6 @@ pgactive_get_remote_nodeinfo_internal(PGconn *conn, struct remote_node_info *ri)
 									  DirectFunctionCall1(int4in, CStringGetDatum(PQgetvalue(res, 0, 10))));
 	ri->cur_nodes = DatumGetInt32(
 								  DirectFunctionCall1(int4in, CStringGetDatum(PQgetvalue(res, 0, 11))));
-	PQclear(res);
 
 	/*
 	 * Even though we should be able to get it from pgactive_version_num,
@@ -289,13 +403,11 @@ pgactive_get_remote_nodeinfo_internal(PGconn *conn, struct remote_node_info *ri)
 		elog(WARNING, "parsed pgactive version %d from string %s != returned pgactive version %d",
 			 parsed_version_num, remote_pgactive_version_str, ri->version_num);
 
-	res = PQexec(conn, "SELECT datcollate, datctype FROM pg_database "
-				 "WHERE datname = current_database();");
-
+	res = queries[2].res;
 	if (PQresultStatus(res) != PGRES_TUPLES_OK)
 		ereport(ERROR,
 				(errmsg("unable to get database collation information from remote node"),
-				 errdetail("Querying remote failed with: %s", PQerrorMessage(conn))));
+				 errdetail("Querying remote failed with: %s", PQresultErrorMessage(res))));
 
 	Assert(PQnfields(res) == 2);
 	Assert(PQntuples(res) == 1);
@@ -303,16 +415,12 @@ pgactive_get_remote_nodeinfo_internal(PGconn *conn, struct remote_node_info *ri)
 		PQgetisnull(res, 0, 0) ? NULL : pstrdup(PQgetvalue(res, 0, 0));
 	ri->datctype =
 		PQgetisnull(res, 0, 1) ? NULL : pstrdup(PQgetvalue(res, 0, 1));
-	PQclear(res);
-
-	/* Get the remote node identity */
-	res = PQexec(conn, "SELECT sysid, timeline, dboid "
-				 "FROM pgactive.pgactive_get_local_nodeid();");
 
+	res = queries[3].res;
 	if (PQresultStatus(res) != PGRES_TUPLES_OK)
 		ereport(ERROR,
 				(errmsg("unable to get remote node identity"),
-				 errdetail("Querying remote failed with: %s", PQerrorMessage(conn))));
+				 errdetail("Querying remote failed with: %s", PQresultErrorMessage(res))));
 
 	Assert(PQnfields(res) == 3);
 	Assert(PQntuples(res) == 1);
@@ -331,16 +439,12 @@ pgactive_get_remote_nodeinfo_internal(PGconn *conn, struct remote_node_info *ri)
 										   DirectFunctionCall1(oidin, CStringGetDatum(PQgetvalue(res, 0, 1))));
 	ri->nodeid.dboid = DatumGetObjectId(
 										DirectFunctionCall1(oidin, CStringGetDatum(PQgetvalue(res, 0, 2))));
-	PQclear(res);
-
-	/* Get the remote node status */
-	res = PQexec(conn, "SELECT node_status FROM pgactive.pgactive_nodes WHERE "
-				 "(node_sysid, node_timeline, node_dboid) = pgactive.pgactive_get_local_nodeid();");
 
+	res = queries[4].res;
 	if (PQresultStatus(res) != PGRES_TUPLES_OK)
 		ereport(ERROR,
 				(errmsg("unable to get remote node status"),
-				 errdetail("Querying remote failed with: %s", PQerrorMessage(conn))));
+				 errdetail("Querying remote failed with: %s", PQresultErrorMessage(res))));
 
 	Assert(PQnfields(res) == 1);
 
@@ -359,19 +463,11 @@ pgactive_get_remote_nodeinfo_internal(PGconn *conn, struct remote_node_info *ri)
 	else
 		elog(ERROR, "got more than one pgactive.pgactive_nodes row matching local nodeid"); /* shouldn't happen */
 
-	PQclear(res);
-
-	/* Fetch total indexes size from remote node */
-	res = PQexec(conn, "SELECT sum(pg_indexes_size(r.oid)) AS indexessize "
-				 "FROM pg_class r JOIN pg_namespace n "
-				 "ON relnamespace = n.oid WHERE n.nspname NOT IN "
-				 "('pg_catalog', 'pgactive', 'information_schema') "
-				 "AND relkind = 'r' AND relpersistence = 'p';");
-
+	res = queries[5].res;
 	if (PQresultStatus(res) != PGRES_TUPLES_OK)
 		ereport(ERROR,
 				(errmsg("unable to get total indexes size from remote node"),
-				 errdetail("Querying remote failed with: %s", PQerrorMessage(conn))));
+				 errdetail("Querying remote failed with: %s", PQresultErrorMessage(res))));
 
 	Assert(PQnfields(res) == 1);
 	Assert(PQntuples(res) == 1);
@@ -382,7 +478,7 @@ pgactive_get_remote_nodeinfo_internal(PGconn *conn, struct remote_node_info *ri)
 		ri->indexessize = DatumGetInt64(
 										DirectFunctionCall1(int8in, CStringGetDatum(PQgetvalue(res, 0, 0))));
 
-	PQclear(res);
+	pgactive_clear_pipeline(queries, lengthof(queries));
 }
 
 static void
@@ -13,11 +13,25 @@
 #include "postgres.h"
 
 #include "fmgr.h"
+#include "funcapi.h"
 
+#include "catalog/pg_class.h"
+#include "catalog/pg_sequence.h"
+#include "catalog/pg_type.h"
+
+#include "port/atomics.h"
+
+#include "storage/ipc.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+
+#include "utils/acl.h"
+#include "utils/array.h"
 #include "utils/lsyscache.h"
 #include "utils/timestamp.h"
 #include "utils/datetime.h"
 #include "utils/fmgrprotos.h"
+#include "utils/syscache.h"
 
 #include "miscadmin.h"
 
@@ -28,16 +42,134 @@
 #define MAX_SEQ_ID		((1 << SEQUENCE_BITS) - 1)
 #define MAX_TIMESTAMP	(((int64)1 << TIMESTAMP_BITS) - 1)
 
+/* Oct 7, 2016, when this code was written, in ms */
+#define SEQ_TS_EPOCH	INT64CONST(529111339634)
+
+/*
+ * Number of sequences the shmem generator can track. Sequences beyond this
+ * fall back to the nextval() based generator. Slots of dropped sequences are
+ * reclaimed when a new sequence finds them all in use.
+ */
+#define pgactive_SNOWFLAKE_ID_SLOTS		64
+
+/*
+ * How far ahead (in ms) of the last issued timestamp the shmem generator
+ * persists its high-water mark into the underlying sequence.
+ */
+#define pgactive_SNOWFLAKE_ID_HORIZON_MS	1000
+
+/*
+ * Largest batch pgactive_snowflake_id_nextval_batch() hands out; about one
+ * second's worth of ids.
+ */
+#define pgactive_SNOWFLAKE_ID_MAX_BATCH	(MAX_SEQ_ID * 1000)
+
+/*
+ * Per-sequence state of the shmem snowflake id generator.
+ *
+ * state packs the last issued (timestamp << SEQUENCE_BITS | sequence) pair so
+ * that a single compare-and-exchange hands out an id. horizon is the highest
+ * timestamp that has been persisted to the underlying sequence; no id with a
+ * timestamp beyond it is ever returned, so after a crash we can restart
+ * safely from it.
+ */
+typedef struct pgactiveSnowflakeIdSlot
+{
+	/* InvalidOid seqoid means the slot is unused */
+	Oid			dboid;
+	Oid			seqoid;
+	pg_atomic_uint64 state;
+	pg_atomic_uint64 horizon;
+}			pgactiveSnowflakeIdSlot;
+
+typedef struct pgactiveSnowflakeIdControl
+{
+	/* Must hold this lock to assign slots or to advance a slot's horizon */
+	LWLockId	lock;
+
+	/*
+	 * The nextval() based generator holds this lock shared to take a value,
+	 * and exclusively to reserve the range of a batch.
+	 */
+	LWLockId	seq_lock;
+	pgactiveSnowflakeIdSlot slots[pgactive_SNOWFLAKE_ID_SLOTS];
+}			pgactiveSnowflakeIdControl;
+
+static pgactiveSnowflakeIdControl * pgactiveSnowflakeIdCtl = NULL;
+
+static shmem_startup_hook_type prev_shmem_startup_hook = NULL;
+
  /* Cache for nodeid so we don't have to read it for every nextval call. */
 static int16 seq_nodeid = -1;
 
 static Oid	seq_nodeid_dboid = InvalidOid;
 
+/* Cache of the last shmem generator slot looked up by this backend */
+static pgactiveSnowflakeIdSlot * seq_last_slot = NULL;
+
 static int16 global_seq_get_nodeid(void);
+static pgactiveSnowflakeIdSlot * global_seq_get_shmem_slot(Oid seqoid,
+															  int64 timestamp);
+static void global_seq_shmem_reserve(pgactiveSnowflakeIdSlot * slot, int64 n,
+									 int64 *timestamp, int64 *sequence);
 
 Datum		pgactive_snowflake_id_nextval_oid(PG_FUNCTION_ARGS);
+PGDLLEXPORT Datum pgactive_snowflake_id_nextval_batch(PG_FUNCTION_ARGS);
+PGDLLEXPORT Datum pgactive_snowflake_id_nextval_array(PG_FUNCTION_ARGS);
 
 PG_FUNCTION_INFO_V1(pgactive_snowflake_id_nextval_oid);
+PG_FUNCTION_INFO_V1(pgactive_snowflake_id_nextval_batch);
+PG_FUNCTION_INFO_V1(pgactive_snowflake_id_nextval_array);
+
+/*
+ * Take n consecutive values of the sequence, as the per-millisecond parts of
+ * n ids, and return the first one.
+ *
+ * A batch reserves its range with one setval() while holding seq_lock
+ * exclusively, so that no other value is taken from the sequence between its
+ * nextval() and setval(). Callers lacking the UPDATE privilege setval()
+ * requires take the values one by one under the lock instead.
+ */
+static int64
+global_seq_nextval(Oid seqoid, int64 n)
+{
+	int64		value;
+
+	Assert(n > 0);
+
+	if (pgactiveSnowflakeIdCtl == NULL)
+		elog(ERROR, "cannot use pgactive snowflake id generator without loading pgactive");
+
+	LWLockAcquire(pgactiveSnowflakeIdCtl->seq_lock,
+				  n > 1 ? LW_EXCLUSIVE : LW_SHARED);
+
+	value = DatumGetInt64(DirectFunctionCall1(nextval_oid, seqoid));
+	if (n > 1 && value >= 0)
+	{
+		if (pg_class_aclcheck(seqoid, GetUserId(), ACL_UPDATE) == ACLCHECK_OK)
+			DirectFunctionCall2(setval_oid,
+								ObjectIdGetDatum(seqoid),
+								Int64GetDatum(value + n - 1));
+		else
+		{
+			int64		i;
+
+			for (i = 1; i < n; i++)
+				(void) DirectFunctionCall1(nextval_oid, seqoid);
+		}
+	}
+
+	LWLockRelease(pgactiveSnowflakeIdCtl->seq_lock);
+
+	if (value < 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("sequence produced negative value"),
+				 errdetail("Sequence \"%s\" produced a negative result. Sequences used as inputs to pgactive global sequence functions must produce positive outputs.",
+						   get_rel_name(seqoid))));
+
+	return value;
+}
 
 /*
  * We generate sequence number from postgres epoch in ms (40 bits),
@@ -47,77 +179,194 @@ PG_FUNCTION_INFO_V1(pgactive_snowflake_id_nextval_oid);
  * 2016), 1024 nodes and 8192 sequences per millisecond (8M per second). Anyone
  * expecting more than that should consider using UUIDs.
  *
- * We wrap the input sequence. If more than 2048 values are generated in a
- * millisecond we could wrap.
+ * With pgactive.snowflake_id_generator = 'sequence' we wrap the input
+ * sequence. If more than 2048 values are generated in a millisecond we could
+ * wrap. All ids of a batch share one timestamp and take consecutive values,
+ * so a batch can't wrap onto itself, but batches and single ids taken
+ * concurrently in the same millisecond can still wrap onto each other.
+ * With 'shmem' the per-millisecond sequence comes from a shared memory
+ * counter instead, and once a millisecond is exhausted ids are taken from the
+ * next one, so there's no wrapping.
  *
  * New variants of this sequence generator may be added by adding new
  * SQL callable functions with different epoch offset and bit ranges,
  * if users have different needs.
+ *
+ * Generates n ids into ids[].
  */
-Datum
-pgactive_snowflake_id_nextval_oid(PG_FUNCTION_ARGS)
+static void
+global_seq_generate(Oid seqoid, int64 current_ts, int64 n, int64 *ids)
 {
-	Oid			seqoid = PG_GETARG_OID(0);
-	Datum		sequenced;
+	pgactiveSnowflakeIdSlot *slot = NULL;
 	int64		sequence;
 	int64		nodeid;
 	int64		timestamp;
-	int64		res;
+	int64		last_timestamp;
+	int64		i;
 
-	/* Oct 7, 2016, when this code was written, in ms */
-	const int64 seq_ts_epoch = 529111339634;
+	Assert(n > 0);
 
-	int64		current_ts = GetCurrentTimestamp();
+	/* timestamp is in milliseconds */
+	timestamp = (current_ts / 1000) - SEQ_TS_EPOCH;
 
-	if (PG_NARGS() == 2)
+	nodeid = global_seq_get_nodeid();
+
+	if (pgactive_snowflake_id_generator == pgactive_SNOWFLAKE_ID_GENERATOR_SHMEM)
+		slot = global_seq_get_shmem_slot(seqoid, timestamp);
+
+	if (slot != NULL)
+		global_seq_shmem_reserve(slot, n, &timestamp, &sequence);
+	else
 	{
 		/*
-		 * We allow an override timestamp to be passed for testing purposes
-		 * using an alternate function signature. We've received one.
+		 * All ids of a batch share one timestamp, so the sequence values
+		 * would wrap within the batch.
 		 */
-		current_ts = PG_GETARG_INT64(1);
-	}
+		if (n > MAX_SEQ_ID)
+			ereport(ERROR,
+					(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+					 errmsg("cannot generate more than %d snowflake ids at once", MAX_SEQ_ID),
+					 errhint("Set pgactive.snowflake_id_generator to \"shmem\" to spread larger batches across milliseconds.")));
 
-	/* timestamp is in milliseconds */
-	timestamp = (current_ts / 1000) - seq_ts_epoch;
-
-	nodeid = global_seq_get_nodeid();
-	sequenced = DirectFunctionCall1(nextval_oid, seqoid);
-	sequence = DatumGetInt64(sequenced) % MAX_SEQ_ID;
+		sequence = global_seq_nextval(seqoid, n) % MAX_SEQ_ID;
+	}
 
 	/*
 	 * This is mainly a failsafe so that we don't generate corrupted sequence
 	 * numbers if machine date is incorrect (or if somebody is still using
 	 * this code after ~2042).
 	 */
-	if (timestamp < 0 || timestamp > MAX_TIMESTAMP)
+	last_timestamp = slot != NULL ?
+		timestamp + (sequence + n - 1) / MAX_SEQ_ID : timestamp;
+	if (timestamp < 0 || last_timestamp > MAX_TIMESTAMP)
 		elog(ERROR, "cannot generate sequence, timestamp " UINT64_FORMAT " out of range 0 .. " UINT64_FORMAT,
-			 timestamp, MAX_TIMESTAMP);
+			 timestamp < 0 ? timestamp : last_timestamp, MAX_TIMESTAMP);
 
 	if (nodeid < 0 || nodeid > MAX_NODE_ID)
 		elog(ERROR, "nodeid must be in range 0 .. %d", MAX_NODE_ID);
 
-	if (sequence < 0)
-		ereport(ERROR,
-				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
-				 errmsg("sequence produced negative value"),
-				 errdetail("Sequence \"%s\" produced a negative result. Sequences used as inputs to pgactive global sequence functions must produce positive outputs.",
-						   get_rel_name(seqoid))));
-
-	Assert(sequence >= 0 && sequence < MAX_SEQ_ID);
-
 	/* static assertions against programmer error: */
 	Assert((MAX_SEQ_ID + 1) % 2 == 0);
 
 	Assert(TIMESTAMP_BITS + NODEID_BITS + SEQUENCE_BITS == 64);
 
-	res = (timestamp << (64 - TIMESTAMP_BITS)) |
-		(nodeid << (64 - TIMESTAMP_BITS - NODEID_BITS)) |
-		sequence;
+	for (i = 0; i < n; i++)
+	{
+		Assert(sequence >= 0 && sequence < MAX_SEQ_ID);
+
+		ids[i] = (timestamp << (64 - TIMESTAMP_BITS)) |
+			(nodeid << (64 - TIMESTAMP_BITS - NODEID_BITS)) |
+			sequence;
+
+		if (i + 1 == n)
+			break;
+
+		if (++sequence == MAX_SEQ_ID)
+		{
+			/* a shmem slot's reserved range continues in the next ms */
+			if (slot != NULL)
+				timestamp++;
+			sequence = 0;
+		}
+	}
+}
+
+Datum
+pgactive_snowflake_id_nextval_oid(PG_FUNCTION_ARGS)
+{
+	Oid			seqoid = PG_GETARG_OID(0);
+	int64		current_ts = GetCurrentTimestamp();
+	int64		res;
+
+	if (PG_NARGS() == 2)
+	{
+		/*
+		 * We allow an override timestamp to be passed for testing purposes
+		 * using an alternate function signature. We've received one.
+		 */
+		current_ts = PG_GETARG_INT64(1);
+	}
+
+	global_seq_generate(seqoid, current_ts, 1, &res);
 
 	PG_RETURN_INT64(res);
 }
 
+/*
+ * Reserve n ids in one go, for loaders that pre-assign keys.
+ */
+static int64 *
+global_seq_generate_batch(FunctionCallInfo fcinfo, int32 *n)
+{
+	Oid			seqoid = PG_GETARG_OID(0);
+	int64	   *ids;
+
+	*n = PG_GETARG_INT32(1);
+
+	if (*n <= 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("number of snowflake ids must be greater than zero")));
+
+	if (*n > pgactive_SNOWFLAKE_ID_MAX_BATCH)
+		ereport(ERROR,
+				(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+				 errmsg("cannot generate more than %d snowflake ids at once",
+						pgactive_SNOWFLAKE_ID_MAX_BATCH)));
+
+	ids = palloc(sizeof(int64) * (*n));
+	global_seq_generate(seqoid, GetCurrentTimestamp(), *n, ids);
+
+	return ids;
+}
+
+Datum
+pgactive_snowflake_id_nextval_batch(PG_FUNCTION_ARGS)
+{
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	int64	   *ids;
+	int32		n;
+	int32		i;
+
+	ids = global_seq_generate_batch(fcinfo, &n);
+
+	/* Construct the tuplestore and tuple descriptor */
+	InitMaterializedSRF(fcinfo, 0);
+
+	for (i = 0; i < n; i++)
+	{
+		Datum		value = Int64GetDatum(ids[i]);
+		bool		isnull = false;
+
+		tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc,
+							 &value, &isnull);
+	}
+
+	pfree(ids);
+
+	PG_RETURN_VOID();
+}
+
+Datum
+pgactive_snowflake_id_nextval_array(PG_FUNCTION_ARGS)
+{
+	int64	   *ids;
+	Datum	   *elems;
+	int32		n;
+	int32		i;
+
+	ids = global_seq_generate_batch(fcinfo, &n);
+
+	elems = palloc(sizeof(Datum) * n);
+	for (i = 0; i < n; i++)
+		elems[i] = Int64GetDatum(ids[i]);
+
+	pfree(ids);
+
+	PG_RETURN_ARRAYTYPE_P(construct_array(elems, n, INT8OID, sizeof(int64),
+										  FLOAT8PASSBYVAL, TYPALIGN_DOUBLE));
+}
+
 /*
  * Read the unique node id for this node.
  */
@@ -153,3 +402,386 @@ global_seq_get_nodeid(void)
 
 	return seq_nodeid;
 }
+
+/*
+ * Read the high-water mark a previous server run persisted into the
+ * underlying sequence, or 0 if the sequence was never used.
+ */
+static int64
+global_seq_read_horizon(Oid seqoid)
+{
+	LOCAL_FCINFO(fcinfo, 1);
+	Datum		result;
+
+	InitFunctionCallInfoData(*fcinfo, NULL, 1, InvalidOid, NULL, NULL);
+	fcinfo->args[0].value = ObjectIdGetDatum(seqoid);
+	fcinfo->args[0].isnull = false;
+
+	result = pg_sequence_last_value(fcinfo);
+
+	if (fcinfo->isnull)
+		return 0;
+
+	return Max(DatumGetInt64(result), 0);
+}
+
+/*
+ * The shmem generator persists millisecond timestamps in the underlying
+ * sequence, which has to be able to hold all of them.
+ */
+static void
+global_seq_check_shmem_bounds(Oid seqoid, int64 timestamp)
+{
+	HeapTuple	tuple;
+	Form_pg_sequence seqform;
+	int64		min_value = Max(timestamp, 0);
+	int64		max_value = MAX_TIMESTAMP + pgactive_SNOWFLAKE_ID_HORIZON_MS;
+
+	tuple = SearchSysCache1(SEQRELID, ObjectIdGetDatum(seqoid));
+	if (!HeapTupleIsValid(tuple))
+		elog(ERROR, "cache lookup failed for sequence %u", seqoid);
+	seqform = (Form_pg_sequence) GETSTRUCT(tuple);
+
+	if (seqform->seqmin > min_value || seqform->seqmax < max_value)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("sequence \"%s\" cannot be used with pgactive.snowflake_id_generator = shmem",
+						get_rel_name(seqoid)),
+				 errdetail("The sequence must accept values from " INT64_FORMAT " to " INT64_FORMAT ", but its range is " INT64_FORMAT " to " INT64_FORMAT ".",
+						   min_value, max_value,
+						   seqform->seqmin, seqform->seqmax),
+				 errhint("Change the sequence with ALTER SEQUENCE ... AS bigint MINVALUE 1 NO MAXVALUE, or set pgactive.snowflake_id_generator to \"sequence\".")));
+
+	ReleaseSysCache(tuple);
+}
+
+/*
+ * Release the shmem generator slots of sequences that have been dropped, and
+ * of databases that have been dropped. Sequences of other databases aren't
+ * visible here, their slots are kept. Returns whether a slot was released.
+ *
+ * A slot is only released if it still belongs to the same sequence once the
+ * lock is taken exclusively. Releasing the slot of a sequence whose drop
+ * rolls back is harmless: the sequence gets a slot again the next time it's
+ * used, restarting from the horizon persisted in it.
+ */
+static bool
+global_seq_reclaim_shmem_slots(void)
+{
+	Oid			dboids[pgactive_SNOWFLAKE_ID_SLOTS];
+	Oid			seqoids[pgactive_SNOWFLAKE_ID_SLOTS];
+	bool		released = false;
+	int			i;
+
+	LWLockAcquire(pgactiveSnowflakeIdCtl->lock, LW_SHARED);
+	for (i = 0; i < pgactive_SNOWFLAKE_ID_SLOTS; i++)
+	{
+		dboids[i] = pgactiveSnowflakeIdCtl->slots[i].dboid;
+		seqoids[i] = pgactiveSnowflakeIdCtl->slots[i].seqoid;
+	}
+	LWLockRelease(pgactiveSnowflakeIdCtl->lock);
+
+	/* Look the relations up without holding the lock */
+	for (i = 0; i < pgactive_SNOWFLAKE_ID_SLOTS; i++)
+	{
+		if (seqoids[i] == InvalidOid)
+			continue;
+
+		if (dboids[i] == MyDatabaseId ?
+			SearchSysCacheExists1(RELOID, ObjectIdGetDatum(seqoids[i])) :
+			SearchSysCacheExists1(DATABASEOID, ObjectIdGetDatum(dboids[i])))
+			seqoids[i] = InvalidOid;
+	}
+
+	LWLockAcquire(pgactiveSnowflakeIdCtl->lock, LW_EXCLUSIVE);
+	for (i = 0; i < pgactive_SNOWFLAKE_ID_SLOTS; i++)
+	{
+		pgactiveSnowflakeIdSlot *s = &pgactiveSnowflakeIdCtl->slots[i];
+
+		if (seqoids[i] == InvalidOid ||
+			s->seqoid != seqoids[i] || s->dboid != dboids[i])
+			continue;
+
+		elog(DEBUG1, "releasing pgactive snowflake id generator slot of dropped sequence %u",
+			 s->seqoid);
+		s->seqoid = InvalidOid;
+		s->dboid = InvalidOid;
+		released = true;
+	}
+	LWLockRelease(pgactiveSnowflakeIdCtl->lock);
+
+	if (released)
+		seq_last_slot = NULL;
+
+	return released;
+}
+
+/*
+ * Find, or assign, the shmem generator slot for a sequence in the current
+ * database. Returns NULL if all slots are in use, in which case the caller
+ * falls back to the nextval() based generator.
+ */
+static pgactiveSnowflakeIdSlot *
+global_seq_get_shmem_slot(Oid seqoid, int64 timestamp)
+{
+	pgactiveSnowflakeIdSlot *slot = NULL;
+	pgactiveSnowflakeIdSlot *free_slot;
+	int64		horizon;
+	bool		reclaimed = false;
+	int			i;
+
+	if (pgactiveSnowflakeIdCtl == NULL)
+		elog(ERROR, "cannot use pgactive snowflake id generator without loading pgactive");
+
+	if (seq_last_slot != NULL &&
+		seq_last_slot->seqoid == seqoid &&
+		seq_last_slot->dboid == MyDatabaseId)
+		return seq_last_slot;
+
+	LWLockAcquire(pgactiveSnowflakeIdCtl->lock, LW_SHARED);
+	for (i = 0; i < pgactive_SNOWFLAKE_ID_SLOTS; i++)
+	{
+		pgactiveSnowflakeIdSlot *s = &pgactiveSnowflakeIdCtl->slots[i];
+
+		if (s->seqoid == seqoid && s->dboid == MyDatabaseId)
+		{
+			slot = s;
+			break;
+		}
+	}
+	LWLockRelease(pgactiveSnowflakeIdCtl->lock);
+
+	if (slot != NULL)
+	{
+		seq_last_slot = slot;
+		return slot;
+	}
+
+	/*
+	 * Read the persisted horizon and check the sequence before taking the
+	 * lock exclusively, the sequence access can ERROR out (e.g. on
+	 * permissions).
+	 */
+	horizon = global_seq_read_horizon(seqoid);
+	global_seq_check_shmem_bounds(seqoid, timestamp);
+
+	for (;;)
+	{
+		free_slot = NULL;
+
+		LWLockAcquire(pgactiveSnowflakeIdCtl->lock, LW_EXCLUSIVE);
+		for (i = 0; i < pgactive_SNOWFLAKE_ID_SLOTS; i++)
+		{
+			pgactiveSnowflakeIdSlot *s = &pgactiveSnowflakeIdCtl->slots[i];
+
+			if (s->seqoid == seqoid && s->dboid == MyDatabaseId)
+			{
+				/* somebody else got here first */
+				slot = s;
+				break;
+			}
+
+			if (free_slot == NULL && s->seqoid == InvalidOid)
+				free_slot = s;
+		}
+
+		if (slot == NULL && free_slot != NULL)
+		{
+			slot = free_slot;
+
+			/*
+			 * Ids with timestamps up to the horizon may have been handed out
+			 * before a crash, so pretend the whole horizon millisecond has
+			 * been used up. The next id is taken from horizon + 1 or later.
+			 */
+			pg_atomic_write_u64(&slot->state,
+								((uint64) horizon << SEQUENCE_BITS) | (MAX_SEQ_ID - 1));
+			pg_atomic_write_u64(&slot->horizon, (uint64) horizon);
+			slot->dboid = MyDatabaseId;
+			pg_write_barrier();
+			slot->seqoid = seqoid;
+		}
+		LWLockRelease(pgactiveSnowflakeIdCtl->lock);
+
+		/* All slots in use, try once to make room */
+		if (slot != NULL || reclaimed)
+			break;
+		reclaimed = true;
+		if (!global_seq_reclaim_shmem_slots())
+			break;
+	}
+
+	if (slot == NULL)
+		elog(DEBUG1, "no free pgactive snowflake id generator slot for sequence %u, falling back to nextval",
+			 seqoid);
+
+	seq_last_slot = slot;
+	return slot;
+}
+
+/*
+ * Get the owner of a sequence.
+ */
+static Oid
+global_seq_get_owner(Oid seqoid)
+{
+	HeapTuple	tuple;
+	Oid			owner;
+
+	tuple = SearchSysCache1(RELOID, ObjectIdGetDatum(seqoid));
+	if (!HeapTupleIsValid(tuple))
+		elog(ERROR, "cache lookup failed for relation %u", seqoid);
+	owner = ((Form_pg_class) GETSTRUCT(tuple))->relowner;
+	ReleaseSysCache(tuple);
+
+	return owner;
+}
+
+/*
+ * Reserve n consecutive (timestamp, sequence) pairs from a shmem generator
+ * slot with a single atomic operation, spilling into following milliseconds
+ * once a millisecond's sequence space is exhausted.
+ *
+ * *timestamp is the current time on entry; on exit *timestamp and *sequence
+ * are the first reserved pair, which is later than the current time if the
+ * clock went backwards or ids were borrowed from the future before.
+ */
+static void
+global_seq_shmem_reserve(pgactiveSnowflakeIdSlot * slot, int64 n,
+						 int64 *timestamp, int64 *sequence)
+{
+	uint64		oldval;
+	uint64		newval;
+	int64		first_ts;
+	int64		first_seq;
+	int64		end_ts;
+
+	Assert(n > 0);
+
+	oldval = pg_atomic_read_u64(&slot->state);
+	for (;;)
+	{
+		int64		last_ts = (int64) (oldval >> SEQUENCE_BITS);
+		int64		last_seq = (int64) (oldval & MAX_SEQ_ID);
+		int64		end_seq;
+
+		if (*timestamp > last_ts)
+		{
+			first_ts = *timestamp;
+			first_seq = 0;
+		}
+		else if (last_seq + 1 < MAX_SEQ_ID)
+		{
+			first_ts = last_ts;
+			first_seq = last_seq + 1;
+		}
+		else
+		{
+			first_ts = last_ts + 1;
+			first_seq = 0;
+		}
+
+		end_ts = first_ts + (first_seq + n - 1) / MAX_SEQ_ID;
+		end_seq = (first_seq + n - 1) % MAX_SEQ_ID;
+
+		newval = ((uint64) end_ts << SEQUENCE_BITS) | (uint64) end_seq;
+
+		if (pg_atomic_compare_exchange_u64(&slot->state, &oldval, newval))
+			break;
+	}
+
+	/*
+	 * Make sure the last timestamp we're about to use is covered by the
+	 * horizon persisted in the underlying sequence, advancing it if required.
+	 * This is the only time the sequence itself is touched.
+	 */
+	if ((uint64) end_ts > pg_atomic_read_u64(&slot->horizon))
+	{
+		LWLockAcquire(pgactiveSnowflakeIdCtl->lock, LW_EXCLUSIVE);
+		if ((uint64) end_ts > pg_atomic_read_u64(&slot->horizon))
+		{
+			int64		new_horizon = end_ts + pgactive_SNOWFLAKE_ID_HORIZON_MS;
+			Oid			save_userid;
+			int			save_sec_context;
+
+			/*
+			 * setval() is WAL-logged and assigns an xid, so the commit of any
+			 * transaction that uses an id below the new horizon flushes it.
+			 *
+			 * Taking ids only requires the USAGE privilege, like nextval(),
+			 * but setval() requires UPDATE. The horizon is the generator's
+			 * own bookkeeping, so it's persisted as the sequence's owner.
+			 */
+			GetUserIdAndSecContext(&save_userid, &save_sec_context);
+			SetUserIdAndSecContext(global_seq_get_owner(slot->seqoid),
+								   save_sec_context |
+								   SECURITY_LOCAL_USERID_CHANGE |
+								   SECURITY_RESTRICTED_OPERATION);
+			DirectFunctionCall2(setval_oid,
+								ObjectIdGetDatum(slot->seqoid),
+								Int64GetDatum(new_horizon));
+			SetUserIdAndSecContext(save_userid, save_sec_context);
+			pg_atomic_write_u64(&slot->horizon, (uint64) new_horizon);
+		}
+		LWLockRelease(pgactiveSnowflakeIdCtl->lock);
+	}
+
+	*timestamp = first_ts;
+	*sequence = first_seq;
+}
+
+/*
+ * pgactive snowflake id generator shared memory functions.
+ */
+
+static size_t
+pgactive_seq_shmem_size(void)
+{
+	return sizeof(pgactiveSnowflakeIdControl);
+}
+
+static void
+pgactive_seq_shmem_startup(void)
+{
+	bool		found;
+
+	if (prev_shmem_startup_hook != NULL)
+		prev_shmem_startup_hook();
+
+	LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
+	pgactiveSnowflakeIdCtl = ShmemInitStruct("pgactive_snowflake_id",
+											 pgactive_seq_shmem_size(),
+											 &found);
+	if (!found)
+	{
+		LWLockPadded *locks = GetNamedLWLockTranche("pgactive_snowflake_id");
+		int			i;
+
+		memset(pgactiveSnowflakeIdCtl, 0, pgactive_seq_shmem_size());
+		pgactiveSnowflakeIdCtl->lock = &locks[0].lock;
+		pgactiveSnowflakeIdCtl->seq_lock = &locks[1].lock;
+
+		for (i = 0; i < pgactive_SNOWFLAKE_ID_SLOTS; i++)
+		{
+			pg_atomic_init_u64(&pgactiveSnowflakeIdCtl->slots[i].state, 0);
+			pg_atomic_init_u64(&pgactiveSnowflakeIdCtl->slots[i].horizon, 0);
+		}
+	}
+	LWLockRelease(AddinShmemInitLock);
+}
+
+/* Needs to be called from a shared_preload_library _PG_init() */
+void
+pgactive_seq_shmem_init(void)
+{
+	/* Must be called from postmaster its self */
+	Assert(IsPostmasterEnvironment && !IsUnderPostmaster);
+
+	pgactiveSnowflakeIdCtl = NULL;
+
+	RequestAddinShmemSpace(pgactive_seq_shmem_size());
+	RequestNamedLWLockTranche("pgactive_snowflake_id", 2);
+
+	prev_shmem_startup_hook = shmem_startup_hook;
+	shmem_startup_hook = pgactive_seq_shmem_startup;
+}
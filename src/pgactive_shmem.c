@@ -70,6 +70,8 @@ pgactive_shmem_init(void)
 	pgactive_locks_shmem_init();
 
 	pgactive_nid_shmem_init();
+
+	pgactive_seq_shmem_init();
 }
 
 /*
@@ -237,6 +239,13 @@ pgactive_worker_shmem_alloc(pgactiveWorkerType worker_type, uint32 *ctl_idx)
 		{
 			memset(new_entry, 0, sizeof(pgactiveWorker));
 			new_entry->worker_type = worker_type;
+			if (worker_type == pgactive_WORKER_PERDB)
+				SpinLockInit(&new_entry->data.perdb.join_progress.mutex);
+			else if (worker_type == pgactive_WORKER_APPLY)
+			{
+				SpinLockInit(&new_entry->data.apply.timing.mutex);
+				SpinLockInit(&new_entry->data.apply.progress.mutex);
+			}
 			if (ctl_idx)
 				*ctl_idx = i;
 			return new_entry;
@@ -198,7 +198,8 @@ pgactive_register_perdb_worker(Oid dboid)
 
 		(void) pgactiveWaitLatch(&MyProc->procLatch,
 								 WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
-								 100L, PG_WAIT_EXTENSION);
+								 100L,
+								 pgactive_wait_event(pgactive_WAIT_SUPERVISOR_PERDB_START));
 		ResetLatch(&MyProc->procLatch);
 		CHECK_FOR_INTERRUPTS();
 
@@ -638,7 +639,8 @@ pgactive_supervisor_worker_main(Datum main_arg)
 		 */
 		rc = pgactiveWaitLatch(&MyProc->procLatch,
 							   WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
-							   timeout, PG_WAIT_EXTENSION);
+							   timeout,
+							   pgactive_wait_event(pgactive_WAIT_SUPERVISOR_MAIN));
 		ResetLatch(&MyProc->procLatch);
 		CHECK_FOR_INTERRUPTS();
 
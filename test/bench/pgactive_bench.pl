@@ -0,0 +1,309 @@
+#!/usr/bin/env perl
+#
+# Replication benchmark harness.
+#
+# Brings up a local group of pgactive nodes, drives pgbench workloads against
+# them and writes a JSON report of how replication kept up with each one:
+# pgbench throughput, changes applied per second, replication lag percentiles,
+# CPU time used by the walsenders, bytes decoding spilled to disk and the
+# conflicts the apply workers ran into.
+#
+# Run it with "make bench" or "meson test --benchmark", which set up the
+# environment the same way as for the TAP tests. It is configured through
+# environment variables:
+#
+#   PGACTIVE_BENCH_NODES      number of nodes in the group (3)
+#   PGACTIVE_BENCH_DURATION   seconds each workload runs for (30)
+#   PGACTIVE_BENCH_CLIENTS    pgbench clients per node (4)
+#   PGACTIVE_BENCH_WORKLOADS  comma separated workloads to run (all)
+#   PGACTIVE_BENCH_REPORT     where to write the report
+#                             (pgactive_bench.json in the test data directory)
+#
+# Workloads run on every node at once, see %workloads for what they do. The
+# pgbench scripts are in test/bench/scripts.
+#
+use strict;
+use warnings;
+use lib 'test/t/';
+use Cwd;
+use Config;
+use IPC::Run;
+use JSON::PP;
+use POSIX qw(strftime);
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+use Time::HiRes qw(time usleep);
+use utils::nodemanagement;
+
+my $nnodes = $ENV{PGACTIVE_BENCH_NODES} // 3;
+my $duration = $ENV{PGACTIVE_BENCH_DURATION} // 30;
+my $clients = $ENV{PGACTIVE_BENCH_CLIENTS} // 4;
+my $report_file = $ENV{PGACTIVE_BENCH_REPORT}
+	// "$PostgreSQL::Test::Utils::tmp_check/pgactive_bench.json";
+my $scripts = 'test/bench/scripts';
+
+# Each workload creates its table, runs its pgbench script on every node and
+# optionally runs an additional script on the first node only.
+my %workloads = (
+	insert_heavy => {
+		ddl => q[CREATE TABLE public.bench_insert(id uuid PRIMARY KEY DEFAULT gen_random_uuid(), node integer, payload text, note integer, created_at timestamptz DEFAULT now());],
+		table => 'public.bench_insert',
+		script => 'insert_heavy.sql',
+	},
+	update_hotspot => {
+		ddl => q[CREATE TABLE public.bench_hot(id integer PRIMARY KEY, counter bigint NOT NULL, updated_by integer);],
+		setup => q[INSERT INTO public.bench_hot SELECT g, 0, NULL FROM generate_series(1, 100) g;],
+		table => 'public.bench_hot',
+		script => 'update_hotspot.sql',
+	},
+	wide_rows => {
+		ddl => q[CREATE TABLE public.bench_wide(id uuid PRIMARY KEY DEFAULT gen_random_uuid(), node integer, i1 bigint, i2 bigint, i3 bigint, i4 bigint, f1 double precision, f2 double precision, t1 text, t2 text, t3 text, t4 text, ts timestamptz, doc jsonb, blob bytea);],
+		table => 'public.bench_wide',
+		script => 'wide_rows.sql',
+	},
+	large_xact => {
+		ddl => q[CREATE TABLE public.bench_large(id uuid PRIMARY KEY DEFAULT gen_random_uuid(), node integer, n integer, payload text);],
+		table => 'public.bench_large',
+		script => 'large_xact.sql',
+		clients => 1,
+	},
+	ddl_under_load => {
+		# Reuses the table of insert_heavy, creating it if that didn't run.
+		ddl => q[CREATE TABLE IF NOT EXISTS public.bench_insert(id uuid PRIMARY KEY DEFAULT gen_random_uuid(), node integer, payload text, note integer, created_at timestamptz DEFAULT now());],
+		table => 'public.bench_insert',
+		script => 'insert_heavy.sql',
+		extra => { script => 'ddl_under_load.sql', rate => 1 },
+		# Acquiring the global DDL lock terminates writers on the other
+		# nodes, so pgbench runs may end early with aborted clients.
+		tolerate_aborts => 1,
+	},
+);
+my @order = qw(insert_heavy update_hotspot wide_rows large_xact ddl_under_load);
+
+my @run = defined $ENV{PGACTIVE_BENCH_WORKLOADS}
+	? split(/\s*,\s*/, $ENV{PGACTIVE_BENCH_WORKLOADS}) : @order;
+foreach my $name (@run)
+{
+	BAIL_OUT("unknown workload $name, expected one of: @order")
+		if !exists $workloads{$name};
+}
+
+my $nodes = make_pgactive_group($nnodes, 'bench_');
+
+# Small enough for the large transactions to spill.
+foreach my $node (@$nodes)
+{
+	$node->append_conf('postgresql.conf', q{logical_decoding_work_mem = '1MB'});
+	$node->reload;
+}
+
+my $node_0 = $nodes->[0];
+my $pg_version = $node_0->safe_psql($pgactive_test_dbname,
+	q[SELECT current_setting('server_version_num')::int / 10000;]);
+
+my %report = (
+	started_at => strftime('%Y-%m-%dT%H:%M:%SZ', gmtime),
+	server_version => $node_0->safe_psql($pgactive_test_dbname, 'SHOW server_version'),
+	pgactive_version => $node_0->safe_psql($pgactive_test_dbname, 'SELECT pgactive.pgactive_version()'),
+	nodes => $nnodes + 0,
+	clients_per_node => $clients + 0,
+	duration => $duration + 0,
+	workloads => [],
+);
+
+foreach my $name (@run)
+{
+	note "running workload $name";
+	push @{ $report{workloads} }, run_workload($name, $workloads{$name});
+}
+
+open(my $fh, '>', $report_file) or die "could not open $report_file: $!";
+print $fh JSON::PP->new->canonical->pretty->encode(\%report);
+close($fh) or die "could not close $report_file: $!";
+note "report written to $report_file";
+
+done_testing();
+
+sub run_workload
+{
+	my ($name, $w) = @_;
+
+	exec_ddl($node_0, $w->{ddl});
+	$node_0->safe_psql($pgactive_test_dbname, $w->{setup}) if defined $w->{setup};
+	wait_for_all_apply();
+
+	my $before = collect_counters();
+	my @lag_samples;
+	my $max_lag_bytes = 0;
+	my $start = time;
+
+	my @runs;
+	for (my $i = 0; $i < $nnodes; $i++)
+	{
+		push @runs, start_pgbench($nodes->[$i], $i, $w->{script}, $w->{clients} // $clients);
+	}
+	push @runs, start_pgbench($node_0, 0, $w->{extra}{script}, 1, $w->{extra}{rate})
+		if defined $w->{extra};
+
+	# Sample the replication lag until the load stops.
+	while (grep { $_->{handle}->pumpable } @runs)
+	{
+		foreach my $node (@$nodes)
+		{
+			my ($lag, $bytes) = split(/\|/, $node->safe_psql($pgactive_test_dbname, q[
+				SELECT coalesce(extract(epoch FROM max(replay_lag)) * 1000, 0),
+					coalesce(max(lag_bytes), 0)
+				FROM pgactive.pgactive_get_local_replication_lag()
+				WHERE direction = 'outbound';]));
+			push @lag_samples, $lag + 0;
+			$max_lag_bytes = $bytes if $bytes > $max_lag_bytes;
+		}
+		$_->{handle}->pump_nb foreach (@runs);
+		usleep(500_000);
+	}
+
+	my $load_end = time;
+	my %pgbench = (transactions => 0, failed => 0, tps => 0, aborted_runs => 0);
+	foreach my $run (@runs)
+	{
+		$run->{handle}->finish;
+
+		# pgbench exits with 2 if clients were aborted
+		my $res = $run->{handle}->result(0);
+		my $ok = ok($res == 0 || ($res == 2 && $w->{tolerate_aborts}),
+			"pgbench $run->{script} on " . $run->{node}->name . " for workload $name");
+		diag $run->{stderr} if !$ok;
+		$pgbench{aborted_runs}++ if $res != 0;
+		next if $run->{extra};
+
+		$pgbench{transactions} += $1 if $run->{stdout} =~ /number of transactions actually processed: (\d+)/;
+		$pgbench{failed} += $1 if $run->{stdout} =~ /number of failed transactions: (\d+)/;
+		$pgbench{tps} += $1 if $run->{stdout} =~ /tps = ([\d.]+)/;
+	}
+
+	wait_for_all_apply();
+	my $end = time;
+	my $after = collect_counters();
+
+	# All nodes end up with the same rows.
+	my @counts = map {
+		$_->safe_psql($pgactive_test_dbname, "SELECT count(*) FROM $w->{table}")
+	} @$nodes;
+	is(scalar(grep { $_ ne $counts[0] } @counts), 0,
+		"$w->{table} has the same number of rows on all nodes after workload $name");
+
+	my %delta = map { $_ => $after->{$_} - $before->{$_} } keys %$after;
+	my $elapsed = $end - $start;
+
+	return {
+		name => $name,
+		pgbench => \%pgbench,
+		apply => {
+			xacts => $delta{xacts},
+			rows => $delta{rows},
+			rows_per_sec => $elapsed > 0 ? $delta{rows} / $elapsed : undef,
+			catchup_seconds => $end - $load_end,
+		},
+		lag_ms => {
+			samples => scalar(@lag_samples),
+			p50 => percentile(\@lag_samples, 50),
+			p95 => percentile(\@lag_samples, 95),
+			p99 => percentile(\@lag_samples, 99),
+			max => percentile(\@lag_samples, 100),
+		},
+		max_lag_bytes => $max_lag_bytes + 0,
+		walsender_cpu_seconds => defined $after->{cpu} ? $delta{cpu} : undef,
+		spill_bytes => $pg_version >= 14 ? $delta{spill_bytes} : undef,
+		spill_count => $pg_version >= 14 ? $delta{spill_count} : undef,
+		conflicts => $delta{conflicts},
+		conflict_rate => $delta{rows} > 0 ? $delta{conflicts} / $delta{rows} : 0,
+	};
+}
+
+sub start_pgbench
+{
+	my ($node, $nodeno, $script, $nclients, $rate) = @_;
+	my %run = (node => $node, script => $script, extra => defined $rate,
+		stdout => '', stderr => '');
+
+	my @cmd = ('pgbench', '-n', '-T', $duration, '-c', $nclients, '-j', $nclients,
+		'-D', "node=$nodeno", '-f', "$scripts/$script");
+	push @cmd, '-R', $rate if defined $rate;
+	push @cmd, $node->connstr($pgactive_test_dbname);
+
+	$run{handle} = IPC::Run::start(\@cmd, '>', \$run{stdout}, '2>', \$run{stderr});
+	return \%run;
+}
+
+sub wait_for_all_apply
+{
+	foreach my $node (@$nodes)
+	{
+		foreach my $peer (@$nodes)
+		{
+			wait_for_apply($node, $peer) if $node != $peer;
+		}
+	}
+}
+
+# Sum up the counters the report is built from over all nodes.
+sub collect_counters
+{
+	my %c = (xacts => 0, rows => 0, conflicts => 0, spill_bytes => 0,
+		spill_count => 0, cpu => 0);
+	my $ticks = POSIX::sysconf(POSIX::_SC_CLK_TCK());
+
+	foreach my $node (@$nodes)
+	{
+		my ($xacts, $rows, $conflicts) = split(/\|/, $node->safe_psql($pgactive_test_dbname, q[
+			SELECT coalesce(sum(nr_commit), 0), coalesce(sum(nr_insert + nr_update + nr_delete), 0),
+				coalesce(sum(nr_insert_conflict + nr_update_conflict + nr_delete_conflict), 0)
+			FROM pgactive.pgactive_get_stats();]));
+		$c{xacts} += $xacts;
+		$c{rows} += $rows;
+		$c{conflicts} += $conflicts;
+
+		if ($pg_version >= 14)
+		{
+			my ($bytes, $count) = split(/\|/, $node->safe_psql($pgactive_test_dbname, q[
+				SELECT coalesce(sum(spill_bytes), 0), coalesce(sum(spill_count), 0)
+				FROM pg_catalog.pg_stat_replication_slots
+				WHERE slot_name LIKE 'pgactive%';]));
+			$c{spill_bytes} += $bytes;
+			$c{spill_count} += $count;
+		}
+
+		# CPU time of the walsenders, from /proc where there is one.
+		my @pids = split(/\n/, $node->safe_psql($pgactive_test_dbname, q[
+			SELECT pid FROM pgactive.pgactive_get_local_replication_lag()
+			WHERE direction = 'outbound';]));
+		foreach my $pid (@pids)
+		{
+			if (!defined $ticks || !open(my $stat, '<', "/proc/$pid/stat"))
+			{
+				$c{cpu} = undef;
+				last;
+			}
+			else
+			{
+				my @f = split(/\s+/, (split(/\)\s+/, <$stat>))[1]);
+				close($stat);
+				# utime and stime, fields 14 and 15 of the file
+				$c{cpu} += ($f[11] + $f[12]) / $ticks if defined $c{cpu};
+			}
+		}
+	}
+
+	return \%c;
+}
+
+sub percentile
+{
+	my ($samples, $pct) = @_;
+	return undef if !@$samples;
+
+	my @sorted = sort { $a <=> $b } @$samples;
+	my $idx = int(($pct / 100) * $#sorted + 0.5);
+	return $sorted[$idx];
+}
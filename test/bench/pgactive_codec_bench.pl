@@ -0,0 +1,105 @@
+#!/usr/bin/env perl
+#
+# Tuple codec microbenchmark.
+#
+# Runs rows of tables covering the common column types through the output
+# plugin's tuple encoding and the apply worker's decoding with
+# pgactive._bench_roundtrip, and writes a JSON report of the nanoseconds and
+# bytes each row and each column took. No replication is involved, so
+# changes to the protocol paths show up here without the noise of a cluster.
+#
+# Run it with "make bench" or "meson test --benchmark". It is configured
+# through environment variables:
+#
+#   PGACTIVE_CODEC_BENCH_ROWS    rows per table (100000)
+#   PGACTIVE_CODEC_BENCH_REPORT  where to write the report
+#                                (pgactive_codec_bench.json in the test data
+#                                directory)
+#
+use strict;
+use warnings;
+use lib 'test/t/';
+use Cwd;
+use Config;
+use JSON::PP;
+use POSIX qw(strftime);
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+use utils::nodemanagement;
+
+my $nrows = $ENV{PGACTIVE_CODEC_BENCH_ROWS} // 100000;
+my $report_file = $ENV{PGACTIVE_CODEC_BENCH_REPORT}
+	// "$PostgreSQL::Test::Utils::tmp_check/pgactive_codec_bench.json";
+
+# Each table is filled with $nrows rows of the given expressions of g, the
+# row number.
+my %tables = (
+	codec_fixed => {
+		ddl => q[CREATE TABLE public.codec_fixed(i2 smallint, i4 integer, i8 bigint, f4 real, f8 double precision, b boolean, d date, ts timestamp, tstz timestamptz, u uuid, o oid);],
+		fill => q[g::smallint, g, g * 1000000007, g / 3.0, g / 7.0, g % 2 = 0, date '2000-01-01' + g % 10000, timestamp '2000-01-01' + g * interval '1 second', now() - g * interval '1 minute', gen_random_uuid(), g],
+	},
+	codec_varlena => {
+		ddl => q[CREATE TABLE public.codec_varlena(t_short text, t_long text, vc varchar(64), n numeric, ba bytea, j jsonb, iv interval, ip inet);],
+		fill => q['row ' || g, repeat(md5(g::text), 64), 'varchar ' || g, g * 3.14159, decode(md5(g::text), 'hex'), jsonb_build_object('id', g, 'tags', jsonb_build_array('a', 'b', g)), g * interval '1 minute', ('10.0.' || g % 256 || '.' || g % 200)::inet],
+	},
+	codec_composite => {
+		ddl => q[CREATE TYPE public.codec_pair AS (a integer, b text); CREATE TABLE public.codec_composite(ia integer[], ta text[], pair public.codec_pair, nulls text);],
+		fill => q[ARRAY[g, g + 1, g + 2], ARRAY['x' || g, 'y' || g], ROW(g, 'p' || g)::public.codec_pair, NULL],
+	},
+);
+
+my $node = PostgreSQL::Test::Cluster->new('codec');
+initandstart_node($node, $pgactive_test_dbname);
+
+my %report = (
+	started_at => strftime('%Y-%m-%dT%H:%M:%SZ', gmtime),
+	server_version => $node->safe_psql($pgactive_test_dbname, 'SHOW server_version'),
+	pgactive_version => $node->safe_psql($pgactive_test_dbname, 'SELECT pgactive.pgactive_version()'),
+	rows => $nrows + 0,
+	tables => [],
+);
+
+foreach my $name (sort keys %tables)
+{
+	note "benchmarking table $name";
+
+	$node->safe_psql($pgactive_test_dbname, $tables{$name}{ddl});
+	$node->safe_psql($pgactive_test_dbname,
+		"INSERT INTO public.$name SELECT $tables{$name}{fill} FROM generate_series(1, $nrows) g;");
+
+	my @columns;
+	my $tuple;
+	foreach my $line (split(/\n/, $node->safe_psql($pgactive_test_dbname, qq[
+		SELECT column_name, type_name, format, bytes_per_row, encode_ns_per_row, decode_ns_per_row
+		FROM pgactive._bench_roundtrip('public.$name', $nrows);])))
+	{
+		my ($column, $type, $format, $bytes, $encode, $decode) = split(/\|/, $line);
+		my %result = (
+			bytes_per_row => $bytes + 0,
+			encode_ns_per_row => $encode + 0,
+			decode_ns_per_row => $decode + 0,
+		);
+
+		if ($column eq '')
+		{
+			$tuple = \%result;
+		}
+		else
+		{
+			push @columns, { column => $column, type => $type, format => $format, %result };
+		}
+		note sprintf("%-8s %-28s %s %8.1f bytes %9.1f ns encode %9.1f ns decode",
+			$column || '(tuple)', $type, $format, $bytes, $encode, $decode);
+	}
+
+	ok(defined $tuple && @columns > 0, "round trip of table $name");
+	push @{ $report{tables} }, { name => $name, tuple => $tuple, columns => \@columns };
+}
+
+open(my $fh, '>', $report_file) or die "could not open $report_file: $!";
+print $fh JSON::PP->new->canonical->pretty->encode(\%report);
+close($fh) or die "could not close $report_file: $!";
+note "report written to $report_file";
+
+done_testing();
@@ -0,0 +1,4 @@
+-- Replicated DDL taking the global DDL lock, run at a fixed rate alongside
+-- insert_heavy.sql.
+\set c random(1, 1000)
+ALTER TABLE public.bench_insert ALTER COLUMN note SET DEFAULT :c;
@@ -0,0 +1,2 @@
+-- Single row inserts, one per transaction.
+INSERT INTO public.bench_insert (node, payload) VALUES (:node, md5(random()::text));
@@ -0,0 +1,4 @@
+-- Transactions inserting 50000 rows each, large enough for decoding to spill
+-- to disk with the logical_decoding_work_mem the harness sets.
+INSERT INTO public.bench_large (node, n, payload)
+SELECT :node, g, md5(g::text) FROM generate_series(1, 50000) g;
@@ -0,0 +1,4 @@
+-- Updates concentrated on a few rows, run on every node to provoke
+-- update/update conflicts.
+\set id random(1, 100)
+UPDATE public.bench_hot SET counter = counter + 1, updated_by = :node WHERE id = :id;
@@ -0,0 +1,8 @@
+-- Inserts of rows with many columns of assorted types, about 2kB each.
+\set n random(1, 1000000000)
+INSERT INTO public.bench_wide (node, i1, i2, i3, i4, f1, f2, t1, t2, t3, t4, ts, doc, blob)
+VALUES (:node, :n, :n + 1, :n + 2, :n + 3, random(), random(),
+	repeat(md5(random()::text), 4), repeat(md5(random()::text), 4),
+	repeat(md5(random()::text), 4), repeat(md5(random()::text), 4),
+	now(), jsonb_build_object('n', :n, 'node', :node, 'tags', jsonb_build_array('a', 'b', 'c')),
+	decode(repeat(md5(random()::text), 16), 'hex'));
@@ -82,3 +82,24 @@ SELECT pgactive.pgactive_wait_for_slots_confirmed_flush_lsn(NULL,NULL);
 \c regression
 
 SELECT count(id) FROM seqvalues;
+
+-- Batches of values are reserved in one call and must not overlap with
+-- each other or with individually generated values.
+SELECT pgactive.pgactive_replicate_ddl_command($DDL$
+CREATE SEQUENCE public.dummy_seq3;
+$DDL$);
+
+WITH vals(val) AS (
+   SELECT pgactive.pgactive_snowflake_id_nextval_batch('dummy_seq3'::regclass, 1000)
+   UNION ALL
+   SELECT unnest(pgactive.pgactive_snowflake_id_nextval_array('dummy_seq3'::regclass, 1000))
+   UNION ALL
+   SELECT pgactive.pgactive_snowflake_id_nextval('dummy_seq3'::regclass)
+)
+SELECT count(val), count(DISTINCT val) FROM vals;
+
+SELECT pgactive.pgactive_snowflake_id_nextval_array('dummy_seq3'::regclass, 0);
+
+-- Larger batches than a millisecond's worth of values would wrap with the
+-- default generator.
+SELECT pgactive.pgactive_snowflake_id_nextval_batch('dummy_seq3'::regclass, 20000);
@@ -0,0 +1,119 @@
+#!/usr/bin/perl
+#
+# Test global sequences with the shared memory snowflake id generator
+#
+use strict;
+use warnings;
+use lib 'test/t/';
+use Cwd;
+use Config;
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+use utils::nodemanagement;
+
+# Create an upstream node and bring up pgactive
+my $node_a = PostgreSQL::Test::Cluster->new('node_a');
+initandstart_pgactive_group($node_a);
+
+$node_a->append_conf('postgresql.conf', q{pgactive.snowflake_id_generator = 'shmem'});
+$node_a->restart;
+
+is($node_a->safe_psql($pgactive_test_dbname, q{SHOW pgactive.snowflake_id_generator;}),
+	'shmem', 'shmem snowflake id generator enabled');
+
+exec_ddl( $node_a, qq{CREATE SEQUENCE public.test_seq;} );
+exec_ddl( $node_a, qq{CREATE TABLE public.test_ids (id bigint PRIMARY KEY);} );
+
+# Generate more ids than fit into a single millisecond; they must not wrap.
+$node_a->safe_psql($pgactive_test_dbname, qq{
+	INSERT INTO public.test_ids
+	SELECT pgactive.pgactive_snowflake_id_nextval('public.test_seq'::regclass)
+	FROM generate_series(1, (2 ^ 14)::bigint * 2);
+});
+is($node_a->safe_psql($pgactive_test_dbname, q{SELECT count(*) FROM public.test_ids;}),
+	2 ** 15, 'no duplicate ids generated');
+
+# Pass a timestamp behind the generator's state, as happens when the clock
+# goes backwards; ids keep coming from the generator's own timestamp.
+$node_a->safe_psql($pgactive_test_dbname, qq{
+	INSERT INTO public.test_ids
+	SELECT pgactive._pgactive_snowflake_id_nextval_private('public.test_seq'::regclass, '530605914245317'::bigint)
+	FROM generate_series(1, (2 ^ 14)::bigint * 2);
+});
+is($node_a->safe_psql($pgactive_test_dbname, q{SELECT count(*) FROM public.test_ids;}),
+	2 ** 16, 'no duplicate ids generated for a timestamp in the past');
+
+# Batches larger than a millisecond's worth of ids are spread across
+# milliseconds.
+$node_a->safe_psql($pgactive_test_dbname, qq{
+	INSERT INTO public.test_ids
+	SELECT pgactive.pgactive_snowflake_id_nextval_batch('public.test_seq'::regclass, 50000);
+	INSERT INTO public.test_ids
+	SELECT unnest(pgactive.pgactive_snowflake_id_nextval_array('public.test_seq'::regclass, 50000));
+});
+is($node_a->safe_psql($pgactive_test_dbname, q{SELECT count(*) FROM public.test_ids;}),
+	2 ** 16 + 100000, 'no duplicate ids generated in batches');
+
+# The sequence is only used to persist the generator's high-water mark.
+cmp_ok($node_a->safe_psql($pgactive_test_dbname, q{SELECT last_value FROM public.test_seq;}),
+	'>', 0, 'generator high-water mark persisted to the sequence');
+
+# Sequences that can't hold millisecond timestamps are refused.
+exec_ddl( $node_a, qq{CREATE SEQUENCE public.int_seq AS integer;} );
+my ($ret, $stdout, $stderr) = $node_a->psql($pgactive_test_dbname,
+	q{SELECT pgactive.pgactive_snowflake_id_nextval('public.int_seq'::regclass);});
+isnt($ret, 0, 'integer sequence refused');
+like($stderr, qr/sequence "int_seq" cannot be used with pgactive.snowflake_id_generator = shmem/,
+	'integer sequence refused with a clear error');
+
+# The USAGE privilege is enough to generate ids, including persisting the
+# high-water mark.
+exec_ddl( $node_a, qq{CREATE ROLE seq_user;} );
+exec_ddl( $node_a, qq{CREATE SEQUENCE public.usage_seq;} );
+exec_ddl( $node_a, qq{GRANT USAGE ON SEQUENCE public.usage_seq TO seq_user;} );
+is($node_a->safe_psql($pgactive_test_dbname, q{
+	SET ROLE seq_user;
+	SELECT count(DISTINCT id) FROM pgactive.pgactive_snowflake_id_nextval_batch('public.usage_seq'::regclass, 50000) AS id;
+}), '50000', 'ids generated with the USAGE privilege only');
+cmp_ok($node_a->safe_psql($pgactive_test_dbname, q{SELECT last_value FROM public.usage_seq;}),
+	'>', 1, 'high-water mark persisted with the USAGE privilege only');
+
+# Fill all shared memory slots, drop the sequences holding them, and check
+# that a new sequence still gets a slot instead of falling back to nextval().
+$node_a->safe_psql($pgactive_test_dbname, q{
+	DO $$
+	BEGIN
+		FOR i IN 1..64 LOOP
+			EXECUTE pg_catalog.format('CREATE SEQUENCE public.fill_seq_%s', i);
+			PERFORM pgactive.pgactive_snowflake_id_nextval(pg_catalog.format('public.fill_seq_%s', i)::regclass);
+		END LOOP;
+	END $$;
+});
+$node_a->safe_psql($pgactive_test_dbname, q{
+	DO $$
+	BEGIN
+		FOR i IN 1..64 LOOP
+			EXECUTE pg_catalog.format('DROP SEQUENCE public.fill_seq_%s', i);
+		END LOOP;
+	END $$;
+});
+exec_ddl( $node_a, qq{CREATE SEQUENCE public.reuse_seq;} );
+$node_a->safe_psql($pgactive_test_dbname,
+	q{SELECT pgactive.pgactive_snowflake_id_nextval('public.reuse_seq'::regclass);});
+cmp_ok($node_a->safe_psql($pgactive_test_dbname, q{SELECT last_value FROM public.reuse_seq;}),
+	'>', 1, 'slot of a dropped sequence reused');
+
+# After a crash, ids must still be greater than all ids handed out before it.
+my $max_before = $node_a->safe_psql($pgactive_test_dbname, q{SELECT max(id) FROM public.test_ids;});
+$node_a->stop('immediate');
+$node_a->start;
+
+$node_a->safe_psql($pgactive_test_dbname,
+	qq[SELECT pgactive.pgactive_wait_for_node_ready($PostgreSQL::Test::Utils::timeout_default)]);
+
+is($node_a->safe_psql($pgactive_test_dbname, qq{
+	SELECT pgactive.pgactive_snowflake_id_nextval('public.test_seq'::regclass) > $max_before;
+}), 't', 'ids generated after crash restart are above pre-crash ids');
+
+done_testing();
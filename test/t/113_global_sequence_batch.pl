@@ -0,0 +1,70 @@
+#!/usr/bin/perl
+#
+# Test concurrent batches of global sequence values with the default,
+# sequence based, snowflake id generator
+#
+use strict;
+use warnings;
+use lib 'test/t/';
+use Cwd;
+use Config;
+use IPC::Run;
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+use utils::nodemanagement;
+
+my $node_a = PostgreSQL::Test::Cluster->new('node_a');
+initandstart_pgactive_group($node_a);
+
+is($node_a->safe_psql($pgactive_test_dbname, q{SHOW pgactive.snowflake_id_generator;}),
+	'sequence', 'sequence snowflake id generator enabled');
+
+exec_ddl( $node_a, qq{CREATE SEQUENCE public.test_seq;} );
+exec_ddl( $node_a, qq{CREATE TABLE public.test_ids (session integer, batch integer, id bigint, PRIMARY KEY (session, batch, id));} );
+
+# Several sessions take batches of nearly a millisecond's worth of ids at
+# the same time. Each batch reserves a consecutive range of the sequence, so
+# its ids don't wrap onto each other however the batches interleave.
+my $nsessions = 4;
+my $nbatches = 5;
+my $batch = 16000;
+my @handles;
+foreach my $i (1 .. $nsessions)
+{
+	my ($stdout, $stderr) = ('', '');
+	push @handles, IPC::Run::start(
+		[ 'psql', '-X', '-v', 'ON_ERROR_STOP=1',
+		  map { ('-c', qq{INSERT INTO public.test_ids
+			SELECT $i, $_, id FROM pgactive.pgactive_snowflake_id_nextval_batch('public.test_seq'::regclass, $batch) id}) } 1 .. $nbatches,
+		  $node_a->connstr($pgactive_test_dbname) ],
+		'1>', \$stdout, '2>', \$stderr);
+}
+
+my $failed = 0;
+foreach my $handle (@handles)
+{
+	$handle->finish;
+	$failed++ if $handle->result != 0;
+}
+is($failed, 0, 'concurrent batches succeed');
+
+is($node_a->safe_psql($pgactive_test_dbname, q{
+	SELECT count(*) FROM (
+		SELECT session, batch FROM public.test_ids GROUP BY session, batch
+		HAVING count(DISTINCT id) <> count(*)) b;}),
+	'0', 'no batch has duplicate ids');
+
+is($node_a->safe_psql($pgactive_test_dbname, q{
+	SELECT count(*) FROM (
+		SELECT session, batch FROM public.test_ids GROUP BY session, batch
+		HAVING count(DISTINCT id >> 24) <> 1) b;}),
+	'0', 'ids of a batch share one timestamp');
+
+is($node_a->safe_psql($pgactive_test_dbname, q{SELECT count(*) FROM public.test_ids;}),
+	$nsessions * $nbatches * $batch, 'all ids inserted');
+
+is($node_a->safe_psql($pgactive_test_dbname, q{SELECT last_value FROM public.test_seq;}),
+	$nsessions * $nbatches * $batch, 'batches take consecutive sequence values');
+
+done_testing();
@@ -0,0 +1,79 @@
+#!/usr/bin/env perl
+#
+# Test per-node and per-relation replication statistics.
+#
+use strict;
+use warnings;
+use lib 'test/t/';
+use Cwd;
+use Config;
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+use utils::nodemanagement;
+
+my $nodes = make_pgactive_group(2, 'node_');
+my ($node_0, $node_1) = @$nodes;
+
+exec_ddl($node_0, q[CREATE TABLE public.stat_a(id integer primary key, data text);]);
+exec_ddl($node_0, q[CREATE TABLE public.stat_b(id integer primary key, data text);]);
+wait_for_apply($node_0, $node_1);
+
+$node_0->safe_psql($pgactive_test_dbname, q[
+	INSERT INTO stat_a SELECT g, 'a' FROM generate_series(1, 10) g;
+	INSERT INTO stat_b SELECT g, 'b' FROM generate_series(1, 5) g;
+	UPDATE stat_a SET data = 'aa' WHERE id <= 4;
+	DELETE FROM stat_b WHERE id <= 2;
+]);
+wait_for_apply($node_0, $node_1);
+
+is($node_1->safe_psql($pgactive_test_dbname, q[
+	SELECT relname, nr_insert, nr_update, nr_delete
+	FROM pgactive.pgactive_stat_relation
+	WHERE relname IN ('stat_a', 'stat_b')
+	ORDER BY relname;]),
+	"stat_a|10|4|0\nstat_b|5|0|2", 'per-relation row counts on receiving node');
+
+is($node_1->safe_psql($pgactive_test_dbname, q[
+	SELECT bool_and(bytes_received > 0), bool_and(apply_time >= 0)
+	FROM pgactive.pgactive_stat_relation
+	WHERE relname IN ('stat_a', 'stat_b');]),
+	't|t', 'bytes received and apply time are tracked');
+
+is($node_0->safe_psql($pgactive_test_dbname, q[
+	SELECT count(*) FROM pgactive.pgactive_stat_relation
+	WHERE relname IN ('stat_a', 'stat_b');]),
+	'0', 'local changes are not counted on originating node');
+
+# Deleting the same row on both nodes while apply is paused is a DELETE vs
+# DELETE conflict once apply resumes.
+$node_1->safe_psql($pgactive_test_dbname, q[SELECT pgactive.pgactive_apply_pause();]);
+$node_1->safe_psql($pgactive_test_dbname, q[DELETE FROM stat_a WHERE id = 10;]);
+$node_0->safe_psql($pgactive_test_dbname, q[DELETE FROM stat_a WHERE id = 10;]);
+$node_1->safe_psql($pgactive_test_dbname, q[SELECT pgactive.pgactive_apply_resume();]);
+wait_for_apply($node_0, $node_1);
+
+is($node_1->safe_psql($pgactive_test_dbname, q[
+	SELECT nr_delete, nr_delete_delete_conflict
+	FROM pgactive.pgactive_stat_relation WHERE relname = 'stat_a';]),
+	'0|1', 'DELETE vs DELETE conflict counted per relation');
+
+# Per-node counters may be flushed lazily, wait for them to show up.
+ok($node_1->poll_query_until($pgactive_test_dbname, q[
+	SELECT sum(nr_insert) >= 15 AND sum(nr_delete_conflict) >= 1
+	FROM pgactive.pgactive_stats;]),
+	'per-node stats count applied changes');
+
+$node_1->safe_psql($pgactive_test_dbname, q[SELECT pgactive.pgactive_stats_reset();]);
+
+is($node_1->safe_psql($pgactive_test_dbname, q[
+	SELECT coalesce(sum(nr_insert), 0) FROM pgactive.pgactive_stats;]),
+	'0', 'per-node stats reset');
+
+$node_1->safe_psql($pgactive_test_dbname, q[SELECT pgactive.pgactive_stat_relation_reset();]);
+
+is($node_1->safe_psql($pgactive_test_dbname, q[
+	SELECT count(*) FROM pgactive.pgactive_stat_relation;]),
+	'0', 'per-relation stats reset');
+
+done_testing();
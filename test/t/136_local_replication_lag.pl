@@ -0,0 +1,43 @@
+#!/usr/bin/env perl
+#
+# Test replication lag reporting from local shared memory.
+#
+use strict;
+use warnings;
+use lib 'test/t/';
+use Cwd;
+use Config;
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+use utils::nodemanagement;
+
+my $nodes = make_pgactive_group(2, 'node_');
+my ($node_0, $node_1) = @$nodes;
+
+exec_ddl($node_0, q[CREATE TABLE public.lag_test(id integer primary key);]);
+$node_0->safe_psql($pgactive_test_dbname,
+	q[INSERT INTO lag_test SELECT generate_series(1, 100);]);
+wait_for_apply($node_0, $node_1);
+
+# Each node has one outbound and one inbound connection to its peer.
+is($node_0->safe_psql($pgactive_test_dbname, q[
+	SELECT string_agg(node_name || ':' || direction, ',' ORDER BY direction)
+	FROM pgactive.pgactive_replication_lag;]),
+	'node_1:inbound,node_1:outbound', 'one row per connection direction');
+
+# Once caught up, the peer has replayed everything we sent.
+ok($node_0->poll_query_until($pgactive_test_dbname, q[
+	SELECT replay_lsn >= sent_lsn AND lag_bytes IS NOT NULL
+	FROM pgactive.pgactive_replication_lag
+	WHERE direction = 'outbound';]),
+	'outbound replay position catches up');
+
+is($node_1->safe_psql($pgactive_test_dbname, q[
+	SELECT last_xact_committs IS NOT NULL AND replay_lag >= '0'::interval
+	       AND replay_lsn IS NOT NULL
+	FROM pgactive.pgactive_replication_lag
+	WHERE direction = 'inbound';]),
+	't', 'inbound connection reports last applied transaction');
+
+done_testing();
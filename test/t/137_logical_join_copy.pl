@@ -0,0 +1,68 @@
+#!/usr/bin/env perl
+#
+# Test logical join of a node that copies table data over parallel COPY
+# connections instead of dumping and restoring it.
+#
+use strict;
+use warnings;
+use lib 'test/t/';
+use Cwd;
+use Config;
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+use utils::nodemanagement;
+
+my $node_0 = PostgreSQL::Test::Cluster->new('node_0');
+initandstart_pgactive_group($node_0);
+
+exec_ddl($node_0, q[CREATE TABLE public.copy_a(id integer primary key, data text);]);
+exec_ddl($node_0, q[CREATE TABLE public.copy_b(id integer primary key, a_id integer REFERENCES public.copy_a(id), doubled integer GENERATED ALWAYS AS (id * 2) STORED);]);
+exec_ddl($node_0, q[CREATE TABLE public.copy_c(id integer primary key, dropme text, data text);]);
+exec_ddl($node_0, q[ALTER TABLE public.copy_c DROP COLUMN dropme;]);
+exec_ddl($node_0, q[CREATE SEQUENCE public.copy_seq;]);
+
+$node_0->safe_psql($pgactive_test_dbname, q[
+	INSERT INTO copy_a SELECT g, 'a' || g FROM generate_series(1, 10000) g;
+	INSERT INTO copy_b SELECT g, g FROM generate_series(1, 5000) g;
+	INSERT INTO copy_c SELECT g, 'c' FROM generate_series(1, 100) g;
+	SELECT nextval('copy_seq') FROM generate_series(1, 42);
+]);
+
+my $node_1 = PostgreSQL::Test::Cluster->new('node_1');
+initandstart_node($node_1);
+$node_1->append_conf('postgresql.conf', q{
+	pgactive.init_node_data_sync_method = 'copy'
+	pgactive.init_node_parallel_jobs = 3
+});
+$node_1->reload;
+
+my $logstart = get_log_size($node_1);
+
+pgactive_logical_join($node_1, $node_0);
+check_join_status($node_1, $node_0);
+
+ok(find_in_log($node_1, qr/copying initial data of \d+ tables in \d+ steps over 3 connections/, $logstart),
+	'table data copied over parallel connections');
+
+is($node_1->safe_psql($pgactive_test_dbname, q[
+	SELECT (SELECT count(*) FROM copy_a), (SELECT count(*) FROM copy_b),
+		(SELECT sum(doubled) FROM copy_b), (SELECT count(*) FROM copy_c WHERE data = 'c');]),
+	'10000|5000|25005000|100', 'table data copied');
+
+is($node_1->safe_psql($pgactive_test_dbname, q[
+	SELECT count(*) FROM pg_constraint
+	WHERE conrelid IN ('copy_a'::regclass, 'copy_b'::regclass) AND contype IN ('p', 'f');]),
+	'3', 'indexes and constraints restored after the data copy');
+
+is($node_1->safe_psql($pgactive_test_dbname, q[SELECT last_value FROM copy_seq;]),
+	'42', 'sequence value copied');
+
+# The joined node replicates as usual afterwards.
+$node_0->safe_psql($pgactive_test_dbname, q[INSERT INTO copy_a VALUES (10001, 'after join');]);
+wait_for_apply($node_0, $node_1);
+
+is($node_1->safe_psql($pgactive_test_dbname, q[SELECT data FROM copy_a WHERE id = 10001;]),
+	'after join', 'changes after join are replicated');
+
+done_testing();
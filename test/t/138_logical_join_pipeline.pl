@@ -0,0 +1,65 @@
+#!/usr/bin/env perl
+#
+# Test logical join of a node that restores table data while it is still
+# being dumped.
+#
+use strict;
+use warnings;
+use lib 'test/t/';
+use Cwd;
+use Config;
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+use utils::nodemanagement;
+
+my $node_0 = PostgreSQL::Test::Cluster->new('node_0');
+initandstart_pgactive_group($node_0);
+
+exec_ddl($node_0, q[CREATE TABLE public.pipe_a(id integer primary key, data text);]);
+exec_ddl($node_0, q[CREATE TABLE public.pipe_b(id integer primary key, a_id integer REFERENCES public.pipe_a(id));]);
+exec_ddl($node_0, q[CREATE SEQUENCE public.pipe_seq;]);
+
+$node_0->safe_psql($pgactive_test_dbname, q[
+	INSERT INTO pipe_a SELECT g, 'a' || g FROM generate_series(1, 10000) g;
+	INSERT INTO pipe_b SELECT g, g FROM generate_series(1, 5000) g;
+	SELECT nextval('pipe_seq') FROM generate_series(1, 42);
+	SELECT lo_from_bytea(0, 'pgactive');
+]);
+
+my $node_1 = PostgreSQL::Test::Cluster->new('node_1');
+initandstart_node($node_1);
+$node_1->append_conf('postgresql.conf', q{
+	pgactive.init_node_data_sync_method = 'pipeline'
+	pgactive.init_node_parallel_jobs = 2
+});
+$node_1->reload;
+
+my $logstart = get_log_size($node_1);
+
+pgactive_logical_join($node_1, $node_0);
+check_join_status($node_1, $node_0);
+
+ok(find_in_log($node_1, qr/restored data of \d+ tables while dumping them/, $logstart),
+	'table data restored while dumping');
+
+is($node_1->safe_psql($pgactive_test_dbname, q[
+	SELECT (SELECT count(*) FROM pipe_a), (SELECT count(*) FROM pipe_b);]),
+	'10000|5000', 'table data restored');
+
+is($node_1->safe_psql($pgactive_test_dbname, q[
+	SELECT count(*) FROM pg_constraint
+	WHERE conrelid IN ('pipe_a'::regclass, 'pipe_b'::regclass) AND contype IN ('p', 'f');]),
+	'3', 'indexes and constraints restored after the data');
+
+is($node_1->safe_psql($pgactive_test_dbname, q[
+	SELECT (SELECT last_value FROM pipe_seq), (SELECT count(*) FROM pg_largeobject_metadata);]),
+	'42|1', 'sequence values and large objects restored');
+
+$node_0->safe_psql($pgactive_test_dbname, q[INSERT INTO pipe_a VALUES (10001, 'after join');]);
+wait_for_apply($node_0, $node_1);
+
+is($node_1->safe_psql($pgactive_test_dbname, q[SELECT data FROM pipe_a WHERE id = 10001;]),
+	'after join', 'changes after join are replicated');
+
+done_testing();
@@ -0,0 +1,180 @@
+#!/usr/bin/env perl
+#
+# Test that a logical join copying table data over COPY connections resumes
+# after a failure, copying only the tables it hadn't finished, unless the
+# schema of the upstream node changed in the meantime or a table left to copy
+# has no key.
+#
+use strict;
+use warnings;
+use lib 'test/t/';
+use Cwd;
+use Config;
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+use utils::nodemanagement;
+
+my $node_0 = PostgreSQL::Test::Cluster->new('node_0');
+initandstart_pgactive_group($node_0);
+
+exec_ddl($node_0, q[CREATE TABLE public.resume_a(id integer primary key, data text);]);
+exec_ddl($node_0, q[CREATE TABLE public.resume_b(id integer primary key, data text);]);
+
+$node_0->safe_psql($pgactive_test_dbname, q[
+	INSERT INTO resume_a SELECT g, 'a' FROM generate_series(1, 10000) g;
+	INSERT INTO resume_b SELECT g, 'b' FROM generate_series(1, 100) g;
+]);
+
+# Make copying the data of resume_b and resume_nokey fail on a joining node
+# for as long as
+# joinfail.enabled is set, by adding a trigger that fires during the initial
+# data copy to the tables when they get created.
+sub make_join_fail
+{
+	my ($node) = @_;
+
+	$node->append_conf('postgresql.conf', q{
+		pgactive.init_node_data_sync_method = 'copy'
+		pgactive.init_node_parallel_jobs = 1
+		joinfail.enabled = on
+	});
+	$node->reload;
+
+	$node->safe_psql($pgactive_test_dbname, q[
+		CREATE SCHEMA joinfail;
+		CREATE FUNCTION joinfail.fail_row() RETURNS trigger LANGUAGE plpgsql AS $$
+		BEGIN
+			IF current_setting('joinfail.enabled', true) = 'on' THEN
+				RAISE EXCEPTION 'failing initial data copy on purpose';
+			END IF;
+			RETURN NEW;
+		END $$;
+		CREATE FUNCTION joinfail.add_trigger() RETURNS event_trigger LANGUAGE plpgsql AS $$
+		BEGIN
+			IF EXISTS (SELECT 1 FROM pg_event_trigger_ddl_commands()
+					   WHERE command_tag = 'CREATE TABLE'
+					   AND object_identity = 'public.resume_b') THEN
+				CREATE TRIGGER fail_row BEFORE INSERT ON public.resume_b
+					FOR EACH ROW EXECUTE FUNCTION joinfail.fail_row();
+				ALTER TABLE public.resume_b ENABLE ALWAYS TRIGGER fail_row;
+			END IF;
+			IF EXISTS (SELECT 1 FROM pg_event_trigger_ddl_commands()
+					   WHERE command_tag = 'CREATE TABLE'
+					   AND object_identity = 'public.resume_nokey') THEN
+				CREATE TRIGGER fail_row BEFORE INSERT ON public.resume_nokey
+					FOR EACH ROW EXECUTE FUNCTION joinfail.fail_row();
+				ALTER TABLE public.resume_nokey ENABLE ALWAYS TRIGGER fail_row;
+			END IF;
+		END $$;
+		CREATE EVENT TRIGGER joinfail_add ON ddl_command_end
+			EXECUTE FUNCTION joinfail.add_trigger();
+		ALTER EVENT TRIGGER joinfail_add ENABLE ALWAYS;
+	]);
+}
+
+my $node_1 = PostgreSQL::Test::Cluster->new('node_1');
+initandstart_node($node_1);
+make_join_fail($node_1);
+
+my $logstart = get_log_size($node_1);
+
+pgactive_logical_join($node_1, $node_0, nowait => 1);
+
+# resume_a is larger and copied first, then copying resume_b fails.
+$node_1->wait_for_log(qr/failing initial data copy on purpose/, $logstart);
+
+is($node_1->safe_psql($pgactive_test_dbname, q[
+	SELECT step, relname, nrows FROM pgactive.pgactive_init_progress ORDER BY step, relname;]),
+	"data|public.resume_a|10000\nschema||", 'progress of failed join recorded');
+
+# Changes made on the upstream node before the join resumes are replayed
+# from its slot.
+$node_0->safe_psql($pgactive_test_dbname, q[
+	INSERT INTO resume_a VALUES (10001, 'while failing');
+	INSERT INTO resume_b VALUES (101, 'while failing');
+]);
+
+$logstart = get_log_size($node_1);
+
+$node_1->append_conf('postgresql.conf', q{joinfail.enabled = off});
+$node_1->reload;
+
+$node_1->safe_psql($pgactive_test_dbname,
+	qq[SELECT pgactive.pgactive_wait_for_node_ready($PostgreSQL::Test::Utils::timeout_default)]);
+check_join_status($node_1, $node_0);
+
+ok(find_in_log($node_1, qr/resuming initial data copy, data of 1 tables has been copied already/, $logstart),
+	'join resumed with the tables copied before');
+ok(find_in_log($node_1, qr/copying initial data of 1 tables in 1 steps over 1 connections/, $logstart),
+	'only the unfinished table copied again');
+
+is($node_1->safe_psql($pgactive_test_dbname, q[
+	SELECT (SELECT count(*) FROM resume_a), (SELECT count(*) FROM resume_b);]),
+	'10001|101', 'table data complete after resumed join');
+
+is($node_1->safe_psql($pgactive_test_dbname, q[
+	SELECT count(*) FROM pg_constraint
+	WHERE conrelid IN ('resume_a'::regclass, 'resume_b'::regclass) AND contype = 'p';]),
+	'2', 'indexes and constraints restored after resumed join');
+
+is($node_1->safe_psql($pgactive_test_dbname, q[
+	SELECT string_agg(step, ',' ORDER BY step) FROM pgactive.pgactive_init_progress WHERE relname = '';]),
+	'post-data,schema', 'all steps of the join recorded');
+
+$node_0->safe_psql($pgactive_test_dbname, q[INSERT INTO resume_b VALUES (102, 'after join');]);
+wait_for_apply($node_0, $node_1);
+
+is($node_1->safe_psql($pgactive_test_dbname, q[SELECT data FROM resume_b WHERE id = 102;]),
+	'after join', 'changes after join are replicated');
+
+# A join isn't resumed while a table without a key is left to copy, since
+# replaying inserts to it would duplicate rows, nor if the schema of the
+# upstream node changed after it created its tables.
+exec_ddl($node_0, q[CREATE TABLE public.resume_nokey(id integer, data text);]);
+$node_0->safe_psql($pgactive_test_dbname, q[INSERT INTO resume_nokey VALUES (1, 'no key');]);
+wait_for_apply($node_0, $node_1);
+
+my $node_2 = PostgreSQL::Test::Cluster->new('node_2');
+initandstart_node($node_2);
+make_join_fail($node_2);
+
+$logstart = get_log_size($node_2);
+
+pgactive_logical_join($node_2, $node_0, nowait => 1);
+$node_2->wait_for_log(qr/failing initial data copy on purpose/, $logstart);
+
+isnt($node_2->safe_psql($pgactive_test_dbname, q[
+	SELECT schema_position FROM pgactive.pgactive_init_progress WHERE step = 'schema';]),
+	'', 'schema position of failed join recorded');
+
+$logstart = get_log_size($node_2);
+
+$node_2->append_conf('postgresql.conf', q{joinfail.enabled = off});
+$node_2->reload;
+
+$node_2->wait_for_log(qr/Table public\.resume_nokey has no primary key or replica identity index/,
+	$logstart);
+is($node_2->safe_psql($pgactive_test_dbname, q[
+	SELECT count(*) FROM resume_nokey;]),
+	'0', 'join not resumed while a table without a key is left to copy');
+
+# The new table isn't replicated, so that the DDL lock doesn't have to wait
+# for the joining node.
+{
+	local $ENV{PGOPTIONS} = '-c pgactive.skip_ddl_replication=on';
+	$node_0->safe_psql($pgactive_test_dbname, q[CREATE TABLE public.resume_c(id integer primary key);]);
+}
+
+$logstart = get_log_size($node_2);
+
+$node_2->wait_for_log(qr/The schema of the upstream node changed since the failed init created the tables/,
+	$logstart);
+ok(!find_in_log($node_2, qr/resuming initial data copy/, $logstart),
+	'join not resumed after the schema of the upstream node changed');
+
+is($node_2->safe_psql($pgactive_test_dbname, q[
+	SELECT count(*) FROM resume_a;]),
+	'10001', 'tables of the failed join left alone');
+
+done_testing();
@@ -0,0 +1,148 @@
+#!/usr/bin/env perl
+#
+# Test that remote node information is fetched in a single round trip using
+# libpq pipeline mode, through a proxy that delays the replies of the node.
+#
+use strict;
+use warnings;
+use lib 'test/t/';
+use Cwd;
+use Config;
+use IO::Select;
+use IO::Socket::INET;
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use POSIX;
+use Test::More;
+use Time::HiRes qw(usleep);
+use utils::nodemanagement;
+
+my $node_0 = PostgreSQL::Test::Cluster->new('node_0');
+initandstart_pgactive_group($node_0);
+
+my $pg_version = $node_0->safe_psql($pgactive_test_dbname,
+	q[SELECT current_setting('server_version_num')::int / 10000;]);
+if ($pg_version < 14)
+{
+	plan skip_all => 'pipeline mode requires PostgreSQL 14 or later';
+}
+
+$node_0->append_conf('postgresql.conf', q{listen_addresses = '127.0.0.1'});
+$node_0->restart;
+
+# Forward connections to node_0, delaying everything it sends by 50ms, and
+# record the number of round trips of each connection: the number of times
+# the client sent something after having received a reply.
+my $turns_file = "$PostgreSQL::Test::Utils::tmp_check/proxy_turns";
+my $listener = IO::Socket::INET->new(
+	LocalAddr => '127.0.0.1',
+	LocalPort => 0,
+	Listen => 10,
+	ReuseAddr => 1) or die "could not create proxy listener: $!";
+my $proxy_port = $listener->sockport;
+
+my $proxy_pid = fork();
+die "could not fork proxy: $!" unless defined $proxy_pid;
+if ($proxy_pid == 0)
+{
+	# Leave the nodes and test state to the parent whatever happens here.
+	eval { run_proxy() };
+	POSIX::_exit(0);
+}
+
+sub run_proxy
+{
+	my $sel = IO::Select->new($listener);
+	my (%peer, %client, %turns, %replied);
+
+	while (1)
+	{
+		foreach my $s ($sel->can_read)
+		{
+			if ($s == $listener)
+			{
+				my $c = $listener->accept;
+				my $srv = IO::Socket::INET->new(
+					PeerAddr => '127.0.0.1',
+					PeerPort => $node_0->port) or die "could not connect to node: $!";
+				$peer{$c} = $srv;
+				$peer{$srv} = $c;
+				$client{$c} = 1;
+				$turns{$c} = 0;
+				$replied{$c} = 1;
+				$sel->add($c, $srv);
+				next;
+			}
+
+			my $other = $peer{$s};
+			my $buf;
+			my $n = sysread($s, $buf, 65536);
+
+			if (!$n)
+			{
+				my $c = $client{$s} ? $s : $other;
+
+				open(my $fh, '>>', $turns_file) or die "could not open $turns_file: $!";
+				print $fh "$turns{$c}\n";
+				close($fh);
+
+				$sel->remove($s, $other);
+				close($s);
+				close($other);
+				delete @peer{ ($s, $other) };
+				delete $client{$c};
+				delete $turns{$c};
+				delete $replied{$c};
+				next;
+			}
+
+			if ($client{$s})
+			{
+				if ($replied{$s})
+				{
+					$turns{$s}++;
+					$replied{$s} = 0;
+				}
+			}
+			else
+			{
+				usleep(50_000);
+				$replied{$other} = 1;
+			}
+			syswrite($other, $buf);
+		}
+	}
+}
+
+my $proxy_dsn = "host=127.0.0.1 port=$proxy_port dbname=$pgactive_test_dbname sslmode=disable gssencmode=disable";
+
+is($node_0->safe_psql($pgactive_test_dbname, qq[
+	SELECT node_name IS NOT NULL AND version_num > 0
+	FROM pgactive._pgactive_get_node_info_private('$proxy_dsn');]),
+	't', 'node info fetched through the proxy');
+
+# The replication connection checking the node's identity, the connection
+# getting its node identifier and the one getting the node information, plus
+# one more looking up the database OID on servers whose IDENTIFY_SYSTEM doesn't
+# report it. Wait for the proxy to see all of them closed.
+my @turns;
+my $nseen = -1;
+foreach my $i (1 .. $PostgreSQL::Test::Utils::timeout_default * 10)
+{
+	@turns = -e $turns_file ? split(/\n/, slurp_file($turns_file)) : ();
+	last if @turns >= 3 && @turns == $nseen;
+	$nseen = scalar(@turns);
+	usleep(500_000);
+}
+
+kill 'TERM', $proxy_pid;
+waitpid($proxy_pid, 0);
+
+cmp_ok(scalar(@turns), '>=', 3, 'connections to the remote node went through the proxy');
+
+# Connection startup, the queries and closing the connection each take one
+# round trip; without pipelining getting the node information alone took six.
+my ($max_turns) = sort { $b <=> $a } @turns;
+cmp_ok($max_turns, '<=', 3, 'each connection takes at most three round trips');
+
+done_testing();
@@ -0,0 +1,139 @@
+#!/usr/bin/env perl
+#
+# Test pgactive_init_copy creating the new node from an incremental backup of
+# the remote node taken against an earlier full backup of it.
+#
+use strict;
+use warnings;
+use lib 'test/t/';
+use Cwd;
+use Config;
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+use utils::nodemanagement;
+
+my $tempdir = PostgreSQL::Test::Utils::tempdir;
+
+my $node_a = PostgreSQL::Test::Cluster->new('node-a');
+initandstart_node($node_a, $pgactive_test_dbname, extra_init_opts => { has_archiving => 1 });
+
+my $pg_version = $node_a->safe_psql($pgactive_test_dbname,
+	q[SELECT current_setting('server_version_num')::int / 10000;]);
+if ($pg_version < 17)
+{
+	plan skip_all => 'incremental backups require PostgreSQL 17 or later';
+}
+
+$node_a->append_conf('postgresql.conf', q{summarize_wal = on});
+$node_a->restart;
+
+my $node_b = PostgreSQL::Test::Cluster->new('node-b');
+
+create_pgactive_group($node_a);
+
+$node_a->safe_psql($pgactive_test_dbname,
+	qq[SELECT pgactive.pgactive_wait_for_node_ready($PostgreSQL::Test::Utils::timeout_default)]);
+$node_a->_update_pid(1);
+
+exec_ddl($node_a, q[CREATE TABLE public.incr_before(id integer primary key, data text);]);
+$node_a->safe_psql($pgactive_test_dbname,
+	q[INSERT INTO incr_before SELECT g, 'before' FROM generate_series(1, 1000) g;]);
+
+# The earlier full backup, changes made afterwards come with the incremental
+# backup.
+$node_a->backup('full');
+
+exec_ddl($node_a, q[CREATE TABLE public.incr_after(id integer primary key, data text);]);
+$node_a->safe_psql($pgactive_test_dbname, q[
+	INSERT INTO incr_after SELECT g, 'after' FROM generate_series(1, 1000) g;
+	UPDATE incr_before SET data = 'updated' WHERE id <= 10;
+]);
+
+# Template a config file using node_b's port, see 010_pgactive_init_copy.pl.
+open(my $conf_a, "<", $node_a->data_dir . '/postgresql.conf')
+	or die ("can't open node_a conf file for reading: $!");
+open(my $conf_b, ">", "$tempdir/postgresql.conf.b")
+	or die ("can't open node_b conf file for writing: $!");
+while (<$conf_a>)
+{
+	if ($_ =~ "^port")
+	{
+		print $conf_b "port = " . $node_b->port . "\n";
+	}
+	else
+	{
+		print $conf_b $_;
+	}
+}
+close($conf_a) or die ("failed to close old postgresql.conf: $!");
+close($conf_b) or die ("failed to close new postgresql.conf: $!");
+
+command_fails(
+	[
+		'pgactive_init_copy',
+		'-D', $node_b->data_dir,
+		"-n", 'node-b',
+		'-d', $node_a->connstr($pgactive_test_dbname),
+		'--local-dbname', $pgactive_test_dbname,
+		'--local-port', $node_b->port,
+		'--incremental-from', $tempdir,
+	],
+	'pgactive_init_copy fails when the prior backup has no manifest');
+
+command_like(
+	[
+		'pgactive_init_copy',
+		'-D', $node_b->data_dir,
+		"-n", 'node-b',
+		'-d', $node_a->connstr($pgactive_test_dbname),
+		'--local-dbname', $pgactive_test_dbname,
+		'--local-port', $node_b->port,
+		'--postgresql-conf', "$tempdir/postgresql.conf.b",
+		'--log-file', $node_b->logfile . "_initcopy",
+		'--incremental-from', $node_a->backup_dir . '/full',
+	],
+	qr/Combining incremental backup with prior backup/,
+	'pgactive_init_copy succeeds with an incremental backup');
+
+$node_b->_update_pid(1);
+
+$node_b->safe_psql($pgactive_test_dbname,
+	qq[SELECT pgactive.pgactive_wait_for_node_ready($PostgreSQL::Test::Utils::timeout_default)]);
+
+ok(!-d $node_b->data_dir . '.incremental', 'incremental backup removed after combining');
+
+is($node_b->safe_psql($pgactive_test_dbname, q[
+	SELECT (SELECT count(*) FROM incr_before), (SELECT count(*) FROM incr_before WHERE data = 'updated'),
+		(SELECT count(*) FROM incr_after);]),
+	'1000|10|1000', 'changes before and after the prior backup present on new node');
+
+is($node_b->safe_psql($pgactive_test_dbname, 'SELECT node_name, pgactive.pgactive_node_status_from_char(node_status) FROM pgactive.pgactive_nodes ORDER BY node_name'),
+	"node-a|pgactive_NODE_STATUS_READY\nnode-b|pgactive_NODE_STATUS_READY", 'node B sees both nodes as ready');
+
+$node_a->safe_psql($pgactive_test_dbname, q[INSERT INTO incr_after VALUES (1001, 'after join');]);
+wait_for_apply($node_a, $node_b);
+
+is($node_b->safe_psql($pgactive_test_dbname, q[SELECT data FROM incr_after WHERE id = 1001;]),
+	'after join', 'changes after join are replicated');
+
+# The data directory of a detached node can't seed a rejoin, it has changes
+# of its own that an incremental backup doesn't know about.
+$node_a->safe_psql($pgactive_test_dbname, q[SELECT pgactive.pgactive_detach_nodes(ARRAY['node-b']);]);
+$node_b->stop;
+
+my $node_c = PostgreSQL::Test::Cluster->new('node-c');
+command_fails(
+	[
+		'pgactive_init_copy',
+		'-D', $node_c->data_dir,
+		"-n", 'node-c',
+		'-d', $node_a->connstr($pgactive_test_dbname),
+		'--local-dbname', $pgactive_test_dbname,
+		'--local-port', $node_c->port,
+		'--incremental-from', $node_b->data_dir,
+	],
+	'pgactive_init_copy fails with the data directory of a detached node');
+ok(!-d $node_c->data_dir . '/base', 'no data directory created from a detached node');
+
+done_testing();
@@ -0,0 +1,89 @@
+#!/usr/bin/env perl
+#
+# Test reporting of the progress of a logical join in
+# pgactive.pgactive_join_progress.
+#
+use strict;
+use warnings;
+use lib 'test/t/';
+use Cwd;
+use Config;
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+use utils::nodemanagement;
+
+my $node_0 = PostgreSQL::Test::Cluster->new('node_0');
+initandstart_pgactive_group($node_0);
+
+exec_ddl($node_0, q[CREATE TABLE public.progress_a(id integer primary key, data text);]);
+exec_ddl($node_0, q[CREATE TABLE public.progress_b(id integer primary key, data text);]);
+
+$node_0->safe_psql($pgactive_test_dbname, q[
+	INSERT INTO progress_a SELECT g, 'a' FROM generate_series(1, 10000) g;
+	INSERT INTO progress_b SELECT g, 'b' FROM generate_series(1, 100) g;
+]);
+
+is($node_0->safe_psql($pgactive_test_dbname, q[
+	SELECT count(*) FROM pgactive.pgactive_join_progress;]),
+	'0', 'no join progress on the first node');
+
+my $node_1 = PostgreSQL::Test::Cluster->new('node_1');
+initandstart_node($node_1);
+$node_1->append_conf('postgresql.conf', q{
+	pgactive.init_node_data_sync_method = 'copy'
+	pgactive.init_node_parallel_jobs = 1
+	joinfail.enabled = on
+});
+$node_1->reload;
+
+# Keep the join from copying progress_b for as long as joinfail.enabled is
+# set, see 139_logical_join_resume.pl.
+$node_1->safe_psql($pgactive_test_dbname, q[
+	CREATE SCHEMA joinfail;
+	CREATE FUNCTION joinfail.fail_row() RETURNS trigger LANGUAGE plpgsql AS $$
+	BEGIN
+		IF current_setting('joinfail.enabled', true) = 'on' THEN
+			RAISE EXCEPTION 'failing initial data copy on purpose';
+		END IF;
+		RETURN NEW;
+	END $$;
+	CREATE FUNCTION joinfail.add_trigger() RETURNS event_trigger LANGUAGE plpgsql AS $$
+	BEGIN
+		IF EXISTS (SELECT 1 FROM pg_event_trigger_ddl_commands()
+				   WHERE command_tag = 'CREATE TABLE'
+				   AND object_identity = 'public.progress_b') THEN
+			CREATE TRIGGER fail_row BEFORE INSERT ON public.progress_b
+				FOR EACH ROW EXECUTE FUNCTION joinfail.fail_row();
+			ALTER TABLE public.progress_b ENABLE ALWAYS TRIGGER fail_row;
+		END IF;
+	END $$;
+	CREATE EVENT TRIGGER joinfail_add ON ddl_command_end
+		EXECUTE FUNCTION joinfail.add_trigger();
+	ALTER EVENT TRIGGER joinfail_add ENABLE ALWAYS;
+]);
+
+pgactive_logical_join($node_1, $node_0, nowait => 1);
+
+# The failed copy of progress_b stays reported until the join is retried,
+# which again stops at progress_b.
+ok($node_1->poll_query_until($pgactive_test_dbname, q[
+	SELECT phase = 'copying data' AND current_table = 'public.progress_b'
+		AND jobs_total = 1 AND tables_done < tables_total
+		AND datname = current_database()
+	FROM pgactive.pgactive_join_progress;]),
+	'table data copy reported while join is stuck');
+
+$node_1->append_conf('postgresql.conf', q{joinfail.enabled = off});
+$node_1->reload;
+
+$node_1->safe_psql($pgactive_test_dbname,
+	qq[SELECT pgactive.pgactive_wait_for_node_ready($PostgreSQL::Test::Utils::timeout_default)]);
+check_join_status($node_1, $node_0);
+
+is($node_1->safe_psql($pgactive_test_dbname, q[
+	SELECT phase, join_started_at <= phase_started_at, estimated_phase_end IS NULL
+	FROM pgactive.pgactive_join_progress;]),
+	'done|t|t', 'finished join reported');
+
+done_testing();
@@ -0,0 +1,112 @@
+#!/usr/bin/env perl
+#
+# Test finding the key ranges of a table that differ between two nodes with
+# pgactive.pgactive_compare_table.
+#
+use strict;
+use warnings;
+use lib 'test/t/';
+use Cwd;
+use Config;
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+use utils::nodemanagement;
+
+my $nodes = make_pgactive_group(2, 'node_');
+my ($node_0, $node_1) = @$nodes;
+
+exec_ddl($node_0, q[CREATE TABLE public.cmp_a(id integer primary key, data text);]);
+exec_ddl($node_0, q[CREATE TABLE public.cmp_b(region text, id bigint, data text, primary key (region, id));]);
+
+$node_0->safe_psql($pgactive_test_dbname, q[
+	INSERT INTO cmp_a SELECT g, 'a' || g FROM generate_series(1, 20000) g;
+	INSERT INTO cmp_b SELECT r, g, 'b' FROM unnest(ARRAY['eu', 'us']) r, generate_series(1, 2000) g;
+]);
+wait_for_apply($node_0, $node_1);
+
+is($node_0->safe_psql($pgactive_test_dbname, q[
+	SELECT count(*) FROM pgactive.pgactive_compare_table('cmp_a', 'node_1');]),
+	'0', 'no differences in replicated table');
+
+# Make the nodes diverge by changing node_1 without replicating the changes.
+{
+	local $ENV{PGOPTIONS} = '-c pgactive.do_not_replicate=on';
+	$node_1->safe_psql($pgactive_test_dbname, q[
+		DELETE FROM cmp_a WHERE id = 100;
+		UPDATE cmp_a SET data = 'diverged' WHERE id = 12345;
+		INSERT INTO cmp_a VALUES (20001, 'only on node_1');
+		UPDATE cmp_b SET data = 'diverged' WHERE region = 'us' AND id = 7;
+	]);
+}
+
+my $ranges = q[
+	CREATE TEMP TABLE diffs AS
+	SELECT * FROM pgactive.pgactive_compare_table('cmp_a', 'node_1');
+];
+
+is($node_0->safe_psql($pgactive_test_dbname, $ranges . q[
+	SELECT (SELECT count(*) FROM unnest(ARRAY[100, 12345, 20001]) k
+			WHERE EXISTS (SELECT 1 FROM diffs
+						  WHERE (key_lo IS NULL OR k >= key_lo[1]::integer)
+						  AND (key_hi IS NULL OR k < key_hi[1]::integer))),
+		(SELECT count(*) FROM diffs);]),
+	'3|3', 'each changed key reported in its own range');
+
+is($node_0->safe_psql($pgactive_test_dbname, $ranges . q[
+	SELECT bool_and(greatest(local_rows, remote_rows) <= 1000),
+		sum(local_rows - remote_rows),
+		(SELECT local_rows - remote_rows FROM diffs WHERE key_lo[1]::integer <= 100 OR key_lo IS NULL)
+	FROM diffs;]),
+	't|0|1', 'row counts of differing ranges reported');
+
+is($node_1->safe_psql($pgactive_test_dbname, q[
+	SELECT key_lo IS NULL OR key_lo[1]::integer <= 12345, local_rows = remote_rows
+	FROM pgactive.pgactive_compare_table('cmp_a', 'node_0')
+	WHERE key_hi IS NULL OR key_hi[1]::integer > 12345
+	ORDER BY key_lo[1]::integer NULLS FIRST LIMIT 1;]),
+	't|t', 'comparison from the other node finds the updated row');
+
+is($node_0->safe_psql($pgactive_test_dbname, q[
+	SELECT array_length(key_lo, 1), local_rows = remote_rows
+	FROM pgactive.pgactive_compare_table('cmp_b', 'node_1');]),
+	'2|t', 'composite primary key range reported');
+
+# Rows are hashed in text form, which must not depend on session settings.
+exec_ddl($node_0, q[CREATE TABLE public.cmp_c(id integer primary key, ts timestamptz, f float8, b bytea, i interval);]);
+$node_0->safe_psql($pgactive_test_dbname, q[
+	INSERT INTO cmp_c SELECT g, now() + g * interval '1 hour', g / 3.0, 'x', g * interval '1 day' FROM generate_series(1, 100) g;]);
+wait_for_apply($node_0, $node_1);
+
+is($node_0->safe_psql($pgactive_test_dbname, q[
+	SET TimeZone = 'Asia/Kolkata';
+	SET DateStyle = 'German';
+	SET IntervalStyle = 'sql_standard';
+	SET extra_float_digits = -3;
+	SET bytea_output = 'escape';
+	SELECT count(*) FROM pgactive.pgactive_compare_table('cmp_c', 'node_1');]),
+	'0', 'comparison independent of session settings');
+
+# The WAL positions each node waits for the other to replay can be chosen.
+my $local_lsn = $node_0->safe_psql($pgactive_test_dbname, q[SELECT pg_current_wal_insert_lsn();]);
+my $remote_lsn = $node_1->safe_psql($pgactive_test_dbname, q[SELECT pg_current_wal_insert_lsn();]);
+is($node_0->safe_psql($pgactive_test_dbname, qq[
+	SELECT count(*) FROM pgactive.pgactive_compare_table('cmp_a', 'node_1', '$local_lsn', '$remote_lsn');]),
+	'3', 'comparison at chosen WAL positions');
+
+my ($ret, $stdout, $stderr) = $node_0->psql($pgactive_test_dbname, q[
+	SELECT * FROM pgactive.pgactive_compare_table('cmp_a', 'node_1', NULL, 'FFFFFFFF/0');]);
+like($stderr, qr/remote_lsn FFFFFFFF\/0 is ahead of the current WAL insert position/,
+	'WAL position ahead of the peer refused');
+
+($ret, $stdout, $stderr) = $node_0->psql($pgactive_test_dbname, q[
+	BEGIN ISOLATION LEVEL REPEATABLE READ;
+	SELECT * FROM pgactive.pgactive_compare_table('cmp_a', 'node_1');]);
+like($stderr, qr/cannot run in a REPEATABLE READ or SERIALIZABLE transaction/,
+	'comparison refused in repeatable read transaction');
+
+($ret, $stdout, $stderr) = $node_0->psql($pgactive_test_dbname, q[
+	SELECT * FROM pgactive.pgactive_compare_table('cmp_a', 'node_0');]);
+like($stderr, qr/node "node_0" is the local node/, 'comparison with the local node refused');
+
+done_testing();
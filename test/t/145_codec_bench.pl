@@ -0,0 +1,57 @@
+#!/usr/bin/env perl
+#
+# Test the tuple codec microbenchmarks pgactive._bench_encode and
+# pgactive._bench_roundtrip.
+#
+use strict;
+use warnings;
+use lib 'test/t/';
+use Cwd;
+use Config;
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+use utils::nodemanagement;
+
+my $node = PostgreSQL::Test::Cluster->new('node_0');
+initandstart_node($node, $pgactive_test_dbname);
+
+$node->safe_psql($pgactive_test_dbname, q[
+	CREATE TYPE public.codec_pair AS (a integer, b text);
+	CREATE TABLE public.codec(id integer, dropped text, n numeric, big text, ta text[], pair public.codec_pair, nothing text);
+	ALTER TABLE public.codec DROP COLUMN dropped;
+	ALTER TABLE public.codec ALTER COLUMN big SET STORAGE EXTERNAL;
+	INSERT INTO public.codec
+	SELECT g, g / 7.0, repeat('x', 10000), ARRAY['a', g::text], ROW(g, 'b'), NULL
+	FROM generate_series(1, 100) g;
+]);
+
+# Out of line values are sent inline, as they are once decoding reassembled
+# them.
+is($node->safe_psql($pgactive_test_dbname, q[
+	SELECT string_agg(column_name || ':' || format, ',' ORDER BY column_name)
+	FROM pgactive._bench_roundtrip('public.codec', 1000)
+	WHERE column_name IS NOT NULL;]),
+	'big:b,id:b,n:b,nothing:n,pair:t,ta:s', 'columns round trip in the expected formats');
+
+is($node->safe_psql($pgactive_test_dbname, q[
+	SELECT bytes_per_row > 10000, encode_ns_per_row > 0, decode_ns_per_row > 0
+	FROM pgactive._bench_roundtrip('public.codec', 1000)
+	WHERE column_name IS NULL;]),
+	't|t|t', 'whole tuple results reported');
+
+is($node->safe_psql($pgactive_test_dbname, q[
+	SELECT count(*), sum(bytes_per_row) FILTER (WHERE column_name = 'id')
+	FROM pgactive._bench_encode('public.codec', 10);]),
+	'7|9', 'encoding only reported for requested rows');
+
+my ($ret, $stdout, $stderr) = $node->psql($pgactive_test_dbname, q[
+	SELECT * FROM pgactive._bench_encode('public.codec', 0);]);
+like($stderr, qr/n_rows must be greater than zero/, 'zero rows refused');
+
+($ret, $stdout, $stderr) = $node->psql($pgactive_test_dbname, q[
+	CREATE TABLE public.codec_empty(id integer);
+	SELECT * FROM pgactive._bench_roundtrip('public.codec_empty', 10);]);
+like($stderr, qr/relation "codec_empty" has no rows/, 'empty table refused');
+
+done_testing();
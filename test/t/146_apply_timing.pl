@@ -0,0 +1,66 @@
+#!/usr/bin/env perl
+#
+# Test per-phase apply timing statistics.
+#
+use strict;
+use warnings;
+use lib 'test/t/';
+use Cwd;
+use Config;
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+use utils::nodemanagement;
+
+my $nodes = make_pgactive_group(2, 'node_');
+my ($node_0, $node_1) = @$nodes;
+
+exec_ddl($node_0, q[CREATE TABLE public.timing_test(id integer primary key, v text);]);
+wait_for_apply($node_0, $node_1);
+
+# Nothing is collected unless enabled.
+is($node_1->safe_psql($pgactive_test_dbname, q[
+	SELECT count(*), sum(calls) FROM pgactive.pgactive_apply_timing;]),
+	'8|0', 'one row per phase, nothing collected by default');
+
+$node_1->safe_psql($pgactive_test_dbname, q[
+	ALTER SYSTEM SET pgactive.track_apply_timing = on;
+	SELECT pg_reload_conf();]);
+ok($node_1->poll_query_until($pgactive_test_dbname, q[
+	SELECT calls > 0 FROM pgactive.pgactive_apply_timing
+	WHERE phase = 'network wait';]),
+	'apply worker picks up the setting');
+
+$node_0->safe_psql($pgactive_test_dbname, q[
+	INSERT INTO timing_test SELECT g, 'a' FROM generate_series(1, 100) g;
+	UPDATE timing_test SET v = 'b' WHERE id <= 50;
+	DELETE FROM timing_test WHERE id <= 10;]);
+wait_for_apply($node_0, $node_1);
+
+is($node_1->safe_psql($pgactive_test_dbname, q[
+	SELECT string_agg(phase, ',' ORDER BY phase)
+	FROM pgactive.pgactive_apply_timing
+	WHERE calls > 0 AND node_name = 'node_0'
+	  AND phase IN ('decode', 'lookup', 'heap write', 'index update', 'commit');]),
+	'commit,decode,heap write,index update,lookup', 'phases of applied changes are timed');
+
+is($node_1->safe_psql($pgactive_test_dbname, q[
+	SELECT calls >= 160 FROM pgactive.pgactive_apply_timing WHERE phase = 'decode';]),
+	't', 'decode timed for every change');
+
+is($node_1->safe_psql($pgactive_test_dbname, q[
+	SELECT bool_and(h.total = calls) AND bool_and(p50_time <= p95_time AND p95_time <= p99_time)
+	FROM pgactive.pgactive_apply_timing,
+	     LATERAL (SELECT sum(b) AS total FROM unnest(histogram) b) h
+	WHERE calls > 0;]),
+	't', 'histograms and percentiles are consistent');
+
+$node_1->safe_psql($pgactive_test_dbname, q[
+	SELECT pgactive.pgactive_apply_timing_reset();]);
+is($node_1->safe_psql($pgactive_test_dbname, q[
+	SELECT sum(calls), bool_and(stats_reset IS NOT NULL)
+	FROM pgactive.pgactive_apply_timing
+	WHERE phase <> 'network wait';]),
+	'0|t', 'reset discards statistics');
+
+done_testing();
@@ -0,0 +1,58 @@
+#!/usr/bin/env perl
+#
+# Test that pgactive waits are reported as named custom wait events.
+#
+use strict;
+use warnings;
+use lib 'test/t/';
+use Cwd;
+use Config;
+use IPC::Run;
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+use utils::nodemanagement;
+
+my $nodes = make_pgactive_group(2, 'node_');
+my ($node_0, $node_1) = @$nodes;
+
+my $pg_version = $node_0->safe_psql($pgactive_test_dbname,
+	q[SELECT current_setting('server_version_num')::int / 10000;]);
+if ($pg_version < 17)
+{
+	plan skip_all => 'custom wait events require PostgreSQL 17 or later';
+}
+
+# An idle apply worker waits for changes from its peer.
+ok($node_0->poll_query_until($pgactive_test_dbname, q[
+	SELECT count(*) > 0 FROM pg_catalog.pg_stat_activity
+	WHERE wait_event_type = 'Extension'
+	  AND wait_event = 'PgactiveApplyNetworkRead';]),
+	'apply worker reports its network wait');
+
+ok($node_0->poll_query_until($pgactive_test_dbname, q[
+	SELECT count(*) > 0 FROM pg_catalog.pg_stat_activity
+	WHERE wait_event = 'PgactivePerdbMain';]),
+	'per-db worker reports its idle wait');
+
+is($node_0->safe_psql($pgactive_test_dbname, q[
+	SELECT string_agg(name, ',' ORDER BY name) FROM pg_catalog.pg_wait_events
+	WHERE type = 'Extension' AND name IN ('PgactiveApplyNetworkRead', 'PgactivePerdbMain');]),
+	'PgactiveApplyNetworkRead,PgactivePerdbMain', 'wait events are listed in pg_wait_events');
+
+# A statement waiting for the slots to confirm a position far ahead reports
+# its own wait event.
+my ($stdout, $stderr) = ('', '');
+my $handle = IPC::Run::start(
+	[ 'psql', '-X', '-c', q[SET statement_timeout = '10s'],
+	  '-c', q[SELECT pgactive.pgactive_wait_for_slots_confirmed_flush_lsn(NULL, 'FFFFFFFF/0')],
+	  $node_0->connstr($pgactive_test_dbname) ],
+	'1>', \$stdout, '2>', \$stderr);
+ok($node_0->poll_query_until($pgactive_test_dbname, q[
+	SELECT count(*) > 0 FROM pg_catalog.pg_stat_activity
+	WHERE wait_event = 'PgactiveSlotFlushWait';]),
+	'slot flush wait reported');
+$handle->finish;
+like($stderr, qr/canceling statement due to statement timeout/, 'slot flush wait ends at statement_timeout');
+
+done_testing();
@@ -0,0 +1,72 @@
+#!/usr/bin/env perl
+#
+# Test the Prometheus metrics exporter.
+#
+use strict;
+use warnings;
+use lib 'test/t/';
+use Cwd;
+use Config;
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+use utils::nodemanagement;
+
+my $nodes = make_pgactive_group(2, 'node_');
+my ($node_0, $node_1) = @$nodes;
+
+exec_ddl($node_0, q[CREATE TABLE public.metrics_test(id integer primary key);]);
+$node_0->safe_psql($pgactive_test_dbname, q[
+	INSERT INTO metrics_test SELECT generate_series(1, 10);]);
+wait_for_apply($node_0, $node_1);
+
+my $sysid_0 = $node_1->safe_psql($pgactive_test_dbname, q[
+	SELECT node_sysid FROM pgactive.pgactive_nodes WHERE node_name = 'node_0';]);
+my $metrics = $node_1->safe_psql($pgactive_test_dbname, q[
+	SELECT pgactive.pgactive_metrics();]);
+
+like($metrics, qr/^# TYPE pgactive_commits_total counter$/m,
+	'counters are typed');
+like($metrics, qr/^pgactive_workers\{type="apply worker"\} 1$/m,
+	'apply worker is counted');
+like($metrics, qr/^pgactive_workers\{type="walsender"\} 1$/m,
+	'walsender is counted');
+like($metrics,
+	qr/^pgactive_apply_applied_lsn\{database="$pgactive_test_dbname",node_sysid="$sysid_0",[^}]*\} [1-9][0-9]*$/m,
+	'apply position of the peer is reported');
+like($metrics,
+	qr/^pgactive_walsender_lsn\{database="$pgactive_test_dbname",[^}]*,position="flush"\} [0-9]+$/m,
+	'walsender positions are reported');
+like($metrics,
+	qr/^pgactive_slot_lsn\{database="$pgactive_test_dbname",node_sysid="$sysid_0",[^}]*,slot="pgactive_[^"]+",position="confirmed_flush"\} [1-9][0-9]*$/m,
+	'slot positions are reported');
+like($metrics,
+	qr/^pgactive_slot_retained_bytes\{database="$pgactive_test_dbname",[^}]*\} [0-9]+$/m,
+	'WAL retained by the slot is reported');
+my ($inserts) = $metrics =~ /^pgactive_inserts_total\{origin="[^"]+"\} ([0-9]+)$/m;
+ok(defined $inserts && $inserts >= 10, 'inserts from the peer are counted');
+like($metrics,
+	qr/^pgactive_global_lock_state\{database="$pgactive_test_dbname",state="nolock",type="nolock"\} 1$/m,
+	'global lock state is reported');
+
+# Every sample follows the header of its family.
+my %families;
+my $ordered = 1;
+foreach my $line (split /\n/, $metrics)
+{
+	if ($line =~ /^# TYPE (\S+) (counter|gauge)$/)
+	{
+		$families{$1} = 1;
+	}
+	elsif ($line =~ /^([a-z_]+)\{/)
+	{
+		$ordered = 0 unless $families{$1};
+	}
+	elsif ($line !~ /^# HELP /)
+	{
+		$ordered = 0;
+	}
+}
+ok($ordered, 'output is well-formed');
+
+done_testing();
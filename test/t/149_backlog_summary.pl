@@ -0,0 +1,120 @@
+#!/usr/bin/env perl
+#
+# Test the summary of the changes pending on a slot.
+#
+use strict;
+use warnings;
+use lib 'test/t/';
+use Cwd;
+use Config;
+use IPC::Run;
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+use utils::nodemanagement;
+
+my $nodes = make_pgactive_group(2, 'node_');
+my ($node_0, $node_1) = @$nodes;
+
+exec_ddl($node_0, q[
+	CREATE TABLE public.backlog_a(id integer primary key, v text);
+	CREATE TABLE public.backlog_b(id integer primary key, v text);]);
+wait_for_apply($node_0, $node_1);
+
+my $slot = $node_0->safe_psql($pgactive_test_dbname, q[
+	SELECT slot_name FROM pg_catalog.pg_replication_slots
+	WHERE slot_name LIKE 'pgactive\_%';]);
+
+# Let changes pile up on node_0's slot for node_1.
+$node_1->safe_psql($pgactive_test_dbname, q[SELECT pgactive.pgactive_apply_pause();]);
+
+$node_0->safe_psql($pgactive_test_dbname, q[
+	INSERT INTO backlog_a SELECT g, repeat('x', 100) FROM generate_series(1, 100) g;]);
+$node_0->safe_psql($pgactive_test_dbname, q[
+	INSERT INTO backlog_b SELECT g, 'y' FROM generate_series(1, 10) g;]);
+$node_0->safe_psql($pgactive_test_dbname, q[
+	UPDATE backlog_b SET v = 'z' WHERE id <= 5;]);
+
+my $confirmed = $node_0->safe_psql($pgactive_test_dbname, qq[
+	SELECT confirmed_flush_lsn FROM pg_catalog.pg_replication_slots
+	WHERE slot_name = '$slot';]);
+
+is($node_0->safe_psql($pgactive_test_dbname, qq[
+	SELECT string_agg(relation::text || '|' || action || '|' || changes, ',' ORDER BY relation::text, action)
+	FROM pgactive.pgactive_backlog_summary('$slot')
+	WHERE kind = 'relation' AND relation::text LIKE 'backlog_%';]),
+	'backlog_a|INSERT|100,backlog_b|INSERT|10,backlog_b|UPDATE|5',
+	'changes are summarized per relation and action');
+
+is($node_0->safe_psql($pgactive_test_dbname, qq[
+	SELECT changes, bytes > 100 * 100, origin IS NULL
+	FROM pgactive.pgactive_backlog_summary('$slot')
+	WHERE kind = 'transaction'
+	ORDER BY bytes DESC LIMIT 1;]),
+	'100|t|t', 'largest transaction is reported');
+
+is($node_0->safe_psql($pgactive_test_dbname, qq[
+	SELECT t.changes >= 115 AND t.bytes = (SELECT sum(bytes) FROM pgactive.pgactive_backlog_summary('$slot') WHERE kind = 'relation')
+	FROM pgactive.pgactive_backlog_summary('$slot') t
+	WHERE kind = 'total';]),
+	't', 'totals add up');
+
+is($node_0->safe_psql($pgactive_test_dbname, qq[
+	SELECT changes = (SELECT changes FROM pgactive.pgactive_backlog_summary('$slot') WHERE kind = 'total'),
+		bytes = (SELECT bytes FROM pgactive.pgactive_backlog_summary('$slot') WHERE kind = 'total'),
+		decoded_changes >= changes
+	FROM pgactive.pgactive_backlog_summary('$slot')
+	WHERE kind = 'origin' AND origin IS NULL;]),
+	't|t|t', 'origin row counts changes and bytes on the same basis');
+
+is($node_0->safe_psql($pgactive_test_dbname, qq[
+	SELECT sum(changes) FROM pgactive.pgactive_backlog_summary('$slot', '0/1')
+	WHERE kind = 'relation';]),
+	'', 'nothing is decoded before upto_lsn');
+
+is($node_0->safe_psql($pgactive_test_dbname, qq[
+	SELECT confirmed_flush_lsn = '$confirmed'
+	FROM pg_catalog.pg_replication_slots WHERE slot_name = '$slot';]),
+	't', 'slot is not consumed');
+is($node_0->safe_psql($pgactive_test_dbname, q[
+	SELECT count(*) FROM pg_catalog.pg_replication_slots
+	WHERE slot_name LIKE 'pgactive\_backlog\_%';]),
+	'0', 'temporary copy is dropped');
+
+my ($ret, $stdout, $stderr) = $node_0->psql($pgactive_test_dbname, q[
+	SELECT * FROM pgactive.pgactive_backlog_summary('no_such_slot');]);
+like($stderr, qr/replication slot "no_such_slot" does not exist/,
+	'unknown slot is rejected');
+
+# The temporary copy uses the pgactive output plugin too, but isn't taken for
+# the slot of a peer node while a summary decodes from it.
+$node_0->safe_psql($pgactive_test_dbname, q[
+	INSERT INTO backlog_a SELECT g, 'w' FROM generate_series(101, 2000000) g;]);
+
+my ($bg_stdout, $bg_stderr) = ('', '');
+my $summary = IPC::Run::start(
+	[ 'psql', '-X', '-v', 'ON_ERROR_STOP=1',
+	  '-c', qq[SELECT count(*) FROM pgactive.pgactive_backlog_summary('$slot')],
+	  $node_0->connstr($pgactive_test_dbname) ],
+	'1>', \$bg_stdout, '2>', \$bg_stderr);
+
+ok($node_0->poll_query_until($pgactive_test_dbname, q[
+	SELECT count(*) > 0 FROM pg_catalog.pg_replication_slots
+	WHERE slot_name LIKE 'pgactive\_backlog\_%' AND active;]),
+	'summary is decoding from its copy');
+is($node_0->safe_psql($pgactive_test_dbname, q[
+	SELECT string_agg(node_name, ',') FROM pgactive.pgactive_node_slots;]),
+	'node_1', 'node slots view works while a summary runs');
+
+$summary->finish;
+is($summary->result, 0, 'summary finished');
+
+$node_1->safe_psql($pgactive_test_dbname, q[SELECT pgactive.pgactive_apply_resume();]);
+wait_for_apply($node_0, $node_1);
+
+is($node_0->safe_psql($pgactive_test_dbname, qq[
+	SELECT count(*) FROM pgactive.pgactive_backlog_summary('$slot')
+	WHERE kind = 'relation' AND relation::text LIKE 'backlog_%';]),
+	'0', 'nothing pending once applied');
+
+done_testing();
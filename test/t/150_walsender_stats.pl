@@ -0,0 +1,57 @@
+#!/usr/bin/env perl
+#
+# Test the decoding statistics of the walsenders.
+#
+use strict;
+use warnings;
+use lib 'test/t/';
+use Cwd;
+use Config;
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+use utils::nodemanagement;
+
+my $nodes = make_pgactive_group(2, 'node_');
+my ($node_0, $node_1) = @$nodes;
+
+exec_ddl($node_0, q[CREATE TABLE public.walsender_test(id integer primary key, v text);]);
+wait_for_apply($node_0, $node_1);
+
+is($node_0->safe_psql($pgactive_test_dbname, q[
+	SELECT count(*) FROM pgactive.pgactive_walsender_stats WHERE node_name = 'node_1';]),
+	'1', 'one row for the walsender to the peer');
+
+my $before = $node_0->safe_psql($pgactive_test_dbname, q[
+	SELECT changes_sent, changes_filtered_origin
+	FROM pgactive.pgactive_walsender_stats WHERE node_name = 'node_1';]);
+my ($sent_before, $filtered_before) = split /\|/, $before;
+
+# Sent from node_0 to node_1.
+$node_0->safe_psql($pgactive_test_dbname, q[
+	INSERT INTO walsender_test SELECT g, 'a' FROM generate_series(1, 50) g;]);
+wait_for_apply($node_0, $node_1);
+
+# Applied on node_0, then decoded but not sent back by its walsender.
+$node_1->safe_psql($pgactive_test_dbname, q[
+	INSERT INTO walsender_test SELECT g, 'b' FROM generate_series(51, 80) g;]);
+wait_for_apply($node_1, $node_0);
+wait_for_apply($node_0, $node_1);
+
+is($node_0->safe_psql($pgactive_test_dbname, qq[
+	SELECT changes_sent - $sent_before >= 50,
+	       changes_filtered_origin - $filtered_before >= 30,
+	       xacts_sent > 0 AND xacts_filtered > 0,
+	       changes_decoded >= changes_sent + changes_filtered_origin + changes_filtered_repset
+	FROM pgactive.pgactive_walsender_stats WHERE node_name = 'node_1';]),
+	't|t|t|t', 'changes are counted as sent or filtered');
+
+is($node_0->safe_psql($pgactive_test_dbname, q[
+	SELECT bytes_sent > 0,
+	       bytes_binary + bytes_sendrecv + bytes_text > 0,
+	       bytes_binary + bytes_sendrecv + bytes_text < bytes_sent,
+	       encode_time > 0
+	FROM pgactive.pgactive_walsender_stats WHERE node_name = 'node_1';]),
+	't|t|t|t', 'bytes and encode time are counted');
+
+done_testing();
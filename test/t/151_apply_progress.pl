@@ -0,0 +1,74 @@
+#!/usr/bin/env perl
+#
+# Test the progress reporting of the transaction being applied.
+#
+use strict;
+use warnings;
+use lib 'test/t/';
+use Cwd;
+use Config;
+use IPC::Run;
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+use utils::nodemanagement;
+
+my $nodes = make_pgactive_group(2, 'node_');
+my ($node_0, $node_1) = @$nodes;
+
+exec_ddl($node_0, q[CREATE TABLE public.progress_test(id integer primary key, v text);]);
+$node_0->safe_psql($pgactive_test_dbname, q[
+	INSERT INTO progress_test SELECT g, 'a' FROM generate_series(1, 100) g;]);
+wait_for_apply($node_0, $node_1);
+
+is($node_1->safe_psql($pgactive_test_dbname, q[
+	SELECT count(*) FROM pgactive.pgactive_stat_progress_apply;]),
+	'0', 'nothing reported between transactions');
+
+# Hold a row lock on node_1 so that apply of an update of all rows stalls
+# part way through.
+my ($stdout, $stderr) = ('', '');
+my $handle = IPC::Run::start(
+	[ 'psql', '-X',
+	  '-c', q[BEGIN],
+	  '-c', q[SELECT * FROM progress_test WHERE id = 100 FOR UPDATE],
+	  '-c', q[SELECT pg_sleep(30)],
+	  '-c', q[COMMIT],
+	  $node_1->connstr($pgactive_test_dbname) ],
+	'1>', \$stdout, '2>', \$stderr);
+ok($node_1->poll_query_until($pgactive_test_dbname, q[
+	SELECT count(*) > 0 FROM pg_catalog.pg_locks l
+	JOIN pg_catalog.pg_class c ON c.oid = l.relation
+	WHERE c.relname = 'progress_test' AND l.mode = 'RowShareLock';]),
+	'row lock taken');
+
+$node_0->safe_psql($pgactive_test_dbname, q[UPDATE progress_test SET v = 'b';]);
+my $xid = $node_0->safe_psql($pgactive_test_dbname, q[
+	SELECT xmin FROM progress_test WHERE id = 1;]);
+
+ok($node_1->poll_query_until($pgactive_test_dbname, q[
+	SELECT count(*) = 1 FROM pgactive.pgactive_stat_progress_apply
+	WHERE node_name = 'node_0' AND current_relation = 'progress_test'::regclass;]),
+	'transaction being applied is reported');
+
+is($node_1->safe_psql($pgactive_test_dbname, qq[
+	SELECT xid = '$xid', changes_total >= 100, changes_done < 100,
+	       changes_done = inserts + updates + deletes, inserts = 0 AND deletes = 0,
+	       elapsed >= interval '0', commit_timestamp <= started_at
+	FROM pgactive.pgactive_stat_progress_apply WHERE node_name = 'node_0';]),
+	't|t|t|t|t|t|t', 'progress of the transaction is reported');
+
+$node_1->safe_psql($pgactive_test_dbname, q[
+	SELECT pg_terminate_backend(pid) FROM pg_catalog.pg_stat_activity
+	WHERE query = 'SELECT pg_sleep(30)';]);
+$handle->finish;
+wait_for_apply($node_0, $node_1);
+
+is($node_1->safe_psql($pgactive_test_dbname, q[
+	SELECT count(*) FROM pgactive.pgactive_stat_progress_apply;]),
+	'0', 'progress is cleared at commit');
+is($node_1->safe_psql($pgactive_test_dbname, q[
+	SELECT count(*) FROM progress_test WHERE v = 'b';]),
+	'100', 'transaction is applied');
+
+done_testing();
@@ -0,0 +1,69 @@
+#!/usr/bin/env perl
+#
+# Test sampling of conflict logging.
+#
+use strict;
+use warnings;
+use lib 'test/t/';
+use Cwd;
+use Config;
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+use utils::nodemanagement;
+
+my $nodes = make_pgactive_group(2, 'node_');
+my ($node_0, $node_1) = @$nodes;
+
+exec_ddl($node_0, q[CREATE TABLE public.sample_test(id integer primary key, v text);]);
+wait_for_apply($node_0, $node_1);
+
+foreach my $node ($node_0, $node_1)
+{
+	$node->safe_psql($pgactive_test_dbname, q[
+		ALTER SYSTEM SET pgactive.log_conflicts_to_table = on;
+		ALTER SYSTEM SET pgactive.log_conflicts_to_logfile = on;
+		ALTER SYSTEM SET pgactive.conflict_logging_sample_limit = 5;
+		ALTER SYSTEM SET pgactive.conflict_logging_sample_interval = '2s';
+		SELECT pg_reload_conf();]);
+}
+
+my $logstart_1 = get_log_size($node_1);
+
+# Insert the same keys on both nodes while neither applies the other's
+# changes, for a storm of INSERT/INSERT conflicts once they do.
+foreach my $node ($node_0, $node_1)
+{
+	$node->safe_psql($pgactive_test_dbname, q[SELECT pgactive.pgactive_apply_pause();]);
+}
+$node_0->safe_psql($pgactive_test_dbname, q[
+	INSERT INTO sample_test SELECT g, 'a' FROM generate_series(1, 20) g;]);
+$node_1->safe_psql($pgactive_test_dbname, q[
+	INSERT INTO sample_test SELECT g, 'b' FROM generate_series(1, 20) g;]);
+foreach my $node ($node_0, $node_1)
+{
+	$node->safe_psql($pgactive_test_dbname, q[SELECT pgactive.pgactive_apply_resume();]);
+}
+wait_for_apply($node_0, $node_1);
+wait_for_apply($node_1, $node_0);
+
+is($node_1->safe_psql($pgactive_test_dbname, q[
+	SELECT count(*) FROM pgactive.pgactive_conflict_history
+	WHERE object_name = 'sample_test'
+	  AND local_node_sysid = (pgactive.pgactive_get_local_nodeid()).sysid;]),
+	'5', 'only the sampled conflicts are logged to the table');
+
+ok(find_in_log($node_1,
+	qr/CONFLICT: 15 more insert_insert conflicts on public\.sample_test in the last \d+ seconds were not logged/,
+	$logstart_1),
+	'summary of the other conflicts is logged');
+ok(find_in_log($node_1,
+	qr/DETAIL:\s+5 conflicts were logged in full\. Resolutions: last_update_wins_keep_\w+ \d+.*Sample keys: \(id=\d+\)/,
+	$logstart_1),
+	'summary has resolutions and sample keys');
+
+my $full = () = slurp_file($node_1->logfile, $logstart_1) =~
+	/CONFLICT: remote INSERT: row was previously INSERTed/g;
+is($full, 5, 'only the sampled conflicts are logged in full');
+
+done_testing();
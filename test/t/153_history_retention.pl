@@ -0,0 +1,113 @@
+#!/usr/bin/env perl
+#
+# Test pruning of the pgactive history tables.
+#
+use strict;
+use warnings;
+use lib 'test/t/';
+use Cwd;
+use Config;
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+use utils::nodemanagement;
+
+my $nodes = make_pgactive_group(2, 'node_');
+my ($node_0, $node_1) = @$nodes;
+
+# DDL queued on node_0 itself, and DDL it applied from node_1.
+exec_ddl($node_0, q[CREATE TABLE public.retention_a(id integer primary key);]);
+wait_for_apply($node_0, $node_1);
+exec_ddl($node_1, q[CREATE TABLE public.retention_b(id integer primary key);]);
+wait_for_apply($node_1, $node_0);
+
+my $count_query = q[
+	SELECT count(*) FROM pgactive.pgactive_queued_commands
+	WHERE command LIKE '%retention\_%'];
+
+is($node_0->safe_psql($pgactive_test_dbname, $count_query), '2',
+	'node_0 has queued both commands');
+my $count_1 = $node_1->safe_psql($pgactive_test_dbname, $count_query);
+
+sleep(2);
+
+$node_0->safe_psql($pgactive_test_dbname, q[
+	ALTER SYSTEM SET pgactive.queued_commands_retention = '1s';
+	SELECT pg_reload_conf();]);
+
+ok($node_0->poll_query_until($pgactive_test_dbname,
+	qq[SELECT ($count_query) = 0;]),
+	'expired commands are pruned');
+
+wait_for_apply($node_0, $node_1);
+is($node_1->safe_psql($pgactive_test_dbname, $count_query), $count_1,
+	'pruning is not replicated');
+
+# Pruning doesn't get in the way of DDL replication.
+exec_ddl($node_0, q[CREATE TABLE public.retention_c(id integer primary key);]);
+wait_for_apply($node_0, $node_1);
+is($node_1->safe_psql($pgactive_test_dbname, q[
+	SELECT count(*) FROM pg_catalog.pg_class WHERE relname = 'retention_c';]),
+	'1', 'DDL is still replicated');
+
+# Conflict history is pruned by age.
+exec_ddl($node_0, q[CREATE TABLE public.retention_conflict(id integer primary key, v text);]);
+wait_for_apply($node_0, $node_1);
+
+foreach my $node ($node_0, $node_1)
+{
+	$node->safe_psql($pgactive_test_dbname, q[
+		ALTER SYSTEM SET pgactive.log_conflicts_to_table = on;
+		SELECT pg_reload_conf();]);
+}
+
+foreach my $node ($node_0, $node_1)
+{
+	$node->safe_psql($pgactive_test_dbname, q[SELECT pgactive.pgactive_apply_pause();]);
+}
+$node_0->safe_psql($pgactive_test_dbname, q[
+	INSERT INTO retention_conflict SELECT g, 'a' FROM generate_series(1, 5) g;]);
+$node_1->safe_psql($pgactive_test_dbname, q[
+	INSERT INTO retention_conflict SELECT g, 'b' FROM generate_series(1, 5) g;]);
+foreach my $node ($node_0, $node_1)
+{
+	$node->safe_psql($pgactive_test_dbname, q[SELECT pgactive.pgactive_apply_resume();]);
+}
+wait_for_apply($node_0, $node_1);
+wait_for_apply($node_1, $node_0);
+
+my $conflict_query = q[
+	SELECT count(*) FROM pgactive.pgactive_conflict_history
+	WHERE object_name = 'retention_conflict'];
+cmp_ok($node_1->safe_psql($pgactive_test_dbname, $conflict_query), '>', 0,
+	'node_1 has logged the conflicts');
+
+# Queued drops are pruned by age only, confirmed by the peers or not: one
+# row past its retention, and a younger one at a position no slot has
+# confirmed. They're not replicated, as node_0 would run the drops.
+{
+	local $ENV{PGOPTIONS} = '-c pgactive.do_not_replicate=on';
+	$node_1->safe_psql($pgactive_test_dbname, q[
+		INSERT INTO pgactive.pgactive_queued_drops VALUES
+			(pg_current_wal_lsn(), now() - interval '2 hours', '{}'),
+			('FFFFFFFF/0', now(), '{}');]);
+}
+
+sleep(2);
+
+$node_1->safe_psql($pgactive_test_dbname, q[
+	ALTER SYSTEM SET pgactive.conflict_history_retention = '1s';
+	ALTER SYSTEM SET pgactive.queued_drops_retention = '1h';
+	SELECT pg_reload_conf();]);
+
+ok($node_1->poll_query_until($pgactive_test_dbname,
+	qq[SELECT ($conflict_query) = 0;]),
+	'expired conflicts are pruned');
+ok($node_1->poll_query_until($pgactive_test_dbname, q[
+	SELECT count(*) = 1 FROM pgactive.pgactive_queued_drops;]),
+	'expired drops are pruned');
+is($node_1->safe_psql($pgactive_test_dbname, q[
+	SELECT lsn FROM pgactive.pgactive_queued_drops;]),
+	'FFFFFFFF/0', 'unconfirmed drop within its retention is kept');
+
+done_testing();
@@ -0,0 +1,79 @@
+#!/usr/bin/env perl
+#
+# Test that a node joins a group of more than two nodes when one of the peers
+# still has the replication slot for it from an earlier join attempt, which
+# errored out before recording the slot's local replication identifier.
+#
+use strict;
+use warnings;
+use lib 'test/t/';
+use Cwd;
+use Config;
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+use utils::nodemanagement;
+
+my $nodes = make_pgactive_group(2, 'node_');
+my ($node_0, $node_1) = @$nodes;
+
+my $node_2 = PostgreSQL::Test::Cluster->new('node_2');
+initandstart_node($node_2);
+
+# Leave node_2's slot behind on node_1, the peer it isn't joining through.
+my $node_2_id = $node_2->safe_psql($pgactive_test_dbname, q[
+	SELECT s.system_identifier || '_' || c.timeline_id || '_' || d.oid
+	FROM pg_catalog.pg_control_system() s, pg_catalog.pg_control_checkpoint() c,
+		 pg_catalog.pg_database d
+	WHERE d.datname = pg_catalog.current_database()]);
+my $node_1_dboid = $node_1->safe_psql($pgactive_test_dbname, q[
+	SELECT oid FROM pg_catalog.pg_database
+	WHERE datname = pg_catalog.current_database()]);
+my $slot_name = "pgactive_${node_1_dboid}_${node_2_id}__";
+
+$node_1->safe_psql($pgactive_test_dbname,
+	qq[SELECT pg_catalog.pg_create_logical_replication_slot('$slot_name', 'pgactive')]);
+
+my $logstart = get_log_size($node_2);
+
+pgactive_logical_join($node_2, $node_0);
+check_join_status($node_2, $node_0);
+check_join_status($node_2, $node_1);
+
+ok(find_in_log($node_2,
+	qr/reusing replication slot "$slot_name" on node .* left behind by an earlier attempt/,
+	$logstart),
+	'joining node reused the slot left behind on node_1');
+
+is($node_1->safe_psql($pgactive_test_dbname,
+	qq[SELECT count(*) FROM pg_catalog.pg_replication_slots WHERE slot_name = '$slot_name']),
+	'1', 'node_1 has a single slot for node_2');
+
+# Changes from every node reach all three.
+exec_ddl($node_0, q[CREATE TABLE public.leftover_slot(id integer primary key, node text);]);
+wait_for_apply($node_0, $node_1);
+wait_for_apply($node_0, $node_2);
+
+push @$nodes, $node_2;
+foreach my $node (@$nodes)
+{
+	my $name = $node->name();
+	$node->safe_psql($pgactive_test_dbname,
+		qq[INSERT INTO public.leftover_slot(id, node) VALUES (@{[ $node->port ]}, '$name')]);
+}
+foreach my $node (@$nodes)
+{
+	foreach my $peer (@$nodes)
+	{
+		wait_for_apply($node, $peer) if $node != $peer;
+	}
+}
+foreach my $node (@$nodes)
+{
+	is($node->safe_psql($pgactive_test_dbname,
+		q[SELECT string_agg(node, ',' ORDER BY node) FROM public.leftover_slot]),
+		'node_0,node_1,node_2',
+		'changes from all nodes replicated to ' . $node->name());
+}
+
+done_testing();